@@ -11,6 +11,7 @@ from test_framework.test_framework import BilliecoinTestFramework
 from test_framework.util import *
 import zmq
 import binascii
+import struct
 
 try:
     import http.client as httplib
@@ -24,6 +25,7 @@ except ImportError:
 class ZMQTest (BilliecoinTestFramework):
 
     port = 28370
+    servicePort = 28371
 
     def setup_nodes(self):
         self.zmqContext = zmq.Context()
@@ -31,8 +33,15 @@ class ZMQTest (BilliecoinTestFramework):
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashblock")
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashtx")
         self.zmqSubSocket.connect("tcp://127.0.0.1:%i" % self.port)
+        # service events go to a socket of their own so the block and tx messages above stay in order
+        self.zmqServiceSocket = self.zmqContext.socket(zmq.SUB)
+        self.zmqServiceSocket.setsockopt(zmq.SUBSCRIBE, b"aliasrecord")
+        self.zmqServiceSocket.setsockopt(zmq.SUBSCRIBE, b"aliashistory")
+        self.zmqServiceSocket.setsockopt(zmq.RCVTIMEO, 60000)
+        self.zmqServiceSocket.connect("tcp://127.0.0.1:%i" % self.servicePort)
         return start_nodes(4, self.options.tmpdir, extra_args=[
-            ['-zmqpubhashtx=tcp://127.0.0.1:'+str(self.port), '-zmqpubhashblock=tcp://127.0.0.1:'+str(self.port)],
+            ['-zmqpubhashtx=tcp://127.0.0.1:'+str(self.port), '-zmqpubhashblock=tcp://127.0.0.1:'+str(self.port),
+             '-zmqpubaliasrecord=tcp://127.0.0.1:'+str(self.servicePort), '-zmqpubaliashistory=tcp://127.0.0.1:'+str(self.servicePort)],
             [],
             [],
             []
@@ -85,6 +94,50 @@ class ZMQTest (BilliecoinTestFramework):
 
         assert_equal(hashRPC, hashZMQ) #blockhash from generate must be equal to the hash received over zmq
 
+        self.test_service_events()
+
+    def send_alias(self, name):
+        res = self.nodes[0].aliasnew(name, "public", 3, 0, "", "", "", "")
+        res = self.nodes[0].billiecointxfund(res[0])
+        res = self.nodes[0].signrawtransaction(res[0])
+        self.nodes[0].billiecoinsendrawtransaction(res["hex"])
+
+    def recv_service_event(self):
+        msg = self.zmqServiceSocket.recv_multipart()
+        assert_equal(len(msg), 3)
+        topic = msg[0]
+        body = msg[1]
+        seq = struct.unpack('<I', msg[2])[0]
+        return topic, body, seq
+
+    def test_service_events(self):
+        # an alias is registered, then activated once the registration is confirmed
+        name = "zmqalias"
+        self.send_alias(name)
+        self.nodes[0].generate(5)
+        self.send_alias(name)
+        self.nodes[0].generate(1)
+        self.sync_all()
+
+        print "listen for service events..."
+        events = {}
+        while b"aliasrecord" not in events or b"aliashistory" not in events:
+            topic, body, seq = self.recv_service_event()
+            events.setdefault(topic, []).append((body, seq))
+
+        for topic in (b"aliasrecord", b"aliashistory"):
+            body, seq = events[topic][0]
+            # the first event of each topic, counted per topic
+            assert_equal(seq, 0)
+            # the layout version leads the payload, the alias record follows in its network serialization
+            assert_equal(ord(body[0:1]), 1)
+            assert(name.encode() in body)
+
+        # later events of a topic carry the next sequence numbers
+        for topic in events:
+            seqs = [seq for body, seq in events[topic]]
+            assert_equal(seqs, list(range(len(seqs))))
+
 
 if __name__ == '__main__':
     ZMQTest ().main ()
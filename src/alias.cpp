@@ -37,6 +37,9 @@
 #include "consensus/validation.h"
 #include "spork.h"
 #include "script/sign.h"
+#include "serviceevent.h"
+#include "servicepayload.h"
+#include "memusage.h"
 using namespace std;
 CAliasDB *paliasdb = NULL;
 COfferDB *pofferdb = NULL;
@@ -223,7 +226,7 @@ bool IsBilliecoinDataOutput(const CTxOut& out) {
    return false;
 }
 
-bool CheckAliasInputs(const CCoinsViewCache &inputs, const CTransaction &tx, int op, const vector<vector<unsigned char> > &vvchArgs, bool fJustCheck, int nHeight, string &errorMessage, bool bSanityCheck) {
+bool CheckAliasInputs(const CCoinsViewCache &inputs, const CTransaction &tx, const CServicePayload &payload, int op, const CServiceArgs &vvchArgs, bool fJustCheck, int nHeight, string &errorMessage, bool bSanityCheck) {
 	if (!paliasdb)
 		return false;
 	if (tx.IsCoinBase() && !fJustCheck && !bSanityCheck)
@@ -241,28 +244,15 @@ bool CheckAliasInputs(const CCoinsViewCache &inputs, const CTransaction &tx, int
 	int prevOp = 0;
 	vector<vector<unsigned char> > vvchPrevArgs;
 
-	// unserialize alias from txn, check for valid
+	// the alias from the data output, decoded with the payload. If there is more than just an
+	// alias script output for this tx its not an alias update
 	CAliasIndex theAlias;
-	vector<unsigned char> vchData;
 	vector<unsigned char> vchAlias;
-	vector<unsigned char> vchHash;
-	int nDataOut;
-	bool aliasData = true;
-	// check to see if there is more than just an alias script output for this tx, if so its not an alias update
-	for (unsigned int i = 0; i < tx.vout.size(); i++) {
-		int pop;
-		if (!FindBilliecoinScriptOp(tx.vout[i].scriptPubKey, pop))
-			continue;
-		if (pop != OP_BILLIECOIN_ALIAS) {
-			aliasData = false;
-		}
-	}
-	// if it has alias data, get it and unserialize the alias from data output
-	if (aliasData) {
-		bool bData = GetBilliecoinData(tx, vchData, vchHash, nDataOut);
-		if (bData)
-			theAlias.UnserializeFromData(vchData, vchHash);
-	}
+	static const vector<unsigned char> vchNoHash;
+	const vector<unsigned char> &vchHash = payload.fOtherServiceOutput ? vchNoHash : payload.vchDataHash;
+	const int nDataOut = payload.nDataOut;
+	if (!payload.fOtherServiceOutput && payload.alias)
+		theAlias = *payload.alias;
 	if(fJustCheck)
 	{
 		
@@ -754,41 +744,22 @@ void CAliasIndex::Serialize(vector<unsigned char>& vchData) {
 }
 
 // TODO: need to cleanout CTxOuts (transactions stored on disk) which have data stored in them after expiry, erase at same time on startup so pruning can happen properly
-bool CAliasDB::CleanupDatabase(int &servicesCleaned)
+bool CAliasDB::CleanupDatabase(const vector<unsigned char>& vchAlias, const uint64_t nExpireTime, int &servicesCleaned)
 {
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
-	CAliasIndex txPos;
-	pair<string, vector<unsigned char> > key;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
-			if (pcursor->GetKey(key) && key.first == "namei") {
-				pcursor->GetValue(txPos);
-  				if (chainActive.Tip()->GetMedianTimePast() >= txPos.nExpireTime)
-				{
-					servicesCleaned++;
-					EraseAlias(key.second, true);
-				} 
-				
-            }
-			else if (pcursor->GetKey(key) && key.first == "namea") {
-				vector<unsigned char> value;
-				CAliasIndex alias;
-				pcursor->GetValue(value);
-				if (GetAlias(value, alias) && chainActive.Tip()->GetMedianTimePast() >= alias.nExpireTime)
-				{
-					servicesCleaned++;
-					EraseAddress(alias.vchAddress);
-				}
-
-			}
-            pcursor->Next();
-        } catch (std::exception &e) {
-            return error("%s() : deserialize error", __PRETTY_FUNCTION__);
-        }
-    }
-	return true;
+	CDBBatch batch(*this);
+	CAliasIndex alias;
+	if (!ReadAlias(vchAlias, alias) || alias.nExpireTime != nExpireTime) {
+		// the entry outlived its record, drop it so that it does not hold up the aliases expiring after it
+		serviceIndex.EraseExpiry(batch, vchAlias, nExpireTime);
+		return WriteBatch(batch);
+	}
+	serviceIndex.Erase(batch, vchAlias);
+	// the address may have moved on to another alias since
+	vector<unsigned char> vchName;
+	if (ReadAddress(alias.vchAddress, vchName) && vchName == vchAlias)
+		batch.Erase(make_pair(string("namea"), alias.vchAddress));
+	servicesCleaned++;
+	return WriteBatch(batch);
 }
 bool FlushBilliecoinDBs() {
 	{
@@ -847,10 +818,8 @@ bool FlushBilliecoinDBs() {
 		}
 	}
 	{
-		LOCK(cs_assetallocationindex);
 		if (passetallocationtransactionsdb != NULL)
 		{
-			passetallocationtransactionsdb->WriteAssetAllocationWalletIndex(AssetAllocationIndex);
 			if (!passetallocationtransactionsdb->Flush()) {
 				LogPrintf("Failed to write to asset allocation transactions database!");
 				return false;
@@ -859,18 +828,88 @@ bool FlushBilliecoinDBs() {
 	}
 	return true;
 }
+// offers, certs and escrows expire with their aliases, so the expired aliases lead to everything there is to prune
+bool PruneBilliecoinServices(const size_t nMaxAliases, int &servicesCleaned, bool &fDone)
+{
+	LOCK(cs_main);
+	fDone = true;
+	if (paliasdb == NULL || chainActive.Tip() == NULL)
+		return false;
+	vector<pair<uint64_t, vector<unsigned char> > > vExpired;
+	if (!paliasdb->GetExpiredAliases(chainActive.Tip()->GetMedianTimePast(), nMaxAliases, vExpired))
+		return false;
+	fDone = vExpired.size() < nMaxAliases;
+	for (const pair<uint64_t, vector<unsigned char> >& expired : vExpired) {
+		if (pofferdb != NULL && !pofferdb->CleanupDatabase(expired.second, servicesCleaned))
+			return false;
+		if (pescrowdb != NULL && !pescrowdb->CleanupDatabase(expired.second, servicesCleaned))
+			return false;
+		if (pcertdb != NULL && !pcertdb->CleanupDatabase(expired.second, servicesCleaned))
+			return false;
+		if (!paliasdb->CleanupDatabase(expired.second, expired.first, servicesCleaned))
+			return false;
+	}
+	return true;
+}
+// the records of owners that have no alias in the expiry index, such as aliases pruned before the index existed
+template<typename DB>
+static bool PruneOrphanedServices(DB* pdb, int &servicesCleaned)
+{
+	vector<unsigned char> vchAfter;
+	bool fDone = pdb == NULL;
+	while (!fDone) {
+		boost::this_thread::interruption_point();
+		LOCK(cs_main);
+		if (paliasdb == NULL || chainActive.Tip() == NULL)
+			return false;
+		vector<vector<unsigned char> > vOwners;
+		if (!pdb->GetOwners(vchAfter, SERVICE_PRUNE_BATCH, vOwners))
+			return false;
+		fDone = vOwners.size() < SERVICE_PRUNE_BATCH;
+		for (const vector<unsigned char>& vchOwner : vOwners) {
+			CAliasIndex alias;
+			if ((!paliasdb->ReadAlias(vchOwner, alias) || alias.nExpireTime == 0) && !pdb->CleanupDatabase(vchOwner, servicesCleaned))
+				return false;
+		}
+		if (!vOwners.empty())
+			vchAfter = vOwners.back();
+	}
+	return true;
+}
+bool PruneOrphanedBilliecoinServices(int &servicesCleaned)
+{
+	return PruneOrphanedServices(pofferdb, servicesCleaned) && PruneOrphanedServices(pescrowdb, servicesCleaned) && PruneOrphanedServices(pcertdb, servicesCleaned);
+}
 void CleanupBilliecoinServiceDatabases(int &numServicesCleaned)
 {
-	if(pofferdb != NULL)
-		pofferdb->CleanupDatabase(numServicesCleaned);
-	if(pescrowdb!= NULL)
-		pescrowdb->CleanupDatabase(numServicesCleaned);
-	if(pcertdb!= NULL)
-		pcertdb->CleanupDatabase(numServicesCleaned);
-	if (paliasdb != NULL) 
-		paliasdb->CleanupDatabase(numServicesCleaned);
+	// release cs_main between batches so that block processing is not held up by a large backlog
+	bool fDone = false;
+	while (!fDone) {
+		boost::this_thread::interruption_point();
+		if (!PruneBilliecoinServices(SERVICE_PRUNE_BATCH, numServicesCleaned, fDone))
+			break;
+	}
+	PruneOrphanedBilliecoinServices(numServicesCleaned);
 	FlushBilliecoinDBs();
 }
+void PruneBilliecoinServicesMaintenance()
+{
+	// the owners without an expiry entry are walked once, whatever is orphaned later is pruned with its alias
+	static bool fOrphansPruned = false;
+	if (IsInitialBlockDownload() || ShutdownRequested())
+		return;
+	int servicesCleaned = 0;
+	bool fDone;
+	if (!PruneBilliecoinServices(SERVICE_PRUNE_BATCH, servicesCleaned, fDone))
+		LogPrintf("%s: failed to prune expired services\n", __func__);
+	else if (!fOrphansPruned) {
+		fOrphansPruned = PruneOrphanedBilliecoinServices(servicesCleaned);
+		if (!fOrphansPruned)
+			LogPrintf("%s: failed to prune services without an expiring alias\n", __func__);
+	}
+	if (servicesCleaned > 0)
+		LogPrint("billiecoin", "%s: pruned %d expired services\n", __func__, servicesCleaned);
+}
 bool GetAlias(const vector<unsigned char> &vchAlias,
 	CAliasIndex& txPos) {
 	if (!paliasdb || !paliasdb->ReadAlias(vchAlias, txPos)) {
@@ -902,12 +941,10 @@ bool GetAliasFromAddress(const std::string& strAddress, std::string& strAlias, s
 
 	vector<unsigned char> vchAddress;
 	DecodeBase58(strAddress, vchAddress);
-	if (!paliasdb || !paliasdb->ExistsAddress(vchAddress))
-		return false;
 
 	// check for alias address mapping existence in DB
 	vector<unsigned char> vchAlias;
-	if (!paliasdb->ReadAddress(vchAddress, vchAlias))
+	if (!paliasdb || !paliasdb->ReadAddress(vchAddress, vchAlias))
 		return false;
 	if (vchAlias.empty())
 		return false;
@@ -1127,122 +1164,82 @@ bool CheckParam(const UniValue& params, const unsigned int index)
 }
 
 void CAliasDB::WriteAliasIndex(const CAliasIndex& alias, const int &op) {
-	if (IsArgSet("-zmqpubaliasrecord")) {
-		UniValue oName(UniValue::VOBJ);
-		oName.push_back(Pair("_id", stringFromVch(alias.vchAlias)));
-		CBilliecoinAddress address(EncodeBase58(alias.vchAddress));
-		oName.push_back(Pair("address", address.ToString()));
-		oName.push_back(Pair("expires_on", alias.nExpireTime));
-		oName.push_back(Pair("encryption_privatekey", HexStr(alias.vchEncryptionPrivateKey)));
-		oName.push_back(Pair("encryption_publickey", HexStr(alias.vchEncryptionPublicKey)));
-		GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "aliasrecord");
+	// notifications follow the alias write once it is committed
+	if (CDBStagedWrites::GetActive()) {
+		CDBStagedWrites::Defer(std::bind(&CAliasDB::WriteAliasIndex, this, alias, op));
+		return;
 	}
+	if (IsArgSet("-zmqpubaliasrecord"))
+		PublishServiceEvent("aliasrecord", alias);
 	WriteAliasIndexHistory(alias, op);
 }
 void CAliasDB::WriteAliasIndexHistory(const CAliasIndex& alias, const int &op) {
-	if (IsArgSet("-zmqpubaliashistory")) {
-		UniValue oName(UniValue::VOBJ);
-		BuildAliasIndexerHistoryJson(alias, oName);
-		oName.push_back(Pair("op", aliasFromOp(op)));
-		GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "aliashistory");
-	}
-}
-bool BuildAliasIndexerTxHistoryJson(const string &user1, const string &user2, const string &user3, const uint256 &txHash, const unsigned int& nHeight, const string &type, const string &guid, UniValue& oName)
-{
-	oName.push_back(Pair("_id", txHash.GetHex()+"-"+guid));
-	oName.push_back(Pair("user1", user1));
-	oName.push_back(Pair("user2", user2));
-	oName.push_back(Pair("user3", user3));
-	oName.push_back(Pair("type", type));
-	oName.push_back(Pair("height", (int)nHeight));
-	int64_t nTime = 0;
-	if (chainActive.Height() >= nHeight-1) {
-		CBlockIndex *pindex = chainActive[nHeight-1];
-		if (pindex) {
-			nTime = pindex->GetMedianTimePast();
-		}
-	}
-	oName.push_back(Pair("time", nTime));
-	return true;
+	if (IsArgSet("-zmqpubaliashistory"))
+		PublishServiceEvent("aliashistory", alias, (unsigned char)op);
 }
 void CAliasDB::WriteAliasIndexTxHistory(const string &user1, const string &user2, const string &user3, const uint256 &txHash, const unsigned int& nHeight, const string &type, const string &guid) {
-	if (IsArgSet("-zmqpubaliastxhistory")) {
-		UniValue oName(UniValue::VOBJ);
-		BuildAliasIndexerTxHistoryJson(user1, user2, user3, txHash, nHeight, type, guid, oName);
-		GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "aliastxhistory");
-	}
+	if (IsArgSet("-zmqpubaliastxhistory"))
+		PublishServiceEvent("aliastxhistory", txHash, nHeight, user1, user2, user3, type, guid);
 }
-UniValue BilliecoinListReceived(bool includeempty=true)
+struct CReceivedAddress {
+	string strAddress;
+	string strLabel;
+	bool fChange;
+};
+// rows go to ret as they are found, false without a wallet. The wallet is only locked while
+// its addresses are copied, the alias and balance lookups run on the copy
+bool BilliecoinListReceived(RPCResultArray& ret, bool includeempty=true)
 {
 	if (!pwalletMain)
-		return NullUniValue;
-	map<string, int> mapAddress;
-	UniValue ret(UniValue::VARR);
-	std::set<CKeyID> setKeyPool;
-	pwalletMain->GetAllReserveKeys(setKeyPool);
-	BOOST_FOREACH(const PAIRTYPE(CBilliecoinAddress, CAddressBookData)& item, pwalletMain->mapAddressBook)
+		return false;
+	vector<CReceivedAddress> vecAddresses;
 	{
-		const CBilliecoinAddress& address = item.first;
-		const string& strAccount = item.second.name;
+		std::set<CKeyID> setKeyPool;
+		pwalletMain->GetAllReserveKeys(setKeyPool);
+		LOCK2(cs_main, pwalletMain->cs_wallet);
+		set<string> setAddress;
+		BOOST_FOREACH(const PAIRTYPE(CBilliecoinAddress, CAddressBookData)& item, pwalletMain->mapAddressBook)
+		{
+			const CBilliecoinAddress& address = item.first;
+			isminefilter filter = ISMINE_SPENDABLE;
+			isminefilter mine = IsMine(*pwalletMain, address.Get());
+			if (!(mine & filter))
+				continue;
+			CReceivedAddress receivedAddress;
+			receivedAddress.strAddress = address.ToString();
+			receivedAddress.strLabel = item.second.name;
+			CKeyID keyid;
+			receivedAddress.fChange = address.GetKeyID(keyid) && !pwalletMain->mapAddressBook.count(keyid) && !setKeyPool.count(keyid);
+			setAddress.insert(receivedAddress.strAddress);
+			vecAddresses.push_back(receivedAddress);
+		}
 
-		isminefilter filter = ISMINE_SPENDABLE;
-		isminefilter mine = IsMine(*pwalletMain, address.Get());
-		if (!(mine & filter))
-			continue;
-		const string& strAddress = address.ToString();
+		vector<COutput> vecOutputs;
+		// include alias balances and alias outputs
+		pwalletMain->AvailableCoins(vecOutputs, true, NULL, includeempty, ALL_COINS, false, true, true);
+		BOOST_FOREACH(const COutput& out, vecOutputs) {
+			CTxDestination address;
+			if (!ExtractDestination(out.tx->tx->vout[out.i].scriptPubKey, address))
+				continue;
 
-		vector<unsigned char> vchMyAlias;
-		vector<unsigned char> vchAddress;
-		DecodeBase58(strAddress, vchAddress);
-		paliasdb->ReadAddress(vchAddress, vchMyAlias);
-		
-		UniValue paramsBalance(UniValue::VARR);
-		UniValue param(UniValue::VOBJ);
-		UniValue balanceParams(UniValue::VARR);
-		balanceParams.push_back(strAddress);
-		param.push_back(Pair("addresses", balanceParams));
-		paramsBalance.push_back(param);
-		JSONRPCRequest request;
-		request.params = paramsBalance;
-		const UniValue &resBalance = getaddressbalance(request);
-		UniValue obj(UniValue::VOBJ);
-		obj.push_back(Pair("address", strAddress));
-		const CAmount& nBalance = AmountFromValue(find_value(resBalance.get_obj(), "balance"));
-		if (includeempty || (!includeempty && nBalance > 0)) {
-			obj.push_back(Pair("balance", ValueFromAmount(nBalance)));
-			obj.push_back(Pair("label", strAccount));
-			obj.push_back(Pair("alias", stringFromVch(vchMyAlias)));
+			CBilliecoinAddress sysAddress(address);
+			CReceivedAddress receivedAddress;
+			receivedAddress.strAddress = sysAddress.ToString();
+			if (!setAddress.insert(receivedAddress.strAddress).second)
+				continue;
 			CKeyID keyid;
-			if (address.GetKeyID(keyid) && !pwalletMain->mapAddressBook.count(keyid) && !setKeyPool.count(keyid)) {
-				obj.push_back(Pair("change", true));
-			}
-			else
-				obj.push_back(Pair("change", false));
-			ret.push_back(obj);
+			receivedAddress.fChange = sysAddress.GetKeyID(keyid) && !pwalletMain->mapAddressBook.count(keyid) && !setKeyPool.count(keyid);
+			vecAddresses.push_back(receivedAddress);
 		}
-		mapAddress[strAddress] = 1;
 	}
 
-	vector<COutput> vecOutputs;
-	// include alias balances and alias outputs
-	pwalletMain->AvailableCoins(vecOutputs, true, NULL, includeempty, ALL_COINS, false, true, true);
-	BOOST_FOREACH(const COutput& out, vecOutputs) {
-		CTxDestination address;
-		if (!ExtractDestination(out.tx->tx->vout[out.i].scriptPubKey, address))
-			continue;
-
-		CBilliecoinAddress sysAddress(address);
-		const string& strAddress = sysAddress.ToString();
-
-		if (mapAddress.find(strAddress) != mapAddress.end())
-			continue;
-
-
+	for (const CReceivedAddress& receivedAddress : vecAddresses) {
+		const string& strAddress = receivedAddress.strAddress;
 		vector<unsigned char> vchMyAlias;
 		vector<unsigned char> vchAddress;
 		DecodeBase58(strAddress, vchAddress);
 		paliasdb->ReadAddress(vchAddress, vchMyAlias);
-	
+
 		UniValue paramsBalance(UniValue::VARR);
 		UniValue param(UniValue::VOBJ);
 		UniValue balanceParams(UniValue::VARR);
@@ -1252,25 +1249,18 @@ UniValue BilliecoinListReceived(bool includeempty=true)
 		JSONRPCRequest request;
 		request.params = paramsBalance;
 		const UniValue &resBalance = getaddressbalance(request);
-		UniValue obj(UniValue::VOBJ);
-		obj.push_back(Pair("address", strAddress));
 		const CAmount& nBalance = AmountFromValue(find_value(resBalance.get_obj(), "balance"));
-		if (includeempty || (!includeempty && nBalance > 0)) {
+		if (includeempty || nBalance > 0) {
+			UniValue obj(UniValue::VOBJ);
+			obj.push_back(Pair("address", strAddress));
 			obj.push_back(Pair("balance", ValueFromAmount(nBalance)));
-			obj.push_back(Pair("label", ""));
+			obj.push_back(Pair("label", receivedAddress.strLabel));
 			obj.push_back(Pair("alias", stringFromVch(vchMyAlias)));
-			CKeyID keyid;
-			if (sysAddress.GetKeyID(keyid) && !pwalletMain->mapAddressBook.count(keyid) && !setKeyPool.count(keyid)) {
-				obj.push_back(Pair("change", true));
-			}
-			else
-				obj.push_back(Pair("change", false));
+			obj.push_back(Pair("change", receivedAddress.fChange));
 			ret.push_back(obj);
 		}
-		mapAddress[strAddress] = 1;
-
 	}
-	return ret;
+	return true;
 }
 UniValue billiecointxfund_helper(const vector<unsigned char> &vchAlias, const vector<unsigned char> &vchWitness, const CRecipient &aliasRecipient, vector<CRecipient> &vecSend) {
 	CMutableTransaction txNew;
@@ -1412,8 +1402,9 @@ UniValue billiecointxfund(const JSONRPCRequest& request) {
 	else {
 		EnsureWalletIsUnlocked();
 		UniValue addressArray(UniValue::VARR);
-		UniValue receivedList = BilliecoinListReceived(false);
-		UniValue recevedListArray = receivedList.get_array();
+		RPCResultArray receivedRows;
+		BilliecoinListReceived(receivedRows, false);
+		UniValue recevedListArray = receivedRows.Finish();
 		for (unsigned int idx = 0; idx < recevedListArray.size(); idx++) {
 			if(find_value(recevedListArray[idx].get_obj(), "alias").get_str().empty())
 				addressArray.push_back(find_value(recevedListArray[idx].get_obj(), "address").get_str());
@@ -1424,15 +1415,14 @@ UniValue billiecointxfund(const JSONRPCRequest& request) {
 	bool fUseInstantSend = false;
 	if (params.size() > 2)
 		fUseInstantSend = params[2].get_bool();
-	UniValue paramsUTXO(UniValue::VARR);
-	paramsUTXO.push_back(addresses);
-	JSONRPCRequest request1;
-	request1.params = paramsUTXO;
-	const UniValue &resUTXOs = getaddressutxos(request1);
-	UniValue utxoArray(UniValue::VARR);
-	if (resUTXOs.isArray())
-		utxoArray = resUTXOs.get_array();
-	else
+	const UniValue &addressValues = find_value(addresses, "addresses");
+	if (!addressValues.isArray())
+		throw runtime_error("Addresses is expected to be an array");
+	vector<string> vecAddresses;
+	for (const UniValue& address : addressValues.getValues())
+		vecAddresses.push_back(address.get_str());
+	std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+	if (!GetAddressesUnspent(vecAddresses, unspentOutputs))
 		throw runtime_error("BILLIECOIN_ALIAS_RPC_ERROR: ERRCODE: 5501 - " + _("No funds found in addresses provided"));
 
 	// add total output amount of transaction to desired amount
@@ -1447,12 +1437,21 @@ UniValue billiecointxfund(const JSONRPCRequest& request) {
 	// get value of inputs
 	nCurrentAmount = view.GetValueIn(txIn_t);
 	
-	int op, aliasOp;
+	int aliasOp;
 	vector<vector<unsigned char> > vvch;
-	vector<vector<unsigned char> > vvchAlias;
-	if (tx.nVersion == BILLIECOIN_TX_VERSION && !DecodeAliasTx(tx, op, vvchAlias))
+	vector<vector<unsigned char> > vvchAliasInput;
+	CServicePayloadRef payload;
+	CServiceArgs vvchAlias;
+	if (tx.nVersion == BILLIECOIN_TX_VERSION)
 	{
-		FindAliasInTx(view, tx, vvchAlias);
+		payload = GetServicePayload(tx);
+		if (payload->fAliasOutput)
+			vvchAlias = payload->vvchAliasArgs;
+		else
+		{
+			FindAliasInTx(view, tx, vvchAliasInput);
+			vvchAlias = CServiceArgs(vvchAliasInput);
+		}
 	}
 	// # vin (with IX)*FEE + # vout*FEE + (10 + # vin)*FEE + 34*FEE (for change output)
 	CAmount nFees = GetFee(10 + 34);
@@ -1482,15 +1481,12 @@ UniValue billiecointxfund(const JSONRPCRequest& request) {
 			unsigned int unspentindex = 0;
 			LOCK(mempool.cs);
 			// fund with alias inputs first
-			for (unsigned int i = 0; i < utxoArray.size(); i++)
+			for (const auto& unspent : unspentOutputs)
 			{
-				const UniValue& utxoObj = utxoArray[i].get_obj();
-				const string &strTxid = find_value(utxoObj, "txid").get_str();
-				const uint256& txid = uint256S(strTxid);
-				const int& nOut = find_value(utxoObj, "outputIndex").get_int();
-				const std::vector<unsigned char> &data(ParseHex(find_value(utxoObj, "script").get_str()));
-				const CScript& scriptPubKey = CScript(data.begin(), data.end());
-				const CAmount &nValue = find_value(utxoObj, "finneas").get_int64();
+				const uint256& txid = unspent.first.txhash;
+				const int nOut = unspent.first.index;
+				const CScript& scriptPubKey = unspent.second.script;
+				const CAmount &nValue = unspent.second.finneas;
 				const CTxIn txIn(txid, nOut, scriptPubKey);
 				const COutPoint outPoint(txid, nOut);
 				if (std::find(tx.vin.begin(), tx.vin.end(), txIn) != tx.vin.end())
@@ -1526,15 +1522,12 @@ UniValue billiecointxfund(const JSONRPCRequest& request) {
 		// if after selecting alias inputs we are still not funded, we need to select alias balances to fund this transaction
 		if (nCurrentAmount < (nDesiredAmount + nFees)) {
 			LOCK(mempool.cs);
-			for (unsigned int i = 0; i < utxoArray.size(); i++)
+			for (const auto& unspent : unspentOutputs)
 			{
-				const UniValue& utxoObj = utxoArray[i].get_obj();
-				const string &strTxid = find_value(utxoObj, "txid").get_str();
-				const uint256& txid = uint256S(strTxid);
-				const int& nOut = find_value(utxoObj, "outputIndex").get_int();
-				const std::vector<unsigned char> &data(ParseHex(find_value(utxoObj, "script").get_str()));
-				const CScript& scriptPubKey = CScript(data.begin(), data.end());
-				const CAmount &nValue = find_value(utxoObj, "finneas").get_int64();
+				const uint256& txid = unspent.first.txhash;
+				const int nOut = unspent.first.index;
+				const CScript& scriptPubKey = unspent.second.script;
+				const CAmount &nValue = unspent.second.finneas;
 				const CTxIn txIn(txid, nOut, scriptPubKey);
 				const COutPoint outPoint(txid, nOut);
 				if (std::find(tx.vin.begin(), tx.vin.end(), txIn) != tx.vin.end())
@@ -2183,12 +2176,13 @@ UniValue billiecoindecoderawtransaction(const JSONRPCRequest& request) {
 	vector<unsigned char> vchData;
 	int nOut;
 	int op;
-	vector<vector<unsigned char> > vvch;
 	vector<unsigned char> vchHash;
 	GetBilliecoinData(rawTx, vchData, vchHash, nOut);	
 	UniValue output(UniValue::VOBJ);
 	char type;
-	if(DecodeAndParseBilliecoinTx(rawTx, op,  vvch, type))
+	// a raw transaction is decoded once here, it is not worth a place in the payload cache
+	const CServicePayload payload(rawTx);
+	if(payload.GetParsedType(op, type))
 		SysTxToJSON(op, vchData, vchHash, output, type);
 	
 	return output;
@@ -2335,6 +2329,30 @@ UniValue prunebilliecoinservices(const JSONRPCRequest& request)
 		LogPrintf("prunebilliecoinservices # cleaned: %d\n", servicesCleaned);
 	return res;
 }
+UniValue aliascacheinfo(const JSONRPCRequest& request)
+{
+	const UniValue &params = request.params;
+	if (request.fHelp || params.size() > 0)
+		throw runtime_error(
+			"aliascacheinfo\n"
+			"\nReturns the state of the caches of aliases and alias addresses read from the alias database.\n"
+			"\nResult:\n"
+			"{\n"
+			"  \"aliases\": {            (object) Aliases by name\n"
+			"    \"entries\": n,         (numeric) Aliases held\n"
+			"    \"usage\": n,           (numeric) Memory used in bytes\n"
+			"    \"hits\": n,            (numeric) Lookups answered from the cache\n"
+			"    \"misses\": n           (numeric) Lookups that read the database\n"
+			"  },\n"
+			"  \"addresses\": { ... }    (object) Alias names by address, with the same fields\n"
+			"}\n"
+			+ HelpExampleCli("aliascacheinfo", "")
+		);
+	UniValue res(UniValue::VOBJ);
+	if (paliasdb)
+		paliasdb->GetReadCacheInfo(res);
+	return res;
+}
 UniValue aliasbalancemulti(const JSONRPCRequest& request)
 {
 	const UniValue &params = request.params;
@@ -2392,20 +2410,8 @@ UniValue aliasbalance(const JSONRPCRequest& request)
 		return  res;
 	}
 	LOCK(cs_main);
-	const string &strAddressFrom = EncodeBase58(theAlias.vchAddress);
-	UniValue paramsUTXO(UniValue::VARR);
-	UniValue param(UniValue::VOBJ);
-	UniValue utxoParams(UniValue::VARR);
-	utxoParams.push_back(strAddressFrom);
-	param.push_back(Pair("addresses", utxoParams));
-	paramsUTXO.push_back(param);
-	JSONRPCRequest request1;
-	request1.params = paramsUTXO;
-	const UniValue &resUTXOs = getaddressutxos(request1);
-	UniValue utxoArray(UniValue::VARR);
-	if (resUTXOs.isArray())
-		utxoArray = resUTXOs.get_array();
-	else
+	std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+	if (!GetAddressesUnspent(vector<string>(1, EncodeBase58(theAlias.vchAddress)), unspentOutputs))
 	{
 		UniValue res(UniValue::VOBJ);
 		res.push_back(Pair("balance", ValueFromAmount(nAmount)));
@@ -2415,23 +2421,16 @@ UniValue aliasbalance(const JSONRPCRequest& request)
 		LOCK(mempool.cs);
 		int op;
 		vector<vector<unsigned char> > vvch;
-		for (unsigned int i = 0; i < utxoArray.size(); i++)
+		for (const auto& unspent : unspentOutputs)
 		{
-			const UniValue& utxoObj = utxoArray[i].get_obj();
-			const uint256& txid = uint256S(find_value(utxoObj, "txid").get_str());
-			const int& nOut = find_value(utxoObj, "outputIndex").get_int();
-			const std::vector<unsigned char> &data(ParseHex(find_value(utxoObj, "script").get_str()));
-			const CScript& scriptPubKey = CScript(data.begin(), data.end());
-			const CAmount &nValue = find_value(utxoObj, "finneas").get_int64();
-			const int& nHeight = find_value(utxoObj, "height").get_int();
-			const COutPoint outPoint(txid, nOut);
-			if (DecodeAliasScript(scriptPubKey, op, vvch))
+			const COutPoint outPoint(unspent.first.txhash, unspent.first.index);
+			if (DecodeAliasScript(unspent.second.script, op, vvch))
 				continue;
 			if (mempool.mapNextTx.find(outPoint) != mempool.mapNextTx.end())
 				continue;
 			if (!IsOutpointMature(outPoint, fUseInstantSend))
 				continue;
-			nAmount += nValue;
+			nAmount += unspent.second.finneas;
 
 		}
 	}
@@ -2491,64 +2490,31 @@ bool BuildAliasJson(const CAliasIndex& alias, UniValue& oName)
 	oName.push_back(Pair("expired", expired));
 	return true;
 }
-bool BuildAliasIndexerHistoryJson(const CAliasIndex& alias, UniValue& oName)
-{
-	oName.push_back(Pair("_id", alias.txHash.GetHex()));
-	oName.push_back(Pair("publicvalue", stringFromVch(alias.vchPublicValue)));
-	oName.push_back(Pair("alias", stringFromVch(alias.vchAlias)));
-	int64_t nTime = 0; 
-	if (chainActive.Height() >= alias.nHeight-1) {
-		CBlockIndex *pindex = chainActive[alias.nHeight-1];
-		if (pindex) {
-			nTime = pindex->GetMedianTimePast();
-		}
-	}
-	oName.push_back(Pair("time", nTime));
-	oName.push_back(Pair("height", (int)alias.nHeight));
-	oName.push_back(Pair("address", EncodeBase58(alias.vchAddress)));
-	oName.push_back(Pair("accepttransferflags", (int)alias.nAcceptTransferFlags));
-	oName.push_back(Pair("encryption_privatekey", HexStr(alias.vchEncryptionPrivateKey)));
-	oName.push_back(Pair("encryption_publickey", HexStr(alias.vchEncryptionPublicKey)));
-	return true;
-}
 unsigned int aliasunspent(const vector<unsigned char> &vchAlias, COutPoint& outpoint)
 {
 	outpoint.SetNull();
 	CAliasIndex theAlias;
 	if (!GetAlias(vchAlias, theAlias))
 		return 0;
-	UniValue paramsUTXO(UniValue::VARR);
-	UniValue param(UniValue::VOBJ);
-	UniValue utxoParams(UniValue::VARR);
-	const string &strAddressFrom = EncodeBase58(theAlias.vchAddress);
-	utxoParams.push_back(strAddressFrom);
-	param.push_back(Pair("addresses", utxoParams));
-	paramsUTXO.push_back(param);
-	JSONRPCRequest request;
-	request.params = paramsUTXO;
-	const UniValue &resUTXOs = getaddressutxos(request);
-	UniValue utxoArray(UniValue::VARR);
-	if (resUTXOs.isArray())
-		utxoArray = resUTXOs.get_array();
-	else
+	CBilliecoinAddress address(EncodeBase58(theAlias.vchAddress));
+	uint160 hashBytes;
+	int type = 0;
+	if (!fAddressIndex || !address.GetIndexKey(hashBytes, type))
 		return 0;
+	// only the alias outputs paying to the current address of the alias
+	const CAliasUnspentKey owner(theAlias.vchAlias, theAlias.vchGUID, type, hashBytes, uint256(), 0);
+	std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > unspentOutputs;
+	if (!pblocktree->ReadAliasUnspentIndex(owner, unspentOutputs))
+		return 0;
+	std::sort(unspentOutputs.begin(), unspentOutputs.end(), [](const std::pair<CAliasUnspentKey, CAddressUnspentValue> &a, const std::pair<CAliasUnspentKey, CAddressUnspentValue> &b) {
+		return a.second.blockHeight < b.second.blockHeight;
+	});
 	unsigned int count = 0;
-	CAmount nCurrentAmount = 0;
 	{
 		LOCK(mempool.cs);
-		for (unsigned int i = 0; i < utxoArray.size(); i++)
+		for (const auto& unspent : unspentOutputs)
 		{
-			const UniValue& utxoObj = utxoArray[i].get_obj();
-			const uint256& txid = uint256S(find_value(utxoObj, "txid").get_str());
-			const int& nOut = find_value(utxoObj, "outputIndex").get_int();
-			const std::vector<unsigned char> &data(ParseHex(find_value(utxoObj, "script").get_str()));
-			const CScript& scriptPubKey = CScript(data.begin(), data.end());
-			int op;
-			vector<vector<unsigned char> > vvch;
-			if (!DecodeAliasScript(scriptPubKey, op, vvch) || vvch.size() <= 1 || vvch[0] != theAlias.vchAlias || vvch[1] != theAlias.vchGUID)
-				continue;
-			const COutPoint &outPointToCheck = COutPoint(txid, nOut);
-
+			const COutPoint outPointToCheck(unspent.first.txhash, unspent.first.index);
 			if (mempool.mapNextTx.find(outPointToCheck) != mempool.mapNextTx.end())
 				continue;
 
@@ -2559,6 +2525,41 @@ unsigned int aliasunspent(const vector<unsigned char> &vchAlias, COutPoint& outp
 	}
 	return count;
 }
+bool GetAliasUnspentKey(const CScript& scriptPubKey, const uint256& txHash, const unsigned int nOut, CAliasUnspentKey& key)
+{
+	int op;
+	vector<vector<unsigned char> > vvch;
+	if (!DecodeAliasScript(scriptPubKey, op, vvch) || vvch.size() <= 1)
+		return false;
+	CTxDestination dest;
+	if (!ExtractDestination(scriptPubKey, dest))
+		return false;
+	int type = 0;
+	if (!CBilliecoinAddress(dest).GetIndexKey(key.hashBytes, type))
+		return false;
+	key.vchAlias = vvch[0];
+	key.vchGUID = vvch[1];
+	key.type = type;
+	key.txhash = txHash;
+	key.index = nOut;
+	return true;
+}
+bool GetAddressesUnspent(const vector<string>& vecAddresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs)
+{
+	for (const string& strAddress : vecAddresses) {
+		CBilliecoinAddress address(strAddress);
+		uint160 hashBytes;
+		int type = 0;
+		if (!address.GetIndexKey(hashBytes, type))
+			return false;
+		if (!GetAddressUnspent(hashBytes, type, unspentOutputs))
+			return false;
+	}
+	std::sort(unspentOutputs.begin(), unspentOutputs.end(), [](const std::pair<CAddressUnspentKey, CAddressUnspentValue> &a, const std::pair<CAddressUnspentKey, CAddressUnspentValue> &b) {
+		return a.second.blockHeight < b.second.blockHeight;
+	});
+	return true;
+}
 UniValue aliaspay_helper(const string strFromAddress, vector<CRecipient> &vecSend, bool fUseInstantSend) {
 	CMutableTransaction txNew;
 	// vouts to the payees
@@ -2860,7 +2861,10 @@ UniValue billiecoinlistreceivedbyaddress(const JSONRPCRequest& request)
 			+ HelpExampleCli("billiecoinlistreceivedbyaddress", "")
 		);
 
-	return BilliecoinListReceived();
+	RPCResultArray ret(request);
+	if (!BilliecoinListReceived(ret))
+		return NullUniValue;
+	return ret.Finish();
 }
 UniValue aliaswhitelist(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
@@ -2903,6 +2907,10 @@ string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op,
 	if (tx.IsNull()) {
 		return "Null Tx";
 	}
+	return GetBilliecoinTransactionDescription(*GetServicePayload(tx), op, responseEnglish, type, responseGUID);
+}
+string GetBilliecoinTransactionDescription(const CServicePayload& payload, const int op, string& responseEnglish, const char &type, string& responseGUID)
+{
 	string strResponse = "";
 	if (type == ALIAS) {
 		// message from op code
@@ -2915,9 +2923,8 @@ string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op,
 			responseEnglish = "Alias Updated";
 		}
 
-		CAliasIndex alias(tx);
-		if (!alias.IsNull()) {
-			responseGUID = stringFromVch(alias.vchAlias);
+		if (payload.alias && !payload.alias->IsNull()) {
+			responseGUID = stringFromVch(payload.alias->vchAlias);
 		}
 	} else 
 	if (type == OFFER) {
@@ -2931,9 +2938,8 @@ string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op,
 			responseEnglish = "Offer Updated";
 		}
 
-		COffer offer(tx);
-		if (!offer.IsNull()) {
-			responseGUID = stringFromVch(offer.vchOffer);
+		if (payload.offer && !payload.offer->IsNull()) {
+			responseGUID = stringFromVch(payload.offer->vchOffer);
 		}		
 	} else 
 	if (type == CERT) {
@@ -2950,9 +2956,8 @@ string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op,
 			strResponse = _("Certificate Transferred");
 			responseEnglish = "Certificate Transferred";
 		}
-		CCert cert(tx);
-		if (!cert.IsNull()) {
-			responseGUID = stringFromVch(cert.vchCert);
+		if (payload.cert && !payload.cert->IsNull()) {
+			responseGUID = stringFromVch(payload.cert->vchCert);
 		}	
 	} else
 	if (type == ASSET) {
@@ -2974,15 +2979,13 @@ string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op,
 			responseEnglish = "Asset Sent";
 		}
 		if (op == OP_ASSET_SEND) {
-			CAssetAllocation assetallocation(tx);
-			if (!assetallocation.IsNull()) {
-				responseGUID = stringFromVch(assetallocation.vchAsset);
+			if (payload.assetAllocation && !payload.assetAllocation->IsNull()) {
+				responseGUID = stringFromVch(payload.assetAllocation->vchAsset);
 			}
 		}
 		else {
-			CAsset asset(tx);
-			if (!asset.IsNull()) {
-				responseGUID = stringFromVch(asset.vchAsset);
+			if (payload.asset && !payload.asset->IsNull()) {
+				responseGUID = stringFromVch(payload.asset->vchAsset);
 			}
 		}
 	} else 
@@ -2997,9 +3000,8 @@ string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op,
 			responseEnglish = "Asset Interest Collected";
 		}
 
-		CAssetAllocation assetallocation(tx);
-		if (!assetallocation.IsNull()) {
-			responseGUID = stringFromVch(assetallocation.vchAsset);
+		if (payload.assetAllocation && !payload.assetAllocation->IsNull()) {
+			responseGUID = stringFromVch(payload.assetAllocation->vchAsset);
 		}
 	} else
 	if (type == ESCROW) {
@@ -3041,9 +3043,8 @@ string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op,
 			responseEnglish = "Escrow Refund Complete";
 		}
 		
-		CEscrow escrow(tx);
-		if (!escrow.IsNull()) {
-			responseGUID = stringFromVch(escrow.vchEscrow);
+		if (payload.escrow && !payload.escrow->IsNull()) {
+			responseGUID = stringFromVch(payload.escrow->vchEscrow);
 		}
 	} 
 	else {
@@ -3072,74 +3073,124 @@ bool IsOutpointMature(const COutPoint& outpoint, bool fUseInstantSend)
 	return false;
 
 }
-bool CAliasDB::ScanAliases(const int count, const int from, const UniValue& oOptions, UniValue& oRes) {
-	string strTxid = "";
+CServiceIndexEntry CAliasDB::GetIndexEntry(const CAliasIndex& alias) {
+	CServiceIndexEntry entry(alias.nHeight, alias.txHash);
+	entry.nExpireTime = alias.nExpireTime;
+	return entry;
+}
+size_t CAliasDB::GetAliasUsage(const CAliasIndex& alias) {
+	return memusage::DynamicUsage(alias.vchAlias) + memusage::DynamicUsage(alias.vchGUID) + memusage::DynamicUsage(alias.vchAddress) +
+		memusage::DynamicUsage(alias.vchEncryptionPublicKey) + memusage::DynamicUsage(alias.vchEncryptionPrivateKey) +
+		memusage::DynamicUsage(alias.vchPublicValue) + memusage::DynamicUsage(alias.offerWhitelist.entries);
+}
+size_t CAliasDB::GetAddressUsage(const std::pair<bool, vector<unsigned char> >& name) {
+	return memusage::DynamicUsage(name.second);
+}
+void CAliasDB::SetReadCacheSize(const size_t nBytes) {
+	// addresses resolve to a name only, most of the memory goes to the aliases
+	cacheAliases.SetMaxUsage(nBytes - nBytes / 4);
+	cacheAddresses.SetMaxUsage(nBytes / 4);
+}
+void CAliasDB::GetReadCacheInfo(UniValue& oInfo) const {
+	UniValue oAliases(UniValue::VOBJ);
+	oAliases.push_back(Pair("entries", (uint64_t)cacheAliases.Size()));
+	oAliases.push_back(Pair("usage", (uint64_t)cacheAliases.DynamicMemoryUsage()));
+	oAliases.push_back(Pair("hits", cacheAliases.Hits()));
+	oAliases.push_back(Pair("misses", cacheAliases.Misses()));
+	oInfo.push_back(Pair("aliases", oAliases));
+	UniValue oAddresses(UniValue::VOBJ);
+	oAddresses.push_back(Pair("entries", (uint64_t)cacheAddresses.Size()));
+	oAddresses.push_back(Pair("usage", (uint64_t)cacheAddresses.DynamicMemoryUsage()));
+	oAddresses.push_back(Pair("hits", cacheAddresses.Hits()));
+	oAddresses.push_back(Pair("misses", cacheAddresses.Misses()));
+	oInfo.push_back(Pair("addresses", oAddresses));
+}
+bool CAliasDB::ReadAlias(const vector<unsigned char>& vchAlias, CAliasIndex& alias) {
+	const std::pair<string, vector<unsigned char> > key(std::string("namei"), vchAlias);
+	// a block being connected on this thread reads what it has written so far
+	if (IsStaged(key))
+		return Read(key, alias);
+	if (cacheAliases.Get(vchAlias, alias))
+		return true;
+	const uint64_t nGeneration = cacheAliases.GetGeneration();
+	if (!Read(key, alias))
+		return false;
+	cacheAliases.Insert(vchAlias, alias, nGeneration);
+	return true;
+}
+bool CAliasDB::ReadAddress(const vector<unsigned char>& address, vector<unsigned char>& name) {
+	const std::pair<string, vector<unsigned char> > key(std::string("namea"), address);
+	if (IsStaged(key))
+		return Read(key, name);
+	std::pair<bool, vector<unsigned char> > cached;
+	if (cacheAddresses.Get(address, cached)) {
+		name = cached.second;
+		return cached.first;
+	}
+	const uint64_t nGeneration = cacheAddresses.GetGeneration();
+	cached.first = Read(key, cached.second);
+	cacheAddresses.Insert(address, cached, nGeneration);
+	name = cached.second;
+	return cached.first;
+}
+namespace {
+// collects the keys a batch changes
+class CBatchKeys : public leveldb::WriteBatch::Handler
+{
+public:
+	vector<string> vKeys;
+	void Put(const leveldb::Slice& key, const leveldb::Slice& value) override {
+		vKeys.push_back(key.ToString());
+	}
+	void Delete(const leveldb::Slice& key) override {
+		vKeys.push_back(key.ToString());
+	}
+};
+}
+void CAliasDB::BatchWritten(const leveldb::WriteBatch& batch) {
+	CBatchKeys handler;
+	if (!batch.Iterate(&handler).ok()) {
+		cacheAliases.Clear();
+		cacheAddresses.Clear();
+		return;
+	}
+	for (const string& strKey : handler.vKeys) {
+		try {
+			CDataStream ssKey(strKey.data(), strKey.data() + strKey.size(), SER_DISK, CLIENT_VERSION);
+			string strName;
+			ssKey >> strName;
+			if (strName != "namei" && strName != "namea")
+				continue;
+			vector<unsigned char> vchKey;
+			ssKey >> vchKey;
+			if (strName == "namei")
+				cacheAliases.Erase(vchKey);
+			else
+				cacheAddresses.Erase(vchKey);
+		}
+		catch (std::exception &e) {
+			// keys of other records need not parse as a name and a vector
+		}
+	}
+}
+bool CAliasDB::ScanAliases(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor) {
 	vector<unsigned char> vchAlias;
-	int nStartBlock = 0;
 	if (!oOptions.isNull()) {
-		const UniValue &txid = find_value(oOptions, "txid");
-		if (txid.isStr()) {
-			strTxid = txid.get_str();
-		}
-
 		const UniValue &aliasObj = find_value(oOptions, "alias");
 		if (aliasObj.isStr()) {
 			vchAlias = vchFromValue(aliasObj);
-		}
-
-		const UniValue &startblock = find_value(oOptions, "startblock");
-		if (startblock.isNum()) {
-			nStartBlock = startblock.get_int();
-		}
-	}
-
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
-	CAliasIndex txPos;
-	pair<string, vector<unsigned char> > key;
-	int index = 0;
-	while (pcursor->Valid()) {
-		boost::this_thread::interruption_point();
-		try {
-			if (pcursor->GetKey(key) && key.first == "namei") {
-				pcursor->GetValue(txPos);
-				if (nStartBlock > 0 && txPos.nHeight < nStartBlock)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!strTxid.empty() && strTxid != txPos.txHash.GetHex())
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchAlias.empty() && vchAlias != txPos.vchAlias)
-				{
-					pcursor->Next();
-					continue;
-				}
-				UniValue oAlias(UniValue::VOBJ);
-				if (!BuildAliasJson(txPos, oAlias))
-				{
-					pcursor->Next();
-					continue;
-				}
-				index += 1;
-				if (index <= from) {
-					pcursor->Next();
-					continue;
-				}
-				oRes.push_back(oAlias);
-				if (index >= count + from)
-					break;
-			}
-			pcursor->Next();
-		}
-		catch (std::exception &e) {
-			return error("%s() : deserialize error", __PRETTY_FUNCTION__);
+			scan.SetKey(vchAlias);
 		}
 	}
-	return true;
+	return serviceIndex.Scan(scan, [&](const CAliasIndex& txPos, UniValue& oAlias) {
+		if (scan.nStartBlock > 0 && txPos.nHeight < scan.nStartBlock)
+			return false;
+		if (!scan.txHash.IsNull() && scan.txHash != txPos.txHash)
+			return false;
+		if (!vchAlias.empty() && vchAlias != txPos.vchAlias)
+			return false;
+		return BuildAliasJson(txPos, oAlias);
+	}, oRes, strCursor);
 }
 UniValue listaliases(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
@@ -3153,11 +3204,13 @@ UniValue listaliases(const JSONRPCRequest& request) {
 			"      \"txid\":txid					(string) Transaction ID to filter results for\n"
 			"      \"alias\":alias				(string) Alias name to filter.\n"
 			"      \"startblock\":block   (number) Earliest block to filter from. Block number is the block at which the transaction would have confirmed.\n"
+			"      \"cursor\":cursor      (string) Page through the results: \"\" for the first page, then the cursor returned with the previous page. The result becomes {\"results\":[...],\"cursor\":cursor}, the cursor is empty after the last page.\n"
 			"    }\n"
 			+ HelpExampleCli("listaliases", "0")
 			+ HelpExampleCli("listaliases", "10 10")
 			+ HelpExampleCli("listaliases", "0 0 '{\"alias\":\"find-this-alias\"}'")
 			+ HelpExampleCli("listaliases", "0 0 '{\"txid\":\"1c7f966dab21119bac53213a2bc7532bff1fa844c124fd750a7d0b1332440bd1\",\"startblock\":0}'")
+			+ HelpExampleCli("listaliases", "100 0 '{\"cursor\":\"\"}'")
 		);
 	UniValue options;
 	int count = 10;
@@ -3181,10 +3234,12 @@ UniValue listaliases(const JSONRPCRequest& request) {
 		options = params[2];
 	}
 
-	UniValue oRes(UniValue::VARR);
-	if (!paliasdb->ScanAliases(count, from, options, oRes))
+	CServiceScan scan(count, from, options);
+	RPCResultArray oRes = ServiceScanArray(request, scan);
+	std::string strCursor;
+	if (!paliasdb->ScanAliases(scan, options, oRes, strCursor))
 		throw runtime_error("BILLIECOIN_ALIAS_RPC_ERROR: ERRCODE: 5522 - " + _("Scan failed"));
-	return oRes;
+	return ServiceScanResult(scan, oRes, strCursor);
 }
 
 void ToLowerCase(std::vector<unsigned char>& vchValue) {
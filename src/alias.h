@@ -7,6 +7,9 @@
 
 #include "rpc/server.h"
 #include "dbwrapper.h"
+#include "serviceargs.h"
+#include "serviceindex.h"
+#include "servicecache.h"
 #include "consensus/params.h"
 #include "sync.h"
 #include "script/script.h"
@@ -18,6 +21,10 @@ class COutPoint;
 class CBilliecoinAddress;
 class CCoinsViewCache;
 struct CRecipient;
+struct CAliasUnspentKey;
+struct CAddressUnspentKey;
+struct CAddressUnspentValue;
+class CServicePayload;
 
 static const unsigned int MAX_GUID_LENGTH = 20;
 static const unsigned int MAX_NAME_LENGTH = 256;
@@ -26,6 +33,12 @@ static const unsigned int MAX_SYMBOL_LENGTH = 8;
 static const unsigned int MIN_SYMBOL_LENGTH = 1;
 static const unsigned int MAX_ENCRYPTED_GUID_LENGTH = MAX_NAME_LENGTH;
 static const uint64_t ONE_YEAR_IN_SECONDS = 31536000;
+/** Default for -aliascache, megabytes of memory for the aliases and alias addresses read from the database */
+static const int64_t DEFAULT_ALIAS_CACHE_SIZE = 16;
+/** Default for -pruneservices, whether expired service data is pruned in the background */
+static const bool DEFAULT_PRUNE_SERVICES = true;
+/** Expired aliases, together with their services, pruned per pass holding cs_main */
+static const unsigned int SERVICE_PRUNE_BATCH = 500;
 enum {
 	ALIAS=0,
 	OFFER, 
@@ -237,28 +250,46 @@ public:
 };
 
 class CAliasDB : public CDBWrapper {
+private:
+	CServiceIndex<std::vector<unsigned char>, CAliasIndex> serviceIndex;
+	static CServiceIndexEntry GetIndexEntry(const CAliasIndex& alias);
+	// aliases by name, and alias names by address where false caches an address without alias
+	CServiceCache<std::vector<unsigned char>, CAliasIndex> cacheAliases;
+	CServiceCache<std::vector<unsigned char>, std::pair<bool, std::vector<unsigned char> > > cacheAddresses;
+	static size_t GetAliasUsage(const CAliasIndex& alias);
+	static size_t GetAddressUsage(const std::pair<bool, std::vector<unsigned char> >& name);
+protected:
+	void BatchWritten(const leveldb::WriteBatch& batch) override;
 public:
-    CAliasDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "aliases", nCacheSize, fMemory, fWipe) {
+    CAliasDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "aliases", nCacheSize, fMemory, fWipe), serviceIndex(*this, "name", &GetIndexEntry),
+		cacheAliases(&GetAliasUsage), cacheAddresses(&GetAddressUsage) {
     }
+	/** Bound the memory of the alias and address caches, 0 disables them */
+	void SetReadCacheSize(const size_t nBytes);
+	void GetReadCacheInfo(UniValue& oInfo) const;
 	bool WriteAlias(const CAliasUnprunable &aliasUnprunable, const std::vector<unsigned char>& address, const CAliasIndex& alias, const int &op) {
 		if(address.empty())
 			return false;	
-		bool writeState = false;
-		writeState = Write(make_pair(std::string("namei"), alias.vchAlias), alias) && Write(make_pair(std::string("namea"), address), alias.vchAlias) && Write(make_pair(std::string("nameu"), alias.vchAlias), aliasUnprunable);
+		CDBBatch batch(*this);
+		serviceIndex.Write(batch, alias.vchAlias, alias);
+		batch.Write(make_pair(std::string("namea"), address), alias.vchAlias);
+		batch.Write(make_pair(std::string("nameu"), alias.vchAlias), aliasUnprunable);
+		const bool writeState = WriteBatch(batch);
 		if(writeState)
 			WriteAliasIndex(alias, op);
 		return writeState;
 	}
 
 	bool EraseAlias(const std::vector<unsigned char>& vchAlias, bool cleanup = false) {
-		return Erase(make_pair(std::string("namei"), vchAlias));
+		CDBBatch batch(*this);
+		serviceIndex.Erase(batch, vchAlias);
+		return WriteBatch(batch);
 	}
-	bool ReadAlias(const std::vector<unsigned char>& vchAlias, CAliasIndex& alias) {
-		return Read(make_pair(std::string("namei"), vchAlias), alias);
-	}
-	bool ReadAddress(const std::vector<unsigned char>& address, std::vector<unsigned char>& name) {
-		return Read(make_pair(std::string("namea"), address), name);
+	bool BuildIndexes() {
+		return serviceIndex.Build();
 	}
+	bool ReadAlias(const std::vector<unsigned char>& vchAlias, CAliasIndex& alias);
+	bool ReadAddress(const std::vector<unsigned char>& address, std::vector<unsigned char>& name);
 	bool ReadAliasUnprunable(const std::vector<unsigned char>& alias, CAliasUnprunable& aliasUnprunable) {
 		return Read(make_pair(std::string("nameu"), alias), aliasUnprunable);
 	}
@@ -266,13 +297,19 @@ public:
 	    return Erase(make_pair(std::string("namea"), address));
 	}
 	bool ExistsAddress(const std::vector<unsigned char>& address) {
-	    return Exists(make_pair(std::string("namea"), address));
+		std::vector<unsigned char> name;
+		return ReadAddress(address, name);
+	}
+	/** Up to nMax aliases expiring at or before nTime with their indexed expiry, the earliest first */
+	bool GetExpiredAliases(const uint64_t nTime, const size_t nMax, std::vector<std::pair<uint64_t, std::vector<unsigned char> > >& vExpired) const {
+		return serviceIndex.GetExpired(nTime, nMax, vExpired);
 	}
-	bool CleanupDatabase(int &servicesCleaned);
+	/** Erase an expired alias and its address, nExpireTime is the expiry it was indexed at */
+	bool CleanupDatabase(const std::vector<unsigned char>& vchAlias, const uint64_t nExpireTime, int &servicesCleaned);
 	void WriteAliasIndex(const CAliasIndex& alias, const int &op);
 	void WriteAliasIndexHistory(const CAliasIndex& alias, const int &op);
 	void WriteAliasIndexTxHistory(const std::string &user1, const std::string &user2, const std::string &user3, const uint256 &txHash, const unsigned int& nHeight, const std::string &type, const std::string &guid);
-	bool ScanAliases(const int count, const int from, const UniValue& oOptions, UniValue& oRes);
+	bool ScanAliases(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor);
 };
 
 class COfferDB;
@@ -295,7 +332,7 @@ std::vector<unsigned char> vchFromString(const std::string &str);
 std::string stringFromValue(const UniValue& value);
 const int BILLIECOIN_TX_VERSION = 0x7400;
 bool IsValidAliasName(const std::vector<unsigned char> &vchAlias);
-bool CheckAliasInputs(const CCoinsViewCache &inputs, const CTransaction &tx, int op, const std::vector<std::vector<unsigned char> > &vvchArgs, bool fJustCheck, int nHeight, std::string &errorMessage,bool bSanityCheck=false);
+bool CheckAliasInputs(const CCoinsViewCache &inputs, const CTransaction &tx, const CServicePayload &payload, int op, const CServiceArgs &vvchArgs, bool fJustCheck, int nHeight, std::string &errorMessage,bool bSanityCheck=false);
 void CreateRecipient(const CScript& scriptPubKey, CRecipient& recipient);
 void CreateAliasRecipient(const CScript& scriptPubKey, CRecipient& recipient);
 void CreateFeeRecipient(CScript& scriptPubKey, const std::vector<unsigned char>& data, CRecipient& recipient);
@@ -312,6 +349,8 @@ bool DecodeAliasScript(const CScript& script, int& op,
 		std::vector<std::vector<unsigned char> > &vvch);
 bool FindAliasInTx(const CCoinsViewCache &inputs, const CTransaction& tx, std::vector<std::vector<unsigned char> >& vvch);
 unsigned int aliasunspent(const std::vector<unsigned char> &vchAlias, COutPoint& outPoint);
+bool GetAliasUnspentKey(const CScript& scriptPubKey, const uint256& txHash, const unsigned int nOut, CAliasUnspentKey& key);
+bool GetAddressesUnspent(const std::vector<std::string>& vecAddresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs);
 bool GetAddressFromAlias(const std::string& strAlias, std::string& strAddress, std::vector<unsigned char> &vchPubKey);
 bool GetAliasFromAddress(const std::string& strAddress, std::string& strAlias, std::vector<unsigned char> &vchPubKey);
 int getFeePerByte(const uint64_t &paymentOptionMask);
@@ -326,14 +365,18 @@ bool GetBilliecoinData(const CScript &scriptPubKey, std::vector<unsigned char> &
 bool IsSysServiceExpired(const uint64_t &nTime);
 bool GetTimeToPrune(const CScript& scriptPubKey, uint64_t &nTime);
 bool IsBilliecoinScript(const CScript& scriptPubKey, int &op, std::vector<std::vector<unsigned char> > &vvchArgs);
+bool FindBilliecoinScriptOp(const CScript& script, int& op);
 bool RemoveBilliecoinScript(const CScript& scriptPubKeyIn, CScript& scriptPubKeyOut);
 void SysTxToJSON(const int op, const std::vector<unsigned char> &vchData, const std::vector<unsigned char> &vchHash, UniValue &entry, const char& type);
 void AliasTxToJSON(const int op, const std::vector<unsigned char> &vchData, const std::vector<unsigned char> &vchHash, UniValue &entry);
 bool BuildAliasJson(const CAliasIndex& alias, UniValue& oName);
 void CleanupBilliecoinServiceDatabases(int &servicesCleaned);
+bool PruneBilliecoinServices(const size_t nMaxAliases, int &servicesCleaned, bool &fDone);
+bool PruneOrphanedBilliecoinServices(int &servicesCleaned);
+void PruneBilliecoinServicesMaintenance();
 void GetAddress(const CAliasIndex &alias, CBilliecoinAddress* address, CScript& script, const uint32_t nPaymentOption=1);
 std::string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op, std::string& responseEnglish, const char &type, std::string& responseGUID);
-bool BuildAliasIndexerHistoryJson(const CAliasIndex& alias, UniValue& oName);
+std::string GetBilliecoinTransactionDescription(const CServicePayload& payload, const int op, std::string& responseEnglish, const char &type, std::string& responseGUID);
 bool DoesAliasExist(const std::string &strAddress);
 bool IsOutpointMature(const COutPoint& outpoint, bool fUseInstantSend = false);
 UniValue billiecointxfund_helper(const std::vector<unsigned char> &vchAlias, const std::vector<unsigned char> &vchWitness, const CRecipient &aliasRecipient, std::vector<CRecipient> &vecSend);
@@ -15,6 +15,8 @@
 #include "wallet/wallet.h"
 #include "chainparams.h"
 #include "wallet/coincontrol.h"
+#include "serviceevent.h"
+#include "servicepayload.h"
 #include <boost/algorithm/hex.hpp>
 #include <boost/algorithm/string/case_conv.hpp> // for to_upper()
 #include <boost/foreach.hpp>
@@ -87,22 +89,18 @@ void CAsset::Serialize( vector<unsigned char> &vchData) {
 
 }
 void CAssetDB::WriteAssetIndex(const CAsset& asset, const int& op) {
-	if (IsArgSet("-zmqpubassetrecord")) {
-		UniValue oName(UniValue::VOBJ);
-		if (BuildAssetIndexerJson(asset, oName)) {
-			GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "assetrecord");
-		}
+	// notifications follow the asset write once it is committed
+	if (CDBStagedWrites::GetActive()) {
+		CDBStagedWrites::Defer(std::bind(&CAssetDB::WriteAssetIndex, this, asset, op));
+		return;
 	}
+	if (IsArgSet("-zmqpubassetrecord"))
+		PublishServiceEvent("assetrecord", asset);
 	WriteAssetIndexHistory(asset, op);
 }
 void CAssetDB::WriteAssetIndexHistory(const CAsset& asset, const int &op) {
-	if (IsArgSet("-zmqpubassethistory")) {
-		UniValue oName(UniValue::VOBJ);
-		if (BuildAssetIndexerHistoryJson(asset, oName)) {
-			oName.push_back(Pair("op", assetFromOp(op)));
-			GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "assethistory");
-		}
-	}
+	if (IsArgSet("-zmqpubassethistory"))
+		PublishServiceEvent("assethistory", asset, (unsigned char)op);
 }
 bool GetAsset(const vector<unsigned char> &vchAsset,
         CAsset& txPos) {
@@ -199,7 +197,7 @@ bool RemoveAssetScriptPrefix(const CScript& scriptIn, CScript& scriptOut) {
 	scriptOut = CScript(pc, scriptIn.end());
 	return true;
 }
-bool CheckAssetInputs(const CTransaction &tx, const CCoinsViewCache &inputs, int op, const vector<vector<unsigned char> > &vvchArgs, const vector<unsigned char> &vchAlias,
+bool CheckAssetInputs(const CTransaction &tx, const CCoinsViewCache &inputs, const CServicePayload &payload, const vector<unsigned char> &vchAlias,
         bool fJustCheck, int nHeight, sorted_vector<CAssetAllocationTuple> &revertedAssetAllocations, string &errorMessage, bool bSanityCheck) {
 	if (!paliasdb || !passetdb)
 		return false;
@@ -213,17 +211,21 @@ bool CheckAssetInputs(const CTransaction &tx, const CCoinsViewCache &inputs, int
 			chainActive.Tip()->nHeight, tx.GetHash().ToString().c_str(),
 			fJustCheck ? "JUSTCHECK" : "BLOCK");
 
-	// unserialize asset from txn, check for valid
-	CAsset theAsset;
-	CAssetAllocation theAssetAllocation;
-	vector<unsigned char> vchData;
-	vector<unsigned char> vchHash;
-	int nDataOut;
-	if(!GetBilliecoinData(tx, vchData, vchHash, nDataOut) || (op != OP_ASSET_SEND &&!theAsset.UnserializeFromData(vchData, vchHash)) || (op == OP_ASSET_SEND && !theAssetAllocation.UnserializeFromData(vchData, vchHash)))
+	// the asset, or the allocation an asset send carries, was unserialized from the txn with the payload, check for valid
+	const int op = payload.nOp;
+	const CServiceArgs &vvchArgs = payload.vvchArgs;
+	const vector<unsigned char> &vchHash = payload.vchDataHash;
+	if(!payload.fDataValid)
 	{
 		errorMessage = "BILLIECOIN_ASSET_CONSENSUS_ERROR ERRCODE: 2000 - " + _("Cannot unserialize data inside of this transaction relating to an asset");
 		return true;
 	}
+	CAsset theAsset;
+	CAssetAllocation theAssetAllocation;
+	if (op == OP_ASSET_SEND)
+		theAssetAllocation = *payload.assetAllocation;
+	else
+		theAsset = *payload.asset;
 
 	if(fJustCheck)
 	{
@@ -420,16 +422,15 @@ bool CheckAssetInputs(const CTransaction &tx, const CCoinsViewCache &inputs, int
 						return true;
 					}
 				}
-				vector<CRange> outputMerge;
 				increaseBalanceByAmount = validateRangesAndGetCount(theAsset.listAllocationInputs);
 				if (increaseBalanceByAmount == 0)
 				{
 					errorMessage = "BILLIECOIN_ASSET_CONSENSUS_ERROR: ERRCODE: 2028 - " + _("Invalid input ranges");
 					return true;
 				}
-				dbAsset.listAllocationInputs.insert(std::end(dbAsset.listAllocationInputs), std::begin(theAsset.listAllocationInputs), std::end(theAsset.listAllocationInputs));
-				mergeRanges(dbAsset.listAllocationInputs, outputMerge);
-				theAsset.listAllocationInputs = outputMerge;
+				CRangeSet supplyRanges(dbAsset.listAllocationInputs);
+				supplyRanges.Add(theAsset.listAllocationInputs);
+				theAsset.listAllocationInputs = supplyRanges.GetRanges();
 			}
 			theAsset.nBalance += increaseBalanceByAmount;
 			// increase total supply
@@ -575,10 +576,9 @@ bool CheckAssetInputs(const CTransaction &tx, const CCoinsViewCache &inputs, int
 						receiverAllocation.nHeight = nHeight;
 						receiverAllocation.vchMemo = theAssetAllocation.vchMemo;
 						// figure out receivers added ranges and balance
-						vector<CRange> outputMerge;
-						receiverAllocation.listAllocationInputs.insert(std::end(receiverAllocation.listAllocationInputs), std::begin(input.second), std::end(input.second));
-						mergeRanges(receiverAllocation.listAllocationInputs, outputMerge);
-						receiverAllocation.listAllocationInputs = outputMerge;
+						CRangeSet receiverRanges(receiverAllocation.listAllocationInputs);
+						receiverRanges.Add(input.second);
+						receiverAllocation.listAllocationInputs = receiverRanges.GetRanges();
 						receiverAllocation.nBalance += rangeTotals[i];
 
 						const string& receiverAddress = stringFromVch(receiverAllocation.vchAliasOrAddress);
@@ -1098,14 +1098,12 @@ UniValue assetsend(const JSONRPCRequest& request) {
 	const CAssetAllocationTuple assetAllocationTuple(vchAsset, theAsset.vchAliasOrAddress);
 	if (!fUnitTest) {
 		// check to see if a transaction for this asset/address tuple has arrived before minimum latency period
-		ArrivalTimesMap arrivalTimes;
+		ArrivalTimesList arrivalTimes;
 		passetallocationdb->ReadISArrivalTimes(assetAllocationTuple, arrivalTimes);
 		const int64_t & nNow = GetTimeMillis();
-		for (auto& arrivalTime : arrivalTimes) {
-			// if this tx arrived within the minimum latency period flag it as potentially conflicting
-			if ((nNow - (arrivalTime.second / 1000)) < ZDAG_MINIMUM_LATENCY_SECONDS) {
-				throw runtime_error("BILLIECOIN_ASSET_RPC_ERROR: ERRCODE: 2509 - " + _("Please wait a few more seconds and try again..."));
-			}
+		// list is in arrival order so only the latest send can fall within the minimum latency period
+		if (!arrivalTimes.empty() && (nNow - (arrivalTimes.back().second / 1000)) < ZDAG_MINIMUM_LATENCY_SECONDS) {
+			throw runtime_error("BILLIECOIN_ASSET_RPC_ERROR: ERRCODE: 2509 - " + _("Please wait a few more seconds and try again..."));
 		}
 	}
 	if (assetAllocationConflicts.find(assetAllocationTuple) != assetAllocationConflicts.end())
@@ -1199,43 +1197,6 @@ bool BuildAssetJson(const CAsset& asset, const bool bGetInputs, UniValue& oAsset
 	}
 	return true;
 }
-bool BuildAssetIndexerHistoryJson(const CAsset& asset, UniValue& oAsset)
-{
-	oAsset.push_back(Pair("_id", asset.txHash.GetHex()));
-	oAsset.push_back(Pair("asset", stringFromVch(asset.vchAsset)));
-	oAsset.push_back(Pair("symbol", stringFromVch(asset.vchSymbol)));
-	oAsset.push_back(Pair("height", (int)asset.nHeight));
-	int64_t nTime = 0;
-	if (chainActive.Height() >= asset.nHeight-1) {
-		CBlockIndex *pindex = chainActive[asset.nHeight-1];
-		if (pindex) {
-			nTime = pindex->GetMedianTimePast();
-		}
-	}
-	oAsset.push_back(Pair("time", nTime));
-	oAsset.push_back(Pair("publicvalue", stringFromVch(asset.vchPubData)));
-	oAsset.push_back(Pair("category", stringFromVch(asset.sCategory)));
-	oAsset.push_back(Pair("alias", stringFromVch(asset.vchAliasOrAddress)));
-	oAsset.push_back(Pair("balance", ValueFromAssetAmount(asset.nBalance, asset.nPrecision, asset.bUseInputRanges)));
-	oAsset.push_back(Pair("total_supply", ValueFromAssetAmount(asset.nTotalSupply, asset.nPrecision, asset.bUseInputRanges)));
-	oAsset.push_back(Pair("interest_rate", asset.fInterestRate));
-	return true;
-}
-bool BuildAssetIndexerJson(const CAsset& asset, UniValue& oAsset)
-{
-	oAsset.push_back(Pair("_id", stringFromVch(asset.vchAsset)));
-	oAsset.push_back(Pair("symbol", stringFromVch(asset.vchSymbol)));
-	oAsset.push_back(Pair("height", (int)asset.nHeight));
-	oAsset.push_back(Pair("category", stringFromVch(asset.sCategory)));
-	oAsset.push_back(Pair("alias", stringFromVch(asset.vchAliasOrAddress)));
-	oAsset.push_back(Pair("use_input_ranges", asset.bUseInputRanges));
-	oAsset.push_back(Pair("balance", ValueFromAssetAmount(asset.nBalance, asset.nPrecision, asset.bUseInputRanges)));
-	oAsset.push_back(Pair("total_supply", ValueFromAssetAmount(asset.nTotalSupply, asset.nPrecision, asset.bUseInputRanges)));
-	oAsset.push_back(Pair("max_supply", ValueFromAssetAmount(asset.nMaxSupply, asset.nPrecision, asset.bUseInputRanges)));
-	oAsset.push_back(Pair("interest_rate", asset.fInterestRate));
-	oAsset.push_back(Pair("precision", (int)asset.nPrecision));
-	return true;
-}
 void AssetTxToJSON(const int op, const std::vector<unsigned char> &vchData, const std::vector<unsigned char> &vchHash, UniValue &entry)
 {
 	string opName = assetFromOp(op);
@@ -1358,19 +1319,19 @@ bool AssetRange(const CAmount& amount, int precision, bool isInputRange)
 		return false;
 	return true;
 }
-bool CAssetDB::ScanAssets(const int count, const int from, const UniValue& oOptions, UniValue& oRes) {
-	string strTxid = "";
+CServiceIndexEntry CAssetDB::GetIndexEntry(const CAsset& asset) {
+	CServiceIndexEntry entry(asset.nHeight, asset.txHash);
+	entry.AddOwner(asset.vchAliasOrAddress);
+	return entry;
+}
+bool CAssetDB::ScanAssets(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor) {
 	vector<vector<unsigned char> > vchAddresses;
 	vector<unsigned char> vchAsset;
-	int nStartBlock = 0;
 	if (!oOptions.isNull()) {
-		const UniValue &txid = find_value(oOptions, "txid");
-		if (txid.isStr()) {
-			strTxid = txid.get_str();
-		}
 		const UniValue &assetObj = find_value(oOptions, "asset");
 		if (assetObj.isStr()) {
 			vchAsset = vchFromValue(assetObj);
+			scan.SetKey(vchAsset);
 		}
 		const UniValue &owners = find_value(oOptions, "owners");
 		if (owners.isArray()) {
@@ -1380,68 +1341,23 @@ bool CAssetDB::ScanAssets(const int count, const int from, const UniValue& oOpti
 				const UniValue &ownerStr = find_value(owner, "owner");
 				if (ownerStr.isStr()) {
 					vchAddresses.push_back(vchFromString(ownerStr.get_str()));
+					scan.AddOwner(vchAddresses.back());
 				}
 			}
 		}
-		const UniValue &startblock = find_value(oOptions, "startblock");
-		if (startblock.isNum()) {
-			nStartBlock = startblock.get_int();
-		}
 	}
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
-	CAsset txPos;
-	pair<string, vector<unsigned char> > key;
 	bool bGetInputs = true;
-	
-	int index = 0;
-	while (pcursor->Valid()) {
-		boost::this_thread::interruption_point();
-		try {
-			if (pcursor->GetKey(key) && key.first == "asseti") {
-				pcursor->GetValue(txPos);
-				if (nStartBlock > 0 && txPos.nHeight < nStartBlock)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!strTxid.empty() && strTxid != txPos.txHash.GetHex())
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchAsset.empty() && vchAsset != txPos.vchAsset)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchAddresses.empty() && std::find(vchAddresses.begin(), vchAddresses.end(), txPos.vchAliasOrAddress) == vchAddresses.end())
-				{
-					pcursor->Next();
-					continue;
-				}
-				UniValue oAsset(UniValue::VOBJ);
-				if (!BuildAssetJson(txPos, bGetInputs, oAsset))
-				{
-					pcursor->Next();
-					continue;
-				}
-				index += 1;
-				if (index <= from) {
-					pcursor->Next();
-					continue;
-				}
-				oRes.push_back(oAsset);
-				if (index >= count + from)
-					break;
-			}
-			pcursor->Next();
-		}
-		catch (std::exception &e) {
-			return error("%s() : deserialize error", __PRETTY_FUNCTION__);
-		}
-	}
-	return true;
+	return serviceIndex.Scan(scan, [&](const CAsset& txPos, UniValue& oAsset) {
+		if (scan.nStartBlock > 0 && txPos.nHeight < scan.nStartBlock)
+			return false;
+		if (!scan.txHash.IsNull() && scan.txHash != txPos.txHash)
+			return false;
+		if (!vchAsset.empty() && vchAsset != txPos.vchAsset)
+			return false;
+		if (!vchAddresses.empty() && std::find(vchAddresses.begin(), vchAddresses.end(), txPos.vchAliasOrAddress) == vchAddresses.end())
+			return false;
+		return BuildAssetJson(txPos, bGetInputs, oAsset);
+	}, oRes, strCursor);
 }
 UniValue listassets(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
@@ -1462,11 +1378,13 @@ UniValue listassets(const JSONRPCRequest& request) {
 			"			,...\n"
 			"		]\n"
 			"      \"startblock\":block 			(number) Earliest block to filter from. Block number is the block at which the transaction would have confirmed.\n"
+			"      \"cursor\":cursor		(string) Page through the results: \"\" for the first page, then the cursor returned with the previous page. The result becomes {\"results\":[...],\"cursor\":cursor}, the cursor is empty after the last page.\n"
 			"    }\n"
 			+ HelpExampleCli("listassets", "0")
 			+ HelpExampleCli("listassets", "10 10")
 			+ HelpExampleCli("listassets", "0 0 '{\"owners\":[{\"owner\":\"SfaMwYY19Dh96B9qQcJQuiNykVRTzXMsZR\"},{\"owner\":\"SfaMwYY19Dh96B9qQcJQuiNykVRTzXMsZR\"}]}'")
 			+ HelpExampleCli("listassets", "0 0 '{\"asset\":\"32bff1fa844c124\",\"owner\":\"SfaT8dGhk1zaQkk8bujMfgWw3szxReej4S\",\"startblock\":0}'")
+			+ HelpExampleCli("listassets", "100 0 '{\"cursor\":\"\"}'")
 		);
 	UniValue options;
 	int count = 10;
@@ -1490,8 +1408,10 @@ UniValue listassets(const JSONRPCRequest& request) {
 		options = params[2];
 	}
 
-	UniValue oRes(UniValue::VARR);
-	if (!passetdb->ScanAssets(count, from, options, oRes))
+	CServiceScan scan(count, from, options);
+	RPCResultArray oRes = ServiceScanArray(request, scan);
+	std::string strCursor;
+	if (!passetdb->ScanAssets(scan, options, oRes, strCursor))
 		throw runtime_error("BILLIECOIN_ASSET_RPC_ERROR: ERRCODE: 2512 - " + _("Scan failed"));
-	return oRes;
+	return ServiceScanResult(scan, oRes, strCursor);
 }
@@ -7,6 +7,7 @@
 
 #include "rpc/server.h"
 #include "dbwrapper.h"
+#include "serviceindex.h"
 #include "script/script.h"
 #include "serialize.h"
 #include "primitives/transaction.h"
@@ -17,8 +18,9 @@ class CReserveKey;
 class CCoinsViewCache;
 class CBlock;
 class CAliasIndex;
+class CServicePayload;
 
-bool CheckAssetInputs(const CTransaction &tx, const CCoinsViewCache &inputs, int op, const std::vector<std::vector<unsigned char> > &vvchArgs, const std::vector<unsigned char> &vchAlias, bool fJustCheck, int nHeight, sorted_vector<CAssetAllocationTuple> &revertedAssetAllocations, std::string &errorMessage, bool bSanityCheck=false);
+bool CheckAssetInputs(const CTransaction &tx, const CCoinsViewCache &inputs, const CServicePayload &payload, const std::vector<unsigned char> &vchAlias, bool fJustCheck, int nHeight, sorted_vector<CAssetAllocationTuple> &revertedAssetAllocations, std::string &errorMessage, bool bSanityCheck=false);
 bool DecodeAssetTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch);
 bool DecodeAndParseAssetTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch, char& type);
 bool DecodeAssetScript(const CScript& script, int& op, std::vector<std::vector<unsigned char> > &vvch);
@@ -129,30 +131,37 @@ public:
 
 
 class CAssetDB : public CDBWrapper {
+private:
+	CServiceIndex<std::vector<unsigned char>, CAsset> serviceIndex;
+	static CServiceIndexEntry GetIndexEntry(const CAsset& asset);
 public:
-    CAssetDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe) {}
+    CAssetDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe), serviceIndex(*this, "asset", &GetIndexEntry) {}
 
     bool WriteAsset(const CAsset& asset, const int &op) {
-		bool writeState = false;
-		writeState = Write(make_pair(std::string("asseti"), asset.vchAsset), asset);
+		CDBBatch batch(*this);
+		serviceIndex.Write(batch, asset.vchAsset, asset);
+		const bool writeState = WriteBatch(batch);
 		if(writeState)
 			WriteAssetIndex(asset, op);
         return writeState;
     }
 	bool EraseAsset(const std::vector<unsigned char>& vchAsset, bool cleanup = false) {
-		return Erase(make_pair(std::string("asseti"), vchAsset));
+		CDBBatch batch(*this);
+		serviceIndex.Erase(batch, vchAsset);
+		return WriteBatch(batch);
 	}
     bool ReadAsset(const std::vector<unsigned char>& vchAsset, CAsset& asset) {
         return Read(make_pair(std::string("asseti"), vchAsset), asset);
     }
 	void WriteAssetIndex(const CAsset& asset, const int &op);
 	void WriteAssetIndexHistory(const CAsset& asset, const int &op);
-	bool ScanAssets(const int count, const int from, const UniValue& oOptions, UniValue& oRes);
+	bool BuildIndexes() {
+		return serviceIndex.Build();
+	}
+	bool ScanAssets(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor);
 };
 bool GetAsset(const std::vector<unsigned char> &vchAsset,CAsset& txPos);
 bool BuildAssetJson(const CAsset& asset, const bool bGetInputs, UniValue& oName);
-bool BuildAssetIndexerJson(const CAsset& asset,UniValue& oName);
-bool BuildAssetIndexerHistoryJson(const CAsset& asset, UniValue& oName);
 UniValue ValueFromAssetAmount(const CAmount& amount, int precision, bool isInputRange);
 CAmount AssetAmountFromValue(UniValue& value, int precision, bool isInputRange);
 bool AssetRange(const CAmount& amountIn, int precision, bool isInputRange);
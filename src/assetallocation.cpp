@@ -24,15 +24,16 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include <boost/algorithm/string.hpp>
-#include "thread_pool/thread_pool.hpp"
-#include <future>
-#include <boost/multiprecision/cpp_dec_float.hpp>
+#include <boost/bind.hpp>
+#include "validationexecutor.h"
+#include "interest.h"
+#include "serviceevent.h"
+#include "servicepayload.h"
 using namespace std;
-using namespace boost::multiprecision;
 vector<pair<uint256, int64_t> > vecTPSTestReceivedTimes;
 vector<JSONRPCRequest> vecTPSRawTransactions;
 int64_t nTPSTestingSendRawElapsedTime = 0;
-AssetAllocationIndexItemMap AssetAllocationIndex;
+CAssetAllocationSenderLedger assetAllocationSenderLedger;
 bool IsAssetAllocationOp(int op) {
 	return op == OP_ASSET_ALLOCATION_SEND || op == OP_ASSET_COLLECT_INTEREST;
 }
@@ -116,27 +117,30 @@ void CAssetAllocation::Serialize( vector<unsigned char> &vchData) {
 
 }
 void CAssetAllocationDB::WriteAssetAllocationIndex(const CAssetAllocation& assetallocation, const CAsset& asset, const CAmount& nSenderBalance, const CAmount& nAmount, const std::string& strSender, const std::string& strReceiver) {
-	if (IsArgSet("-zmqpubassetallocation") || fAssetAllocationIndex) {
-		UniValue oName(UniValue::VOBJ);
+	// notifications and the wallet index follow the allocation write once it is committed
+	if (CDBStagedWrites::GetActive()) {
+		CDBStagedWrites::Defer(std::bind(&CAssetAllocationDB::WriteAssetAllocationIndex, this, assetallocation, asset, nSenderBalance, nAmount, strSender, strReceiver));
+		return;
+	}
+	if (IsArgSet("-zmqpubassetallocation"))
+		PublishServiceEvent("assetallocation", assetallocation, nSenderBalance, nAmount, strSender, strReceiver);
+	if (fAssetAllocationIndex && passetallocationtransactionsdb) {
+		CAssetAllocationIndexEntry entry;
 		bool isMine = true;
-		if (BuildAssetAllocationIndexerJson(assetallocation, asset, nSenderBalance, nAmount, strSender, strReceiver, isMine, oName)) {
-			const string& strObj = oName.write();
-			GetMainSignals().NotifyBilliecoinUpdate(strObj.c_str(), "assetallocation");
-			if (isMine && fAssetAllocationIndex) {
-				int nHeight = assetallocation.nHeight;
-				const string& strKey = assetallocation.txHash.GetHex()+"-"+stringFromVch(asset.vchAsset)+"-"+ strSender +"-"+ strReceiver;
-				{
-					LOCK2(mempool.cs, cs_assetallocationindex);
-					// we want to the height from mempool if it exists or use the one stored in assetallocation
-					CTxMemPool::txiter it = mempool.mapTx.find(assetallocation.txHash);
-					if (it != mempool.mapTx.end())
-						nHeight = (*it).GetHeight();
-					AssetAllocationIndex[nHeight][strKey] = strObj;
-				}
+		if (BuildAssetAllocationIndexEntry(assetallocation, asset, nSenderBalance, nAmount, strSender, strReceiver, isMine, entry) && isMine) {
+			int nHeight = assetallocation.nHeight;
+			{
+				LOCK(mempool.cs);
+				// we want to the height from mempool if it exists or use the one stored in assetallocation
+				CTxMemPool::txiter it = mempool.mapTx.find(assetallocation.txHash);
+				if (it != mempool.mapTx.end())
+					nHeight = (*it).GetHeight();
 			}
+			const CAssetAllocationIndexKey key(nHeight, assetallocation.txHash, stringFromVch(asset.vchAsset), strSender, strReceiver);
+			if (!passetallocationtransactionsdb->WriteAssetAllocationIndexEntry(key, entry))
+				LogPrintf("Failed to write to asset allocation transactions database!\n");
 		}
 	}
-
 }
 bool GetAssetAllocation(const CAssetAllocationTuple &assetAllocationTuple, CAssetAllocation& txPos) {
     if (!passetallocationdb || !passetallocationdb->ReadAssetAllocation(assetAllocationTuple, txPos))
@@ -260,17 +264,20 @@ bool RevertAssetAllocation(const CAssetAllocationTuple &assetAllocationToRemove,
 	revertedAssetAllocations.insert(assetAllocationToRemove);
 
 	// TODO make this based on txid/allocation tuple since we may have multiple conflicts within an asset allocation that need to be cleared seperately
-	// remove the conflict once we revert since it is assumed to be resolved on POW
-	sorted_vector<CAssetAllocationTuple>::const_iterator it = assetAllocationConflicts.find(assetAllocationToRemove);
-	if (it != assetAllocationConflicts.end()) {
-		assetAllocationConflicts.V.erase(const_iterator_cast(assetAllocationConflicts.V, it));
-	}
+	// remove the conflict once we revert since it is assumed to be resolved on POW, once the revert is committed
+	CDBStagedWrites::Defer([assetAllocationToRemove]() {
+		LOCK(cs_assetallocation);
+		sorted_vector<CAssetAllocationTuple>::const_iterator it = assetAllocationConflicts.find(assetAllocationToRemove);
+		if (it != assetAllocationConflicts.end()) {
+			assetAllocationConflicts.V.erase(const_iterator_cast(assetAllocationConflicts.V, it));
+		}
+	});
 
 	return true;
 	
 }
-// calculate annual interest on an asset allocation
-CAmount GetAssetAllocationInterest(CAssetAllocation & assetAllocation, const int& nHeight, string& errorMessage) {
+// calculate annual interest on an asset allocation, pInterestBatch shares the growth between allocations of an asset
+CAmount GetAssetAllocationInterest(CAssetAllocation & assetAllocation, const int& nHeight, string& errorMessage, CCompoundInterestBatch* pInterestBatch = NULL) {
 	// need to do one more average balance calculation since the last update to this asset allocation
 	if (!AccumulateInterestSinceLastClaim(assetAllocation, nHeight)) {
 		errorMessage = _("Not enough blocks in-between interest claims");
@@ -281,15 +288,13 @@ CAmount GetAssetAllocationInterest(CAssetAllocation & assetAllocation, const int
 		errorMessage = _("Not enough blocks have passed since the last claim, please wait some more time...");
 		return 0;
 	}
-	const cpp_dec_float_50 &nInterestBlockTerm = fUnitTest ? cpp_dec_float_50(ONE_HOUR_IN_BLOCKS) : cpp_dec_float_50(ONE_YEAR_IN_BLOCKS);
-	const cpp_dec_float_50 &nBlockDifference = cpp_dec_float_50(nHeight - assetAllocation.nLastInterestClaimHeight);
+	const int &nInterestBlockTerm = fUnitTest ? ONE_HOUR_IN_BLOCKS : ONE_YEAR_IN_BLOCKS;
+	const int &nBlockDifference = nHeight - assetAllocation.nLastInterestClaimHeight;
 
 	// apply compound annual interest to get total interest since last time interest was collected
-	const cpp_dec_float_50& nBalanceOverTimeDifference = cpp_dec_float_50(assetAllocation.nAccumulatedBalanceSinceLastInterestClaim / nBlockDifference);
-	const cpp_dec_float_50& fInterestOverTimeDifference = cpp_dec_float_50(assetAllocation.fAccumulatedInterestSinceLastInterestClaim / nBlockDifference);
-	const cpp_dec_float_50& nInterestPerBlock = fInterestOverTimeDifference / nInterestBlockTerm;
-	const cpp_dec_float_50& powcalc = (boost::multiprecision::pow(cpp_dec_float_50(1.0) + nInterestPerBlock, nBlockDifference)*nBalanceOverTimeDifference) - nBalanceOverTimeDifference;
-	return powcalc.convert_to<CAmount>();
+	if (pInterestBatch)
+		return pInterestBatch->GetCompoundInterest(assetAllocation.nAccumulatedBalanceSinceLastInterestClaim, assetAllocation.fAccumulatedInterestSinceLastInterestClaim, nBlockDifference, nInterestBlockTerm);
+	return GetCompoundInterest(assetAllocation.nAccumulatedBalanceSinceLastInterestClaim, assetAllocation.fAccumulatedInterestSinceLastInterestClaim, nBlockDifference, nInterestBlockTerm);
 }
 bool ApplyAssetAllocationInterest(CAsset& asset, CAssetAllocation & assetAllocation, const int& nHeight, string& errorMessage) {
 	CAmount nInterest = GetAssetAllocationInterest(assetAllocation, nHeight, errorMessage);
@@ -325,7 +330,7 @@ bool AccumulateInterestSinceLastClaim(CAssetAllocation & assetAllocation, const
 	assetAllocation.fAccumulatedInterestSinceLastInterestClaim += assetAllocation.fInterestRate*nBlocksSinceLastUpdate;
 	return true;
 }
-bool CheckAssetAllocationInputs(const CTransaction &tx, const CCoinsViewCache &inputs, int op, const vector<vector<unsigned char> > &vvchArgs, const vector<unsigned char> &vchAlias,
+bool CheckAssetAllocationInputs(const CTransaction &tx, const CCoinsViewCache &inputs, const CServicePayload &payload, const vector<unsigned char> &vchAlias,
         bool fJustCheck, int nHeight, sorted_vector<CAssetAllocationTuple> &revertedAssetAllocations, string &errorMessage, bool bSanityCheck) {
 	if (!paliasdb || !passetallocationdb)
 		return false;
@@ -334,21 +339,22 @@ bool CheckAssetAllocationInputs(const CTransaction &tx, const CCoinsViewCache &i
 		LogPrintf("*Trying to add assetallocation in coinbase transaction, skipping...");
 		return true;
 	}
+	// nHeight is the tip height plus one, the chain is not read here as blocks connect sends concurrently
 	if (fDebug && !bSanityCheck)
-		LogPrintf("*** ASSET ALLOCATION %d %d %s %s\n", nHeight,
-			chainActive.Tip()->nHeight, tx.GetHash().ToString().c_str(),
+		LogPrintf("*** ASSET ALLOCATION %d %s %s\n", nHeight,
+			tx.GetHash().ToString().c_str(),
 			fJustCheck ? "JUSTCHECK" : "BLOCK");
 
-	// unserialize assetallocation from txn, check for valid
-	CAssetAllocation theAssetAllocation;
-	vector<unsigned char> vchData;
-	vector<unsigned char> vchHash;
-	int nDataOut;
-	if(!GetBilliecoinData(tx, vchData, vchHash, nDataOut) || !theAssetAllocation.UnserializeFromData(vchData, vchHash))
+	// the assetallocation was unserialized from the txn with the payload, check for valid
+	const int op = payload.nOp;
+	const CServiceArgs &vvchArgs = payload.vvchArgs;
+	const vector<unsigned char> &vchHash = payload.vchDataHash;
+	if(!payload.assetAllocation)
 	{
 		errorMessage = "BILLIECOIN_ASSET_ALLOCATION_CONSENSUS_ERROR ERRCODE: 1001 - " + _("Cannot unserialize data inside of this transaction relating to an assetallocation");
 		return true;
 	}
+	CAssetAllocation theAssetAllocation(*payload.assetAllocation);
 
 	if(fJustCheck)
 	{
@@ -470,7 +476,12 @@ bool CheckAssetAllocationInputs(const CTransaction &tx, const CCoinsViewCache &i
 	}
 	else if (op == OP_ASSET_ALLOCATION_SEND)
 	{
-		LOCK(cs_assetallocation);
+		// keeps a send atomic against other sends of the same allocation. Block connect with staged
+		// writes reads its own reverted state and runs all sends of an asset on one thread, see
+		// CheckBilliecoinInputs, so sends of different assets can be connected concurrently there
+		std::unique_ptr<CCriticalBlock> lockAllocation;
+		if (fJustCheck || !CDBStagedWrites::GetActive())
+			lockAllocation.reset(new CCriticalBlock(cs_assetallocation, "cs_assetallocation", __FILE__, __LINE__));
 		if (!vchAlias.empty() && CBilliecoinAddress(user1).IsValid()) {
 			errorMessage = "BILLIECOIN_ASSET_ALLOCATION_CONSENSUS_ERROR: ERRCODE: 1016 - " + _("This asset allocation cannot be spent because owner is an alias but the alias is also a valid billiecoin address");
 			return true;
@@ -703,10 +714,9 @@ bool CheckAssetAllocationInputs(const CTransaction &tx, const CCoinsViewCache &i
 						receiverAllocation.nHeight = nHeight;
 						receiverAllocation.vchMemo = theAssetAllocation.vchMemo;
 						// figure out receivers added ranges and balance
-						vector<CRange> outputMerge;
-						receiverAllocation.listAllocationInputs.insert(std::end(receiverAllocation.listAllocationInputs), std::begin(input.second), std::end(input.second));
-						mergeRanges(receiverAllocation.listAllocationInputs, outputMerge);
-						receiverAllocation.listAllocationInputs = outputMerge;
+						CRangeSet receiverRanges(receiverAllocation.listAllocationInputs);
+						receiverRanges.Add(input.second);
+						receiverAllocation.listAllocationInputs = receiverRanges.GetRanges();
 						const CAmount prevBalance = receiverAllocation.nBalance;
 						receiverAllocation.nBalance += rangeTotals[i];
 
@@ -846,7 +856,7 @@ UniValue tpstestadd(const JSONRPCRequest& request) {
 		}
 		if (bFirstTime) {
 			// define a task for the worker to process
-			std::packaged_task<void()> task([]() {
+			CValidationExecutor::Task task([]() {
 				while (nTPSTestingStartTime <= 0 || GetTimeMicros() < nTPSTestingStartTime) {
 					MilliSleep(0);
 				}
@@ -857,18 +867,8 @@ UniValue tpstestadd(const JSONRPCRequest& request) {
 				}
 				nTPSTestingSendRawElapsedTime = GetTimeMicros() - nStart;
 			});
-			bool isThreadPosted = false;
-			for (int numTries = 1; numTries <= 50; numTries++)
-			{
-				// send task to threadpool pointer from init.cpp
-				isThreadPosted = threadpool->tryPost(task);
-				if (isThreadPosted)
-				{
-					break;
-				}
-				MilliSleep(10);
-			}
-			if (!isThreadPosted)
+			// send task to threadpool pointer from init.cpp
+			if (!threadpool->Submit(THREADPOOL_LOCAL_NODE, task))
 				throw runtime_error("BILLIECOIN_ASSET_ALLOCATION_RPC_ERROR: ERRCODE: 1501 - " + _("thread pool queue is full"));
 		}
 	}
@@ -990,18 +990,15 @@ UniValue assetallocationsend(const JSONRPCRequest& request) {
 	CScript scriptPubKey;
 
 	// check to see if a transaction for this asset/address tuple has arrived before minimum latency period
-	ArrivalTimesMap arrivalTimes;
+	ArrivalTimesList arrivalTimes;
 	passetallocationdb->ReadISArrivalTimes(assetAllocationTuple, arrivalTimes);
 	const int64_t & nNow = GetTimeMillis();
-        
-	for (auto& arrivalTime : arrivalTimes) {
-		int minLatency = ZDAG_MINIMUM_LATENCY_SECONDS*1000;
-		if (fUnitTest)
-			minLatency = 1000;
-		// if this tx arrived within the minimum latency period flag it as potentially conflicting
-		if ((nNow - arrivalTime.second) < minLatency) {
-			throw runtime_error("BILLIECOIN_ASSET_ALLOCATION_RPC_ERROR: ERRCODE: 1503 - " + _("Please wait a few more seconds and try again..."));
-		}
+	int minLatency = ZDAG_MINIMUM_LATENCY_SECONDS*1000;
+	if (fUnitTest)
+		minLatency = 1000;
+	// list is in arrival order so only the latest send can fall within the minimum latency period
+	if (!arrivalTimes.empty() && (nNow - arrivalTimes.back().second) < minLatency) {
+		throw runtime_error("BILLIECOIN_ASSET_ALLOCATION_RPC_ERROR: ERRCODE: 1503 - " + _("Please wait a few more seconds and try again..."));
 	}
 	
 	if (assetAllocationConflicts.find(assetAllocationTuple) != assetAllocationConflicts.end())
@@ -1144,10 +1141,10 @@ UniValue assetallocationinfo(const JSONRPCRequest& request) {
 		oAssetAllocation.clear();
     return oAssetAllocation;
 }
-int DetectPotentialAssetAllocationSenderConflicts(const CAssetAllocationTuple& assetAllocationTupleSender, const uint256& lookForTxHash) {
+int DetectPotentialAssetAllocationSenderConflicts(const CAssetAllocationTuple& assetAllocationTupleSender, const uint256& lookForTxHash, const int64_t& nNow) {
 	LOCK2(cs_main, mempool.cs);
 	CAssetAllocation dbLastAssetAllocation, dbAssetAllocation;
-	ArrivalTimesMap arrivalTimes;
+	ArrivalTimesList arrivalTimes;
 	// get last POW asset allocation balance to ensure we use POW balance to check for potential conflicts in mempool (real-time balances).
 	// The idea is that real-time spending amounts can in some cases overrun the POW balance safely whereas in some cases some of the spends are 
 	// put in another block due to not using enough fees or for other reasons that miners don't mine them.
@@ -1160,28 +1157,14 @@ int DetectPotentialAssetAllocationSenderConflicts(const CAssetAllocationTuple& a
 
 	// ensure that this transaction exists in the arrivalTimes DB (which is the running stored lists of all real-time asset allocation sends not in POW)
 	// the arrivalTimes DB is only added to for valid asset allocation sends that happen in real-time and it is removed once there is POW on that transaction
+	// the log is keyed by arrival time so it comes back already sorted ascending
 	if(!passetallocationdb->ReadISArrivalTimes(assetAllocationTupleSender, arrivalTimes))
 		return ZDAG_NOT_FOUND;
-	// sort the arrivalTimesMap ascending based on arrival time value
-
-	// Declaring the type of Predicate for comparing arrivalTimesMap
-	typedef std::function<bool(std::pair<uint256, int64_t>, std::pair<uint256, int64_t>)> Comparator;
-
-	// Defining a lambda function to compare two pairs. It will compare two pairs using second field
-	Comparator compFunctor =
-		[](std::pair<uint256, int64_t> elem1, std::pair<uint256, int64_t> elem2)
-	{
-		return elem1.second < elem2.second;
-	};
-
-	// Declaring a set that will store the pairs using above comparision logic
-	std::set<std::pair<uint256, int64_t>, Comparator> arrivalTimesSet(
-		arrivalTimes.begin(), arrivalTimes.end(), compFunctor);
 
 	// go through arrival times and check that balances don't overrun the POW balance
 	CAmount nRealtimeBalanceRequired = 0;
 	pair<uint256, int64_t> lastArrivalTime;
-	lastArrivalTime.second = GetTimeMillis();
+	lastArrivalTime.second = nNow;
 	map<vector<unsigned char>, CAmount> mapBalances;
 	// init sender balance, track balances by address
 	// this is important because asset allocations can be sent/received within blocks and will overrun balances prematurely if not tracked properly, for example pow balance 3, sender sends 3, gets 2 sends 2 (total send 3+2=5 > balance of 3 from last stored state, this is a valid scenario and shouldn't be flagged)
@@ -1190,7 +1173,7 @@ int DetectPotentialAssetAllocationSenderConflicts(const CAssetAllocationTuple& a
 	int minLatency = ZDAG_MINIMUM_LATENCY_SECONDS * 1000;
 	if (fUnitTest)
 		minLatency = 1000;
-	for (auto& arrivalTime : arrivalTimesSet)
+	for (auto& arrivalTime : arrivalTimes)
 	{
 		// ensure mempool has this transaction and it is not yet mined, get the transaction in question
 		const CTransactionRef txRef = mempool.get(arrivalTime.first);
@@ -1204,9 +1187,10 @@ int DetectPotentialAssetAllocationSenderConflicts(const CAssetAllocationTuple& a
 		}
 		const uint256& txHash = tx.GetHash();
 		// get asset allocation object from this tx, if for some reason it doesn't have it, just skip (shouldn't happen)
-		CAssetAllocation assetallocation(tx);
-		if (assetallocation.IsNull())
+		const CServicePayloadRef payload = GetServicePayload(tx);
+		if (!payload->assetAllocation)
 			continue;
+		const CAssetAllocation &assetallocation = *payload->assetAllocation;
 
 		if (!assetallocation.listSendingAllocationAmounts.empty()) {
 			for (auto& amountTuple : assetallocation.listSendingAllocationAmounts) {
@@ -1241,6 +1225,224 @@ int DetectPotentialAssetAllocationSenderConflicts(const CAssetAllocationTuple& a
 		return ZDAG_NOT_FOUND;
 	return lookForTxHash.IsNull()? ZDAG_STATUS_OK: ZDAG_NOT_FOUND;
 }
+void CAssetAllocationSenderLedger::Append(const CAssetAllocationTuple& assetAllocationTuple, CLedgerSender& sender, const CTransaction& tx, const int64_t& arrivalTime) {
+	const int nIndex = sender.vecTx.size();
+	CLedgerTx ledgerTx;
+	ledgerTx.txHash = tx.GetHash();
+	ledgerTx.nArrivalTime = arrivalTime;
+	const CServicePayloadRef payload = GetServicePayload(tx);
+	ledgerTx.bAllocation = payload->assetAllocation != nullptr;
+	sender.vecTx.push_back(ledgerTx);
+	sender.mapTxIndex[ledgerTx.txHash] = nIndex;
+	if (!ledgerTx.bAllocation)
+		return;
+	const CAssetAllocation &assetallocation = *payload->assetAllocation;
+	// same running balance as the DB replay, a send back to the sender itself is credited before the overrun check
+	if (!assetallocation.listSendingAllocationAmounts.empty()) {
+		for (auto& amountTuple : assetallocation.listSendingAllocationAmounts) {
+			sender.nRunningBalance -= amountTuple.second;
+			if (amountTuple.first == assetAllocationTuple.vchAliasOrAddress)
+				sender.nRunningBalance += amountTuple.second;
+			if (sender.nRunningBalance < 0 && sender.nFirstOverrun < 0)
+				sender.nFirstOverrun = nIndex;
+		}
+	}
+	else if (!assetallocation.listSendingAllocationInputs.empty()) {
+		for (auto& inputTuple : assetallocation.listSendingAllocationInputs) {
+			const unsigned int &rangeCount = validateRangesAndGetCount(inputTuple.second);
+			if (rangeCount == 0)
+				continue;
+			sender.nRunningBalance -= rangeCount;
+			if (inputTuple.first == assetAllocationTuple.vchAliasOrAddress)
+				sender.nRunningBalance += rangeCount;
+			if (sender.nRunningBalance < 0 && sender.nFirstOverrun < 0)
+				sender.nFirstOverrun = nIndex;
+		}
+	}
+}
+bool CAssetAllocationSenderLedger::Build(const CAssetAllocationTuple& assetAllocationTuple, CLedgerSender& sender) {
+	AssertLockHeld(cs_main);
+	AssertLockHeld(mempool.cs);
+	AssertLockHeld(cs);
+	CAssetAllocation dbLastAssetAllocation, dbAssetAllocation;
+	ArrivalTimesList arrivalTimes;
+	if (!passetallocationdb || !passetallocationdb->ReadLastAssetAllocation(assetAllocationTuple, dbLastAssetAllocation))
+		return false;
+	if (!passetallocationdb->ReadAssetAllocation(assetAllocationTuple, dbAssetAllocation))
+		return false;
+	if (!passetallocationdb->ReadISArrivalTimes(assetAllocationTuple, arrivalTimes))
+		return false;
+	sender.nRunningBalance = dbLastAssetAllocation.nBalance;
+	sender.nRealtimeBalance = dbAssetAllocation.nBalance;
+	sender.nFirstOverrun = -1;
+	sender.vecTx.clear();
+	sender.mapTxIndex.clear();
+	sender.vecTx.reserve(arrivalTimes.size());
+	for (auto& arrivalTime : arrivalTimes) {
+		const CTransactionRef txRef = mempool.get(arrivalTime.first);
+		if (!txRef)
+			continue;
+		Append(assetAllocationTuple, sender, *txRef, arrivalTime.second);
+	}
+	return true;
+}
+int CAssetAllocationSenderLedger::Lookup(const CLedgerSender& sender, const uint256& txid, const int64_t& nNow) const {
+	int nLast = sender.vecTx.size() - 1;
+	bool bMatch = false;
+	if (!txid.IsNull()) {
+		auto it = sender.mapTxIndex.find(txid);
+		if (it != sender.mapTxIndex.end() && sender.vecTx[it->second].bAllocation) {
+			nLast = it->second;
+			bMatch = true;
+		}
+	}
+	int minLatency = ZDAG_MINIMUM_LATENCY_SECONDS * 1000;
+	if (fUnitTest)
+		minLatency = 1000;
+	// the replay flags any send up to the one looked for that arrived within the minimum latency of now,
+	// entries are in arrival order so only the first one after (now - latency) needs checking
+	auto itLatency = std::upper_bound(sender.vecTx.begin(), sender.vecTx.begin() + nLast + 1, nNow - minLatency,
+		[](const int64_t& nTime, const CLedgerTx& ledgerTx) { return nTime < ledgerTx.nArrivalTime; });
+	if (itLatency != sender.vecTx.begin() + nLast + 1 && itLatency->nArrivalTime < nNow + minLatency)
+		return ZDAG_MINOR_CONFLICT;
+	if (sender.nFirstOverrun >= 0 && sender.nFirstOverrun <= nLast)
+		return ZDAG_MINOR_CONFLICT;
+	if (bMatch)
+		return ZDAG_STATUS_OK;
+	if (!txid.IsNull())
+		return ZDAG_NOT_FOUND;
+	return sender.nRunningBalance == sender.nRealtimeBalance ? ZDAG_STATUS_OK : ZDAG_NOT_FOUND;
+}
+void CAssetAllocationSenderLedger::AddArrival(const CAssetAllocationTuple& assetAllocationTuple, const CTransaction& tx, const int64_t& arrivalTime) {
+	AssertLockHeld(cs);
+	auto it = mapSenders.find(assetAllocationTuple);
+	if (it == mapSenders.end())
+		return;
+	CLedgerSender& sender = it->second;
+	const uint256& txHash = tx.GetHash();
+	if (sender.mapTxIndex.count(txHash))
+		return;
+	// only a send landing after everything already replayed can be appended, anything else reorders the replay
+	if (!sender.vecTx.empty()) {
+		const CLedgerTx& last = sender.vecTx.back();
+		if (arrivalTime < last.nArrivalTime || (arrivalTime == last.nArrivalTime && txHash < last.txHash)) {
+			mapSenders.erase(it);
+			return;
+		}
+	}
+	Append(assetAllocationTuple, sender, tx, arrivalTime);
+}
+void CAssetAllocationSenderLedger::ConnectMempool(CTxMemPool& pool) {
+	pool.NotifyEntryAdded.connect(boost::bind(&CAssetAllocationSenderLedger::TransactionAddedToMempool, this, _1));
+	pool.NotifyEntryRemoved.connect(boost::bind(&CAssetAllocationSenderLedger::TransactionRemovedFromMempool, this, _1, _2));
+}
+void CAssetAllocationSenderLedger::DisconnectMempool(CTxMemPool& pool) {
+	pool.NotifyEntryAdded.disconnect(boost::bind(&CAssetAllocationSenderLedger::TransactionAddedToMempool, this, _1));
+	pool.NotifyEntryRemoved.disconnect(boost::bind(&CAssetAllocationSenderLedger::TransactionRemovedFromMempool, this, _1, _2));
+	Clear();
+}
+void CAssetAllocationSenderLedger::ArrivalTimeWritten(const CAssetAllocationTuple& assetAllocationTuple, const uint256& txid, const int64_t& arrivalTime) {
+	// the replay skips sends that are not in the mempool yet, TransactionAddedToMempool picks those up later
+	const CTransactionRef txRef = mempool.get(txid);
+	if (!txRef)
+		return;
+	LOCK(cs);
+	AddArrival(assetAllocationTuple, *txRef, arrivalTime);
+}
+void CAssetAllocationSenderLedger::RealtimeBalanceWritten(const CAssetAllocationTuple& assetAllocationTuple, const CAmount& nBalance) {
+	LOCK(cs);
+	auto it = mapSenders.find(assetAllocationTuple);
+	if (it != mapSenders.end())
+		it->second.nRealtimeBalance = nBalance;
+}
+void CAssetAllocationSenderLedger::Invalidate(const CAssetAllocationTuple& assetAllocationTuple) {
+	LOCK(cs);
+	mapSenders.erase(assetAllocationTuple);
+}
+void CAssetAllocationSenderLedger::InvalidateAsset(const vector<unsigned char>& vchAsset) {
+	LOCK(cs);
+	for (auto it = mapSenders.begin(); it != mapSenders.end();) {
+		if (it->first.vchAsset == vchAsset)
+			it = mapSenders.erase(it);
+		else
+			++it;
+	}
+}
+void CAssetAllocationSenderLedger::Clear() {
+	LOCK(cs);
+	mapSenders.clear();
+}
+// the sender CheckAssetAllocationInputs replays a send for: the alias of the alias input, which the alias output
+// of the send carries on, or else the owner named in the allocation. False if the send names neither
+static bool GetLedgerSender(const CServicePayload& payload, CAssetAllocationTuple& assetAllocationTuple) {
+	const CAssetAllocation &assetallocation = *payload.assetAllocation;
+	if (payload.fAliasOutput && !payload.vvchAliasArgs.empty() && !payload.vvchAliasArgs[0].empty())
+		assetAllocationTuple = CAssetAllocationTuple(assetallocation.vchAsset, payload.vvchAliasArgs[0].ToVch());
+	else if (!assetallocation.vchAliasOrAddress.empty())
+		assetAllocationTuple = CAssetAllocationTuple(assetallocation.vchAsset, assetallocation.vchAliasOrAddress);
+	else
+		return false;
+	return true;
+}
+void CAssetAllocationSenderLedger::TransactionAddedToMempool(CTransactionRef ptx) {
+	const CTransaction& tx = *ptx;
+	const CServicePayloadRef payload = GetServicePayload(tx);
+	if (!payload->IsAssetAllocation() || !payload->assetAllocation)
+		return;
+	CAssetAllocationTuple assetAllocationTuple;
+	// a sender that cannot be told can only be one of the senders of the asset
+	if (!GetLedgerSender(*payload, assetAllocationTuple)) {
+		InvalidateAsset(payload->assetAllocation->vchAsset);
+		return;
+	}
+	int64_t arrivalTime;
+	if (!passetallocationdb || !passetallocationdb->ReadISArrivalTime(assetAllocationTuple, tx.GetHash(), arrivalTime))
+		return;
+	LOCK(cs);
+	AddArrival(assetAllocationTuple, tx, arrivalTime);
+}
+void CAssetAllocationSenderLedger::TransactionRemovedFromMempool(CTransactionRef ptx, MemPoolRemovalReason reason) {
+	const CTransaction& tx = *ptx;
+	const CServicePayloadRef payload = GetServicePayload(tx);
+	if (!payload->IsAssetAllocation() || !payload->assetAllocation)
+		return;
+	CAssetAllocationTuple assetAllocationTuple;
+	if (!GetLedgerSender(*payload, assetAllocationTuple)) {
+		InvalidateAsset(payload->assetAllocation->vchAsset);
+		return;
+	}
+	Invalidate(assetAllocationTuple);
+}
+int CAssetAllocationSenderLedger::GetSenderStatus(const CAssetAllocationTuple& assetAllocationTuple, const uint256& txid) {
+	if (!fCheckConsistency) {
+		LOCK(cs);
+		auto it = mapSenders.find(assetAllocationTuple);
+		if (it != mapSenders.end())
+			return Lookup(it->second, txid, GetTimeMillis());
+	}
+	LOCK2(cs_main, mempool.cs);
+	LOCK(cs);
+	const int64_t nNow = GetTimeMillis();
+	auto it = mapSenders.find(assetAllocationTuple);
+	if (it == mapSenders.end()) {
+		CLedgerSender sender;
+		if (!Build(assetAllocationTuple, sender))
+			return ZDAG_NOT_FOUND;
+		it = mapSenders.emplace(assetAllocationTuple, std::move(sender)).first;
+	}
+	const int nStatus = Lookup(it->second, txid, nNow);
+	if (fCheckConsistency) {
+		const int nReplayStatus = DetectPotentialAssetAllocationSenderConflicts(assetAllocationTuple, txid, nNow);
+		if (nStatus != nReplayStatus)
+			LogPrintf("CAssetAllocationSenderLedger::GetSenderStatus: ledger status %d does not match DB replay status %d for %s txid %s\n", nStatus, nReplayStatus, assetAllocationTuple.ToString(), txid.GetHex());
+		assert(nStatus == nReplayStatus);
+	}
+	return nStatus;
+}
+size_t CAssetAllocationSenderLedger::Size() const {
+	LOCK(cs);
+	return mapSenders.size();
+}
 UniValue assetallocationsenderstatus(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
 	if (request.fHelp || 3 != params.size())
@@ -1267,12 +1469,12 @@ UniValue assetallocationsenderstatus(const JSONRPCRequest& request) {
 	if (assetAllocationConflicts.find(assetAllocationTupleSender) != assetAllocationConflicts.end())
 		nStatus = ZDAG_MAJOR_CONFLICT;
 	else {
-		nStatus = DetectPotentialAssetAllocationSenderConflicts(assetAllocationTupleSender, txid);
+		nStatus = assetAllocationSenderLedger.GetSenderStatus(assetAllocationTupleSender, txid);
 	}
 	oAssetAllocationStatus.push_back(Pair("status", nStatus));
 	return oAssetAllocationStatus;
 }
-bool BuildAssetAllocationJson(CAssetAllocation& assetallocation, const CAsset& asset, const bool bGetInputs, UniValue& oAssetAllocation)
+bool BuildAssetAllocationJson(CAssetAllocation& assetallocation, const CAsset& asset, const bool bGetInputs, UniValue& oAssetAllocation, CCompoundInterestBatch* pInterestBatch)
 {
     oAssetAllocation.push_back(Pair("_id", CAssetAllocationTuple(assetallocation.vchAsset, assetallocation.vchAliasOrAddress).ToString()));
 	oAssetAllocation.push_back(Pair("asset", stringFromVch(assetallocation.vchAsset)));
@@ -1295,10 +1497,10 @@ bool BuildAssetAllocationJson(CAssetAllocation& assetallocation, const CAsset& a
 		oAssetAllocation.push_back(Pair("inputs", oAssetAllocationInputsArray));
 	}
 	string errorMessage;
-	oAssetAllocation.push_back(Pair("accumulated_interest", ValueFromAssetAmount(GetAssetAllocationInterest(assetallocation, chainActive.Tip()->nHeight, errorMessage), asset.nPrecision, asset.bUseInputRanges)));
+	oAssetAllocation.push_back(Pair("accumulated_interest", ValueFromAssetAmount(GetAssetAllocationInterest(assetallocation, chainActive.Tip()->nHeight, errorMessage, pInterestBatch), asset.nPrecision, asset.bUseInputRanges)));
 	return true;
 }
-bool BuildAssetAllocationIndexerJson(const CAssetAllocation& assetallocation, const CAsset& asset, const CAmount& nSenderBalance, const CAmount& nAmount, const string& strSender, const string& strReceiver, bool &isMine, UniValue& oAssetAllocation)
+bool BuildAssetAllocationIndexEntry(const CAssetAllocation& assetallocation, const CAsset& asset, const CAmount& nSenderBalance, const CAmount& nAmount, const string& strSender, const string& strReceiver, bool &isMine, CAssetAllocationIndexEntry& entry)
 {
 	CAmount nAmountDisplay = nAmount;
 	int64_t nTime = 0;
@@ -1311,21 +1513,19 @@ bool BuildAssetAllocationIndexerJson(const CAssetAllocation& assetallocation, co
 		}
 	}
 
-	oAssetAllocation.push_back(Pair("_id", CAssetAllocationTuple(assetallocation.vchAsset, assetallocation.vchAliasOrAddress).ToString()));
-	oAssetAllocation.push_back(Pair("txid", assetallocation.txHash.GetHex()));
-	oAssetAllocation.push_back(Pair("time", nTime));
-	oAssetAllocation.push_back(Pair("asset", stringFromVch(assetallocation.vchAsset)));
-	oAssetAllocation.push_back(Pair("symbol", stringFromVch(asset.vchSymbol)));
-	oAssetAllocation.push_back(Pair("interest_rate", assetallocation.fInterestRate));
-	oAssetAllocation.push_back(Pair("height", (int)assetallocation.nHeight));
-	oAssetAllocation.push_back(Pair("sender", strSender));
-	oAssetAllocation.push_back(Pair("sender_balance", ValueFromAssetAmount(nSenderBalance, asset.nPrecision, asset.bUseInputRanges)));
-	oAssetAllocation.push_back(Pair("receiver", strReceiver));
-	oAssetAllocation.push_back(Pair("receiver_balance", ValueFromAssetAmount(assetallocation.nBalance, asset.nPrecision, asset.bUseInputRanges)));
-	oAssetAllocation.push_back(Pair("memo", stringFromVch(assetallocation.vchMemo)));
-	oAssetAllocation.push_back(Pair("confirmed", bConfirmed));
+	entry.vchAliasOrAddress = assetallocation.vchAliasOrAddress;
+	entry.nTime = nTime;
+	entry.vchSymbol = asset.vchSymbol;
+	entry.fInterestRate = assetallocation.fInterestRate;
+	entry.nHeight = assetallocation.nHeight;
+	entry.nSenderBalance = nSenderBalance;
+	entry.nReceiverBalance = assetallocation.nBalance;
+	entry.vchMemo = assetallocation.vchMemo;
+	entry.bConfirmed = bConfirmed;
+	entry.nPrecision = asset.nPrecision;
+	entry.bUseInputRanges = asset.bUseInputRanges;
+	entry.strCategory = "";
 	if (fAssetAllocationIndex) {
-		string strCat = "";
 		string strSenderTmp = strSender;
 		string strReceiverTmp = strReceiver;
 		CAliasIndex fromAlias;
@@ -1338,19 +1538,79 @@ bool BuildAssetAllocationIndexerJson(const CAssetAllocation& assetallocation, co
 			isminefilter filter = ISMINE_SPENDABLE;
 			isminefilter mine = IsMine(*pwalletMain, CBilliecoinAddress(strSenderTmp).Get());
 			if ((mine & filter)) {
-				strCat = "send";
+				entry.strCategory = "send";
 				nAmountDisplay *= -1;
 			}
 			else if(!strReceiverTmp.empty()){
 				mine = IsMine(*pwalletMain, CBilliecoinAddress(strReceiverTmp).Get());
 				if ((mine & filter))
-					strCat = "receive";
+					entry.strCategory = "receive";
 			}
 		}
-
-		oAssetAllocation.push_back(Pair("category", strCat));
 	}
-	oAssetAllocation.push_back(Pair("amount", ValueFromAssetAmount(nAmountDisplay, asset.nPrecision, asset.bUseInputRanges)));
+	entry.nAmount = nAmountDisplay;
+	return true;
+}
+void CAssetAllocationIndexEntry::ToJSON(const CAssetAllocationIndexKey& key, UniValue& oEntry) const
+{
+	oEntry.setObject();
+	oEntry.push_back(Pair("_id", CAssetAllocationTuple(vchFromString(key.strAsset), vchAliasOrAddress).ToString()));
+	oEntry.push_back(Pair("txid", key.txHash.GetHex()));
+	oEntry.push_back(Pair("time", nTime));
+	oEntry.push_back(Pair("asset", key.strAsset));
+	oEntry.push_back(Pair("symbol", stringFromVch(vchSymbol)));
+	oEntry.push_back(Pair("interest_rate", fInterestRate));
+	oEntry.push_back(Pair("height", (int)nHeight));
+	oEntry.push_back(Pair("sender", key.strSender));
+	oEntry.push_back(Pair("sender_balance", ValueFromAssetAmount(nSenderBalance, nPrecision, bUseInputRanges)));
+	oEntry.push_back(Pair("receiver", key.strReceiver));
+	oEntry.push_back(Pair("receiver_balance", ValueFromAssetAmount(nReceiverBalance, nPrecision, bUseInputRanges)));
+	oEntry.push_back(Pair("memo", stringFromVch(vchMemo)));
+	oEntry.push_back(Pair("confirmed", bConfirmed));
+	oEntry.push_back(Pair("category", strCategory));
+	oEntry.push_back(Pair("amount", ValueFromAssetAmount(nAmount, nPrecision, bUseInputRanges)));
+}
+// read an entry from the json older versions stored, the amounts are read with the precision
+// of the asset or, for an asset no longer known, with as many decimals as they were written with
+bool CAssetAllocationIndexEntry::FromJSON(const UniValue& oEntry)
+{
+	SetNull();
+	if (!oEntry.isObject())
+		return false;
+	const string strAsset = find_value(oEntry, "asset").getValStr();
+	const string strId = find_value(oEntry, "_id").getValStr();
+	if (strId.compare(0, strAsset.size() + 1, strAsset + "-") == 0)
+		vchAliasOrAddress = vchFromString(strId.substr(strAsset.size() + 1));
+	CAsset asset;
+	if (GetAsset(vchFromString(strAsset), asset)) {
+		nPrecision = asset.nPrecision;
+		bUseInputRanges = asset.bUseInputRanges;
+	}
+	else {
+		const string strAmount = find_value(oEntry, "amount").getValStr();
+		const size_t nPoint = strAmount.find('.');
+		nPrecision = nPoint == string::npos ? 0 : std::min<size_t>(strAmount.size() - nPoint - 1, 8);
+	}
+	const int nDecimals = bUseInputRanges ? 0 : nPrecision;
+	if (!ParseFixedPoint(find_value(oEntry, "sender_balance").getValStr(), nDecimals, &nSenderBalance) ||
+		!ParseFixedPoint(find_value(oEntry, "receiver_balance").getValStr(), nDecimals, &nReceiverBalance) ||
+		!ParseFixedPoint(find_value(oEntry, "amount").getValStr(), nDecimals, &nAmount))
+		return false;
+	const UniValue& time = find_value(oEntry, "time");
+	if (time.isNum())
+		nTime = time.get_int64();
+	const UniValue& height = find_value(oEntry, "height");
+	if (height.isNum())
+		nHeight = height.get_int();
+	const UniValue& interestRate = find_value(oEntry, "interest_rate");
+	if (interestRate.isNum())
+		fInterestRate = interestRate.get_real();
+	const UniValue& confirmed = find_value(oEntry, "confirmed");
+	if (confirmed.isBool())
+		bConfirmed = confirmed.get_bool();
+	vchSymbol = vchFromString(find_value(oEntry, "symbol").getValStr());
+	vchMemo = vchFromString(find_value(oEntry, "memo").getValStr());
+	strCategory = find_value(oEntry, "category").getValStr();
 	return true;
 }
 void AssetAllocationTxToJSON(const int op, const std::vector<unsigned char> &vchData, const std::vector<unsigned char> &vchHash, UniValue &entry)
@@ -1395,23 +1655,87 @@ void AssetAllocationTxToJSON(const int op, const std::vector<unsigned char> &vch
 
 
 }
-bool CAssetAllocationTransactionsDB::ScanAssetAllocationIndex(const int count, const int from, const UniValue& oOptions, UniValue& oRes) {
+bool CAssetAllocationTransactionsDB::WriteAssetAllocationIndexEntry(const CAssetAllocationIndexKey& key, const CAssetAllocationIndexEntry& entry) {
+	CDBBatch batch(*this);
+	batch.Write(make_pair(string("assetallocationtxr"), key), entry);
+	batch.Write(make_pair(string("assetallocationtxa"), make_pair(key.strAsset, key)), string());
+	if (!WriteBatch(batch))
+		return false;
+	LOCK(cs);
+	cacheEntries.Erase(key);
+	cacheEntries.Insert(key, entry);
+	return true;
+}
+bool CAssetAllocationTransactionsDB::ReadAssetAllocationIndexEntry(const CAssetAllocationIndexKey& key, CAssetAllocationIndexEntry& entry) {
+	{
+		LOCK(cs);
+		if (cacheEntries.Get(key, entry)) {
+			cacheEntries.Erase(key);
+			cacheEntries.Insert(key, entry);
+			return true;
+		}
+	}
+	if (!Read(make_pair(string("assetallocationtxr"), key), entry))
+		return false;
+	LOCK(cs);
+	cacheEntries.Insert(key, entry);
+	return true;
+}
+// move the entries older versions stored as json, in the whole-map blob or under their own keys, to typed entries
+bool CAssetAllocationTransactionsDB::UpgradeAssetAllocationIndex() {
+	CDBBatch batch(*this);
+	int nUpgraded = 0;
+	map<int, map<string, string> > mapIndex;
+	if (Read(string("assetallocationtxi"), mapIndex)) {
+		for (auto& indexObj : mapIndex) {
+			for (auto& indexItem : indexObj.second) {
+				UniValue oEntry;
+				CAssetAllocationIndexEntry entry;
+				if (!oEntry.read(indexItem.second) || !entry.FromJSON(oEntry))
+					continue;
+				const CAssetAllocationIndexKey key(indexObj.first, uint256S(find_value(oEntry, "txid").getValStr()), find_value(oEntry, "asset").getValStr(), find_value(oEntry, "sender").getValStr(), find_value(oEntry, "receiver").getValStr());
+				batch.Write(make_pair(string("assetallocationtxr"), key), entry);
+				batch.Write(make_pair(string("assetallocationtxa"), make_pair(key.strAsset, key)), string());
+				nUpgraded++;
+			}
+		}
+		batch.Erase(string("assetallocationtxi"));
+	}
+	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+	pcursor->Seek(string("assetallocationtxe"));
+	pair<string, CAssetAllocationIndexKey> key;
+	for (; pcursor->Valid(); pcursor->Next()) {
+		boost::this_thread::interruption_point();
+		if (!pcursor->GetKey(key) || key.first != "assetallocationtxe")
+			break;
+		string strEntry;
+		UniValue oEntry;
+		CAssetAllocationIndexEntry entry;
+		if (pcursor->GetValue(strEntry) && oEntry.read(strEntry) && entry.FromJSON(oEntry)) {
+			batch.Write(make_pair(string("assetallocationtxr"), key.second), entry);
+			nUpgraded++;
+		}
+		batch.Erase(key);
+	}
+	if (batch.SizeEstimate() == 0)
+		return true;
+	LogPrintf("Moved %d asset allocation index entries to typed entries\n", nUpgraded);
+	return WriteBatch(batch, true);
+}
+bool CAssetAllocationTransactionsDB::ScanAssetAllocationIndex(const int count, const int from, const UniValue& oOptions, RPCResultArray& oRes) {
 	string strTxid = "";
 	vector<string> vecSenders;
 	vector<string> vecReceivers;
 	string strAsset = "";
-	bool bParseKey = false;
 	int nStartBlock = 0;
 	if (!oOptions.isNull()) {
 		const UniValue &txid = find_value(oOptions, "txid");
 		if (txid.isStr()) {
 			strTxid = txid.get_str();
-			bParseKey = true;
 		}
 		const UniValue &asset = find_value(oOptions, "asset");
 		if (asset.isStr()) {
 			strAsset = asset.get_str();
-			bParseKey = true;
 		}
 		const UniValue &senders = find_value(oOptions, "senders");
 		if (senders.isArray()) {
@@ -1421,32 +1745,28 @@ bool CAssetAllocationTransactionsDB::ScanAssetAllocationIndex(const int count, c
 				const UniValue &senderAlias = find_value(sender, "sender_alias");
 				if (senderAlias.isStr()) {
 					vecSenders.push_back(senderAlias.get_str());
-					bParseKey = true;
 				}
 				else {
 					const UniValue &senderAddress = find_value(sender, "sender_address");
 					if (senderAddress.isStr()) {
 						vecSenders.push_back(senderAddress.get_str());
-						bParseKey = true;
 					}
 				}
 			}
 		}
 		const UniValue &receivers = find_value(oOptions, "receivers");
 		if (receivers.isArray()) {
-			const UniValue &receiversArray = senders.get_array();
+			const UniValue &receiversArray = receivers.get_array();
 			for (int i = 0; i < receiversArray.size(); i++) {
 				const UniValue &receiver = receiversArray[i].get_obj();
 				const UniValue &receiverAlias = find_value(receiver, "receiver_alias");
 				if (receiverAlias.isStr()) {
-					vecSenders.push_back(receiverAlias.get_str());
-					bParseKey = true;
+					vecReceivers.push_back(receiverAlias.get_str());
 				}
 				else {
 					const UniValue &receiverAddress = find_value(receiver, "receiver_address");
 					if (receiverAddress.isStr()) {
-						vecSenders.push_back(receiverAddress.get_str());
-						bParseKey = true;
+						vecReceivers.push_back(receiverAddress.get_str());
 					}
 				}
 			}
@@ -1457,32 +1777,44 @@ bool CAssetAllocationTransactionsDB::ScanAssetAllocationIndex(const int count, c
 		}
 	}
 	int index = 0;
-	UniValue assetValue;
-	vector<string> contents;
-	contents.reserve(5);
-	for (auto&indexObj : boost::adaptors::reverse(AssetAllocationIndex)) {
-		if (nStartBlock > 0 && indexObj.first < nStartBlock)
-			continue;
-		for (auto& indexItem : indexObj.second) {
-			if (bParseKey) {
-				boost::algorithm::split(contents, indexItem.first, boost::is_any_of("-"));
-				if (!strTxid.empty() && strTxid != contents[0])
-					continue;
-				if (!strAsset.empty() && strAsset != contents[1])
-					continue;
-				if (!vecSenders.empty() && std::find(vecSenders.begin(), vecSenders.end(), contents[2]) == vecSenders.end())
-					continue;
-				if (!vecReceivers.empty() && std::find(vecReceivers.begin(), vecReceivers.end(), contents[3]) == vecReceivers.end())
-					continue;
-			}
-			index += 1;
-			if (index <= from) {
-				continue;
-			}
-			if (assetValue.read(indexItem.second))
-				oRes.push_back(assetValue);
-			if (index >= count + from)
+	CAssetAllocationIndexEntry entry;
+	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+	// entries are keyed newest first, by themselves and under their asset
+	if (strAsset.empty())
+		pcursor->Seek(string("assetallocationtxr"));
+	else
+		pcursor->Seek(make_pair(string("assetallocationtxa"), strAsset));
+	for (; pcursor->Valid(); pcursor->Next()) {
+		boost::this_thread::interruption_point();
+		CAssetAllocationIndexKey indexKey;
+		if (strAsset.empty()) {
+			pair<string, CAssetAllocationIndexKey> key;
+			if (!pcursor->GetKey(key) || key.first != "assetallocationtxr")
 				break;
+			indexKey = key.second;
+		}
+		else {
+			pair<string, pair<string, CAssetAllocationIndexKey> > key;
+			if (!pcursor->GetKey(key) || key.first != "assetallocationtxa" || key.second.first != strAsset)
+				break;
+			indexKey = key.second.second;
+		}
+		if (nStartBlock > 0 && indexKey.nHeight < (unsigned int)nStartBlock)
+			break;
+		if (!strTxid.empty() && strTxid != indexKey.txHash.GetHex())
+			continue;
+		if (!vecSenders.empty() && std::find(vecSenders.begin(), vecSenders.end(), indexKey.strSender) == vecSenders.end())
+			continue;
+		if (!vecReceivers.empty() && std::find(vecReceivers.begin(), vecReceivers.end(), indexKey.strReceiver) == vecReceivers.end())
+			continue;
+		index += 1;
+		if (index <= from) {
+			continue;
+		}
+		if (ReadAssetAllocationIndexEntry(indexKey, entry)) {
+			UniValue oEntry;
+			entry.ToJSON(indexKey, oEntry);
+			oRes.push_back(oEntry);
 		}
 		if (index >= count + from)
 			break;
@@ -1490,15 +1822,71 @@ bool CAssetAllocationTransactionsDB::ScanAssetAllocationIndex(const int count, c
 	return true;
 }
 
-bool CAssetAllocationDB::ScanAssetAllocations(const int count, const int from, const UniValue& oOptions, UniValue& oRes) {
-	string strTxid = "";
+bool CAssetAllocationDB::ReadISArrivalTimes(const CAssetAllocationTuple& assetAllocationTuple, ArrivalTimesList& arrivalTimes) {
+	arrivalTimes.clear();
+	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+	pcursor->Seek(make_pair(string("assetallocationl"), assetAllocationTuple));
+	pair<string, CAssetAllocationArrivalKey> key;
+	while (pcursor->Valid()) {
+		boost::this_thread::interruption_point();
+		if (!pcursor->GetKey(key) || key.first != "assetallocationl" || key.second.assetAllocationTuple != assetAllocationTuple)
+			break;
+		arrivalTimes.push_back(make_pair(key.second.txHash, key.second.nArrivalTime));
+		pcursor->Next();
+	}
+	return !arrivalTimes.empty();
+}
+bool CAssetAllocationDB::EraseISArrivalTimes(const CAssetAllocationTuple& assetAllocationTuple) {
+	ArrivalTimesList arrivalTimes;
+	ReadISArrivalTimes(assetAllocationTuple, arrivalTimes);
+	CDBBatch batch(*this);
+	for (auto& arrivalTime : arrivalTimes) {
+		batch.Erase(make_pair(string("assetallocationl"), CAssetAllocationArrivalKey(assetAllocationTuple, arrivalTime.second, arrivalTime.first)));
+		batch.Erase(make_pair(string("assetallocationt"), make_pair(assetAllocationTuple, arrivalTime.first)));
+	}
+	if (!WriteBatch(batch))
+		return false;
+	assetAllocationSenderLedger.Invalidate(assetAllocationTuple);
+	return true;
+}
+// move the arrival times of the whole-map blobs written by older versions to the per-txid log
+bool CAssetAllocationDB::UpgradeArrivalTimes() {
+	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+	pcursor->Seek(string("assetallocationa"));
+	CDBBatch batch(*this);
+	pair<string, CAssetAllocationTuple> key;
+	int nUpgraded = 0;
+	while (pcursor->Valid()) {
+		boost::this_thread::interruption_point();
+		if (!pcursor->GetKey(key) || key.first != "assetallocationa")
+			break;
+		ArrivalTimesMap arrivalTimes;
+		if (!pcursor->GetValue(arrivalTimes))
+			return error("%s: cannot read the arrival times of %s", __func__, key.second.ToString());
+		for (auto& arrivalTime : arrivalTimes) {
+			// first arrival wins, same as WriteISArrivalTime
+			if (Exists(make_pair(string("assetallocationt"), make_pair(key.second, arrivalTime.first))))
+				continue;
+			batch.Write(make_pair(string("assetallocationl"), CAssetAllocationArrivalKey(key.second, arrivalTime.second, arrivalTime.first)), arrivalTime.second);
+			batch.Write(make_pair(string("assetallocationt"), make_pair(key.second, arrivalTime.first)), arrivalTime.second);
+		}
+		batch.Erase(key);
+		nUpgraded++;
+		pcursor->Next();
+	}
+	if (nUpgraded == 0)
+		return true;
+	LogPrintf("Moved the arrival times of %d asset allocations to their own keys\n", nUpgraded);
+	return WriteBatch(batch, true);
+}
+CServiceIndexEntry CAssetAllocationDB::GetIndexEntry(const CAssetAllocation& assetallocation) {
+	CServiceIndexEntry entry(assetallocation.nHeight, assetallocation.txHash);
+	entry.AddOwner(assetallocation.vchAliasOrAddress);
+	return entry;
+}
+bool CAssetAllocationDB::ScanAssetAllocations(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor) {
 	vector<unsigned char> vchAliasOrAddress, vchAsset;
-	int nStartBlock = 0;
 	if (!oOptions.isNull()) {
-		const UniValue &txid = find_value(oOptions, "txid");
-		if (txid.isStr()) {
-			strTxid = txid.get_str();
-		}
 		const UniValue &assetObj = find_value(oOptions, "asset");
 		if(assetObj.isStr()) {
 			vchAsset = vchFromValue(assetObj);
@@ -1512,74 +1900,52 @@ bool CAssetAllocationDB::ScanAssetAllocations(const int count, const int from, c
 		if (receiverAddress.isStr()) {
 			vchAliasOrAddress = vchFromValue(receiverAddress);
 		}
-
-		const UniValue &startblock = find_value(oOptions, "startblock");
-		if (startblock.isNum()) {
-			nStartBlock = startblock.get_int();
-		}
+		// the asset is the leading field of the allocation key
+		if (!vchAsset.empty() && !vchAliasOrAddress.empty())
+			scan.SetKey(CAssetAllocationTuple(vchAsset, vchAliasOrAddress));
+		else if (!vchAsset.empty())
+			scan.SetKey(vchAsset);
+		else
+			scan.AddOwner(vchAliasOrAddress);
 	}
 
-	LOCK(cs_assetallocation);
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
-	CAssetAllocation txPos;
-	pair<string, vector<unsigned char> > key;
 	bool bGetInputs = true;
 	CAsset theAsset;
-	int index = 0;
-	while (pcursor->Valid()) {
-		boost::this_thread::interruption_point();
-		try {
-			if (pcursor->GetKey(key) && key.first == "assetallocationi") {
-				pcursor->GetValue(txPos);
-				if (!GetAsset(txPos.vchAsset, theAsset))
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (nStartBlock > 0 && txPos.nHeight < nStartBlock)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!strTxid.empty() && strTxid != txPos.txHash.GetHex())
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchAsset.empty() && vchAsset != txPos.vchAsset)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchAliasOrAddress.empty() && vchAliasOrAddress != txPos.vchAliasOrAddress)
-				{
-					pcursor->Next();
-					continue;
-				}
-				UniValue oAssetAllocation(UniValue::VOBJ);
-				if (!BuildAssetAllocationJson(txPos, theAsset, bGetInputs, oAssetAllocation)) 
-				{
-					pcursor->Next();
-					continue;
-				}
-				index += 1;
-				if (index <= from) {
-					pcursor->Next();
-					continue;
-				}
-				oRes.push_back(oAssetAllocation);
-				if (index >= count + from) {
-					break;
-				}
-			}
-			pcursor->Next();
-		}
-		catch (std::exception &e) {
-			return error("%s() : deserialize error", __PRETTY_FUNCTION__);
+	// the allocations of an asset mostly share their rate and claim period
+	CCompoundInterestBatch interestBatch;
+	const std::function<bool(CAssetAllocation&, UniValue&)> fnBuild = [&](CAssetAllocation& txPos, UniValue& oAssetAllocation) {
+		if (!GetAsset(txPos.vchAsset, theAsset))
+			return false;
+		if (scan.nStartBlock > 0 && txPos.nHeight < scan.nStartBlock)
+			return false;
+		if (!scan.txHash.IsNull() && scan.txHash != txPos.txHash)
+			return false;
+		if (!vchAsset.empty() && vchAsset != txPos.vchAsset)
+			return false;
+		if (!vchAliasOrAddress.empty() && vchAliasOrAddress != txPos.vchAliasOrAddress)
+			return false;
+		return BuildAssetAllocationJson(txPos, theAsset, bGetInputs, oAssetAllocation, &interestBatch);
+	};
+	// build a chunk of rows under the lock and stream it after releasing the lock, then go on
+	// from the cursor of the chunk, so a long listing does not hold up CheckAssetAllocationInputs
+	CServiceScan chunk(scan);
+	int nRemaining = scan.nCount;
+	while (true) {
+		chunk.nCount = std::min(nRemaining, ASSET_ALLOCATION_SCAN_CHUNK);
+		vector<UniValue> vRows;
+		{
+			LOCK(cs_assetallocation);
+			if (!serviceIndex.Scan(chunk, fnBuild, vRows, strCursor))
+				return false;
 		}
+		for (const UniValue& oRow : vRows)
+			oRes.push_back(oRow);
+		nRemaining -= vRows.size();
+		if (strCursor.empty() || nRemaining <= 0)
+			return true;
+		chunk.nFrom = 0;
+		chunk.strCursor = strCursor;
 	}
-	return true;
 }
 UniValue listassetallocationtransactions(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
@@ -1627,11 +1993,10 @@ UniValue listassetallocationtransactions(const JSONRPCRequest& request) {
 	if (!fAssetAllocationIndex) {
 		throw runtime_error("BILLIECOIN_ASSET_ALLOCATION_RPC_ERROR: ERRCODE: 1509 - " + _("Asset allocation index not enabled, you must enable -assetallocationindex as a startup parameter or through billiecoin.conf file to use this function.")); 
 	}
-	LOCK(cs_assetallocationindex);
-	UniValue oRes(UniValue::VARR);
+	RPCResultArray oRes(request);
 	if (!passetallocationtransactionsdb->ScanAssetAllocationIndex(count, from, options, oRes))
 		throw runtime_error("BILLIECOIN_ASSET_ALLOCATION_RPC_ERROR: ERRCODE: 1509 - " + _("Scan failed"));
-	return oRes;
+	return oRes.Finish();
 }
 UniValue listassetallocations(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
@@ -1647,12 +2012,14 @@ UniValue listassetallocations(const JSONRPCRequest& request) {
 			"      \"receiver_alias\":string		(string) Receiver alias to filter.\n"
 			"      \"receiver_address\":string		(string) Receiver address to filter.\n"
 			"      \"startblock\":block				(number) Earliest block to filter from. Block number is the block at which the transaction would have confirmed.\n"
+			"      \"cursor\":cursor				(string) Page through the results: \"\" for the first page, then the cursor returned with the previous page. The result becomes {\"results\":[...],\"cursor\":cursor}, the cursor is empty after the last page.\n"
 			"    }\n"
 			+ HelpExampleCli("listassetallocations", "0")
 			+ HelpExampleCli("listassetallocations", "10 10")
 			+ HelpExampleCli("listassetallocations", "0 0 '{\"asset\":\"32bff1fa844c124\",\"startblock\":0}'")
 			+ HelpExampleCli("listassetallocations", "0 0 '{\"receiver_address\":\"SfaMwYY19Dh96B9qQcJQuiNykVRTzXMsZR\"}'")
 			+ HelpExampleCli("listassetallocations", "0 0 '{\"txid\":\"1c7f966dab21119bac53213a2bc7532bff1fa844c124fd750a7d0b1332440bd1\"}'")
+			+ HelpExampleCli("listassetallocations", "100 0 '{\"cursor\":\"\"}'")
 		);
 	UniValue options;
 	int count = 10;
@@ -1675,9 +2042,10 @@ UniValue listassetallocations(const JSONRPCRequest& request) {
 	if (params.size() > 2) {
 		options = params[2];
 	}
-	LOCK(cs_assetallocation);
-	UniValue oRes(UniValue::VARR);
-	if (!passetallocationdb->ScanAssetAllocations(count, from, options, oRes))
+	CServiceScan scan(count, from, options);
+	RPCResultArray oRes = ServiceScanArray(request, scan);
+	std::string strCursor;
+	if (!passetallocationdb->ScanAssetAllocations(scan, options, oRes, strCursor))
 		throw runtime_error("BILLIECOIN_ASSET_ALLOCATION_RPC_ERROR: ERRCODE: 1510 - " + _("Scan failed"));
-	return oRes;
+	return ServiceScanResult(scan, oRes, strCursor);
 }
@@ -7,9 +7,12 @@
 
 #include "rpc/server.h"
 #include "dbwrapper.h"
+#include "serviceindex.h"
 #include "feedback.h"
 #include "primitives/transaction.h"
 #include "ranges.h"
+#include "cachemap.h"
+#include <tuple>
 #include <unordered_map>
 #include "graph.h"
 class CWalletTx;
@@ -19,6 +22,8 @@ class CCoinsViewCache;
 class CBlock;
 class CAliasIndex;
 class CAsset;
+class CCompoundInterestBatch;
+class CServicePayload;
 
 bool DecodeAssetAllocationTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch);
 bool DecodeAndParseAssetAllocationTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch, char& type);
@@ -73,13 +78,128 @@ public:
 		return (vchAsset.empty() && vchAliasOrAddress.empty());
 	}
 };
+// key of one entry in the per-tuple ZDAG arrival log, arrival time is big endian so entries iterate in arrival order
+struct CAssetAllocationArrivalKey {
+	CAssetAllocationTuple assetAllocationTuple;
+	int64_t nArrivalTime;
+	uint256 txHash;
+
+	template<typename Stream>
+	void Serialize(Stream& s) const {
+		assetAllocationTuple.Serialize(s);
+		ser_writedata64be(s, nArrivalTime);
+		txHash.Serialize(s);
+	}
+	template<typename Stream>
+	void Unserialize(Stream& s) {
+		assetAllocationTuple.Unserialize(s);
+		nArrivalTime = ser_readdata64be(s);
+		txHash.Unserialize(s);
+	}
+	CAssetAllocationArrivalKey(const CAssetAllocationTuple& tuple, const int64_t& arrivalTime, const uint256& txid) {
+		assetAllocationTuple = tuple;
+		nArrivalTime = arrivalTime;
+		txHash = txid;
+	}
+	CAssetAllocationArrivalKey() {
+		SetNull();
+	}
+	inline void SetNull() {
+		assetAllocationTuple.SetNull();
+		nArrivalTime = 0;
+		txHash.SetNull();
+	}
+};
+// key of one entry in the wallet index of asset allocation transactions, height is big endian and inverted so entries iterate newest first
+struct CAssetAllocationIndexKey {
+	unsigned int nHeight;
+	uint256 txHash;
+	std::string strAsset;
+	std::string strSender;
+	std::string strReceiver;
+
+	template<typename Stream>
+	void Serialize(Stream& s) const {
+		ser_writedata32be(s, ~nHeight);
+		s << txHash << strAsset << strSender << strReceiver;
+	}
+	template<typename Stream>
+	void Unserialize(Stream& s) {
+		nHeight = ~ser_readdata32be(s);
+		s >> txHash >> strAsset >> strSender >> strReceiver;
+	}
+	CAssetAllocationIndexKey(const unsigned int height, const uint256& txid, const std::string& asset, const std::string& sender, const std::string& receiver) :
+		nHeight(height), txHash(txid), strAsset(asset), strSender(sender), strReceiver(receiver) {}
+	CAssetAllocationIndexKey() : nHeight(0) {}
+	friend bool operator<(const CAssetAllocationIndexKey& a, const CAssetAllocationIndexKey& b) {
+		return std::tie(a.nHeight, a.txHash, a.strAsset, a.strSender, a.strReceiver) < std::tie(b.nHeight, b.txHash, b.strAsset, b.strSender, b.strReceiver);
+	}
+};
+// one entry in the wallet index of asset allocation transactions, the fields the key does not hold. Amounts are
+// kept as stored with the precision of the asset, listassetallocationtransactions builds the json
+class CAssetAllocationIndexEntry {
+public:
+	std::vector<unsigned char> vchAliasOrAddress;
+	std::vector<unsigned char> vchSymbol;
+	std::vector<unsigned char> vchMemo;
+	std::string strCategory;
+	int64_t nTime;
+	unsigned int nHeight;
+	float fInterestRate;
+	CAmount nSenderBalance;
+	CAmount nReceiverBalance;
+	CAmount nAmount;
+	unsigned char nPrecision;
+	bool bUseInputRanges;
+	bool bConfirmed;
+	CAssetAllocationIndexEntry() {
+		SetNull();
+	}
+	ADD_SERIALIZE_METHODS;
+	template <typename Stream, typename Operation>
+	inline void SerializationOp(Stream& s, Operation ser_action) {
+		READWRITE(vchAliasOrAddress);
+		READWRITE(vchSymbol);
+		READWRITE(vchMemo);
+		READWRITE(strCategory);
+		READWRITE(nTime);
+		READWRITE(VARINT(nHeight));
+		READWRITE(fInterestRate);
+		READWRITE(nSenderBalance);
+		READWRITE(nReceiverBalance);
+		READWRITE(nAmount);
+		READWRITE(nPrecision);
+		READWRITE(bUseInputRanges);
+		READWRITE(bConfirmed);
+	}
+	inline void SetNull() {
+		vchAliasOrAddress.clear();
+		vchSymbol.clear();
+		vchMemo.clear();
+		strCategory.clear();
+		nTime = 0;
+		nHeight = 0;
+		fInterestRate = 0;
+		nSenderBalance = 0;
+		nReceiverBalance = 0;
+		nAmount = 0;
+		nPrecision = 8;
+		bUseInputRanges = false;
+		bConfirmed = false;
+	}
+	void ToJSON(const CAssetAllocationIndexKey& key, UniValue& oEntry) const;
+	bool FromJSON(const UniValue& oEntry);
+};
 typedef std::pair<std::vector<unsigned char>, std::vector<CRange> > InputRanges;
 typedef std::vector<InputRanges> RangeInputArrayTuples;
 typedef std::vector<std::pair<std::vector<unsigned char>, CAmount > > RangeAmountTuples;
 typedef std::map<uint256, int64_t> ArrivalTimesMap;
-typedef std::map<std::string, std::string> AssetAllocationIndexItem;
-typedef std::map<int, AssetAllocationIndexItem> AssetAllocationIndexItemMap;
-extern AssetAllocationIndexItemMap AssetAllocationIndex;
+// txid/arrival time pairs in ascending arrival order
+typedef std::vector<std::pair<uint256, int64_t> > ArrivalTimesList;
+// entries of the asset allocation wallet index kept decoded in memory
+static const unsigned int ASSET_ALLOCATION_INDEX_CACHE_SIZE = 10000;
+// allocations listassetallocations builds under cs_assetallocation before streaming them
+static const int ASSET_ALLOCATION_SCAN_CHUNK = 100;
 static const int ZDAG_MINIMUM_LATENCY_SECONDS = 10;
 static const int MAX_MEMO_LENGTH = 128;
 static const int ONE_YEAR_IN_BLOCKS = 525600;
@@ -87,7 +207,6 @@ static const int ONE_HOUR_IN_BLOCKS = 60;
 static const int ONE_MONTH_IN_BLOCKS = 43800;
 static sorted_vector<CAssetAllocationTuple> assetAllocationConflicts;
 static CCriticalSection cs_assetallocation;
-static CCriticalSection cs_assetallocationindex;
 enum {
 	ZDAG_NOT_FOUND = -1,
 	ZDAG_STATUS_OK = 0,
@@ -165,24 +284,78 @@ public:
 };
 
 
+// in-memory view of the pending ZDAG sends of each queried sender, kept in step with the mempool and the asset allocation DB so status polls don't replay the DB
+class CAssetAllocationSenderLedger {
+private:
+	struct CLedgerTx {
+		uint256 txHash;
+		int64_t nArrivalTime;
+		// false if the tx did not carry an asset allocation payload, it still counts towards latency but never matches a lookup
+		bool bAllocation;
+	};
+	struct CLedgerSender {
+		// last POW balance less every pending send replayed so far
+		CAmount nRunningBalance;
+		// real-time balance as stored in the DB, used to verify the replay when no txid is given
+		CAmount nRealtimeBalance;
+		// index of the first send that overran the POW balance, -1 if none
+		int nFirstOverrun;
+		// mempool sends in arrival order
+		std::vector<CLedgerTx> vecTx;
+		std::unordered_map<uint256, int, SaltedTxidHasher> mapTxIndex;
+	};
+	mutable CCriticalSection cs;
+	std::map<CAssetAllocationTuple, CLedgerSender> mapSenders;
+	bool fCheckConsistency;
+
+	void Append(const CAssetAllocationTuple& assetAllocationTuple, CLedgerSender& sender, const CTransaction& tx, const int64_t& arrivalTime);
+	bool Build(const CAssetAllocationTuple& assetAllocationTuple, CLedgerSender& sender);
+	int Lookup(const CLedgerSender& sender, const uint256& txid, const int64_t& nNow) const;
+	void AddArrival(const CAssetAllocationTuple& assetAllocationTuple, const CTransaction& tx, const int64_t& arrivalTime);
+public:
+	CAssetAllocationSenderLedger() : fCheckConsistency(false) {}
+	void SetCheckConsistency(bool fCheck) { fCheckConsistency = fCheck; }
+	void ConnectMempool(CTxMemPool& pool);
+	void DisconnectMempool(CTxMemPool& pool);
+	// DB hooks, called after the corresponding write succeeds
+	void ArrivalTimeWritten(const CAssetAllocationTuple& assetAllocationTuple, const uint256& txid, const int64_t& arrivalTime);
+	void RealtimeBalanceWritten(const CAssetAllocationTuple& assetAllocationTuple, const CAmount& nBalance);
+	void Invalidate(const CAssetAllocationTuple& assetAllocationTuple);
+	// drop every sender of an asset, for sends whose sender cannot be told
+	void InvalidateAsset(const std::vector<unsigned char>& vchAsset);
+	void Clear();
+	// mempool hooks
+	void TransactionAddedToMempool(CTransactionRef ptx);
+	void TransactionRemovedFromMempool(CTransactionRef ptx, MemPoolRemovalReason reason);
+	// same result as DetectPotentialAssetAllocationSenderConflicts, the DB is only replayed the first time a sender is queried after a change
+	int GetSenderStatus(const CAssetAllocationTuple& assetAllocationTuple, const uint256& txid);
+	size_t Size() const;
+};
+extern CAssetAllocationSenderLedger assetAllocationSenderLedger;
+
 class CAssetAllocationDB : public CDBWrapper {
+private:
+	CServiceIndex<CAssetAllocationTuple, CAssetAllocation> serviceIndex;
+	static CServiceIndexEntry GetIndexEntry(const CAssetAllocation& assetallocation);
 public:
-	CAssetAllocationDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assetallocations", nCacheSize, fMemory, fWipe, false, true) {}
+	CAssetAllocationDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assetallocations", nCacheSize, fMemory, fWipe, false, true), serviceIndex(*this, "assetallocation", &GetIndexEntry) {}
 
     bool WriteAssetAllocation(const CAssetAllocation& assetallocation, const CAmount& nSenderBalance, const CAmount& nAmount, const CAsset& asset, const int64_t& arrivalTime, const std::string& strSender, const std::string& strReceiver, const bool& fJustCheck) {
 		const CAssetAllocationTuple allocationTuple(assetallocation.vchAsset, assetallocation.vchAliasOrAddress);
 		bool writeState = false;
 		{
-			writeState = Write(make_pair(std::string("assetallocationi"), allocationTuple), assetallocation);
-			if (!fJustCheck)
+			CDBBatch batch(*this);
+			serviceIndex.Write(batch, allocationTuple, assetallocation);
+			writeState = WriteBatch(batch);
+			if (!fJustCheck) {
 				writeState = writeState && Write(make_pair(std::string("assetallocationp"), allocationTuple), assetallocation);
+				assetAllocationSenderLedger.Invalidate(allocationTuple);
+			}
 			else if (fJustCheck) {
-				if (arrivalTime < INT64_MAX) {
-					ArrivalTimesMap arrivalTimes;
-					ReadISArrivalTimes(allocationTuple, arrivalTimes);
-					arrivalTimes.emplace(assetallocation.txHash, arrivalTime);
-					writeState = writeState && Write(make_pair(std::string("assetallocationa"), allocationTuple), arrivalTimes);
-				}
+				if (writeState)
+					assetAllocationSenderLedger.RealtimeBalanceWritten(allocationTuple, assetallocation.nBalance);
+				if (arrivalTime < INT64_MAX)
+					writeState = writeState && WriteISArrivalTime(allocationTuple, assetallocation.txHash, arrivalTime);
 			}
 		}
 		if(writeState && !strReceiver.empty())
@@ -190,10 +363,13 @@ public:
         return writeState;
     }
 	bool EraseAssetAllocation(const CAssetAllocationTuple& assetAllocationTuple, bool cleanup = false) {
-		bool eraseState = Erase(make_pair(std::string("assetallocationi"), assetAllocationTuple));
+		CDBBatch batch(*this);
+		serviceIndex.Erase(batch, assetAllocationTuple);
+		bool eraseState = WriteBatch(batch);
 		if (eraseState) {
 			Erase(make_pair(std::string("assetp"), assetAllocationTuple));
 			EraseISArrivalTimes(assetAllocationTuple);
+			assetAllocationSenderLedger.Invalidate(assetAllocationTuple);
 		}
 		return eraseState;
 	}
@@ -203,43 +379,61 @@ public:
 	bool ReadLastAssetAllocation(const CAssetAllocationTuple& assetAllocationTuple, CAssetAllocation& assetallocation) {
 		return Read(make_pair(std::string("assetallocationp"), assetAllocationTuple), assetallocation);
 	}
-	bool ReadISArrivalTimes(const CAssetAllocationTuple& assetAllocationTuple, ArrivalTimesMap& arrivalTimes) {
-		return Read(make_pair(std::string("assetallocationa"), assetAllocationTuple), arrivalTimes);
+	// arrival times are kept as one key per txid: "assetallocationl" (tuple, time, txid) is the ordered log and "assetallocationt" (tuple, txid) points back at its time
+	bool WriteISArrivalTime(const CAssetAllocationTuple& assetAllocationTuple, const uint256& txid, const int64_t& arrivalTime) {
+		// first arrival wins, same as the old map emplace
+		if (Exists(make_pair(std::string("assetallocationt"), std::make_pair(assetAllocationTuple, txid))))
+			return true;
+		CDBBatch batch(*this);
+		batch.Write(make_pair(std::string("assetallocationl"), CAssetAllocationArrivalKey(assetAllocationTuple, arrivalTime, txid)), arrivalTime);
+		batch.Write(make_pair(std::string("assetallocationt"), std::make_pair(assetAllocationTuple, txid)), arrivalTime);
+		if (!WriteBatch(batch))
+			return false;
+		assetAllocationSenderLedger.ArrivalTimeWritten(assetAllocationTuple, txid, arrivalTime);
+		return true;
+	}
+	bool ReadISArrivalTime(const CAssetAllocationTuple& assetAllocationTuple, const uint256& txid, int64_t& arrivalTime) {
+		return Read(make_pair(std::string("assetallocationt"), std::make_pair(assetAllocationTuple, txid)), arrivalTime);
 	}
+	bool ReadISArrivalTimes(const CAssetAllocationTuple& assetAllocationTuple, ArrivalTimesList& arrivalTimes);
 	bool EraseISArrivalTime(const CAssetAllocationTuple& assetAllocationTuple, const uint256& txid) {
-		ArrivalTimesMap arrivalTimes;
-		ReadISArrivalTimes(assetAllocationTuple, arrivalTimes);
-		ArrivalTimesMap::const_iterator it = arrivalTimes.find(txid);
-		if (it != arrivalTimes.end())
-			arrivalTimes.erase(it);
-		if (arrivalTimes.size() > 0)
-			return Write(make_pair(std::string("assetallocationa"), assetAllocationTuple), arrivalTimes);
-		else
-			return Erase(make_pair(std::string("assetallocationa"), assetAllocationTuple));
-	}
-	bool EraseISArrivalTimes(const CAssetAllocationTuple& assetAllocationTuple) {
-		return Erase(make_pair(std::string("assetallocationa"), assetAllocationTuple));
+		int64_t arrivalTime;
+		if (!ReadISArrivalTime(assetAllocationTuple, txid, arrivalTime))
+			return true;
+		CDBBatch batch(*this);
+		batch.Erase(make_pair(std::string("assetallocationl"), CAssetAllocationArrivalKey(assetAllocationTuple, arrivalTime, txid)));
+		batch.Erase(make_pair(std::string("assetallocationt"), std::make_pair(assetAllocationTuple, txid)));
+		if (!WriteBatch(batch))
+			return false;
+		assetAllocationSenderLedger.Invalidate(assetAllocationTuple);
+		return true;
 	}
+	bool EraseISArrivalTimes(const CAssetAllocationTuple& assetAllocationTuple);
+	bool UpgradeArrivalTimes();
 	void WriteAssetAllocationIndex(const CAssetAllocation& assetAllocationTuple, const CAsset& asset, const CAmount& nSenderBalance, const CAmount& nAmount, const std::string& strSender, const std::string& strReceiver);
-	bool ScanAssetAllocations(const int count, const int from, const UniValue& oOptions, UniValue& oRes);
+	bool BuildIndexes() {
+		return serviceIndex.Build();
+	}
+	bool ScanAssetAllocations(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor);
 };
 class CAssetAllocationTransactionsDB : public CDBWrapper {
+private:
+	mutable CCriticalSection cs;
+	// the most recently written or listed entries, a hit moves the entry to the front
+	CacheMap<CAssetAllocationIndexKey, CAssetAllocationIndexEntry> cacheEntries;
 public:
-	CAssetAllocationTransactionsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assetallocationtransactions", nCacheSize, fMemory, fWipe, false, true) {
-		ReadAssetAllocationWalletIndex(AssetAllocationIndex);
-	}
+	CAssetAllocationTransactionsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assetallocationtransactions", nCacheSize, fMemory, fWipe, false, true), cacheEntries(ASSET_ALLOCATION_INDEX_CACHE_SIZE) {}
 
-	bool WriteAssetAllocationWalletIndex(const AssetAllocationIndexItemMap &valueMap) {
-		return Write(std::string("assetallocationtxi"), valueMap, true);
-	}
-	bool ReadAssetAllocationWalletIndex(AssetAllocationIndexItemMap &valueMap) {
-		return Read(std::string("assetallocationtxi"), valueMap);
-	}
-	bool ScanAssetAllocationIndex(const int count, const int from, const UniValue& oOptions, UniValue& oRes);
+	bool UpgradeAssetAllocationIndex();
+
+	bool WriteAssetAllocationIndexEntry(const CAssetAllocationIndexKey& key, const CAssetAllocationIndexEntry& entry);
+	bool ReadAssetAllocationIndexEntry(const CAssetAllocationIndexKey& key, CAssetAllocationIndexEntry& entry);
+	bool ScanAssetAllocationIndex(const int count, const int from, const UniValue& oOptions, RPCResultArray& oRes);
 };
-bool CheckAssetAllocationInputs(const CTransaction &tx, const CCoinsViewCache &inputs, int op, const std::vector<std::vector<unsigned char> > &vvchArgs, const std::vector<unsigned char> &vchAlias, bool fJustCheck, int nHeight, sorted_vector<CAssetAllocationTuple> &revertedAssetAllocations, std::string &errorMessage, bool bSanityCheck = false);
+bool CheckAssetAllocationInputs(const CTransaction &tx, const CCoinsViewCache &inputs, const CServicePayload &payload, const std::vector<unsigned char> &vchAlias, bool fJustCheck, int nHeight, sorted_vector<CAssetAllocationTuple> &revertedAssetAllocations, std::string &errorMessage, bool bSanityCheck = false);
 bool GetAssetAllocation(const CAssetAllocationTuple& assetAllocationTuple,CAssetAllocation& txPos);
-bool BuildAssetAllocationJson(CAssetAllocation& assetallocation, const CAsset& asset, const bool bGetInputs, UniValue& oName);
-bool BuildAssetAllocationIndexerJson(const CAssetAllocation& assetallocation, const CAsset& asset, const CAmount& nSenderBalance, const CAmount& nAmount, const std::string& strSender, const std::string& strReceiver, bool &isMine, UniValue& oAssetAllocation);
+bool BuildAssetAllocationJson(CAssetAllocation& assetallocation, const CAsset& asset, const bool bGetInputs, UniValue& oName, CCompoundInterestBatch* pInterestBatch = NULL);
+bool BuildAssetAllocationIndexEntry(const CAssetAllocation& assetallocation, const CAsset& asset, const CAmount& nSenderBalance, const CAmount& nAmount, const std::string& strSender, const std::string& strReceiver, bool &isMine, CAssetAllocationIndexEntry& entry);
 bool AccumulateInterestSinceLastClaim(CAssetAllocation & assetAllocation, const int& nHeight);
+int DetectPotentialAssetAllocationSenderConflicts(const CAssetAllocationTuple& assetAllocationTupleSender, const uint256& lookForTxHash, const int64_t& nNow);
 #endif // ASSETALLOCATION_H
@@ -0,0 +1,88 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "alias.h"
+#include "assetallocation.h"
+#include "chainparams.h"
+#include "graph.h"
+#include "hash.h"
+#include "random.h"
+#include "validation.h"
+
+// These benchmarks replay the ordering CheckBilliecoinInputs does for every
+// connected block: build the sender/receiver graph of the asset allocation
+// sends, drop the senders that close a cycle and sort the rest topologically.
+
+static const int BLOCK_SENDS = 12000;
+
+static CTransactionRef MakeAllocationSend(const std::string& strSender, const std::vector<std::string>& vReceivers)
+{
+    CAssetAllocation allocation;
+    allocation.vchAsset = vchFromString("benchasset");
+    allocation.vchAliasOrAddress = vchFromString(strSender);
+    for (const std::string& strReceiver : vReceivers)
+        allocation.listSendingAllocationAmounts.push_back(std::make_pair(vchFromString(strReceiver), 1 * COIN));
+    std::vector<unsigned char> data;
+    allocation.Serialize(data);
+    const std::vector<unsigned char> vchHash = vchFromString(Hash(data.begin(), data.end()).GetHex());
+
+    CMutableTransaction mtx;
+    mtx.nVersion = BILLIECOIN_TX_VERSION;
+    mtx.vout.resize(2);
+    mtx.vout[0].scriptPubKey << CScript::EncodeOP_N(OP_BILLIECOIN_ASSET_ALLOCATION) << CScript::EncodeOP_N(OP_ASSET_ALLOCATION_SEND) << vchHash << OP_2DROP << OP_DROP << OP_TRUE;
+    mtx.vout[1].scriptPubKey << OP_RETURN << data << vchHash;
+    return MakeTransactionRef(std::move(mtx));
+}
+
+static void OrderBlock(benchmark::State& state, const std::vector<CTransactionRef>& vtx)
+{
+    const int nHeight = Params().GetConsensus().nShareFeeBlock;
+    while (state.KeepRunning()) {
+        LOCK(cs_main);
+        std::vector<CTransactionRef> sortedVtx = vtx;
+        CServiceTxGraph graph;
+        if (CreateGraphFromVTX(nHeight, sortedVtx, graph)) {
+            std::vector<int> conflictedIndexes;
+            GraphRemoveCycles(sortedVtx, conflictedIndexes, graph);
+            assert(DAGTopologicalSort(sortedVtx, conflictedIndexes, graph));
+        }
+    }
+}
+
+// sends between random aliases, a sparse graph with a few cycles
+static void BlockGraphRandomSends(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    FastRandomContext insecure_rand(true);
+    std::vector<CTransactionRef> vtx(1, MakeTransactionRef(CMutableTransaction()));
+    for (int i = 0; i < BLOCK_SENDS; i++) {
+        std::vector<std::string> vReceivers;
+        for (uint32_t n = 1 + insecure_rand.rand32() % 3; n > 0; n--)
+            vReceivers.push_back(strprintf("alias%d", insecure_rand.rand32() % 4000));
+        vtx.push_back(MakeAllocationSend(strprintf("alias%d", insecure_rand.rand32() % 4000), vReceivers));
+    }
+    OrderBlock(state, vtx);
+}
+
+// aliases sending along a ring with chords, so nearly every sender is on many
+// cycles. Enumerating every circuit of this graph does not finish in practice.
+static void BlockGraphDenseCycles(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    static const int RING_SIZE = 500;
+    std::vector<CTransactionRef> vtx(1, MakeTransactionRef(CMutableTransaction()));
+    for (int i = 0; i < BLOCK_SENDS; i++) {
+        const int nSender = i % RING_SIZE;
+        std::vector<std::string> vReceivers;
+        vReceivers.push_back(strprintf("ring%d", (nSender + 1) % RING_SIZE));
+        vReceivers.push_back(strprintf("ring%d", (nSender + 1 + i / RING_SIZE) % RING_SIZE));
+        vtx.push_back(MakeAllocationSend(strprintf("ring%d", nSender), vReceivers));
+    }
+    OrderBlock(state, vtx);
+}
+
+BENCHMARK(BlockGraphRandomSends);
+BENCHMARK(BlockGraphDenseCycles);
@@ -10,6 +10,8 @@
 #include <vector>
 #include <boost/thread/thread.hpp>
 #include "random.h"
+#include "hash.h"
+#include <atomic>
 
 
 // This Benchmark tests the CheckQueue with the lightest
@@ -99,5 +101,45 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.interrupt_all();
     tg.join_all();
 }
+// This Benchmark feeds the queue the way multithreaded mempool validation does:
+// many small transactions with one to three inputs each arrive one at a time and
+// are batched across transactions by CCheckQueueBatcher, with every transaction
+// getting its own result back.
+static const size_t MEMPOOL_TXS = 3000;
+static const unsigned int MEMPOOL_BATCH_SIZE = 256;
+static void CCheckQueueSpeedMempoolBatcher(benchmark::State& state)
+{
+    struct SigJob {
+        uint256 hash;
+        bool operator()()
+        {
+            // stand-in for an ECDSA verification, cheap but not free
+            for (int i = 0; i < 16; i++)
+                hash = Hash(hash.begin(), hash.end());
+            return true;
+        }
+        void swap(SigJob& x) { std::swap(hash, x.hash); };
+    };
+    CCheckQueue<CBatchedCheck<SigJob> > queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()); ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    CCheckQueueBatcher<SigJob> batcher(&queue, MEMPOOL_BATCH_SIZE);
+    std::atomic<size_t> nDone(0);
+    while (state.KeepRunning()) {
+        FastRandomContext insecure_rand(true);
+        for (size_t i = 0; i < MEMPOOL_TXS; ++i)
+            batcher.Expect();
+        for (size_t i = 0; i < MEMPOOL_TXS; ++i) {
+            std::vector<SigJob> vChecks(1 + insecure_rand.rand32() % 3);
+            if (batcher.Add(vChecks, [&nDone](bool fOk) { nDone++; }))
+                batcher.Flush();
+        }
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
 BENCHMARK(CCheckQueueSpeed);
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+BENCHMARK(CCheckQueueSpeedMempoolBatcher);
@@ -0,0 +1,76 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "masternode-sync.h"
+#include "masternodeman.h"
+#include "net.h"
+#include "random.h"
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+static const int MASTERNODE_COUNT = 5000;
+
+static void FillMasternodes(CMasternodeMan& man, std::vector<COutPoint>& vecOutpoints)
+{
+    // ranks are only handed out once the list is synced
+    CConnman connman(GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max()));
+    masternodeSync.Reset();
+    while (!masternodeSync.IsMasternodeListSynced())
+        masternodeSync.SwitchToNextAsset(connman);
+
+    for (int i = 0; i < MASTERNODE_COUNT; i++) {
+        CMasternode mn;
+        mn.outpoint = COutPoint(GetRandHash(), 0);
+        mn.nCollateralMinConfBlockHash = GetRandHash();
+        mn.nProtocolVersion = PROTOCOL_VERSION;
+        man.Add(mn);
+        vecOutpoints.push_back(mn.outpoint);
+    }
+}
+
+// Rank lookups at the few block hashes payments, PoSe and InstantSend ask about
+static void MasternodeRank(benchmark::State& state)
+{
+    CMasternodeMan man;
+    std::vector<COutPoint> vecOutpoints;
+    FillMasternodes(man, vecOutpoints);
+    std::vector<uint256> vecBlockHashes;
+    for (int i = 0; i < 4; i++)
+        vecBlockHashes.push_back(GetRandHash());
+
+    size_t nIndex = 0;
+    int nRank;
+    int64_t nRankSum = 0;
+    while (state.KeepRunning()) {
+        const COutPoint& outpoint = vecOutpoints[nIndex++ % vecOutpoints.size()];
+        for (const auto& hash : vecBlockHashes) {
+            man.GetMasternodeRank(outpoint, nRank, hash);
+            nRankSum += nRank;
+        }
+    }
+    assert(nRankSum > 0);
+}
+
+// Ranking the whole list at a block hash not seen before
+static void MasternodeRankNewBlock(benchmark::State& state)
+{
+    CMasternodeMan man;
+    std::vector<COutPoint> vecOutpoints;
+    FillMasternodes(man, vecOutpoints);
+
+    int nRank;
+    int64_t nRankSum = 0;
+    while (state.KeepRunning()) {
+        man.GetMasternodeRank(vecOutpoints[0], nRank, GetRandHash());
+        nRankSum += nRank;
+    }
+    assert(nRankSum > 0);
+}
+
+BENCHMARK(MasternodeRank);
+BENCHMARK(MasternodeRankNewBlock);
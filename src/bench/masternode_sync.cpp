@@ -0,0 +1,188 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chain.h"
+#include "masternode-sync.h"
+#include "masternodeman.h"
+#include "net.h"
+#include "protocol.h"
+#include "pubkey.h"
+#include "random.h"
+#include "util.h"
+#include "validation.h"
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+static const int MASTERNODE_SYNC_BROADCASTS = 1000;
+
+// Signed broadcasts with their last pings, as a node syncing the list receives them
+static void MakeBroadcasts(std::vector<CMasternodeBroadcast>& vecMnb)
+{
+    for (int i = 0; i < MASTERNODE_SYNC_BROADCASTS; i++) {
+        CKey keyCollateral, keyMasternode;
+        keyCollateral.MakeNewKey(true);
+        keyMasternode.MakeNewKey(true);
+        CMasternodeBroadcast mnb;
+        mnb.outpoint = COutPoint(GetRandHash(), 0);
+        mnb.pubKeyCollateralAddress = keyCollateral.GetPubKey();
+        mnb.pubKeyMasternode = keyMasternode.GetPubKey();
+        mnb.nProtocolVersion = PROTOCOL_VERSION;
+        mnb.lastPing.masternodeOutpoint = mnb.outpoint;
+        mnb.lastPing.blockHash = GetRandHash();
+        bool fSigned = mnb.lastPing.Sign(keyMasternode, mnb.pubKeyMasternode) && mnb.Sign(keyCollateral);
+        assert(fSigned);
+        vecMnb.push_back(mnb);
+    }
+}
+
+static bool CheckBroadcasts(const std::vector<CMasternodeBroadcast>& vecMnb)
+{
+    int nDos;
+    for (const auto& mnb : vecMnb) {
+        if (!mnb.CheckSignature(nDos) || !mnb.lastPing.CheckSignature(mnb.pubKeyMasternode, nDos))
+            return false;
+    }
+    return true;
+}
+
+// The signature checks of a list sync, one message after the other
+static void MasternodeSyncSignatures(benchmark::State& state)
+{
+    ECCVerifyHandle verifyHandle;
+    std::vector<CMasternodeBroadcast> vecMnb;
+    MakeBroadcasts(vecMnb);
+
+    while (state.KeepRunning()) {
+        bool fOk = CheckBroadcasts(vecMnb);
+        assert(fOk);
+    }
+}
+
+// The same with the keys recovered on the masternode sync threads first
+static void MasternodeSyncSignaturesParallel(benchmark::State& state)
+{
+    ECCVerifyHandle verifyHandle;
+    std::vector<CMasternodeBroadcast> vecMnb;
+    MakeBroadcasts(vecMnb);
+
+    boost::thread_group tg;
+    const int nThreads = std::min(GetNumCores(), MAX_MASTERNODE_SYNC_THREADS);
+    for (int i = 0; i < nThreads - 1; i++) {
+        tg.create_thread(&ThreadMasternodeSyncCheck);
+    }
+
+    while (state.KeepRunning()) {
+        std::vector<CMasternodeSyncCheck> vChecks;
+        vChecks.reserve(vecMnb.size() * 2);
+        for (auto& mnb : vecMnb) {
+            mnb.keyRecovered = CRecoveredHashKey();
+            mnb.lastPing.keyRecovered = CRecoveredHashKey();
+            vChecks.push_back(CMasternodeSyncCheck(mnb.GetSignatureHash(), mnb.vchSig, mnb.keyRecovered));
+            vChecks.push_back(CMasternodeSyncCheck(mnb.lastPing.GetSignatureHash(), mnb.lastPing.vchSig, mnb.lastPing.keyRecovered));
+        }
+        RunMasternodeSyncChecks(vChecks);
+        bool fOk = CheckBroadcasts(vecMnb);
+        assert(fOk);
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+// Pings of the known masternodes as they arrive during list sync, queued by
+// ProcessMessage and checked and processed by ProcessPendingSyncMessages
+static void MasternodeSyncPings(benchmark::State& state, int nThreads)
+{
+    ECCVerifyHandle verifyHandle;
+    const bool fUnitTestOld = fUnitTest;
+    const int nMasternodeSyncThreadsOld = nMasternodeSyncThreads;
+    // the collateral of the masternodes is not looked up
+    fUnitTest = true;
+    nMasternodeSyncThreads = nThreads;
+
+    CConnman connman(GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max()));
+    masternodeSync.Reset();
+    while (!masternodeSync.IsBlockchainSynced())
+        masternodeSync.SwitchToNextAsset(connman);
+    assert(!masternodeSync.IsMasternodeListSynced());
+
+    // the block the pings are for
+    const uint256 hashBlock = GetRandHash();
+    CBlockIndex index;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hashBlock, &index)).first;
+        index.phashBlock = &mi->first;
+    }
+
+    std::vector<CMasternode> vecMn;
+    std::vector<CMasternodePing> vecPings;
+    for (int i = 0; i < MASTERNODE_SYNC_BROADCASTS; i++) {
+        CKey keyMasternode;
+        keyMasternode.MakeNewKey(true);
+        CMasternode mn;
+        mn.outpoint = COutPoint(GetRandHash(), 0);
+        mn.pubKeyMasternode = keyMasternode.GetPubKey();
+        mn.nProtocolVersion = PROTOCOL_VERSION;
+        vecMn.push_back(mn);
+        CMasternodePing mnp;
+        mnp.masternodeOutpoint = mn.outpoint;
+        mnp.blockHash = hashBlock;
+        bool fSigned = mnp.Sign(keyMasternode, mn.pubKeyMasternode);
+        assert(fSigned);
+        vecPings.push_back(mnp);
+    }
+
+    boost::thread_group tg;
+    for (int i = 0; i < nThreads - 1; i++) {
+        tg.create_thread(&ThreadMasternodeSyncCheck);
+    }
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(CService(), NODE_NONE), 0, 0, "", true);
+
+    while (state.KeepRunning()) {
+        // a list without any pings yet, so none of them is seen or early
+        mnodeman.Clear();
+        for (auto& mn : vecMn)
+            mnodeman.Add(mn);
+        for (const auto& mnp : vecPings) {
+            CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+            vRecv << mnp;
+            mnodeman.ProcessMessage(&node, NetMsgType::MNPING, vRecv, connman);
+        }
+        mnodeman.ProcessPendingSyncMessages(connman);
+        CMasternode mn;
+        bool fPinged = mnodeman.Get(vecPings.back().masternodeOutpoint, mn) && mn.lastPing == vecPings.back();
+        assert(fPinged);
+    }
+
+    tg.interrupt_all();
+    tg.join_all();
+    mnodeman.Clear();
+    {
+        LOCK(cs_main);
+        mapBlockIndex.erase(hashBlock);
+    }
+    fUnitTest = fUnitTestOld;
+    nMasternodeSyncThreads = nMasternodeSyncThreadsOld;
+}
+
+static void MasternodeSyncPingsSerial(benchmark::State& state)
+{
+    MasternodeSyncPings(state, 0);
+}
+
+static void MasternodeSyncPingsBatched(benchmark::State& state)
+{
+    MasternodeSyncPings(state, std::min(GetNumCores(), MAX_MASTERNODE_SYNC_THREADS));
+}
+
+BENCHMARK(MasternodeSyncSignatures);
+BENCHMARK(MasternodeSyncSignaturesParallel);
+BENCHMARK(MasternodeSyncPingsSerial);
+BENCHMARK(MasternodeSyncPingsBatched);
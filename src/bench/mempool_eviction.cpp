@@ -20,7 +20,7 @@ static void AddTx(const CTransaction& tx, const CAmount& nFee, CTxMemPool& pool)
     LockPoints lp;
     pool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(
                                         MakeTransactionRef(tx), nFee, nTime, dPriority, nHeight,
-                                        tx.GetValueOut(), spendsCoinbase, sigOpCost, lp));
+                                        tx.GetValueOut(), spendsCoinbase, sigOpCost, lp, nTime * 1000));
 }
 
 // Right now this is only testing eviction performance in an extremely small
@@ -0,0 +1,60 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "ranges.h"
+
+// A holder of a range tracked asset whose inputs are fragmented into single
+// indexes, every other index of the supply, sending a fragmented part of them
+// the way CheckAssetAllocationInputs does: check the sender holds it, add it to
+// the receiver and take it off the sender.
+
+static const unsigned int HOLDER_RANGES = 100000;
+static const unsigned int SEND_RANGES = 2000;
+
+static std::vector<CRange> FragmentedRanges(unsigned int nFirst, unsigned int nCount, unsigned int nStride)
+{
+    std::vector<CRange> ranges;
+    for (unsigned int i = 0; i < nCount; i++)
+        ranges.push_back(CRange(nFirst + i * nStride, nFirst + i * nStride));
+    return ranges;
+}
+
+static void RangeContainFragmented(benchmark::State& state)
+{
+    const std::vector<CRange> holder = FragmentedRanges(0, HOLDER_RANGES, 2);
+    const std::vector<CRange> send = FragmentedRanges(HOLDER_RANGES / 2, SEND_RANGES, 4);
+    while (state.KeepRunning()) {
+        assert(doesRangeContain(holder, send));
+    }
+}
+
+static void RangeMergeFragmented(benchmark::State& state)
+{
+    const std::vector<CRange> receiver = FragmentedRanges(1, HOLDER_RANGES, 2);
+    const std::vector<CRange> send = FragmentedRanges(HOLDER_RANGES / 2, SEND_RANGES, 4);
+    while (state.KeepRunning()) {
+        CRangeSet receiverRanges(receiver);
+        receiverRanges.Add(send);
+        assert(receiverRanges.Count() == HOLDER_RANGES + SEND_RANGES);
+    }
+}
+
+static void RangeSubtractFragmented(benchmark::State& state)
+{
+    const std::vector<CRange> holder = FragmentedRanges(0, HOLDER_RANGES, 2);
+    const std::vector<CRange> send = FragmentedRanges(HOLDER_RANGES / 2, SEND_RANGES, 4);
+    while (state.KeepRunning()) {
+        std::vector<CRange> sender = holder;
+        std::vector<CRange> deletions = send;
+        std::vector<CRange> output;
+        subtractRanges(sender, deletions, output);
+        assert(output.size() == HOLDER_RANGES - SEND_RANGES);
+    }
+}
+
+BENCHMARK(RangeContainFragmented);
+BENCHMARK(RangeMergeFragmented);
+BENCHMARK(RangeSubtractFragmented);
@@ -14,6 +14,8 @@
 #include "wallet/wallet.h"
 #include "chainparams.h"
 #include "wallet/coincontrol.h"
+#include "serviceevent.h"
+#include "servicepayload.h"
 #include <boost/algorithm/hex.hpp>
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/foreach.hpp>
@@ -92,46 +94,29 @@ void CCert::Serialize( vector<unsigned char> &vchData) {
 
 }
 void CCertDB::WriteCertIndex(const CCert& cert, const int& op) {
-	if (IsArgSet("-zmqpubcertrecord")) {
-		UniValue oName(UniValue::VOBJ);
-		if (BuildCertIndexerJson(cert, oName)) {
-			GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "certrecord");
-		}
-	}
+	if (IsArgSet("-zmqpubcertrecord"))
+		PublishServiceEvent("certrecord", cert);
 	WriteCertIndexHistory(cert, op);
 }
 void CCertDB::WriteCertIndexHistory(const CCert& cert, const int &op) {
-	if (IsArgSet("-zmqpubcerthistory")) {
-		UniValue oName(UniValue::VOBJ);
-		if (BuildCertIndexerHistoryJson(cert, oName)) {
-			oName.push_back(Pair("op", certFromOp(op)));
-			GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "certhistory");
-		}
-	}
+	if (IsArgSet("-zmqpubcerthistory"))
+		PublishServiceEvent("certhistory", cert, (unsigned char)op);
 }
 	
-bool CCertDB::CleanupDatabase(int &servicesCleaned)
+bool CCertDB::CleanupDatabase(const vector<unsigned char>& vchAlias, int &servicesCleaned)
 {
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
+	vector<vector<unsigned char> > vchCerts;
+	if (!serviceIndex.GetOwned(vchAlias, vchCerts))
+		return false;
 	CCert txPos;
-	pair<string, vector<unsigned char> > key;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
-			if (pcursor->GetKey(key) && key.first == "certi") {
-  				if (!GetCert(key.second, txPos) || chainActive.Tip()->GetMedianTimePast() >= (int64_t)GetCertExpiration(txPos))
-				{
-					servicesCleaned++;
-					EraseCert(key.second, true);
-				} 
-				
-            }
-            pcursor->Next();
-        } catch (std::exception &e) {
-            return error("%s() : deserialize error", __PRETTY_FUNCTION__);
-        }
-    }
+	for (const vector<unsigned char>& vchCert : vchCerts) {
+		if (!GetCert(vchCert, txPos) || chainActive.Tip()->GetMedianTimePast() >= (int64_t)GetCertExpiration(txPos))
+		{
+			servicesCleaned++;
+			if (!EraseCert(vchCert, true))
+				return false;
+		}
+	}
 	return true;
 }
 bool GetCert(const vector<unsigned char> &vchCert,
@@ -270,7 +255,7 @@ bool RevertCert(const std::vector<unsigned char>& vchCert, const int op, const u
 	return true;
 
 }
-bool CheckCertInputs(const CTransaction &tx, int op, const vector<vector<unsigned char> > &vvchArgs, const std::vector<unsigned char> &vvchAlias,
+bool CheckCertInputs(const CTransaction &tx, const CServicePayload &payload, const std::vector<unsigned char> &vvchAlias,
         bool fJustCheck, int nHeight, sorted_vector<std::vector<unsigned char> > &revertedCerts, string &errorMessage, bool bSanityCheck) {
 	if (!pcertdb || !paliasdb)
 		return false;
@@ -284,16 +269,16 @@ bool CheckCertInputs(const CTransaction &tx, int op, const vector<vector<unsigne
 			chainActive.Tip()->nHeight, tx.GetHash().ToString().c_str(),
 			fJustCheck ? "JUSTCHECK" : "BLOCK");
 
-	// unserialize cert from txn, check for valid
-	CCert theCert;
-	vector<unsigned char> vchData;
-	vector<unsigned char> vchHash;
-	int nDataOut;
-	if(!GetBilliecoinData(tx, vchData, vchHash, nDataOut) || !theCert.UnserializeFromData(vchData, vchHash))
+	// the cert was unserialized from the txn with the payload, check for valid
+	const int op = payload.nOp;
+	const CServiceArgs &vvchArgs = payload.vvchArgs;
+	const vector<unsigned char> &vchHash = payload.vchDataHash;
+	if(!payload.cert)
 	{
 		errorMessage = "BILLIECOIN_CERTIFICATE_CONSENSUS_ERROR ERRCODE: 3002 - " + _("Cannot unserialize data inside of this transaction relating to a certificate");
 		return true;
 	}
+	CCert theCert(*payload.cert);
 
 	if(fJustCheck)
 	{
@@ -810,38 +795,6 @@ bool BuildCertJson(const CCert& cert, UniValue& oCert)
 	oCert.push_back(Pair("expired", expired));
 	return true;
 }
-bool BuildCertIndexerHistoryJson(const CCert& cert, UniValue& oCert)
-{
-	oCert.push_back(Pair("_id", cert.txHash.GetHex()));
-	oCert.push_back(Pair("cert", stringFromVch(cert.vchCert)));
-	oCert.push_back(Pair("height", (int)cert.nHeight));
-	int64_t nTime = 0;
-	if (chainActive.Height() >= cert.nHeight-1) {
-		CBlockIndex *pindex = chainActive[cert.nHeight-1];
-		if (pindex) {
-			nTime = pindex->GetMedianTimePast();
-		}
-	}
-	oCert.push_back(Pair("time", nTime));
-	oCert.push_back(Pair("title", stringFromVch(cert.vchTitle)));
-	oCert.push_back(Pair("publicvalue", stringFromVch(cert.vchPubData)));
-	oCert.push_back(Pair("category", stringFromVch(cert.sCategory)));
-	oCert.push_back(Pair("alias", stringFromVch(cert.vchAlias)));
-	oCert.push_back(Pair("access_flags", cert.nAccessFlags));
-	return true;
-}
-bool BuildCertIndexerJson(const CCert& cert, UniValue& oCert)
-{
-	oCert.push_back(Pair("_id", stringFromVch(cert.vchCert)));
-	oCert.push_back(Pair("title", stringFromVch(cert.vchTitle)));
-	oCert.push_back(Pair("height", (int)cert.nHeight));
-	oCert.push_back(Pair("category", stringFromVch(cert.sCategory)));
-	// TODO change alias to owner in later release with help of BMD team to detect upstream changes
-	oCert.push_back(Pair("alias", stringFromVch(cert.vchAlias)));
-	// TODO remove in later release with help of BMD team to detect upstream issues
-	oCert.push_back(Pair("expires_on", GetCertExpiration(cert)));
-	return true;
-}
 void CertTxToJSON(const int op, const std::vector<unsigned char> &vchData, const std::vector<unsigned char> &vchHash, UniValue &entry)
 {
 	string opName = certFromOp(op);
@@ -868,83 +821,37 @@ void CertTxToJSON(const int op, const std::vector<unsigned char> &vchData, const
 		entry.push_back(Pair("access_flags", cert.nAccessFlags));
 }
 
-bool CCertDB::ScanCerts(const int count, const int from, const UniValue& oOptions, UniValue& oRes) {
-	string strTxid = "";
+CServiceIndexEntry CCertDB::GetIndexEntry(const CCert& cert) {
+	CServiceIndexEntry entry(cert.nHeight, cert.txHash);
+	entry.AddOwner(cert.vchAlias);
+	return entry;
+}
+bool CCertDB::ScanCerts(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor) {
 	vector<unsigned char> vchCert, vchAlias;
-	int nStartBlock = 0;
 	if (!oOptions.isNull()) {
-		const UniValue &txid = find_value(oOptions, "txid");
-		if (txid.isStr()) {
-			strTxid = txid.get_str();
-		}
 		const UniValue &certObj = find_value(oOptions, "cert");
 		if (certObj.isStr()) {
 			vchCert = vchFromValue(certObj);
+			scan.SetKey(vchCert);
 		}
 
 		const UniValue &aliasObj = find_value(oOptions, "alias");
 		if (aliasObj.isStr()) {
 			vchAlias = vchFromValue(aliasObj);
-		}
-
-		const UniValue &startblock = find_value(oOptions, "startblock");
-		if (startblock.isNum()) {
-			nStartBlock = startblock.get_int();
-		}
-	}
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
-	CCert txPos;
-	pair<string, vector<unsigned char> > key;
-	int index = 0;
-	while (pcursor->Valid()) {
-		boost::this_thread::interruption_point();
-		try {
-			if (pcursor->GetKey(key) && key.first == "certi") {
-				pcursor->GetValue(txPos);
-				if (nStartBlock > 0 && txPos.nHeight < nStartBlock)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!strTxid.empty() && strTxid != txPos.txHash.GetHex())
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchCert.empty() && vchCert != txPos.vchCert)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchAlias.empty() && vchAlias != txPos.vchAlias)
-				{
-					pcursor->Next();
-					continue;
-				}
-				UniValue oCert(UniValue::VOBJ);
-				if (!BuildCertJson(txPos, oCert))
-				{
-					pcursor->Next();
-					continue;
-				}
-				index += 1;
-				if (index <= from)
-				{
-					pcursor->Next();
-					continue;
-				}
-				oRes.push_back(oCert);
-				if (index >= count + from)
-					break;
-			}
-			pcursor->Next();
-		}
-		catch (std::exception &e) {
-			return error("%s() : deserialize error", __PRETTY_FUNCTION__);
+			scan.AddOwner(vchAlias);
 		}
 	}
-	return true;
+	return serviceIndex.Scan(scan, [&](const CCert& txPos, UniValue& oCert) {
+		if (scan.nStartBlock > 0 && txPos.nHeight < scan.nStartBlock)
+			return false;
+		if (!scan.txHash.IsNull() && scan.txHash != txPos.txHash)
+			return false;
+		if (!vchCert.empty() && vchCert != txPos.vchCert)
+			return false;
+		if (!vchAlias.empty() && vchAlias != txPos.vchAlias)
+			return false;
+		return BuildCertJson(txPos, oCert);
+	}, oRes, strCursor);
 }
 
 UniValue listcerts(const JSONRPCRequest& request) {
@@ -960,12 +867,14 @@ UniValue listcerts(const JSONRPCRequest& request) {
 			"	     \"cert\":guid				(string) Certificate GUID to filter.\n"
 			"      \"alias\":alias			(string) Owner alias name to filter.\n"
 			"      \"startblock\":block	(number) Earliest block to filter from. Block number is the block at which the transaction would have confirmed.\n"
+			"      \"cursor\":cursor		(string) Page through the results: \"\" for the first page, then the cursor returned with the previous page. The result becomes {\"results\":[...],\"cursor\":cursor}, the cursor is empty after the last page.\n"
 			"    }\n"
 			+ HelpExampleCli("listcerts", "0")
 			+ HelpExampleCli("listcerts", "10 0")
 			+ HelpExampleCli("listcerts", "0 0 '{\"alias\":\"cert-owner-alias\",\"startblock\":0}'")
 			+ HelpExampleCli("listcerts", "0 0 '{\"cert\":\"32bff1fa844c124\"}'")
 			+ HelpExampleCli("listcerts", "0 0 '{\"txid\":\"1c7f966dab21119bac53213a2bc7532bff1fa844c124fd750a7d0b1332440bd1\"}'")
+			+ HelpExampleCli("listcerts", "100 0 '{\"cursor\":\"\"}'")
 		);
 	UniValue options;
 	int count = 10;
@@ -989,8 +898,10 @@ UniValue listcerts(const JSONRPCRequest& request) {
 		options = params[2];
 	}
 
-	UniValue oRes(UniValue::VARR);
-	if (!pcertdb->ScanCerts(count, from, options, oRes))
+	CServiceScan scan(count, from, options);
+	RPCResultArray oRes = ServiceScanArray(request, scan);
+	std::string strCursor;
+	if (!pcertdb->ScanCerts(scan, options, oRes, strCursor))
 		throw runtime_error("BILLIECOIN_CERT_RPC_ERROR: ERRCODE: 3508 - " + _("Scan failed"));
-	return oRes;
+	return ServiceScanResult(scan, oRes, strCursor);
 }
@@ -7,6 +7,7 @@
 
 #include "rpc/server.h"
 #include "dbwrapper.h"
+#include "serviceindex.h"
 #include "script/script.h"
 #include "serialize.h"
 #include "assetallocation.h"
@@ -16,7 +17,8 @@ class CReserveKey;
 class CCoinsViewCache;
 class CBlock;
 class CAliasIndex;
-bool CheckCertInputs(const CTransaction &tx, int op, const std::vector<std::vector<unsigned char> > &vvchArgs, const std::vector<unsigned char> &vvchAlias, bool fJustCheck, int nHeight, sorted_vector<std::vector<unsigned char> > &revertedCerts, std::string &errorMessage, bool bSanityCheck=false);
+class CServicePayload;
+bool CheckCertInputs(const CTransaction &tx, const CServicePayload &payload, const std::vector<unsigned char> &vvchAlias, bool fJustCheck, int nHeight, sorted_vector<std::vector<unsigned char> > &revertedCerts, std::string &errorMessage, bool bSanityCheck=false);
 bool DecodeCertTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch);
 bool DecodeAndParseCertTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch, char& type);
 bool DecodeCertScript(const CScript& script, int& op, std::vector<std::vector<unsigned char> > &vvch);
@@ -90,12 +92,16 @@ public:
 
 
 class CCertDB : public CDBWrapper {
+private:
+	CServiceIndex<std::vector<unsigned char>, CCert> serviceIndex;
+	static CServiceIndexEntry GetIndexEntry(const CCert& cert);
 public:
-    CCertDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "certificates", nCacheSize, fMemory, fWipe) {}
+    CCertDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "certificates", nCacheSize, fMemory, fWipe), serviceIndex(*this, "cert", &GetIndexEntry) {}
 
     bool WriteCert(const CCert& cert, const int &op, const int64_t& arrivalTime, const bool &fJustCheck, const bool bNotify=true) {
-		bool writeState = false;;
-		writeState = Write(make_pair(std::string("certi"), cert.vchCert), cert);
+		CDBBatch batch(*this);
+		serviceIndex.Write(batch, cert.vchCert, cert);
+		bool writeState = WriteBatch(batch);
 		if (!fJustCheck) {
 			writeState = writeState && Write(make_pair(std::string("certp"), cert.vchCert), cert);
 			if (op == OP_CERT_ACTIVATE)
@@ -115,7 +121,9 @@ public:
     }
 
     bool EraseCert(const std::vector<unsigned char>& vchCert, bool cleanup = false) {
-		bool eraseState = Erase(make_pair(std::string("certi"), vchCert));
+		CDBBatch batch(*this);
+		serviceIndex.Erase(batch, vchCert);
+		bool eraseState = WriteBatch(batch);
 		if (eraseState) {
 			Erase(make_pair(std::string("certp"), vchCert));
 			Erase(make_pair(std::string("certf"), vchCert));
@@ -139,16 +147,22 @@ public:
 	bool EraseISArrivalTimes(const std::vector<unsigned char>& vchCert) {
 		return Erase(make_pair(std::string("certa"), vchCert));
 	}
-	bool CleanupDatabase(int &servicesCleaned);
+	/** Erase the expired records an alias is indexed as an owner of */
+	bool CleanupDatabase(const std::vector<unsigned char>& vchAlias, int &servicesCleaned);
+	/** Up to nMax aliases after vchAfter that own certificates */
+	bool GetOwners(const std::vector<unsigned char>& vchAfter, const size_t nMax, std::vector<std::vector<unsigned char> >& vOwners) const {
+		return serviceIndex.GetOwners(vchAfter, nMax, vOwners);
+	}
 	void WriteCertIndex(const CCert& cert, const int &op);
 	void WriteCertIndexHistory(const CCert& cert, const int &op);
-	bool ScanCerts(const int count, const int from, const UniValue& oOptions, UniValue& oRes);
+	bool BuildIndexes() {
+		return serviceIndex.Build();
+	}
+	bool ScanCerts(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor);
 
 };
 bool GetCert(const std::vector<unsigned char> &vchCert,CCert& txPos);
 bool GetFirstCert(const std::vector<unsigned char> &vchCert, CCert& txPos);
 bool BuildCertJson(const CCert& cert, UniValue& oName);
-bool BuildCertIndexerJson(const CCert& cert,UniValue& oName);
-bool BuildCertIndexerHistoryJson(const CCert& cert, UniValue& oName);
 uint64_t GetCertExpiration(const CCert& cert);
 #endif // CERT_H
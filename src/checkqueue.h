@@ -7,6 +7,9 @@
 #define BILLIECOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -215,4 +218,150 @@ public:
     }
 };
 
+/**
+ * Wraps a check so that it reports failure to the transaction it belongs to
+ * instead of failing the whole queue run. This lets checks of unrelated
+ * transactions share one CCheckQueue batch.
+ */
+template <typename T>
+class CBatchedCheck
+{
+public:
+    struct Result {
+        std::atomic<bool> fFailed;
+        Result() : fFailed(false) {}
+    };
+
+    CBatchedCheck() {}
+    CBatchedCheck(T& checkIn, const std::shared_ptr<Result>& resultIn) : result(resultIn)
+    {
+        check.swap(checkIn);
+    }
+
+    bool operator()()
+    {
+        // skip the remaining checks of a transaction that already failed
+        if (!result->fFailed.load(std::memory_order_relaxed) && !check())
+            result->fFailed = true;
+        return true;
+    }
+
+    void swap(CBatchedCheck& x)
+    {
+        check.swap(x.check);
+        result.swap(x.result);
+    }
+
+private:
+    T check;
+    std::shared_ptr<Result> result;
+};
+
+/**
+ * Collects the checks of many transactions into batches that are run through a
+ * CCheckQueue together, then hands every transaction its own result.
+ *
+ * Add() never runs anything, it only reports when the caller should flush: the
+ * batch is full, or no task announced through Expect() is left to add to it. The
+ * last announced task to add therefore always flushes, whatever other work is
+ * queued behind it. Flush() runs whatever is pending, and keeps going while other
+ * threads add more. An announced task that will never run, for instance because
+ * its executor dropped it on shutdown, must be withdrawn through Drop() or the
+ * partial batch waits for it forever. Only one thread flushes at a time, a concurrent Flush()
+ * returns right away and leaves the work to the thread already flushing.
+ * Callbacks run on the flushing thread and must not throw.
+ */
+template <typename T>
+class CCheckQueueBatcher
+{
+public:
+    typedef std::function<void(bool)> Callback;
+
+    CCheckQueueBatcher(CCheckQueue<CBatchedCheck<T> >* pqueueIn, unsigned int nBatchSizeIn) : pqueue(pqueueIn), nBatchSize(nBatchSizeIn), nExpected(0), fFlushing(false) {}
+
+    //! Announce a task that will Add() its checks later, callers adding before it leave the flush to it
+    void Expect()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nExpected++;
+    }
+
+    //! Withdraw an announcement for a task that will not run, returns true when the caller should flush
+    bool Cancel()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (nExpected > 0)
+            nExpected--;
+        return nExpected == 0 && !vPending.empty();
+    }
+
+    //! Withdraw the announcement of a task that was dropped and flush if it was the last one, returns the number of checks run
+    size_t Drop()
+    {
+        return Cancel() ? Flush() : 0;
+    }
+
+    //! Queue the checks of one (announced) transaction, returns true when the caller should flush
+    bool Add(std::vector<T>& vChecksIn, const Callback& callback)
+    {
+        std::shared_ptr<typename CBatchedCheck<T>::Result> result = std::make_shared<typename CBatchedCheck<T>::Result>();
+        boost::unique_lock<boost::mutex> lock(mutex);
+        for (T& check : vChecksIn)
+            vChecks.emplace_back(check, result);
+        vPending.push_back(std::make_pair(result, callback));
+        if (nExpected > 0)
+            nExpected--;
+        return vChecks.size() >= nBatchSize || nExpected == 0;
+    }
+
+    //! Run the pending checks and call back, returns the number of checks run by this thread
+    size_t Flush()
+    {
+        size_t nRun = 0;
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (fFlushing)
+            return 0;
+        fFlushing = true;
+        while (!vPending.empty()) {
+            std::vector<CBatchedCheck<T> > vBatch;
+            std::vector<PendingTx> vDone;
+            vBatch.swap(vChecks);
+            vDone.swap(vPending);
+            lock.unlock();
+            nRun += vBatch.size();
+            if (pqueue != NULL) {
+                CCheckQueueControl<CBatchedCheck<T> > control(pqueue);
+                control.Add(vBatch);
+                control.Wait();
+            } else {
+                for (CBatchedCheck<T>& check : vBatch)
+                    check();
+            }
+            for (PendingTx& pending : vDone)
+                pending.second(!pending.first->fFailed);
+            lock.lock();
+        }
+        fFlushing = false;
+        return nRun;
+    }
+
+    size_t GetPending()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        return vChecks.size();
+    }
+
+private:
+    typedef std::pair<std::shared_ptr<typename CBatchedCheck<T>::Result>, Callback> PendingTx;
+
+    CCheckQueue<CBatchedCheck<T> >* const pqueue;
+    const unsigned int nBatchSize;
+    boost::mutex mutex;
+    std::vector<CBatchedCheck<T> > vChecks;
+    std::vector<PendingTx> vPending;
+    //! announced tasks that have not added yet
+    unsigned int nExpected;
+    bool fFlushing;
+};
+
 #endif // BILLIECOIN_CHECKQUEUE_H
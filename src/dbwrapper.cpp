@@ -9,6 +9,8 @@
 #include "random.h"
 
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -16,6 +18,7 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <memory>
 
 class CBilliecoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -182,12 +185,143 @@ CDBWrapper::~CDBWrapper()
 }
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
+{
+    CDBStagedWrites* pstaged = CDBStagedWrites::GetActive();
+    if (pstaged) {
+        pstaged->Stage(this, batch.batch);
+        return true;
+    }
+    return WriteBatchDirect(batch, fSync);
+}
+
+bool CDBWrapper::WriteBatchDirect(CDBBatch& batch, bool fSync)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    BatchWritten(batch.batch);
+    return true;
+}
+
+bool CDBWrapper::ReadRaw(const leveldb::Slice& slKey, std::string& strValue) const
+{
+    const CDBStagedWrites* pstaged = CDBStagedWrites::GetActive();
+    if (pstaged) {
+        const int nStaged = pstaged->Lookup(this, slKey, strValue);
+        if (nStaged != 0)
+            return nStaged > 0;
+    }
+    leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+    if (!status.ok()) {
+        if (status.IsNotFound())
+            return false;
+        LogPrintf("LevelDB read failure: %s\n", status.ToString());
+        dbwrapper_private::HandleError(status);
+    }
+    return true;
+}
+
+namespace {
+// records the operations of a leveldb::WriteBatch as staged changes
+class CStagingHandler : public leveldb::WriteBatch::Handler
+{
+public:
+    std::vector<std::pair<std::string, boost::optional<std::string> > > vOps;
+
+    void Put(const leveldb::Slice& key, const leveldb::Slice& value) override
+    {
+        vOps.emplace_back(key.ToString(), value.ToString());
+    }
+    void Delete(const leveldb::Slice& key) override
+    {
+        vOps.emplace_back(key.ToString(), boost::none);
+    }
+};
+
+// staged writes are owned by the caller, the thread only points at them
+void NoCleanup(CDBStagedWrites*) {}
+boost::thread_specific_ptr<CDBStagedWrites> ptrStagedWrites(NoCleanup);
+}
+
+CDBStagedWrites* CDBStagedWrites::GetActive()
+{
+    return ptrStagedWrites.get();
+}
+
+void CDBStagedWrites::Stage(CDBWrapper* pdb, const leveldb::WriteBatch& batch)
+{
+    CStagingHandler handler;
+    leveldb::Status status = batch.Iterate(&handler);
+    dbwrapper_private::HandleError(status);
+    for (auto& op : handler.vOps) {
+        mapLatest[std::make_pair(pdb, op.first)] = vChanges.size();
+        vChanges.push_back(CChange{pdb, std::move(op.first), !op.second, op.second ? std::move(*op.second) : std::string(), nTag});
+    }
+}
+
+int CDBStagedWrites::Lookup(const CDBWrapper* pdb, const leveldb::Slice& key, std::string& strValue) const
+{
+    auto it = mapLatest.find(std::make_pair(pdb, key.ToString()));
+    if (it == mapLatest.end())
+        return 0;
+    const CChange& change = vChanges[it->second];
+    if (change.fErase)
+        return -1;
+    strValue = change.strValue;
+    return 1;
+}
+
+void CDBStagedWrites::Defer(const std::function<void()>& func)
+{
+    CDBStagedWrites* pstaged = GetActive();
+    if (!pstaged) {
+        func();
+        return;
+    }
+    pstaged->vDeferred.push_back(CDeferred{func, pstaged->nTag});
+}
+
+bool CDBStagedWrites::Commit(int nTagEnd)
+{
+    assert(GetActive() != this);
+    std::vector<CDeferred> vKept;
+    for (CDeferred& deferred : vDeferred) {
+        if (deferred.nTag < nTagEnd)
+            vKept.push_back(std::move(deferred));
+    }
+    vDeferred.clear();
+    std::map<CDBWrapper*, std::unique_ptr<CDBBatch> > mapBatches;
+    for (const CChange& change : vChanges) {
+        if (change.nTag >= nTagEnd)
+            continue;
+        std::unique_ptr<CDBBatch>& batch = mapBatches[change.pdb];
+        if (!batch)
+            batch.reset(new CDBBatch(*change.pdb));
+        if (change.fErase)
+            batch->batch.Delete(change.strKey);
+        else
+            batch->batch.Put(change.strKey, change.strValue);
+    }
+    vChanges.clear();
+    mapLatest.clear();
+    for (auto& batch : mapBatches) {
+        if (!batch.first->WriteBatch(*batch.second))
+            return false;
+    }
+    for (CDeferred& deferred : vKept)
+        Defer(deferred.func);
     return true;
 }
 
+CDBStagingScope::CDBStagingScope(CDBStagedWrites& staged) : pprev(ptrStagedWrites.get())
+{
+    ptrStagedWrites.reset(&staged);
+}
+
+CDBStagingScope::~CDBStagingScope()
+{
+    ptrStagedWrites.reset(pprev);
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
@@ -13,6 +13,8 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <functional>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -49,6 +51,7 @@ const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w);
 class CDBBatch
 {
     friend class CDBWrapper;
+    friend class CDBStagedWrites;
 
 private:
     const CDBWrapper &parent;
@@ -141,6 +144,11 @@ public:
         piter->Seek(slKey);
     }
 
+    /** Seek to a key given in its serialized form, as returned by GetKeyRaw */
+    void SeekRaw(const std::string& strKey) {
+        piter->Seek(leveldb::Slice(strKey));
+    }
+
     void Next();
 
     template<typename K> bool GetKey(K& key) {
@@ -154,6 +162,10 @@ public:
         return true;
     }
 
+    std::string GetKeyRaw() {
+        return piter->key().ToString();
+    }
+
     unsigned int GetKeySize() {
         return piter->key().size();
     }
@@ -176,9 +188,82 @@ public:
 
 };
 
+/**
+ * Changes to databases held back on one thread until they are committed.
+ *
+ * While a CDBStagedWrites is active on a thread (see CDBStagingScope), Write,
+ * Erase and WriteBatch on any CDBWrapper only record the change, and Read and
+ * Exists on that thread find the recorded changes before the database. Other
+ * threads and iterators see committed data only. Changes are tagged with the
+ * value last passed to SetTag so that a prefix of the work can be committed.
+ * Scopes nest, committing inside another scope moves the changes into it.
+ * Work that has to follow a change, like notifications and index updates that
+ * read the wallet or the chain, is queued with Defer() and runs on the
+ * committing thread once the change it follows is committed.
+ */
+class CDBStagedWrites
+{
+private:
+    struct CChange {
+        CDBWrapper* pdb;
+        std::string strKey;
+        bool fErase;
+        std::string strValue;
+        int nTag;
+    };
+    struct CDeferred {
+        std::function<void()> func;
+        int nTag;
+    };
+    std::vector<CChange> vChanges;
+    std::vector<CDeferred> vDeferred;
+    //! position of the latest change of each key in vChanges
+    std::map<std::pair<const CDBWrapper*, std::string>, size_t> mapLatest;
+    int nTag;
+
+public:
+    CDBStagedWrites() : nTag(0) {}
+
+    /** The staged writes active on the calling thread, NULL if writes go straight to the database */
+    static CDBStagedWrites* GetActive();
+
+    void SetTag(int nTagIn) { nTag = nTagIn; }
+    void Stage(CDBWrapper* pdb, const leveldb::WriteBatch& batch);
+
+    /** Run func now, or if staged writes are active on the calling thread once they are committed with the current tag kept */
+    static void Defer(const std::function<void()>& func);
+
+    /**
+     * Find the latest staged change of a key.
+     * @return 1 and the raw value if the key was written, -1 if it was erased, 0 if it was not changed
+     */
+    int Lookup(const CDBWrapper* pdb, const leveldb::Slice& key, std::string& strValue) const;
+
+    /**
+     * Write the changes tagged below nTagEnd, in staging order with one batch per database, then run the
+     * deferred work tagged below nTagEnd, and forget all changes and work. If other staged writes are
+     * active on the calling thread the changes and the work go there instead.
+     */
+    bool Commit(int nTagEnd);
+
+    size_t Size() const { return vChanges.size(); }
+};
+
+/** Makes a CDBStagedWrites active on the calling thread for the lifetime of the scope */
+class CDBStagingScope
+{
+private:
+    CDBStagedWrites* pprev;
+
+public:
+    explicit CDBStagingScope(CDBStagedWrites& staged);
+    ~CDBStagingScope();
+};
+
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
+    friend class CDBStagedWrites;
 private:
     //! custom environment this database is using (may be NULL in case of default environment)
     leveldb::Env* penv;
@@ -212,6 +297,15 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+    //! look a serialized key up in the staged writes of this thread and then in the database
+    bool ReadRaw(const leveldb::Slice& slKey, std::string& strValue) const;
+
+    bool WriteBatchDirect(CDBBatch& batch, bool fSync);
+
+protected:
+    //! called after a batch reached the database, for caches in front of it to drop the keys it changed
+    virtual void BatchWritten(const leveldb::WriteBatch& batch) {}
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -222,7 +316,7 @@ public:
      *                        with a zero'd byte array.
      */
     CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, bool bBilliecoin = false);
-    ~CDBWrapper();
+    virtual ~CDBWrapper();
 
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
@@ -233,13 +327,8 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
-        if (!status.ok()) {
-            if (status.IsNotFound())
-                return false;
-            LogPrintf("LevelDB read failure: %s\n", status.ToString());
-            dbwrapper_private::HandleError(status);
-        }
+        if (!ReadRaw(slKey, strValue))
+            return false;
         try {
             CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue.Xor(obfuscate_key);
@@ -250,6 +339,20 @@ public:
         return true;
     }
 
+    /** Whether the calling thread has staged changes of the key, which reads would see instead of the database */
+    template <typename K>
+    bool IsStaged(const K& key) const
+    {
+        const CDBStagedWrites* pstaged = CDBStagedWrites::GetActive();
+        if (!pstaged)
+            return false;
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey << key;
+        std::string strValue;
+        return pstaged->Lookup(this, leveldb::Slice(ssKey.data(), ssKey.size()), strValue) != 0;
+    }
+
     template <typename K, typename V>
     bool Write(const K& key, const V& value, bool fSync = false)
     {
@@ -267,14 +370,7 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
-        if (!status.ok()) {
-            if (status.IsNotFound())
-                return false;
-            LogPrintf("LevelDB read failure: %s\n", status.ToString());
-            dbwrapper_private::HandleError(status);
-        }
-        return true;
+        return ReadRaw(slKey, strValue);
     }
 
     template <typename K>
@@ -18,6 +18,8 @@
 #include "script/script.h"
 #include "chainparams.h"
 #include "wallet/coincontrol.h"
+#include "serviceevent.h"
+#include "servicepayload.h"
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/hex.hpp>
@@ -201,51 +203,34 @@ void CEscrow::Serialize(vector<unsigned char>& vchData) {
 	vchData = vector<unsigned char>(dsEscrow.begin(), dsEscrow.end());
 
 }
-void CEscrowDB::WriteEscrowIndex(const COffer& offer, const CEscrow& escrow, const std::vector<std::vector<unsigned char> > &vvchArgs) {
-	if (IsArgSet("-zmqpubescrowrecord")) {
-		UniValue oName(UniValue::VOBJ);
-		if (BuildEscrowIndexerJson(offer, escrow, oName)) {
-			GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "escrowrecord");
-		}
-	}
+void CEscrowDB::WriteEscrowIndex(const COffer& offer, const CEscrow& escrow, const CServiceArgs &vvchArgs) {
+	if (IsArgSet("-zmqpubescrowrecord"))
+		PublishServiceEvent("escrowrecord", escrow, offer);
 }
 void CEscrowDB::WriteEscrowFeedbackIndex(const COffer &offer, const CEscrow& escrow) {
-	if (IsArgSet("-zmqpubescrowfeedback")) {
-		UniValue oName(UniValue::VOBJ);
-		BuildFeedbackJson(offer, escrow, oName);
-		GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "escrowfeedback");
-	}
+	if (IsArgSet("-zmqpubescrowfeedback"))
+		PublishServiceEvent("escrowfeedback", escrow, offer);
 }
 void CEscrowDB::WriteEscrowBidIndex(const COffer& offer, const CEscrow& escrow, const string& status) {
 	if (escrow.op != OP_ESCROW_ACTIVATE)
 		return;
-	if (IsArgSet("-zmqpubescrowbid")) {
-		UniValue oName(UniValue::VOBJ);
-		BuildEscrowBidJson(offer, escrow, status, oName);
-		GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "escrowbid");
-	}
+	if (IsArgSet("-zmqpubescrowbid"))
+		PublishServiceEvent("escrowbid", escrow, offer, status);
 }
-bool CEscrowDB::CleanupDatabase(int &servicesCleaned)
+bool CEscrowDB::CleanupDatabase(const vector<unsigned char>& vchAlias, int &servicesCleaned)
 {
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
+	vector<vector<unsigned char> > vchEscrows;
+	if (!serviceIndex.GetOwned(vchAlias, vchEscrows))
+		return false;
 	CEscrow txPos;
-	pair<string, vector<unsigned char> > key;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
-			if (pcursor->GetKey(key) && key.first == "escrowi") {
-  				if (!GetEscrow(key.second, txPos) || chainActive.Tip()->GetMedianTimePast() >= (int64_t)GetEscrowExpiration(txPos))
-				{
-					servicesCleaned++;
-					EraseEscrow(key.second, true);
-				}
-            }
-            pcursor->Next();
-        } catch (std::exception &e) {
-            return error("%s() : deserialize error", __PRETTY_FUNCTION__);
-        }
-    }
+	for (const vector<unsigned char>& vchEscrow : vchEscrows) {
+		if (!GetEscrow(vchEscrow, txPos) || chainActive.Tip()->GetMedianTimePast() >= (int64_t)GetEscrowExpiration(txPos))
+		{
+			servicesCleaned++;
+			if (!EraseEscrow(vchEscrow, true))
+				return false;
+		}
+	}
 	return true;
 }
 
@@ -365,7 +350,7 @@ bool ValidateExternalPayment(const CEscrow& theEscrow, const bool &bSanityCheck,
 	}
 	return true;
 }
-bool CheckEscrowInputs(const CTransaction &tx, int op, const vector<vector<unsigned char> > &vvchArgs, const std::vector<std::vector<unsigned char> > &vvchAliasArgs, bool fJustCheck, int nHeight, string &errorMessage, bool bSanityCheck) {
+bool CheckEscrowInputs(const CTransaction &tx, const CServicePayload &payload, const CServiceArgs &vvchAliasArgs, bool fJustCheck, int nHeight, string &errorMessage, bool bSanityCheck) {
 	if (!pescrowdb || !paliasdb)
 		return false;
 	if (tx.IsCoinBase() && !fJustCheck && !bSanityCheck)
@@ -379,16 +364,16 @@ bool CheckEscrowInputs(const CTransaction &tx, int op, const vector<vector<unsig
 			fJustCheck ? "JUSTCHECK" : "BLOCK");
 
 
-	 // unserialize escrow UniValue from txn, check for valid
-    CEscrow theEscrow;
-	vector<unsigned char> vchData;
-	vector<unsigned char> vchHash;
-	int nDataOut;
-	if(!GetBilliecoinData(tx, vchData, vchHash, nDataOut) || !theEscrow.UnserializeFromData(vchData, vchHash))
+	// the escrow was unserialized from the txn with the payload, check for valid
+	const int op = payload.nOp;
+	const CServiceArgs &vvchArgs = payload.vvchArgs;
+	const vector<unsigned char> &vchHash = payload.vchDataHash;
+	if(!payload.escrow)
 	{
 		errorMessage = "BILLIECOIN_ESCROW_CONSENSUS_ERROR ERRCODE: 4000 - " + _("Cannot unserialize data inside of this transaction relating to an escrow");
 		return true;
 	}
+	CEscrow theEscrow(*payload.escrow);
 
 	if(fJustCheck)
 	{
@@ -2224,46 +2209,6 @@ UniValue escrowinfo(const JSONRPCRequest& request) {
 		throw runtime_error("BILLIECOIN_ESCROW_RPC_ERROR: ERRCODE: 4538 - " + _("Could not find this escrow"));
     return oEscrow;
 }
-void BuildFeedbackJson(const COffer& offer, const CEscrow& escrow, UniValue& oFeedback) {
-	string sFeedbackTime;
-	if (escrow.feedback.IsNull())
-		return;
-	if (chainActive.Height() >= escrow.nHeight-1) {
-		CBlockIndex *pindex = chainActive[escrow.nHeight-1];
-		if (pindex) {
-			sFeedbackTime = strprintf("%llu", pindex->GetMedianTimePast());
-		}
-	}
-	const string &id = stringFromVch(escrow.vchEscrow) + CFeedback::FeedbackUserToString(escrow.feedback.nFeedbackUserFrom) + CFeedback::FeedbackUserToString(escrow.feedback.nFeedbackUserTo);
-	oFeedback.push_back(Pair("_id", id));
-	oFeedback.push_back(Pair("offer", stringFromVch(escrow.vchOffer)));
-	oFeedback.push_back(Pair("escrow", stringFromVch(escrow.vchEscrow)));
-	oFeedback.push_back(Pair("txid", escrow.txHash.GetHex()));
-	oFeedback.push_back(Pair("time", sFeedbackTime));
-	oFeedback.push_back(Pair("rating", escrow.feedback.nRating));
-	oFeedback.push_back(Pair("feedbackuserfrom", escrow.feedback.nFeedbackUserFrom));
-	oFeedback.push_back(Pair("feedbackuserto", escrow.feedback.nFeedbackUserTo));
-	oFeedback.push_back(Pair("feedback", stringFromVch(escrow.feedback.vchFeedback)));
-}
-void BuildEscrowBidJson(const COffer& offer, const CEscrow& escrow, const string& status, UniValue& oBid) {
-	oBid.push_back(Pair("_id", escrow.txHash.GetHex()));
-	int64_t nTime = 0;
-	if (chainActive.Height() >= escrow.nHeight-1) {
-		CBlockIndex *pindex = chainActive[escrow.nHeight-1];
-		if (pindex) {
-			nTime = pindex->GetMedianTimePast();
-		}
-	}
-	oBid.push_back(Pair("time", nTime));
-	oBid.push_back(Pair("offer", stringFromVch(escrow.vchOffer)));
-	oBid.push_back(Pair("escrow", stringFromVch(escrow.vchEscrow)));
-	oBid.push_back(Pair("height", (int)escrow.nHeight));
-	oBid.push_back(Pair("bidder", stringFromVch(escrow.vchBuyerAlias)));
-	oBid.push_back(Pair("bid_in_offer_currency_per_unit", escrow.fBidPerUnit));
-	oBid.push_back(Pair("bid_in_payment_option_per_unit", ValueFromAmount(escrow.nAmountOrBidPerUnit)));
-	oBid.push_back(Pair("witness", stringFromVch(escrow.vchWitness)));
-	oBid.push_back(Pair("status", status));
-}
 bool BuildEscrowJson(const CEscrow &escrow, UniValue& oEscrow)
 {
 	COffer theOffer;
@@ -2327,39 +2272,6 @@ bool BuildEscrowJson(const CEscrow &escrow, UniValue& oEscrow)
 	oEscrow.push_back(Pair("status", escrowEnumFromOp(escrow.op)));
 	return true;
 }
-bool BuildEscrowIndexerJson(const COffer& theOffer, const CEscrow &escrow, UniValue& oEscrow)
-{
-	oEscrow.push_back(Pair("_id", stringFromVch(escrow.vchEscrow)));
-	int64_t nTime = 0;
-	if (chainActive.Height() >= escrow.nHeight-1) {
-		CBlockIndex *pindex = chainActive[escrow.nHeight-1];
-		if (pindex) {
-			nTime = pindex->GetMedianTimePast();
-		}
-	}
-	oEscrow.push_back(Pair("time", nTime));
-	oEscrow.push_back(Pair("offer", stringFromVch(escrow.vchOffer)));
-	oEscrow.push_back(Pair("height", (int)escrow.nHeight));
-	oEscrow.push_back(Pair("seller", stringFromVch(escrow.vchSellerAlias)));
-	oEscrow.push_back(Pair("arbiter", stringFromVch(escrow.vchArbiterAlias)));
-	oEscrow.push_back(Pair("buyer", stringFromVch(escrow.vchBuyerAlias)));
-	oEscrow.push_back(Pair("currency", IsOfferTypeInMask(theOffer.offerType, OFFERTYPE_COIN) ? GetPaymentOptionsString(escrow.nPaymentOption) : stringFromVch(theOffer.sCurrencyCode)));
-	oEscrow.push_back(Pair("offer_price", theOffer.GetPrice()));
-	oEscrow.push_back(Pair("offer_title", stringFromVch(theOffer.sTitle)));
-	oEscrow.push_back(Pair("quantity", (int)escrow.nQty));
-	const CAmount &nEscrowFees = escrow.nDeposit + escrow.nArbiterFee + escrow.nWitnessFee + escrow.nNetworkFee + escrow.nShipping;
-	const CAmount &nTotalWithoutFee = escrow.nAmountOrBidPerUnit*escrow.nQty;
-	const CAmount &nTotalWithFee = nTotalWithoutFee + nEscrowFees;
-	oEscrow.push_back(Pair("total_with_fee", ValueFromAmount(nTotalWithFee)));
-	oEscrow.push_back(Pair("total_without_fee", ValueFromAmount(nTotalWithoutFee)));
-	oEscrow.push_back(Pair("exttxid", escrow.extTxId.IsNull() ? "" : escrow.extTxId.GetHex()));
-	CScriptID innerID(CScript(escrow.vchRedeemScript.begin(), escrow.vchRedeemScript.end()));
-	CBilliecoinAddress address(innerID, PaymentOptionToAddressType(escrow.nPaymentOption));
-	oEscrow.push_back(Pair("escrowaddress", address.ToString()));
-	oEscrow.push_back(Pair("paymentoption", GetPaymentOptionsString(escrow.nPaymentOption)));
-	oEscrow.push_back(Pair("status", escrowEnumFromOp(escrow.op)));
-	return true;
-}
 void EscrowTxToJSON(const int op, const std::vector<unsigned char> &vchData, const std::vector<unsigned char> &vchHash, UniValue &entry)
 {
 	
@@ -2384,18 +2296,20 @@ void EscrowTxToJSON(const int op, const std::vector<unsigned char> &vchData, con
 	if(!escrow.feedback.IsNull())
 		entry.push_back(Pair("feedback",_("Escrow feedback was given")));
 }
-bool CEscrowDB::ScanEscrows(const int count, const int from, const UniValue& oOptions, UniValue& oRes) {
-	string strTxid = "";
+CServiceIndexEntry CEscrowDB::GetIndexEntry(const CEscrow& escrow) {
+	CServiceIndexEntry entry(escrow.nHeight, escrow.txHash);
+	entry.AddOwner(escrow.vchBuyerAlias);
+	entry.AddOwner(escrow.vchSellerAlias);
+	entry.AddOwner(escrow.vchArbiterAlias);
+	return entry;
+}
+bool CEscrowDB::ScanEscrows(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor) {
 	vector<unsigned char> vchEscrow, vchBuyerAlias, vchSellerAlias, vchArbiterAlias;
-	int nStartBlock = 0;
 	if (!oOptions.isNull()) {
-		const UniValue &txid = find_value(oOptions, "txid");
-		if (txid.isStr()) {
-			strTxid = txid.get_str();
-		}
 		const UniValue &escrowObj = find_value(oOptions, "escrow");
 		if (escrowObj.isStr()) {
 			vchEscrow = vchFromValue(escrowObj);
+			scan.SetKey(vchEscrow);
 		}
 
 		const UniValue &aliasBuyerObj = find_value(oOptions, "buyeralias");
@@ -2412,75 +2326,30 @@ bool CEscrowDB::ScanEscrows(const int count, const int from, const UniValue& oOp
 		if (aliasArbiterObj.isStr()) {
 			vchArbiterAlias = vchFromValue(aliasArbiterObj);
 		}
-
-		const UniValue &startblock = find_value(oOptions, "startblock");
-		if (startblock.isNum()) {
-			nStartBlock = startblock.get_int();
-		}
+		// all three parties are in the owner index, walking the entries of one of them is enough
+		if (!vchBuyerAlias.empty())
+			scan.AddOwner(vchBuyerAlias);
+		else if (!vchSellerAlias.empty())
+			scan.AddOwner(vchSellerAlias);
+		else
+			scan.AddOwner(vchArbiterAlias);
 	}
 
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
-	CEscrow txPos;
-	pair<string, vector<unsigned char> > key;
-	int index = 0;
-	while (pcursor->Valid()) {
-		boost::this_thread::interruption_point();
-		try {
-			if (pcursor->GetKey(key) && key.first == "escrowi") {
-				pcursor->GetValue(txPos);
-				if (nStartBlock > 0 && txPos.nHeight < nStartBlock)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!strTxid.empty() && strTxid != txPos.txHash.GetHex())
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchEscrow.empty() && vchEscrow != txPos.vchEscrow)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchBuyerAlias.empty() && vchBuyerAlias != txPos.vchBuyerAlias)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchSellerAlias.empty() && vchSellerAlias != txPos.vchSellerAlias)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchArbiterAlias.empty() && vchArbiterAlias != txPos.vchArbiterAlias)
-				{
-					pcursor->Next();
-					continue;
-				}
-				UniValue oEscrow(UniValue::VOBJ);
-				if (!BuildEscrowJson(txPos, oEscrow))
-				{
-					pcursor->Next();
-					continue;
-				}
-				index += 1;
-				if (index <= from) {
-					pcursor->Next();
-					continue;
-				}
-				oRes.push_back(oEscrow);
-				if (index >= count + from)
-					break;
-			}
-			pcursor->Next();
-		}
-		catch (std::exception &e) {
-			return error("%s() : deserialize error", __PRETTY_FUNCTION__);
-		}
-	}
-	return true;
+	return serviceIndex.Scan(scan, [&](const CEscrow& txPos, UniValue& oEscrow) {
+		if (scan.nStartBlock > 0 && txPos.nHeight < scan.nStartBlock)
+			return false;
+		if (!scan.txHash.IsNull() && scan.txHash != txPos.txHash)
+			return false;
+		if (!vchEscrow.empty() && vchEscrow != txPos.vchEscrow)
+			return false;
+		if (!vchBuyerAlias.empty() && vchBuyerAlias != txPos.vchBuyerAlias)
+			return false;
+		if (!vchSellerAlias.empty() && vchSellerAlias != txPos.vchSellerAlias)
+			return false;
+		if (!vchArbiterAlias.empty() && vchArbiterAlias != txPos.vchArbiterAlias)
+			return false;
+		return BuildEscrowJson(txPos, oEscrow);
+	}, oRes, strCursor);
 }
 UniValue listescrows(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
@@ -2497,12 +2366,14 @@ UniValue listescrows(const JSONRPCRequest& request) {
 			"      \"selleralias\":alias	(string) Seller Alias name to filter.\n"
 			"      \"arbiteralias\":alias	(string) Arbiter Alias name to filter.\n"
 			"      \"startblock\":block 	(number) Earliest block to filter from. Block number is the block at which the transaction would have confirmed.\n"
+			"      \"cursor\":cursor		(string) Page through the results: \"\" for the first page, then the cursor returned with the previous page. The result becomes {\"results\":[...],\"cursor\":cursor}, the cursor is empty after the last page.\n"
 			"    }\n"
 			+ HelpExampleCli("listcerts", "0")
 			+ HelpExampleCli("listcerts", "10 10")
 			+ HelpExampleCli("listcerts", "0 0 '{\"escrow\":\"32bff1fa844c124\"}'")
 			+ HelpExampleCli("listcerts", "0 0 '{\"buyeralias\":\"buyer-alias\",\"selleralias\":\"seller-alias\",\"arbiteralias\":\"arbiter-alias\"}'")
 			+ HelpExampleCli("listcerts", "0 0 '{\"txid\":\"1c7f966dab21119bac53213a2bc7532bff1fa844c124fd750a7d0b1332440bd1\",\"startblock\":0}'")
+			+ HelpExampleCli("listescrows", "100 0 '{\"cursor\":\"\"}'")
 		);
 	UniValue options;
 	int count = 10;
@@ -2526,8 +2397,10 @@ UniValue listescrows(const JSONRPCRequest& request) {
 		options = params[2];
 	}
 
-	UniValue oRes(UniValue::VARR);
-	if (!pescrowdb->ScanEscrows(count, from, options, oRes))
+	CServiceScan scan(count, from, options);
+	RPCResultArray oRes = ServiceScanArray(request, scan);
+	std::string strCursor;
+	if (!pescrowdb->ScanEscrows(scan, options, oRes, strCursor))
 		throw runtime_error("BILLIECOIN_ESCROW_RPC_ERROR: ERRCODE: 4539 - " + _("Scan failed"));
-	return oRes;
+	return ServiceScanResult(scan, oRes, strCursor);
 }
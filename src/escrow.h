@@ -7,15 +7,18 @@
 
 #include "rpc/server.h"
 #include "dbwrapper.h"
+#include "serviceindex.h"
 #include "feedback.h"
 #include "sync.h"
+#include "serviceargs.h"
 class CWalletTx;
 class CTransaction;
 class CReserveKey;
 class CCoinsViewCache;
 class CBlock;
 class COffer;
-bool CheckEscrowInputs(const CTransaction &tx, int op,const std::vector<std::vector<unsigned char> > &vvchArgs, const std::vector<std::vector<unsigned char> > &vvchAliasArgs, bool fJustCheck, int nHeight, std::string &errorMessage, bool bSanityCheck=false);
+class CServicePayload;
+bool CheckEscrowInputs(const CTransaction &tx, const CServicePayload &payload, const CServiceArgs &vvchAliasArgs, bool fJustCheck, int nHeight, std::string &errorMessage, bool bSanityCheck=false);
 bool DecodeEscrowTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch);
 bool DecodeAndParseEscrowTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch, char &type);
 bool DecodeEscrowScript(const CScript& script, int& op, std::vector<std::vector<unsigned char> > &vvch);
@@ -167,12 +170,16 @@ public:
 
 
 class CEscrowDB : public CDBWrapper {
+private:
+	CServiceIndex<std::vector<unsigned char>, CEscrow> serviceIndex;
+	static CServiceIndexEntry GetIndexEntry(const CEscrow& escrow);
 public:
-    CEscrowDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "escrow", nCacheSize, fMemory, fWipe) {}
+    CEscrowDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "escrow", nCacheSize, fMemory, fWipe), serviceIndex(*this, "escrow", &GetIndexEntry) {}
 
-    bool WriteEscrow( const std::vector<std::vector<unsigned char> > &vvchArgs, const COffer &offer, const CEscrow& escrow) {
-		bool writeState = false;
-		writeState = Write(make_pair(std::string("escrowi"), escrow.vchEscrow), escrow);
+    bool WriteEscrow( const CServiceArgs &vvchArgs, const COffer &offer, const CEscrow& escrow) {
+		CDBBatch batch(*this);
+		serviceIndex.Write(batch, escrow.vchEscrow, escrow);
+		const bool writeState = WriteBatch(batch);
 		if(writeState)
 			WriteEscrowIndex(offer, escrow, vvchArgs);
         return writeState;
@@ -181,7 +188,9 @@ public:
 		WriteEscrowBidIndex(offer, escrow, status);
 	}
     bool EraseEscrow(const std::vector<unsigned char>& vchEscrow, bool cleanup = false) {
-		return Erase(make_pair(std::string("escrowi"), vchEscrow));
+		CDBBatch batch(*this);
+		serviceIndex.Erase(batch, vchEscrow);
+		return WriteBatch(batch);
     }
     bool ReadEscrow(const std::vector<unsigned char>& vchEscrow, CEscrow& escrow) {
         return Read(make_pair(std::string("escrowi"), vchEscrow), escrow);
@@ -189,19 +198,24 @@ public:
 	bool ReadEscrowLastTXID(const std::vector<unsigned char>& escrow, uint256& txid) {
 		return Read(make_pair(std::string("escrowlt"), escrow), txid);
 	}
-	bool CleanupDatabase(int &servicesCleaned);
-	void WriteEscrowIndex(const COffer& offer, const CEscrow& escrow, const std::vector<std::vector<unsigned char> > &vvchArgs);
+	/** Erase the expired records an alias is indexed as an owner of */
+	bool CleanupDatabase(const std::vector<unsigned char>& vchAlias, int &servicesCleaned);
+	/** Up to nMax aliases after vchAfter that own escrows */
+	bool GetOwners(const std::vector<unsigned char>& vchAfter, const size_t nMax, std::vector<std::vector<unsigned char> >& vOwners) const {
+		return serviceIndex.GetOwners(vchAfter, nMax, vOwners);
+	}
+	void WriteEscrowIndex(const COffer& offer, const CEscrow& escrow, const CServiceArgs &vvchArgs);
 	void WriteEscrowFeedbackIndex(const COffer& offer, const CEscrow& escrow);
 	void WriteEscrowBidIndex(const COffer& offer, const CEscrow& escrow, const std::string& status);
 	void RefundEscrowBidIndex(const std::vector<unsigned char>& vchEscrow, const std::string& status);
-	bool ScanEscrows(const int count, const int from, const UniValue& oOptions, UniValue& oRes);
+	bool BuildIndexes() {
+		return serviceIndex.Build();
+	}
+	bool ScanEscrows(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor);
 };
 
 bool GetEscrow(const std::vector<unsigned char> &vchEscrow, CEscrow& txPos);
 bool BuildEscrowJson(const CEscrow &escrow, UniValue& oEscrow);
-bool BuildEscrowIndexerJson(const COffer& offer, const CEscrow &escrow, UniValue& oEscrow);
-void BuildEscrowBidJson(const COffer& offer, const CEscrow& escrow, const std::string& status, UniValue& oBid);
-void BuildFeedbackJson(const COffer& offer, const CEscrow& escrow, UniValue& oFeedback);
 int64_t GetEscrowArbiterFee(const int64_t &escrowValue, const float &fEscrowFee);
 int64_t GetEscrowWitnessFee(const int64_t &escrowValue, const float &fWitnessFee);
 int64_t GetEscrowDepositFee(const int64_t &escrowValue, const float &fDepositPercentage);
@@ -17,6 +17,10 @@
 /** 
 *   Generic Dumping and Loading
 *   ---------------------------
+*
+*   Files are written next to their destination and renamed over it once
+*   committed, so dumping from the scheduler while the node runs cannot leave
+*   a truncated file behind if the node stops half way.
 */
 
 template<typename T>
@@ -45,27 +49,41 @@ private:
         int64_t nStart = GetTimeMillis();
 
         // serialize, checksum data up to that point, then append checksum
+        // (objToSave is only locked while it serializes into memory)
         CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
-        ssObj << objToSave;
+        try {
+            ssObj << strMagicMessage; // specific magic message for this type of object
+            ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
+            ssObj << objToSave;
+        }
+        catch (std::exception &e) {
+            return error("%s: Serialize error - %s", __func__, e.what());
+        }
         uint256 hash = Hash(ssObj.begin(), ssObj.end());
         ssObj << hash;
 
         // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        boost::filesystem::path pathTmp = pathDB;
+        pathTmp += ".new";
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
         // Write and commit header, data
         try {
             fileout << ssObj;
         }
         catch (std::exception &e) {
+            fileout.fclose();
+            boost::system::error_code ec;
+            boost::filesystem::remove(pathTmp, ec);
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Failed to rename %s to %s", __func__, pathTmp.string(), pathDB.string());
 
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
@@ -73,6 +91,37 @@ private:
         return true;
     }
 
+    /** Check the magic message and network of the file without reading the object */
+    ReadResult ReadHeader()
+    {
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return FileError;
+
+        unsigned char pchMsgTmp[4];
+        std::string strMagicMessageTmp;
+        try {
+            filein >> strMagicMessageTmp;
+            if (strMagicMessage != strMagicMessageTmp)
+            {
+                error("%s: Invalid magic message", __func__);
+                return IncorrectMagicMessage;
+            }
+            filein >> FLATDATA(pchMsgTmp);
+            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            {
+                error("%s: Invalid network magic number", __func__);
+                return IncorrectMagicNumber;
+            }
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+        return Ok;
+    }
+
     ReadResult Read(T& objToLoad, bool fDryRun = false)
     {
         //LOCK(objToLoad.cs);
@@ -172,10 +221,14 @@ public:
         strMagicMessage = strMagicMessageIn;
     }
 
-    bool Load(T& objToLoad)
+    /**
+     * Read the file into objToLoad. Without fCheckAndRemove the caller cleans
+     * the object up itself, e.g. once files loaded in parallel are all read.
+     */
+    bool Load(T& objToLoad, bool fCheckAndRemove = true)
     {
         LogPrintf("Reading info from %s...\n", strFilename);
-        ReadResult readResult = Read(objToLoad);
+        ReadResult readResult = Read(objToLoad, !fCheckAndRemove);
         if (readResult == FileError)
             LogPrintf("Missing file %s, will try to recreate\n", strFilename);
         else if (readResult != Ok)
@@ -194,13 +247,15 @@ public:
         return true;
     }
 
+    /** Write objToSave over the file, false if that failed and the old file was left in place */
     bool Dump(T& objToSave)
     {
         int64_t nStart = GetTimeMillis();
 
+        // the checksum was verified when the file was loaded, only make sure
+        // not to overwrite a file of another kind or network
         LogPrintf("Verifying %s format...\n", strFilename);
-        T tmpObjToLoad;
-        ReadResult readResult = Read(tmpObjToLoad, true);
+        ReadResult readResult = ReadHeader();
 
         // there was an error and it was not an error on file opening => do not proceed
         if (readResult == FileError)
@@ -218,7 +273,8 @@ public:
         }
 
         LogPrintf("Writing info to %s...\n", strFilename);
-        Write(objToSave);
+        if (!Write(objToSave))
+            return false;
         LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
 
         return true;
@@ -43,6 +43,7 @@ CGovernanceObject::CGovernanceObject():
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
     LoadData();
+    fileVotes.SetParentHash(GetHash());
 }
 
 CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevisionIn, int64_t nTimeIn, const uint256& nCollateralHashIn, const std::string& strDataHexIn):
@@ -71,6 +72,7 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
     LoadData();
+    fileVotes.SetParentHash(GetHash());
 }
 
 CGovernanceObject::CGovernanceObject(const CGovernanceObject& other):
@@ -263,6 +265,7 @@ uint256 CGovernanceObject::GetSignatureHash() const
 void CGovernanceObject::SetMasternodeOutpoint(const COutPoint& outpoint)
 {
     masternodeOutpoint = outpoint;
+    fileVotes.SetParentHash(GetHash());
 }
 
 bool CGovernanceObject::Sign(const CKey& keyMasternode, const CPubKey& pubKeyMasternode)
@@ -283,6 +286,9 @@ bool CGovernanceObject::Sign(const CKey& keyMasternode, const CPubKey& pubKeyMas
         }
     } 
 
+    // the signature is part of the hash the votes are keyed by
+    fileVotes.SetParentHash(GetHash());
+
     LogPrint("gobject", "CGovernanceObject::Sign -- pubkey id = %s, masternode = %s\n",
              pubKeyMasternode.GetID().ToString(), masternodeOutpoint.ToStringShort());
 
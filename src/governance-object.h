@@ -326,6 +326,14 @@ public:
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
             READWRITE(fileVotes);
+        }
+        if (ser_action.ForRead()) {
+            // votes are keyed by the hash of the object, not by what the file was written with
+            fileVotes.SetParentHash(GetHash());
+            if (s.GetType() & SER_DISK)
+                fileVotes.RecountVotes();
+        }
+        if (s.GetType() & SER_DISK) {
             LogPrint("gobject", "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
 
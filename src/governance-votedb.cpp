@@ -5,85 +5,219 @@
 
 #include "governance-votedb.h"
 
+#include "clientversion.h"
+#include "memusage.h"
+#include "util.h"
+
+#include <algorithm>
+
+#include <boost/scoped_ptr.hpp>
+
+static const char DB_VOTE = 'v';
+
+CGovernanceVoteDB* pgovernancevotedb = NULL;
+
+CGovernanceVoteDB::CGovernanceVoteDB(size_t nCacheSize, bool fMemory, bool fWipe)
+    : CDBWrapper(GetDataDir() / "govvotes", nCacheSize, fMemory, fWipe),
+      cacheVotes(&GetVoteUsage, GOVERNANCE_VOTE_CACHE_USAGE)
+{}
+
+size_t CGovernanceVoteDB::GetVoteUsage(const std::shared_ptr<const CGovernanceVote>& pvote)
+{
+    // besides the vote and its control block, the signature is the only allocation
+    // and makes up most of the serialized vote
+    return memusage::MallocUsage(sizeof(CGovernanceVote) + 2 * sizeof(long)) +
+        memusage::MallocUsage(::GetSerializeSize(*pvote, SER_DISK, CLIENT_VERSION));
+}
+
+bool CGovernanceVoteDB::WriteVote(const CGovernanceVote& vote)
+{
+    const uint256 nHash = vote.GetHash();
+    if (!Write(std::make_pair(DB_VOTE, std::make_pair(vote.GetParentHash(), nHash)), vote))
+        return false;
+    // votes never change once written, so the one just written is as good as one read back
+    cacheVotes.Insert(nHash, std::make_shared<const CGovernanceVote>(vote), cacheVotes.GetGeneration());
+    return true;
+}
+
+bool CGovernanceVoteDB::ReadVote(const uint256& nParentHash, const uint256& nHash, std::shared_ptr<const CGovernanceVote>& pvote)
+{
+    if (cacheVotes.Get(nHash, pvote))
+        return pvote->GetParentHash() == nParentHash;
+    const uint64_t nGeneration = cacheVotes.GetGeneration();
+    CGovernanceVote vote;
+    if (!Read(std::make_pair(DB_VOTE, std::make_pair(nParentHash, nHash)), vote))
+        return false;
+    pvote = std::make_shared<const CGovernanceVote>(vote);
+    cacheVotes.Insert(nHash, pvote, nGeneration);
+    return true;
+}
+
+bool CGovernanceVoteDB::HasVote(const uint256& nParentHash, const uint256& nHash)
+{
+    std::shared_ptr<const CGovernanceVote> pvote;
+    if (cacheVotes.Get(nHash, pvote))
+        return pvote->GetParentHash() == nParentHash;
+    return Exists(std::make_pair(DB_VOTE, std::make_pair(nParentHash, nHash)));
+}
+
+bool CGovernanceVoteDB::EraseVotes(const uint256& nParentHash, const std::vector<uint256>& vecHashes)
+{
+    CDBBatch batch(*this);
+    for (const auto& nHash : vecHashes) {
+        batch.Erase(std::make_pair(DB_VOTE, std::make_pair(nParentHash, nHash)));
+        cacheVotes.Erase(nHash);
+    }
+    return WriteBatch(batch);
+}
+
+bool CGovernanceVoteDB::ForEachVote(const uint256& nParentHash, const std::function<bool(const CGovernanceVote&)>& fn)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_VOTE, std::make_pair(nParentHash, uint256())));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, std::pair<uint256, uint256> > key;
+        if (!pcursor->GetKey(key) || key.first != DB_VOTE || key.second.first != nParentHash)
+            break;
+        CGovernanceVote vote;
+        if (!pcursor->GetValue(vote))
+            return error("%s: unable to read vote %s", __func__, key.second.second.ToString());
+        if (!fn(vote))
+            break;
+    }
+    return true;
+}
+
+int CGovernanceVoteDB::CountVotes(const uint256& nParentHash)
+{
+    int nCount = 0;
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_VOTE, std::make_pair(nParentHash, uint256())));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, std::pair<uint256, uint256> > key;
+        if (!pcursor->GetKey(key) || key.first != DB_VOTE || key.second.first != nParentHash)
+            break;
+        nCount++;
+    }
+    return nCount;
+}
+
+int CGovernanceVoteDB::EraseOtherVotes(const std::set<uint256>& setParentHashes)
+{
+    int nErased = 0;
+    CDBBatch batch(*this);
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_VOTE, std::make_pair(uint256(), uint256())));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, std::pair<uint256, uint256> > key;
+        if (!pcursor->GetKey(key) || key.first != DB_VOTE)
+            break;
+        if (setParentHashes.count(key.second.first))
+            continue;
+        batch.Erase(key);
+        cacheVotes.Erase(key.second.second);
+        nErased++;
+        if (batch.SizeEstimate() > (1 << 20)) {
+            WriteBatch(batch);
+            batch.Clear();
+        }
+    }
+    WriteBatch(batch);
+    return nErased;
+}
+
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
-    : nMemoryVotes(0),
-      listVotes(),
-      mapVoteIndex()
+    : nParentHash(),
+      nVoteCount(0)
+{}
+
+CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const uint256& nParentHashIn)
+    : nParentHash(nParentHashIn),
+      nVoteCount(0)
 {}
 
-CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
-    : nMemoryVotes(other.nMemoryVotes),
-      listVotes(other.listVotes),
-      mapVoteIndex()
+void CGovernanceObjectVoteFile::RecountVotes()
 {
-    RebuildIndex();
+    if (nParentHash.IsNull() || !pgovernancevotedb)
+        return;
+    const int nCount = pgovernancevotedb->CountVotes(nParentHash);
+    if (nCount != nVoteCount)
+        LogPrint("gobject", "CGovernanceObjectVoteFile::RecountVotes -- %s has %d votes on disk, %d expected\n", nParentHash.ToString(), nCount, nVoteCount);
+    nVoteCount = nCount;
 }
 
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
-    uint256 nHash = vote.GetHash();
+    if (nParentHash.IsNull() || vote.GetParentHash() != nParentHash) {
+        LogPrintf("CGovernanceObjectVoteFile::AddVote -- vote %s is not for object %s\n", vote.GetHash().ToString(), nParentHash.ToString());
+        return;
+    }
     // make sure to never add/update already known votes
-    if (HasVote(nHash))
+    if (HasVote(vote.GetHash()))
+        return;
+    if (!pgovernancevotedb || !pgovernancevotedb->WriteVote(vote)) {
+        LogPrintf("CGovernanceObjectVoteFile::AddVote -- unable to write vote %s\n", vote.GetHash().ToString());
         return;
-    listVotes.push_front(vote);
-    mapVoteIndex.emplace(nHash, listVotes.begin());
-    ++nMemoryVotes;
+    }
+    ++nVoteCount;
 }
 
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 {
-    return mapVoteIndex.find(nHash) != mapVoteIndex.end();
+    if (nParentHash.IsNull() || !pgovernancevotedb)
+        return false;
+    return pgovernancevotedb->HasVote(nParentHash, nHash);
 }
 
 bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const
 {
-    vote_m_cit it = mapVoteIndex.find(nHash);
-    if(it == mapVoteIndex.end()) {
+    std::shared_ptr<const CGovernanceVote> pvote;
+    if (nParentHash.IsNull() || !pgovernancevotedb || !pgovernancevotedb->ReadVote(nParentHash, nHash, pvote)) {
         return false;
     }
-    ss << *(it->second);
+    ss << *pvote;
     return true;
 }
 
+void CGovernanceObjectVoteFile::ForEachVote(const std::function<bool(const CGovernanceVote&)>& fn) const
+{
+    if (nParentHash.IsNull() || !pgovernancevotedb)
+        return;
+    pgovernancevotedb->ForEachVote(nParentHash, fn);
+}
+
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
     std::vector<CGovernanceVote> vecResult;
-    for(vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
-    }
+    vecResult.reserve(nVoteCount);
+    ForEachVote([&vecResult](const CGovernanceVote& vote) {
+        vecResult.push_back(vote);
+        return true;
+    });
     return vecResult;
 }
 
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        if(it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        }
-        else {
-            ++it;
-        }
-    }
+    std::vector<uint256> vecHashes;
+    ForEachVote([&vecHashes, &outpointMasternode](const CGovernanceVote& vote) {
+        if (vote.GetMasternodeOutpoint() == outpointMasternode)
+            vecHashes.push_back(vote.GetHash());
+        return true;
+    });
+    if (vecHashes.empty() || !pgovernancevotedb->EraseVotes(nParentHash, vecHashes))
+        return;
+    nVoteCount = std::max(0, nVoteCount - (int)vecHashes.size());
 }
 
-void CGovernanceObjectVoteFile::RebuildIndex()
+void CGovernanceObjectVoteFile::RemoveAllVotes()
 {
-    mapVoteIndex.clear();
-    nMemoryVotes = 0;
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        CGovernanceVote& vote = *it;
-        uint256 nHash = vote.GetHash();
-        if(mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
-            mapVoteIndex[nHash] = it;
-            ++nMemoryVotes;
-            ++it;
-        }
-        else {
-            listVotes.erase(it++);
-        }
-    }
+    std::vector<uint256> vecHashes;
+    ForEachVote([&vecHashes](const CGovernanceVote& vote) {
+        vecHashes.push_back(vote.GetHash());
+        return true;
+    });
+    if (!vecHashes.empty() && !pgovernancevotedb->EraseVotes(nParentHash, vecHashes))
+        return;
+    nVoteCount = 0;
 }
@@ -6,88 +6,140 @@
 #ifndef GOVERNANCE_VOTEDB_H
 #define GOVERNANCE_VOTEDB_H
 
-#include <list>
-#include <map>
+#include <functional>
+#include <memory>
+#include <set>
+#include <vector>
 
+#include "dbwrapper.h"
 #include "governance-vote.h"
 #include "serialize.h"
+#include "servicecache.h"
 #include "streams.h"
 #include "uint256.h"
 
+/** LevelDB cache of the governance vote database (bytes) */
+static const size_t GOVERNANCE_VOTE_DB_CACHE = 2 << 20;
+/** Memory the votes recently read or written may use (bytes) */
+static const size_t GOVERNANCE_VOTE_CACHE_USAGE = 8 << 20;
+
 /**
- * Represents the collection of votes associated with a given CGovernanceObject
- * Recently received votes are held in memory until a maximum size is reached after
- * which older votes a flushed to a disk file.
+ * Access to the governance vote database (govvotes/)
  *
- * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * Votes are keyed by the hash of the object they are for followed by their own
+ * hash, so the votes of one object are read with a single cursor. The votes
+ * used most recently are held in a cache bounded by GOVERNANCE_VOTE_CACHE_USAGE.
  */
-class CGovernanceObjectVoteFile
+class CGovernanceVoteDB : public CDBWrapper
 {
-public: // Types
-    typedef std::list<CGovernanceVote> vote_l_t;
+private:
+    // votes cannot be assigned to, the cache shares them instead
+    CServiceCache<uint256, std::shared_ptr<const CGovernanceVote> > cacheVotes;
 
-    typedef vote_l_t::iterator vote_l_it;
+    static size_t GetVoteUsage(const std::shared_ptr<const CGovernanceVote>& pvote);
 
-    typedef vote_l_t::const_iterator vote_l_cit;
+public:
+    CGovernanceVoteDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
-    typedef std::map<uint256,vote_l_it> vote_m_t;
+    bool WriteVote(const CGovernanceVote& vote);
+    bool ReadVote(const uint256& nParentHash, const uint256& nHash, std::shared_ptr<const CGovernanceVote>& pvote);
+    bool HasVote(const uint256& nParentHash, const uint256& nHash);
+    bool EraseVotes(const uint256& nParentHash, const std::vector<uint256>& vecHashes);
 
-    typedef vote_m_t::iterator vote_m_it;
+    /**
+     * Call fn with each vote for an object as it is read from disk, until it returns false
+     */
+    bool ForEachVote(const uint256& nParentHash, const std::function<bool(const CGovernanceVote&)>& fn);
 
-    typedef vote_m_t::const_iterator vote_m_cit;
+    /**
+     * Count the votes for an object from the keys alone
+     */
+    int CountVotes(const uint256& nParentHash);
 
-private:
-    static const int MAX_MEMORY_VOTES = -1;
+    /**
+     * Erase the votes for objects other than the ones given, returning how many were erased
+     */
+    int EraseOtherVotes(const std::set<uint256>& setParentHashes);
+};
 
-    int nMemoryVotes;
+extern CGovernanceVoteDB* pgovernancevotedb;
 
-    vote_l_t listVotes;
+/**
+ * Represents the collection of votes associated with a given CGovernanceObject
+ *
+ * The votes live in the governance vote database, the file only keeps track of
+ * which object they are for and how many there are.
+ */
+class CGovernanceObjectVoteFile
+{
+private:
+    // hash of the object the votes are for, set by the object itself
+    uint256 nParentHash;
 
-    vote_m_t mapVoteIndex;
+    int nVoteCount;
 
 public:
     CGovernanceObjectVoteFile();
 
-    CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other);
+    explicit CGovernanceObjectVoteFile(const uint256& nParentHashIn);
+
+    /**
+     * Set the hash of the object the votes are for, the votes on disk are keyed by it
+     */
+    void SetParentHash(const uint256& nParentHashIn) {
+        nParentHash = nParentHashIn;
+    }
+
+    const uint256& GetParentHash() const {
+        return nParentHash;
+    }
+
+    /**
+     * Count the votes on disk again, after a load the stored count may be stale
+     */
+    void RecountVotes();
 
     /**
-     * Add a vote to the file
+     * Add a vote to the file, votes for other objects are ignored
      */
     void AddVote(const CGovernanceVote& vote);
 
     /**
-     * Return true if the vote with this hash is currently cached in memory
+     * Return true if the vote with this hash is in the file
      */
     bool HasVote(const uint256& nHash) const;
 
     /**
-     * Retrieve a vote cached in memory
+     * Read a vote from disk into ss
      */
     bool SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const;
 
-    int GetVoteCount() {
-        return nMemoryVotes;
+    int GetVoteCount() const {
+        return nVoteCount;
     }
 
+    /**
+     * Call fn with each vote as it is read from disk, until it returns false
+     */
+    void ForEachVote(const std::function<bool(const CGovernanceVote&)>& fn) const;
+
     std::vector<CGovernanceVote> GetVotes() const;
 
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
 
+    /**
+     * Erase all votes from disk, for objects that are deleted
+     */
+    void RemoveAllVotes();
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
-        READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
-        if(ser_action.ForRead()) {
-            RebuildIndex();
-        }
+        READWRITE(nParentHash);
+        READWRITE(nVoteCount);
     }
-private:
-    void RebuildIndex();
-
 };
 
 #endif
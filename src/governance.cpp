@@ -22,7 +22,7 @@ CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-12";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-13";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60*60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
 
@@ -359,7 +359,7 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
     // WE MIGHT HAVE PENDING/ORPHAN VOTES FOR THIS OBJECT
 
     CGovernanceException exception;
-    CheckOrphanVotes(govobj, exception, connman);
+    CheckOrphanVotes(objpair.first->second, exception, connman);
 
     DBG( std::cout << "CGovernanceManager::AddGovernanceObject END" << std::endl; );
 }
@@ -447,6 +447,7 @@ void CGovernanceManager::UpdateCachesAndClean()
             }
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            pObj->fileVotes.RemoveAllVotes();
             mapObjects.erase(it++);
         } else {
             // NOTE: triggers are handled via triggerman
@@ -675,16 +676,16 @@ void CGovernanceManager::SyncSingleObjAndItsVotes(CNode* pnode, const uint256& n
     LogPrint("gobject", "CGovernanceManager::%s -- syncing govobj: %s, peer=%d\n", __func__, strHash, pnode->id);
     pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
 
-    auto fileVotes = govobj.GetVoteFile();
-
-    for (const auto& vote : fileVotes.GetVotes()) {
+    // stream the votes from disk rather than loading them all
+    govobj.GetVoteFile().ForEachVote([&](const CGovernanceVote& vote) {
         uint256 nVoteHash = vote.GetHash();
         if(filter.contains(nVoteHash) || !vote.IsValid(true)) {
-            continue;
+            return true;
         }
         pnode->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, nVoteHash));
         ++nVoteCount;
-    }
+        return true;
+    });
 
     CNetMsgMaker msgMaker(pnode->GetSendVersion());
     connman.PushMessage(pnode, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_GOVOBJ, 1));
@@ -1029,11 +1030,11 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
         if(pObj) {
             filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            nVoteCount = vecVotes.size();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                filter.insert(vecVotes[i].GetHash());
-            }
+            pObj->GetVoteFile().ForEachVote([&](const CGovernanceVote& vote) {
+                filter.insert(vote.GetHash());
+                ++nVoteCount;
+                return true;
+            });
         }
     }
 
@@ -1183,10 +1184,10 @@ void CGovernanceManager::RebuildIndexes()
     cmapVoteToObject.Clear();
     for (auto& objPair : mapObjects) {
         CGovernanceObject& govobj = objPair.second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for(size_t i = 0; i < vecVotes.size(); ++i) {
-            cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
-        }
+        govobj.GetVoteFile().ForEachVote([&](const CGovernanceVote& vote) {
+            cmapVoteToObject.Insert(vote.GetHash(), &govobj);
+            return true;
+        });
     }
 }
 
@@ -1215,6 +1216,17 @@ void CGovernanceManager::InitOnLoad()
     LOCK(cs);
     int64_t nStart = GetTimeMillis();
     LogPrintf("Preparing masternode indexes and governance triggers...\n");
+    if (pgovernancevotedb) {
+        // votes for objects the cache no longer has, e.g. after it was discarded
+        std::set<uint256> setObjectHashes;
+        for (const auto& objPair : mapObjects) {
+            setObjectHashes.insert(objPair.first);
+        }
+        int nErased = pgovernancevotedb->EraseOtherVotes(setObjectHashes);
+        if (nErased > 0) {
+            LogPrintf("Erased %d votes for unknown governance objects\n", nErased);
+        }
+    }
     RebuildIndexes();
     AddCachedTriggers();
     LogPrintf("Masternode indexes and governance triggers prepared  %dms\n", GetTimeMillis() - nStart);
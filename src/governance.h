@@ -338,6 +338,11 @@ public:
         std::string strVersion;
         if(ser_action.ForRead()) {
             READWRITE(strVersion);
+            // older versions lay the objects out differently, don't try to read them
+            if(strVersion != SERIALIZATION_VERSION_STRING) {
+                Clear();
+                return;
+            }
         }
         else {
             strVersion = SERIALIZATION_VERSION_STRING;
@@ -349,10 +354,6 @@ public:
         READWRITE(cmmapOrphanVotes);
         READWRITE(mapObjects);
         READWRITE(mapLastMasternodeObject);
-        if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
-            Clear();
-            return;
-        }
     }
 
     void UpdatedBlockTip(const CBlockIndex *pindex, CConnman& connman);
@@ -4,19 +4,14 @@
 #include "alias.h"
 #include "asset.h"
 #include "assetallocation.h"
+#include "servicepayload.h"
 #include "validation.h"
-using namespace boost;
 using namespace std;
-typedef typename std::vector<int> container;
-bool OrderBasedOnArrivalTime(const int &nHeight, std::vector<CTransactionRef>& blockVtx) {
-	std::vector<vector<unsigned char> > vvchArgs;
-	std::vector<vector<unsigned char> > vvchAliasArgs;
+bool OrderBasedOnArrivalTime(const CTxMemPool& pool, std::vector<CTransactionRef>& blockVtx) {
 	std::vector<CTransactionRef> orderedVtx;
-	int op;
-	AssertLockHeld(cs_main);
-	CCoinsViewCache view(pcoinsTip);
-	// order the arrival times in ascending order using a map
-	std::multimap<int64_t, int> orderedIndexes;
+	AssertLockHeld(pool.cs);
+	// service transactions go after the others in the order the mempool first saw them, ties keep block order
+	std::vector<std::pair<int64_t, int> > orderedIndexes;
 	for (unsigned int n = 0; n < blockVtx.size(); n++) {
 		const CTransactionRef txRef = blockVtx[n];
 		if (!txRef)
@@ -24,62 +19,22 @@ bool OrderBasedOnArrivalTime(const int &nHeight, std::vector<CTransactionRef>& b
 		const CTransaction &tx = *txRef;
 		if (tx.nVersion == BILLIECOIN_TX_VERSION)
 		{
-			if (DecodeAssetAllocationTx(tx, op, vvchArgs))
-			{
-				LOCK(cs_assetallocation);
-				ArrivalTimesMap arrivalTimes;
-				CAssetAllocation assetallocation(tx);
-				if (nHeight >= Params().GetConsensus().nShareFeeBlock) {
-					CAssetAllocationTuple assetAllocationTuple(assetallocation.vchAsset, assetallocation.vchAliasOrAddress);
-					passetallocationdb->ReadISArrivalTimes(assetAllocationTuple, arrivalTimes);
-				}
-				else {
-					if (!FindAliasInTx(view, tx, vvchAliasArgs)) {
-						continue;
-					}
-					CAssetAllocationTuple assetAllocationTuple(assetallocation.vchAsset, vvchAliasArgs[0]);
-					passetallocationdb->ReadISArrivalTimes(assetAllocationTuple, arrivalTimes);
-				}
-
-				
-				ArrivalTimesMap::iterator it = arrivalTimes.find(tx.GetHash());
-				if (it != arrivalTimes.end())
-					orderedIndexes.insert(make_pair((*it).second, n));
-				// we don't have this in our arrival times list, means it must be rejected via consensus so add it to the end
-				else
-					orderedIndexes.insert(make_pair(INT64_MAX, n));
-				continue;
-			}
-			else if (DecodeOfferTx(tx, op, vvchArgs))
-			{
-				ArrivalTimesMap arrivalTimes;
-				COffer offer(tx);
-				pofferdb->ReadISArrivalTimes(offer.vchOffer, arrivalTimes);
-				ArrivalTimesMap::iterator it = arrivalTimes.find(tx.GetHash());
-				if (it != arrivalTimes.end())
-					orderedIndexes.insert(make_pair((*it).second, n));
-				// we don't have this in our arrival times list, means it must be rejected via consensus so add it to the end
-				else
-					orderedIndexes.insert(make_pair(INT64_MAX, n));
-				continue;
-			}
-			else if (DecodeCertTx(tx, op, vvchArgs))
-			{
-				ArrivalTimesMap arrivalTimes;
-				CCert cert(tx);
-				pcertdb->ReadISArrivalTimes(cert.vchCert, arrivalTimes);
-				ArrivalTimesMap::iterator it = arrivalTimes.find(tx.GetHash());
-				if (it != arrivalTimes.end())
-					orderedIndexes.insert(make_pair((*it).second, n));
-				// we don't have this in our arrival times list, means it must be rejected via consensus so add it to the end
-				else
-					orderedIndexes.insert(make_pair(INT64_MAX, n));
+			CTxMemPool::indexed_transaction_set::const_iterator it = pool.mapTx.find(tx.GetHash());
+			CServicePayloadRef payload = it != pool.mapTx.end() ? it->GetServicePayload() : NULL;
+			if (!payload)
+				payload = GetServicePayload(tx);
+			if (payload->type != ASSETALLOCATION && payload->type != OFFER && payload->type != CERT) {
+				orderedVtx.emplace_back(txRef);
 				continue;
 			}
+			// we don't know when this arrived so add it to the end
+			orderedIndexes.push_back(make_pair(it != pool.mapTx.end() ? it->GetArrivalTime() : INT64_MAX, n));
+			continue;
 		}
 		// add normal tx's to orderedvtx, 
 		orderedVtx.emplace_back(txRef);
 	}
+	std::sort(orderedIndexes.begin(), orderedIndexes.end());
 	for (auto& orderedIndex : orderedIndexes) {
 		orderedVtx.emplace_back(blockVtx[orderedIndex.second]);
 	}
@@ -91,11 +46,181 @@ bool OrderBasedOnArrivalTime(const int &nHeight, std::vector<CTransactionRef>& b
 	blockVtx = orderedVtx;
 	return true;
 }
-bool CreateGraphFromVTX(const int &nHeight, const std::vector<CTransactionRef>& blockVtx, Graph &graph, std::vector<vertex_descriptor> &vertices, IndexMap &mapTxIndex) {
-	AliasMap mapAliasIndex;
-	std::vector<vector<unsigned char> > vvchArgs;
+int CServiceTxGraph::AddVertex() {
+	vSenderTxs.emplace_back();
+	fFinalized = false;
+	return vSenderTxs.size() - 1;
+}
+void CServiceTxGraph::AddEdge(int nFrom, int nTo) {
+	vEdges.emplace_back(nFrom, nTo);
+	fFinalized = false;
+}
+void CServiceTxGraph::AddSenderTx(int nVertex, int nTxIndex) {
+	if (vSenderTxs[nVertex].empty())
+		nSenders++;
+	vSenderTxs[nVertex].push_back(nTxIndex);
+}
+// lay the edges out per source vertex, keeping insertion order within each vertex
+void CServiceTxGraph::Finalize() {
+	if (fFinalized)
+		return;
+	const int nVertices = vSenderTxs.size();
+	vOutStart.assign(nVertices + 1, 0);
+	for (auto& edge : vEdges)
+		vOutStart[edge.first + 1]++;
+	for (int v = 0; v < nVertices; v++)
+		vOutStart[v + 1] += vOutStart[v];
+	vOutTargets.resize(vEdges.size());
+	std::vector<int> vFill(vOutStart.begin(), vOutStart.end() - 1);
+	for (auto& edge : vEdges)
+		vOutTargets[vFill[edge.first]++] = edge.second;
+	vDetached.resize(nVertices, false);
+	fFinalized = true;
+}
+// iterative Tarjan, vComponent gets the same id for vertices in the same strongly connected component
+void CServiceTxGraph::StronglyConnectedComponents(std::vector<int>& vComponent) const {
+	const int nVertices = vSenderTxs.size();
+	std::vector<int> vIndex(nVertices, -1);
+	std::vector<int> vLowLink(nVertices, 0);
+	std::vector<bool> vOnStack(nVertices, false);
+	std::vector<int> vStack;
+	// call stack of (vertex, next out edge position)
+	std::vector<std::pair<int, int> > vCalls;
+	vComponent.assign(nVertices, -1);
+	int nNextIndex = 0;
+	int nComponents = 0;
+	for (int nRoot = 0; nRoot < nVertices; nRoot++) {
+		if (vIndex[nRoot] != -1)
+			continue;
+		vCalls.emplace_back(nRoot, vOutStart[nRoot]);
+		vIndex[nRoot] = vLowLink[nRoot] = nNextIndex++;
+		vStack.push_back(nRoot);
+		vOnStack[nRoot] = true;
+		while (!vCalls.empty()) {
+			const int v = vCalls.back().first;
+			int& nEdge = vCalls.back().second;
+			if (nEdge < vOutStart[v + 1]) {
+				const int w = vOutTargets[nEdge++];
+				if (vIndex[w] == -1) {
+					vIndex[w] = vLowLink[w] = nNextIndex++;
+					vStack.push_back(w);
+					vOnStack[w] = true;
+					vCalls.emplace_back(w, vOutStart[w]);
+				}
+				else if (vOnStack[w])
+					vLowLink[v] = std::min(vLowLink[v], vIndex[w]);
+				continue;
+			}
+			if (vLowLink[v] == vIndex[v]) {
+				int w;
+				do {
+					w = vStack.back();
+					vStack.pop_back();
+					vOnStack[w] = false;
+					vComponent[w] = nComponents;
+				} while (w != v);
+				nComponents++;
+			}
+			vCalls.pop_back();
+			if (!vCalls.empty()) {
+				const int nParent = vCalls.back().first;
+				vLowLink[nParent] = std::min(vLowLink[nParent], vLowLink[v]);
+			}
+		}
+	}
+}
+void CServiceTxGraph::RemoveCycles(std::vector<int>& conflictedIndexes) {
+	Finalize();
+	const int nVertices = vSenderTxs.size();
+	std::vector<int> vComponent;
+	StronglyConnectedComponents(vComponent);
+
+	// v closes a cycle if it has an edge to itself, or an edge back to a lower numbered s
+	// in its component that reaches v through vertices numbered s or higher. Collect the
+	// candidate edges per s so every s needs one search.
+	std::vector<bool> vCleared(nVertices, false);
+	std::vector<std::pair<int, int> > vCandidates;
+	for (int v = 0; v < nVertices; v++) {
+		for (int nEdge = vOutStart[v]; nEdge < vOutStart[v + 1]; nEdge++) {
+			const int s = vOutTargets[nEdge];
+			if (s == v)
+				vCleared[v] = true;
+			else if (s < v && vComponent[s] == vComponent[v])
+				vCandidates.emplace_back(s, v);
+		}
+	}
+	std::sort(vCandidates.begin(), vCandidates.end());
+	std::vector<int> vVisited(nVertices, -1);
+	std::vector<int> vSearch;
+	for (size_t i = 0; i < vCandidates.size();) {
+		const int s = vCandidates[i].first;
+		vVisited[s] = s;
+		vSearch.assign(1, s);
+		while (!vSearch.empty()) {
+			const int u = vSearch.back();
+			vSearch.pop_back();
+			for (int nEdge = vOutStart[u]; nEdge < vOutStart[u + 1]; nEdge++) {
+				const int w = vOutTargets[nEdge];
+				if (w > s && vVisited[w] != s && vComponent[w] == vComponent[s]) {
+					vVisited[w] = s;
+					vSearch.push_back(w);
+				}
+			}
+		}
+		for (; i < vCandidates.size() && vCandidates[i].first == s; i++) {
+			if (vVisited[vCandidates[i].second] == s)
+				vCleared[vCandidates[i].second] = true;
+		}
+	}
+
+	for (int v = 0; v < nVertices; v++) {
+		if (!vCleared[v] || vSenderTxs[v].empty())
+			continue;
+		vDetached[v] = true;
+		conflictedIndexes.insert(conflictedIndexes.end(), vSenderTxs[v].begin(), vSenderTxs[v].end());
+		vSenderTxs[v].clear();
+		nSenders--;
+	}
+	// block gives us the transactions in order by time so we want to ensure we preserve it
+	std::sort(conflictedIndexes.begin(), conflictedIndexes.end());
+}
+bool CServiceTxGraph::TopologicalSort(std::vector<int>& vOrder) {
+	Finalize();
+	const int nVertices = vSenderTxs.size();
+	// 0 = not seen, 1 = on the current path, 2 = finished
+	std::vector<char> vColor(nVertices, 0);
+	std::vector<std::pair<int, int> > vCalls;
+	vOrder.clear();
+	vOrder.reserve(nVertices);
+	for (int nRoot = 0; nRoot < nVertices; nRoot++) {
+		if (vColor[nRoot] != 0)
+			continue;
+		vColor[nRoot] = 1;
+		vCalls.emplace_back(nRoot, vOutStart[nRoot]);
+		while (!vCalls.empty()) {
+			const int v = vCalls.back().first;
+			int& nEdge = vCalls.back().second;
+			if (!vDetached[v] && nEdge < vOutStart[v + 1]) {
+				const int w = vOutTargets[nEdge++];
+				if (vColor[w] == 0) {
+					vColor[w] = 1;
+					vCalls.emplace_back(w, vOutStart[w]);
+				}
+				else if (vColor[w] == 1)
+					return false;
+				continue;
+			}
+			vColor[v] = 2;
+			vOrder.push_back(v);
+			vCalls.pop_back();
+		}
+	}
+	std::reverse(vOrder.begin(), vOrder.end());
+	return true;
+}
+bool CreateGraphFromVTX(const int &nHeight, const std::vector<CTransactionRef>& blockVtx, CServiceTxGraph &graph) {
+	std::unordered_map<std::string, int> mapAliasIndex;
 	std::vector<vector<unsigned char> > vvchAliasArgs;
-	int op;
 	AssertLockHeld(cs_main);
 	CCoinsViewCache view(pcoinsTip);
 	string sender;
@@ -106,112 +231,78 @@ bool CreateGraphFromVTX(const int &nHeight, const std::vector<CTransactionRef>&
 		const CTransaction &tx = *txRef;
 		if (tx.nVersion == BILLIECOIN_TX_VERSION)
 		{
-			if (DecodeAssetAllocationTx(tx, op, vvchArgs))
+			const CServicePayloadRef payload = GetServicePayload(tx);
+			if (payload->IsAssetAllocation())
 			{	
-				AliasMap::const_iterator it;
-				CAssetAllocation allocation(tx);
+				// an allocation whose data does not parse has no sender nor receivers, as a null CAssetAllocation(tx)
+				static const CAssetAllocation emptyAllocation;
+				const CAssetAllocation& allocation = payload->assetAllocation ? *payload->assetAllocation : emptyAllocation;
 				if (nHeight >= Params().GetConsensus().nShareFeeBlock) {
 					sender = stringFromVch(allocation.vchAliasOrAddress);
-					it = mapAliasIndex.find(sender);
 				}
 				else {
 					if (!FindAliasInTx(view, tx, vvchAliasArgs)) {
 						continue;
 					}
 					sender = stringFromVch(vvchAliasArgs[0]);
-					it = mapAliasIndex.find(sender);
-				}
-				if (it == mapAliasIndex.end()) {
-					vertices.push_back(add_vertex(graph));
-					mapAliasIndex[sender] = vertices.size() - 1;
 				}
-				mapTxIndex[mapAliasIndex[sender]].push_back(n);
+				auto itSender = mapAliasIndex.find(sender);
+				if (itSender == mapAliasIndex.end())
+					itSender = mapAliasIndex.emplace(sender, graph.AddVertex()).first;
+				const int nSender = itSender->second;
+				graph.AddSenderTx(nSender, n);
 				
 				if (!allocation.listSendingAllocationAmounts.empty()) {
 					for (auto& allocationInstance : allocation.listSendingAllocationAmounts) {
 						const string& receiver = stringFromVch(allocationInstance.first);
-						AliasMap::const_iterator it = mapAliasIndex.find(receiver);
-						if (it == mapAliasIndex.end()) {
-							vertices.push_back(add_vertex(graph));
-							mapAliasIndex[receiver] = vertices.size() - 1;
-						}
+						auto it = mapAliasIndex.find(receiver);
+						if (it == mapAliasIndex.end())
+							it = mapAliasIndex.emplace(receiver, graph.AddVertex()).first;
 						// the graph needs to be from index to index 
-						add_edge(vertices[mapAliasIndex[sender]], vertices[mapAliasIndex[receiver]], graph);
+						graph.AddEdge(nSender, it->second);
 					}
 				}
 				else if (!allocation.listSendingAllocationInputs.empty()) {
 					for (auto& allocationInstance : allocation.listSendingAllocationInputs) {
 						const string& receiver = stringFromVch(allocationInstance.first);
-						AliasMap::const_iterator it = mapAliasIndex.find(receiver);
-						if (it == mapAliasIndex.end()) {
-							vertices.push_back(add_vertex(graph));
-							mapAliasIndex[receiver] = vertices.size() - 1;
-						}
+						auto it = mapAliasIndex.find(receiver);
+						if (it == mapAliasIndex.end())
+							it = mapAliasIndex.emplace(receiver, graph.AddVertex()).first;
 						// the graph needs to be from index to index 
-						add_edge(vertices[mapAliasIndex[sender]], vertices[mapAliasIndex[receiver]], graph);
+						graph.AddEdge(nSender, it->second);
 					}
 				}
 			}
 		}
 	}
-	return mapTxIndex.size() > 0;
+	return graph.HasSenders();
 }
 // remove cycles in a graph and create a DAG, modify the blockVtx passed in to remove conflicts, the conflicts should be added back to the end of this vtx after toposort
-void GraphRemoveCycles(const std::vector<CTransactionRef>& blockVtx, std::vector<int> &conflictedIndexes, Graph& graph, const std::vector<vertex_descriptor> &vertices, IndexMap &mapTxIndex) {
-	sorted_vector<int> clearedVertices;
-	cycle_visitor<sorted_vector<int> > visitor(clearedVertices);
-	hawick_circuits(graph, visitor);
-	for (auto& nVertex : clearedVertices) {
-		IndexMap::const_iterator it = mapTxIndex.find(nVertex);
-		if (it == mapTxIndex.end())
-			continue;
-		// remove from graph
-		const int nVertexIndex = (*it).first;
-		if (nVertexIndex >= (int)vertices.size())
-			continue;
-		boost::clear_out_edges(vertices[nVertexIndex], graph);
-		const std::vector<int> &vecTx = (*it).second;
-		// mapTxIndex knows of the mapping between vertices and tx vout positions
-		for (auto& nIndex : vecTx) {
-			if (nIndex >= (int)blockVtx.size())
-				continue;
-			conflictedIndexes.push_back(nIndex);
-		}
-		mapTxIndex.erase(it);
-	}
-	// block gives us the transactions in order by time so we want to ensure we preserve it
-	std::sort(conflictedIndexes.begin(), conflictedIndexes.end());
+void GraphRemoveCycles(const std::vector<CTransactionRef>& blockVtx, std::vector<int> &conflictedIndexes, CServiceTxGraph& graph) {
+	graph.RemoveCycles(conflictedIndexes);
+	conflictedIndexes.erase(std::remove_if(conflictedIndexes.begin(), conflictedIndexes.end(),
+		[&blockVtx](int nIndex) { return nIndex >= (int)blockVtx.size(); }), conflictedIndexes.end());
 }
-bool DAGTopologicalSort(std::vector<CTransactionRef>& blockVtx, const std::vector<int> &conflictedIndexes, const Graph& graph, const IndexMap &mapTxIndex) {
+bool DAGTopologicalSort(std::vector<CTransactionRef>& blockVtx, const std::vector<int> &conflictedIndexes, CServiceTxGraph& graph) {
 	std::vector<CTransactionRef> newVtx;
-	container c;
-	try
-	{
-		topological_sort(graph, std::back_inserter(c));
-	}
-	catch (not_a_dag const& e){
-		LogPrintf("DAGTopologicalSort: Not a DAG: %s\n", e.what());
+	std::vector<int> c;
+	if (!graph.TopologicalSort(c)) {
+		LogPrintf("DAGTopologicalSort: Not a DAG\n");
 		return false;
 	}
 	// add coinbase
 	newVtx.emplace_back(blockVtx[0]);
 
-	// add sys tx's to newVtx in reverse sorted order
-	reverse(c.begin(), c.end());
+	// add sys tx's to newVtx in sorted order
 	for (auto& nVertex : c) {
-		// this may not find the vertex if its a receiver (we only want to process sender as tx is tied to sender)
-		IndexMap::const_iterator it = mapTxIndex.find(nVertex);
-		if (it == mapTxIndex.end())
-			continue;
-		const std::vector<int> &vecTx = (*it).second;
-		// mapTxIndex knows of the mapping between vertices and tx index positions
+		// receivers have no transactions (we only want to process sender as tx is tied to sender)
+		const std::vector<int> &vecTx = graph.GetSenderTxs(nVertex);
 		for (auto& nIndex : vecTx) {
 			if (nIndex >= (int)blockVtx.size())
 				continue;
 			newVtx.emplace_back(blockVtx[nIndex]);
 		}
 	}
-
 	// add conflicting indexes next (should already be in order)
 	for (auto& nIndex : conflictedIndexes) {
 		if (nIndex >= (int)blockVtx.size())
@@ -220,12 +311,10 @@ bool DAGTopologicalSort(std::vector<CTransactionRef>& blockVtx, const std::vecto
 	}
 	
 	// add non-sys and other sys tx's to end of newVtx
-	std::vector<vector<unsigned char> > vvchArgs;
-	int op;
 	for (unsigned int vOut = 1; vOut< blockVtx.size(); vOut++) {
 		const CTransactionRef& txRef = blockVtx[vOut];
 		const CTransaction& tx = *txRef;
-		if (!DecodeAssetAllocationTx(tx, op, vvchArgs))
+		if (!GetServicePayload(tx)->IsAssetAllocation())
 		{
 			newVtx.emplace_back(txRef);
 		}
@@ -238,4 +327,40 @@ bool DAGTopologicalSort(std::vector<CTransactionRef>& blockVtx, const std::vecto
 	// set newVtx to block's vtx so block can process as normal
 	blockVtx = newVtx;
 	return true;
-}
\ No newline at end of file
+}
+static int FindRoot(std::vector<int>& vParent, int n) {
+	while (vParent[n] != n) {
+		vParent[n] = vParent[vParent[n]];
+		n = vParent[n];
+	}
+	return n;
+}
+void PartitionByKeys(const std::vector<std::vector<std::string> >& vTxKeys, std::vector<std::vector<int> >& vGroups) {
+	vGroups.clear();
+	std::vector<int> vParent(vTxKeys.size());
+	for (unsigned int n = 0; n < vTxKeys.size(); n++)
+		vParent[n] = n;
+	// first transaction seen with each key, later ones are joined to it
+	std::unordered_map<std::string, int> mapKeyOwner;
+	for (unsigned int n = 0; n < vTxKeys.size(); n++) {
+		for (auto& key : vTxKeys[n]) {
+			auto result = mapKeyOwner.emplace(key, n);
+			if (result.second)
+				continue;
+			const int nRootA = FindRoot(vParent, n);
+			const int nRootB = FindRoot(vParent, result.first->second);
+			// keep the lower transaction as root so roots are the first transaction of their group
+			if (nRootA != nRootB)
+				vParent[std::max(nRootA, nRootB)] = std::min(nRootA, nRootB);
+		}
+	}
+	std::vector<int> vGroupOfRoot(vTxKeys.size(), -1);
+	for (unsigned int n = 0; n < vTxKeys.size(); n++) {
+		const int nRoot = FindRoot(vParent, n);
+		if (vGroupOfRoot[nRoot] < 0) {
+			vGroupOfRoot[nRoot] = vGroups.size();
+			vGroups.emplace_back();
+		}
+		vGroups[vGroupOfRoot[nRoot]].push_back(n);
+	}
+}
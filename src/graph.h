@@ -1,21 +1,8 @@
 #ifndef GRAPH_H
 #define GRAPH_H
-#include <vector>
-#include <boost/graph/directed_graph.hpp>
-#include <boost/graph/graph_traits.hpp>
-#include <boost/graph/hawick_circuits.hpp>
-#include <boost/next_prior.hpp>
-#include <boost/property_map/property_map.hpp>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/topological_sort.hpp>
-#include <unordered_map>
+#include <algorithm>
 #include <vector>
 #include "miner.h"
-typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::directedS > Graph;
-typedef boost::graph_traits<Graph> Traits;
-typedef typename Traits::vertex_descriptor vertex_descriptor;
-typedef std::map<int, std::vector<int> > IndexMap;
-typedef std::map<std::string, int> AliasMap;
 template <class T, class Compare = std::less<T> >
 struct sorted_vector {
 	std::vector<T> V;
@@ -54,25 +41,69 @@ const_iterator_cast(std::vector<T>& v, typename std::vector<T>::const_iterator i
 {
 	return v.begin() + (iter - v.cbegin());
 }
-template <typename ClearedVertices>
-struct cycle_visitor
+/**
+ * Dependency graph of the asset allocation senders and receivers of a block.
+ *
+ * Vertices are numbered in order of first appearance and edges point from sender
+ * to receiver, kept in insertion order in flat arrays. RemoveCycles() and
+ * TopologicalSort() give exactly the result the former boost::adjacency_list code
+ * (hawick_circuits followed by topological_sort) gave, since the resulting tx order
+ * is consensus critical, but in polynomial instead of exponential time: cycles are
+ * only searched for inside strongly connected components, which are found in
+ * linear time, so blocks without cycles cost a single pass.
+ */
+class CServiceTxGraph
 {
-	cycle_visitor(ClearedVertices& vertices)
-		: cleared(vertices)
-	{}
+public:
+	CServiceTxGraph() : nSenders(0), fFinalized(false) {}
 
-	template <typename Path, typename Graph>
-	void cycle(Path const& p, Graph & g)
-	{
-		if (p.empty())
-			return;
-		const int &nValue = *(boost::prior(p.end()));
-		cleared.insert(nValue);
-	}
-	ClearedVertices& cleared;
+	int AddVertex();
+	void AddEdge(int nFrom, int nTo);
+	void AddSenderTx(int nVertex, int nTxIndex);
+
+	size_t VertexCount() const { return vSenderTxs.size(); }
+	size_t EdgeCount() const { return vEdges.size(); }
+	/** Whether any vertex still sends a transaction */
+	bool HasSenders() const { return nSenders > 0; }
+	/** Block indexes of the transactions sent by a vertex, in block order */
+	const std::vector<int>& GetSenderTxs(int nVertex) const { return vSenderTxs[nVertex]; }
+
+	/**
+	 * Find every vertex that closes an elementary cycle, meaning it has an edge
+	 * back to the lowest numbered vertex of the cycle, and detach it: its out
+	 * edges are dropped and its transactions are appended to conflictedIndexes,
+	 * which is sorted afterwards.
+	 */
+	void RemoveCycles(std::vector<int>& conflictedIndexes);
+	/**
+	 * Vertices in reverse depth first finishing order, visiting vertices and
+	 * edges in insertion order. Returns false if there is still a cycle.
+	 */
+	bool TopologicalSort(std::vector<int>& vOrder);
+
+private:
+	void Finalize();
+	void StronglyConnectedComponents(std::vector<int>& vComponent) const;
+
+	std::vector<std::pair<int, int> > vEdges;
+	// out edges of vertex v are vOutTargets[vOutStart[v]] up to vOutTargets[vOutStart[v + 1]]
+	std::vector<int> vOutStart;
+	std::vector<int> vOutTargets;
+	std::vector<std::vector<int> > vSenderTxs;
+	std::vector<bool> vDetached;
+	size_t nSenders;
+	bool fFinalized;
 };
-bool OrderBasedOnArrivalTime(const int &nHeight,std::vector<CTransactionRef>& blockVtx);
-bool CreateGraphFromVTX(const int &nHeight, const std::vector<CTransactionRef>& blockVtx, Graph &graph, std::vector<vertex_descriptor> &vertices, IndexMap &mapTxIndex);
-void GraphRemoveCycles(const std::vector<CTransactionRef>& blockVtx, std::vector<int> &conflictedIndexes, Graph& graph, const std::vector<vertex_descriptor> &vertices, IndexMap &mapTxIndex);
-bool DAGTopologicalSort(std::vector<CTransactionRef>& blockVtx, const std::vector<int> &conflictedIndexes, const Graph& graph, const IndexMap &mapTxIndex);
-#endif // GRAPH_H
\ No newline at end of file
+/** Move the asset allocation, offer and cert transactions to the end of blockVtx, ordered by their mempool arrival time */
+bool OrderBasedOnArrivalTime(const CTxMemPool& pool, std::vector<CTransactionRef>& blockVtx);
+bool CreateGraphFromVTX(const int &nHeight, const std::vector<CTransactionRef>& blockVtx, CServiceTxGraph &graph);
+void GraphRemoveCycles(const std::vector<CTransactionRef>& blockVtx, std::vector<int> &conflictedIndexes, CServiceTxGraph& graph);
+bool DAGTopologicalSort(std::vector<CTransactionRef>& blockVtx, const std::vector<int> &conflictedIndexes, CServiceTxGraph& graph);
+/**
+ * Split transactions into groups that share no key. Transaction n touches the keys
+ * in vTxKeys[n] and transactions sharing a key, directly or through others, end up
+ * in the same group. Each group lists its transactions in ascending order and the
+ * groups are ordered by their first transaction.
+ */
+void PartitionByKeys(const std::vector<std::vector<std::string> >& vTxKeys, std::vector<std::vector<int> >& vGroups);
+#endif // GRAPH_H
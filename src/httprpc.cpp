@@ -23,6 +23,8 @@
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
+/** Bytes of a streamed result collected before they are sent as one part of the reply */
+static const size_t RPC_STREAM_CHUNK_SIZE = 1 << 16;
 
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
@@ -60,6 +62,60 @@ private:
     struct event_base* base;
 };
 
+/** Sends the result of a JSON-RPC call as the reply body while the call
+ * produces it. The reply starts with the first write, errors after that
+ * can only be reported in the error member of the reply.
+ */
+class HTTPRPCStream : public RPCStream
+{
+public:
+    HTTPRPCStream(HTTPRequest* _req) : req(_req), fStarted(false), fClosed(false)
+    {
+    }
+    void Write(const std::string& strJSON) override
+    {
+        if (!fStarted) {
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReplyStart(HTTP_OK);
+            strBuffer = "{\"result\":";
+            fStarted = true;
+        }
+        strBuffer += strJSON;
+        if (strBuffer.size() >= RPC_STREAM_CHUNK_SIZE)
+            Flush();
+        if (fClosed)
+            throw std::runtime_error("Client closed the connection");
+    }
+    void SetClosing(const std::string& _strClosing) override
+    {
+        strClosing = _strClosing;
+    }
+    bool IsStarted() const
+    {
+        return fStarted;
+    }
+    /** Complete the reply, error is set when the call failed after the reply started */
+    void End(const UniValue& error, const UniValue& id)
+    {
+        strBuffer += strClosing + ",\"error\":" + error.write() + ",\"id\":" + id.write() + "}\n";
+        Flush();
+        req->WriteReplyEnd();
+    }
+private:
+    HTTPRequest* req;
+    std::string strBuffer;
+    std::string strClosing;
+    bool fStarted;
+    bool fClosed;
+
+    void Flush()
+    {
+        if (!fClosed && !req->WriteReplyChunk(strBuffer))
+            fClosed = true;
+        strBuffer.clear();
+    }
+};
+
 
 /* Pre-base64-encoded authentication token */
 static std::string strRPCUserColonPass;
@@ -301,6 +357,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
     }
 
     JSONRPCRequest jreq;
+    HTTPRPCStream stream(req);
     if (!RPCAuthorized(authHeader.second, jreq.authUser)) {
         LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", req->GetPeer().ToString());
 
@@ -327,8 +384,14 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
+            // list RPCs write their rows out as they go
+            jreq.stream = &stream;
 
             UniValue result = tableRPC.execute(jreq);
+            if (stream.IsStarted()) {
+                stream.End(NullUniValue, jreq.id);
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -342,10 +405,16 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
+        if (stream.IsStarted())
+            stream.End(objError, jreq.id);
+        else
+            JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        if (stream.IsStarted())
+            stream.End(JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        else
+            JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
     return true;
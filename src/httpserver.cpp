@@ -41,6 +41,8 @@
 
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
+/** Bytes of a reply sent in parts that may wait to be written to the client before the writer blocks */
+static const size_t MAX_REPLY_STREAM_BUFFER = 1 << 20;
 
 /** HTTP request work item */
 class HTTPWorkItem : public HTTPClosure
@@ -557,13 +559,68 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+/** Flow control of a reply sent in parts, shared by the worker writing it and the main http thread */
+struct HTTPReplyStream
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    // a part is on its way to the client's connection, or the connection has too much left to write
+    bool fBusy;
+    // the client is gone
+    bool fClosed;
+
+    HTTPReplyStream() : fBusy(false), fClosed(false) {}
+};
+
+/** Re-enable reading from the socket once a reply is sent. This is the second part of the libevent workaround in http_request_cb */
+static void http_reply_enable_read(struct evhttp_request* req)
+{
+	if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+		evhttp_connection* conn = evhttp_request_get_connection(req);
+		if (conn) {
+			bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+			if (bev) {
+				bufferevent_enable(bev, EV_READ | EV_WRITE);
+			}
+		}
+	}
+}
+
+/** Let the writer of a reply sent in parts go on once the connection has written most of it, checking back while it has not.
+ * Libevent keeps a request it has not been given the end of the reply for, it only detaches it from a failed connection.
+ */
+static void http_reply_stream_drain(struct evhttp_request* req, std::shared_ptr<HTTPReplyStream> stream)
+{
+	evhttp_connection* conn = evhttp_request_get_connection(req);
+	bufferevent* bev = conn ? evhttp_connection_get_bufferevent(conn) : nullptr;
+	if (bev && evbuffer_get_length(bufferevent_get_output(bev)) > MAX_REPLY_STREAM_BUFFER) {
+		// a client that stops reading altogether runs into the -rpcservertimeout write timeout
+		struct timeval tv = {0, 10000};
+		HTTPEvent* ev = new HTTPEvent(eventBase, true, [req, stream] {
+			http_reply_stream_drain(req, stream);
+		});
+		ev->trigger(&tv);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(stream->cs);
+		stream->fBusy = false;
+		stream->fClosed = (conn == nullptr);
+	}
+	stream->cond.notify_all();
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req),
                                                        replySent(false)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (!replySent && replyStream) {
+        // the client sees the reply cut short
+        LogPrintf("%s: Unfinished reply\n", __func__);
+        WriteReplyEnd();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -623,17 +680,62 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 	auto req_copy = req;
 	HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus] {
 		evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-		// Re-enable reading from the socket. This is the second part of the libevent
-		// workaround above.
-		if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-			evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-			if (conn) {
-				bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-				if (bev) {
-					bufferevent_enable(bev, EV_READ | EV_WRITE);
-				}
-			}
-		}
+		http_reply_enable_read(req_copy);
+	});
+	ev->trigger(nullptr);
+	replySent = true;
+	req = nullptr; // transferred back to main thread
+}
+/** The parts of a reply are handed to the main http thread one at a time,
+* events activated from one thread run in the order they were activated.
+*/
+void HTTPRequest::WriteReplyStart(int nStatus)
+{
+	assert(!replySent && req && !replyStream);
+	replyStream = std::make_shared<HTTPReplyStream>();
+	auto req_copy = req;
+	HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus] {
+		evhttp_send_reply_start(req_copy, nStatus, nullptr);
+	});
+	ev->trigger(nullptr);
+}
+bool HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+	assert(!replySent && req && replyStream);
+	std::shared_ptr<HTTPReplyStream> stream = replyStream;
+	{
+		std::unique_lock<std::mutex> lock(stream->cs);
+		while (stream->fBusy)
+			stream->cond.wait(lock);
+		if (stream->fClosed)
+			return false;
+		stream->fBusy = true;
+	}
+	struct evbuffer* evb = evbuffer_new();
+	assert(evb);
+	evbuffer_add(evb, strChunk.data(), strChunk.size());
+	auto req_copy = req;
+	HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, stream] {
+		evhttp_send_reply_chunk(req_copy, evb);
+		evbuffer_free(evb);
+		http_reply_stream_drain(req_copy, stream);
+	});
+	ev->trigger(nullptr);
+	return true;
+}
+void HTTPRequest::WriteReplyEnd()
+{
+	assert(!replySent && req && replyStream);
+	{
+		// the drain check must not outlive the request, which ending the reply may free
+		std::unique_lock<std::mutex> lock(replyStream->cs);
+		while (replyStream->fBusy)
+			replyStream->cond.wait(lock);
+	}
+	auto req_copy = req;
+	HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy] {
+		http_reply_enable_read(req_copy);
+		evhttp_send_reply_end(req_copy);
 	});
 	ev->trigger(nullptr);
 	replySent = true;
@@ -8,6 +8,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -17,6 +18,7 @@ struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPReplyStream;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -55,6 +57,8 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    // set once a reply in parts was started
+    std::shared_ptr<HTTPReplyStream> replyStream;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -111,6 +115,24 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a reply whose body follows in parts, sent with chunked transfer
+     * encoding. Complete it with WriteReplyEnd instead of calling WriteReply.
+     */
+    void WriteReplyStart(int nStatus);
+    /**
+     * Send the next part of a reply started with WriteReplyStart. Blocks while
+     * the client is behind on reading what was sent before, so that a reply
+     * does not pile up in memory. Returns false once the client is gone.
+     */
+    bool WriteReplyChunk(const std::string& strChunk);
+    /**
+     * Complete a reply started with WriteReplyStart.
+     *
+     * @note Like WriteReply this gives the request back to the main thread.
+     */
+    void WriteReplyEnd();
 };
 
 /** Event handler closure.
@@ -77,7 +77,8 @@
 #include "escrow.h"
 #include "asset.h"
 #include "assetallocation.h"
-#include "thread_pool/thread_pool.hpp"
+#include "validationexecutor.h"
+#include "serviceevent.h"
 #ifndef WIN32
 #include <signal.h>
 #endif
@@ -131,6 +132,8 @@ enum BindFlags {
 };
 
 static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
+/** Seconds between stores of the masternode and governance caches while running */
+static const int64_t CACHE_DUMP_INTERVAL = 15 * 60;
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -219,6 +222,28 @@ void Interrupt(boost::thread_group& threadGroup)
     threadGroup.interrupt_all();
 }
 
+/** Store the masternode, payment, governance and request caches, from the scheduler and on shutdown */
+static void DumpCacheFiles()
+{
+    static CCriticalSection cs_DumpCacheFiles;
+    LOCK(cs_DumpCacheFiles);
+
+    // STORE DATA CACHES INTO SERIALIZED DAT FILES
+    CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
+    flatdb1.Dump(mnodeman);
+    CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+    flatdb2.Dump(mnpayments);
+    CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+    flatdb3.Dump(governance);
+    CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
+    flatdb4.Dump(netfulfilledman);
+    if(fEnableInstantSend)
+    {
+        CFlatDB<CInstantSend> flatdb5("instantsend.dat", "magicInstantSendCache");
+        flatdb5.Dump(instantsend);
+    }
+}
+
 /** Preparing steps before shutting down or restarting the wallet */
 void PrepareShutdown()
 {
@@ -238,6 +263,9 @@ void PrepareShutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    // no mempool validation task may run once the peers and databases below are torn down
+    if (threadpool)
+        threadpool->Stop();
 #ifdef ENABLE_WALLET
     if (pwalletMain)
         pwalletMain->Flush(false);
@@ -245,6 +273,8 @@ void PrepareShutdown()
     MapPort(false);
     UnregisterValidationInterface(peerLogic.get());
     peerLogic.reset();
+    // queued list sync messages hold references to their peers
+    mnodeman.ReleasePendingSyncMessages();
     g_connman.reset();
 
     if (!fLiteMode) {
@@ -253,21 +283,10 @@ void PrepareShutdown()
         privateSendClient.fEnablePrivateSend = false;
         privateSendClient.ResetPool();
 #endif
-        // STORE DATA CACHES INTO SERIALIZED DAT FILES
-        CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
-        flatdb1.Dump(mnodeman);
-        CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
-        flatdb2.Dump(mnpayments);
-        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-        flatdb3.Dump(governance);
-        CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
-        flatdb4.Dump(netfulfilledman);
-        if(fEnableInstantSend)
-        {
-            CFlatDB<CInstantSend> flatdb5("instantsend.dat", "magicInstantSendCache");
-            flatdb5.Dump(instantsend);
-        }
+        DumpCacheFiles();
     }
+    delete pgovernancevotedb;
+    pgovernancevotedb = NULL;
 
     UnregisterNodeSignals(GetNodeSignals());
     if (fDumpMempoolLater)
@@ -306,6 +325,7 @@ void PrepareShutdown()
 		delete passetdb;
 		passetdb = NULL;
 	}
+	assetAllocationSenderLedger.DisconnectMempool(mempool);
 	if (passetallocationdb != NULL)
 	{
 		delete passetallocationdb;
@@ -451,6 +471,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-aliascache=<n>", strprintf(_("Keep up to <n> megabytes of aliases read from the alias database in memory (default: %u)"), DEFAULT_ALIAS_CACHE_SIZE));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
@@ -471,12 +492,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-threadpoolsize=<n>", strprintf(_("Set the number of mempool validation threads (0 = one less than the number of cores, default: %d)"), DEFAULT_THREADPOOL_SIZE));
+    strUsage += HelpMessageOpt("-threadpoolqueue=<n>", strprintf(_("Maximum number of transactions waiting for mempool validation threads, peers over their share are paused (default: %d)"), DEFAULT_THREADPOOL_QUEUE));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BILLIECOIN_PID_FILENAME));
 #endif
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+    strUsage += HelpMessageOpt("-pruneservices", strprintf(_("Prune the data of expired aliases and of the offers, certificates and escrows that expired with them in the background (default: %u)"), DEFAULT_PRUNE_SERVICES));
     strUsage += HelpMessageOpt("-reindex-chainstate", _("Rebuild chain state from the currently indexed blocks"));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild chain state and block index from the blk*.dat files on disk"));
 #ifndef WIN32
@@ -558,6 +582,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubescrowrecord=<address>", _("Enable publish raw escrow payload in <address>"));
     strUsage += HelpMessageOpt("-zmqpubofferhistory=<address>", _("Enable publish raw offer history payload in <address>"));
     strUsage += HelpMessageOpt("-zmqpubofferrecord=<address>", _("Enable publish raw offer payload in <address>"));
+    strUsage += HelpMessageOpt("-zmqservicequeue=<n>", strprintf(_("Keep at most <n> billiecoin service payloads waiting to be published, newer ones are dropped (default: %u)"), DEFAULT_SERVICE_EVENT_QUEUE_SIZE));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -568,6 +593,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-checkzdagledger", strprintf("Verify every Z-DAG sender status lookup against a full asset allocation DB replay, abort on a mismatch (default: %u)", 0));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-testsafemode", strprintf("Force safe mode (default: %u)", DEFAULT_TESTSAFEMODE));
@@ -621,6 +647,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-mnconf=<file>", strprintf(_("Specify masternode configuration file (default: %s)"), "masternode.conf"));
     strUsage += HelpMessageOpt("-mnconflock=<n>", strprintf(_("Lock masternodes from masternode configuration file (default: %u)"), 1));
     strUsage += HelpMessageOpt("-masternodeprivkey=<n>", _("Set the masternode private key"));
+    strUsage += HelpMessageOpt("-masternodesyncthreads=<n>", strprintf(_("Set the number of threads checking masternode signatures while the masternode list syncs (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        -GetNumCores(), MAX_MASTERNODE_SYNC_THREADS, DEFAULT_MASTERNODE_SYNC_THREADS));
 
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(_("PrivateSend options:"));
@@ -1172,6 +1200,8 @@ bool AppInitParameterInteraction()
     if (ratio != 0) {
         mempool.setSanityCheck(1.0 / ratio);
     }
+    assetAllocationSenderLedger.SetCheckConsistency(GetBoolArg("-checkzdagledger", false));
+    assetAllocationSenderLedger.ConnectMempool(mempool);
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
@@ -1205,6 +1235,15 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // same rules as -par, with 0 threads the masternode list is synced one message at a time
+    nMasternodeSyncThreads = GetArg("-masternodesyncthreads", DEFAULT_MASTERNODE_SYNC_THREADS);
+    if (nMasternodeSyncThreads <= 0)
+        nMasternodeSyncThreads += GetNumCores();
+    if (nMasternodeSyncThreads <= 1)
+        nMasternodeSyncThreads = 0;
+    else if (nMasternodeSyncThreads > MAX_MASTERNODE_SYNC_THREADS)
+        nMasternodeSyncThreads = MAX_MASTERNODE_SYNC_THREADS;
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1417,10 +1456,17 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadMempoolScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadServiceCheck);
     }
+    LogPrintf("Using %u threads for masternode list sync\n", nMasternodeSyncThreads);
+    for (int i=0; i<nMasternodeSyncThreads-1; i++)
+        threadGroup.create_thread(&ThreadMasternodeSyncCheck);
 	if (!threadpool) {
-		threadpool = new tp::ThreadPool;
-		LogPrint("threadpool", "THREADPOOL::Created threadpool\n");
+		threadpool = new CValidationExecutor(GetArg("-threadpoolsize", DEFAULT_THREADPOOL_SIZE), GetArg("-threadpoolqueue", DEFAULT_THREADPOOL_QUEUE));
+		LogPrintf("Using %u threads and a queue of %u for mempool validation\n", threadpool->GetThreadCount(), threadpool->GetMaxDepth());
 	}
     if (!sporkManager.SetSporkAddress(GetArg("-sporkaddr", Params().SporkAddress())))
         return InitError(_("Invalid spork address specified with -sporkaddr"));
@@ -1612,6 +1658,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     if (pzmqNotificationInterface) {
         RegisterValidationInterface(pzmqNotificationInterface);
+        serviceEventPublisher.Enable(GetArg("-zmqservicequeue", DEFAULT_SERVICE_EVENT_QUEUE_SIZE));
+        threadGroup.create_thread(&ThreadPublishServiceEvents);
     }
 #endif
 
@@ -1702,12 +1750,21 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 				paliasdb = new CAliasDB(nCoinCacheUsage, false, fReindex);
+				paliasdb->SetReadCacheSize(GetArg("-aliascache", DEFAULT_ALIAS_CACHE_SIZE) << 20);
 				pofferdb = new COfferDB(nCoinCacheUsage, false, fReindex);
 				pcertdb = new CCertDB(nCoinCacheUsage, false, fReindex);
 				passetdb = new CAssetDB(nCoinCacheUsage, false, fReindex);
 				passetallocationdb = new CAssetAllocationDB(nCoinCacheUsage, false, fReindex);
 				passetallocationtransactionsdb = new CAssetAllocationTransactionsDB(0, false, fReindex);
 				pescrowdb = new CEscrowDB(nCoinCacheUsage, false, fReindex);
+				if (!paliasdb->BuildIndexes() || !pofferdb->BuildIndexes() || !pcertdb->BuildIndexes() || !passetdb->BuildIndexes() || !passetallocationdb->BuildIndexes() || !pescrowdb->BuildIndexes()) {
+					strLoadError = _("Error indexing billiecoin service databases");
+					break;
+				}
+				if (!passetallocationdb->UpgradeArrivalTimes() || !passetallocationtransactionsdb->UpgradeAssetAllocationIndex()) {
+					strLoadError = _("Error upgrading asset allocation databases");
+					break;
+				}
 
                 if (fReindex) {
                     pblocktree->WriteReindexing(true);
@@ -1888,7 +1945,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     fMasternodeMode = GetBoolArg("-masternode", false);
 	fUnitTest = GetBoolArg("-unittest", false);
 	fTPSTest = GetBoolArg("-tpstest", false);
-	fLogThreadpool = LogAcceptCategory("threadpool");
 	fAssetAllocationIndex = GetBoolArg("-assetallocationindex", false);
     // TODO: masternode should have no wallet
 
@@ -1973,6 +2029,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
 
+    // governance votes are kept on disk, governance.dat only refers to them
+    pgovernancevotedb = new CGovernanceVoteDB(GOVERNANCE_VOTE_DB_CACHE);
+
     if (!fLiteMode) {
         boost::filesystem::path pathDB = GetDataDir();
         std::string strDBName;
@@ -1985,19 +2044,26 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
 
         if(mnodeman.size()) {
-            strDBName = "mnpayments.dat";
-            uiInterface.InitMessage(_("Loading masternode payment cache..."));
-            CFlatDB<CMasternodePayments> flatdb2(strDBName, "magicMasternodePaymentsCache");
-            if(!flatdb2.Load(mnpayments)) {
-                return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / strDBName).string());
+            // the payment and governance caches are independent, read them
+            // side by side and clean them up once both are in
+            uiInterface.InitMessage(_("Loading masternode payment and governance caches..."));
+            CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+            CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+            bool fGovernanceLoaded = false;
+            boost::thread threadGovernance([&flatdb3, &fGovernanceLoaded] {
+                RenameThread("billiecoin-loadgov");
+                fGovernanceLoaded = flatdb3.Load(governance, false);
+            });
+            bool fPaymentsLoaded = flatdb2.Load(mnpayments, false);
+            threadGovernance.join();
+            if(!fPaymentsLoaded) {
+                return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / "mnpayments.dat").string());
             }
-
-            strDBName = "governance.dat";
-            uiInterface.InitMessage(_("Loading governance cache..."));
-            CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
-            if(!flatdb3.Load(governance)) {
-                return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
+            if(!fGovernanceLoaded) {
+                return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / "governance.dat").string());
             }
+            mnpayments.CheckAndRemove();
+            governance.CheckAndRemove();
             governance.InitOnLoad();
         } else {
             uiInterface.InitMessage(_("Masternode cache is empty, skipping payments and governance cache..."));
@@ -2042,6 +2108,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
         scheduler.scheduleEvery(boost::bind(&CInstantSend::DoMaintenance, boost::ref(instantsend)), 60);
 
+        // keep the cache files recent so a crash does not lose everything since startup
+        scheduler.scheduleEvery(&DumpCacheFiles, CACHE_DUMP_INTERVAL);
+
         if (fMasternodeMode)
             scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), MASTERNODE_SYNC_TICK_SECONDS);
 #ifdef ENABLE_WALLET
@@ -2050,6 +2119,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 #endif // ENABLE_WALLET
     }
 
+    if (GetBoolArg("-pruneservices", DEFAULT_PRUNE_SERVICES))
+        scheduler.scheduleEvery(&PruneBilliecoinServicesMaintenance, 60);
+
     // ********************************************************* Step 12: start node
 
     //// debug print
@@ -89,6 +89,7 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
+        LOCK(cs_instantsend);
         std::string strVersion;
         if(ser_action.ForRead()) {
             READWRITE(strVersion);
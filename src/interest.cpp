@@ -0,0 +1,186 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "interest.h"
+
+#include <cmath>
+#include <string.h>
+
+#include <boost/multiprecision/cpp_dec_float.hpp>
+using namespace boost::multiprecision;
+
+CInterestFixed::CInterestFixed() {
+	memset(pn, 0, sizeof(pn));
+}
+CInterestFixed::CInterestFixed(const uint32_t nInteger) {
+	memset(pn, 0, sizeof(pn));
+	pn[FRACTION_WIDTH] = nInteger;
+}
+bool CInterestFixed::SetDouble(const double d) {
+	memset(pn, 0, sizeof(pn));
+	if (!std::isfinite(d) || d < 0)
+		return false;
+	if (d == 0)
+		return true;
+	int nExponent;
+	uint64_t nMantissa = (uint64_t)std::ldexp(std::frexp(d, &nExponent), 53);
+	// position of the lowest mantissa bit above the lowest fraction bit
+	int nShift = nExponent - 53 + 32 * FRACTION_WIDTH;
+	while (nShift < 0 && (nMantissa & 1) == 0) {
+		nMantissa >>= 1;
+		nShift++;
+	}
+	if (nShift < 0 || nShift + 53 > 32 * WIDTH)
+		return false;
+	for (int i = nShift / 32; nMantissa != 0 && i < WIDTH; i++) {
+		const int nBits = (i == nShift / 32) ? nShift % 32 : 0;
+		pn[i] |= (uint32_t)(nMantissa << nBits);
+		nMantissa >>= (32 - nBits);
+	}
+	return true;
+}
+void CInterestFixed::Divide(const uint32_t n) {
+	uint64_t nRemainder = 0;
+	for (int i = WIDTH - 1; i >= 0; i--) {
+		const uint64_t nCur = (nRemainder << 32) | pn[i];
+		pn[i] = (uint32_t)(nCur / n);
+		nRemainder = nCur % n;
+	}
+}
+bool CInterestFixed::SetProduct(const CInterestFixed& a, const CInterestFixed& b) {
+	uint32_t product[2 * WIDTH];
+	memset(product, 0, sizeof(product));
+	// the growth factors use few integer words, skip the zero ones
+	int nWidthB = WIDTH;
+	while (nWidthB > 0 && b.pn[nWidthB - 1] == 0)
+		nWidthB--;
+	for (int i = 0; i < WIDTH; i++) {
+		if (a.pn[i] == 0)
+			continue;
+		uint64_t nCarry = 0;
+		for (int j = 0; j < nWidthB; j++) {
+			const uint64_t n = nCarry + product[i + j] + (uint64_t)a.pn[i] * b.pn[j];
+			product[i + j] = (uint32_t)n;
+			nCarry = n >> 32;
+		}
+		product[i + nWidthB] = (uint32_t)nCarry;
+	}
+	for (int i = FRACTION_WIDTH + WIDTH; i < 2 * WIDTH; i++) {
+		if (product[i] != 0)
+			return false;
+	}
+	memcpy(pn, product + FRACTION_WIDTH, sizeof(pn));
+	return true;
+}
+bool CInterestFixed::Subtract(const CInterestFixed& b) {
+	int64_t nBorrow = 0;
+	for (int i = 0; i < WIDTH; i++) {
+		const int64_t n = (int64_t)pn[i] - b.pn[i] - nBorrow;
+		pn[i] = (uint32_t)n;
+		nBorrow = n < 0 ? 1 : 0;
+	}
+	return nBorrow == 0;
+}
+bool CInterestFixed::IsZero() const {
+	for (int i = 0; i < WIDTH; i++) {
+		if (pn[i] != 0)
+			return false;
+	}
+	return true;
+}
+
+// (1 + fAccumulatedInterest / nBlocks / nTermBlocks) ^ nBlocks
+static bool GetCompoundGrowth(const float fAccumulatedInterest, const int nBlocks, const int nTermBlocks, CInterestFixed& growth) {
+	CInterestFixed base;
+	if (nBlocks <= 0 || nTermBlocks <= 0 || !base.SetDouble(fAccumulatedInterest))
+		return false;
+	base.Divide(nBlocks);
+	base.Divide(nTermBlocks);
+	// a float is below 2^128 so adding one cannot carry out of the integer words
+	for (int i = CInterestFixed::FRACTION_WIDTH; i < CInterestFixed::WIDTH && ++base.pn[i] == 0; i++) {}
+
+	growth = CInterestFixed(1);
+	for (unsigned int nExponent = nBlocks; ; ) {
+		if (nExponent & 1) {
+			if (!growth.SetProduct(growth, base))
+				return false;
+		}
+		nExponent >>= 1;
+		if (nExponent == 0)
+			break;
+		if (!base.SetProduct(base, base))
+			return false;
+	}
+	return true;
+}
+// growth * balance - balance, false if the result is not certain to round like the decimal computation
+static bool ApplyCompoundGrowth(const double nAccumulatedBalance, const int nBlocks, const CInterestFixed& growth, CAmount& nInterest) {
+	CInterestFixed balance, interest;
+	if (!balance.SetDouble(nAccumulatedBalance))
+		return false;
+	balance.Divide(nBlocks);
+	// the error bound holds for balances within the range of CAmount
+	for (int i = CInterestFixed::FRACTION_WIDTH + 2; i < CInterestFixed::WIDTH; i++) {
+		if (balance.pn[i] != 0)
+			return false;
+	}
+	if (!interest.SetProduct(growth, balance) || !interest.Subtract(balance))
+		return false;
+	// the decimal computation saturates on interest beyond the range of CAmount
+	for (int i = CInterestFixed::FRACTION_WIDTH + 2; i < CInterestFixed::WIDTH; i++) {
+		if (interest.pn[i] != 0) {
+			nInterest = INT64_MAX;
+			return true;
+		}
+	}
+	const uint64_t nInteger = ((uint64_t)interest.pn[CInterestFixed::FRACTION_WIDTH + 1] << 32) | interest.pn[CInterestFixed::FRACTION_WIDTH];
+	// an error of up to 2^-60 could carry a result this close to a whole unit across it
+	const uint32_t nFractionHigh = interest.pn[CInterestFixed::FRACTION_WIDTH - 1];
+	if (nInteger > (uint64_t)INT64_MAX) {
+		nInterest = INT64_MAX;
+		return true;
+	}
+	if (nFractionHigh == 0 || nFractionHigh == 0xffffffff || nInteger == (uint64_t)INT64_MAX)
+		return false;
+	nInterest = (CAmount)nInteger;
+	return true;
+}
+
+CAmount GetCompoundInterest(const double nAccumulatedBalance, const float fAccumulatedInterest, const int nBlocks, const int nTermBlocks) {
+	CCompoundInterestBatch batch;
+	return batch.GetCompoundInterest(nAccumulatedBalance, fAccumulatedInterest, nBlocks, nTermBlocks);
+}
+CAmount GetCompoundInterestDecimal(const double nAccumulatedBalance, const float fAccumulatedInterest, const int nBlocks, const int nTermBlocks) {
+	const cpp_dec_float_50 &nInterestBlockTerm = cpp_dec_float_50(nTermBlocks);
+	const cpp_dec_float_50 &nBlockDifference = cpp_dec_float_50(nBlocks);
+
+	const cpp_dec_float_50& nBalanceOverTimeDifference = cpp_dec_float_50(nAccumulatedBalance / nBlockDifference);
+	const cpp_dec_float_50& fInterestOverTimeDifference = cpp_dec_float_50(fAccumulatedInterest / nBlockDifference);
+	const cpp_dec_float_50& nInterestPerBlock = fInterestOverTimeDifference / nInterestBlockTerm;
+	const cpp_dec_float_50& powcalc = (boost::multiprecision::pow(cpp_dec_float_50(1.0) + nInterestPerBlock, nBlockDifference)*nBalanceOverTimeDifference) - nBalanceOverTimeDifference;
+	return powcalc.convert_to<CAmount>();
+}
+
+CAmount CCompoundInterestBatch::GetCompoundInterest(const double nAccumulatedBalance, const float fAccumulatedInterest, const int nBlocks, const int nTermBlocks) {
+	// no growth or nothing to grow is exact in both computations
+	if (nBlocks > 0 && nTermBlocks > 0 && std::isfinite(nAccumulatedBalance) && std::isfinite(fAccumulatedInterest) && (nAccumulatedBalance == 0 || fAccumulatedInterest == 0))
+		return 0;
+	// rates that are not finite have no growth factor to share
+	if (!std::isfinite(fAccumulatedInterest))
+		return GetCompoundInterestDecimal(nAccumulatedBalance, fAccumulatedInterest, nBlocks, nTermBlocks);
+	uint32_t nInterestBits;
+	static_assert(sizeof(nInterestBits) == sizeof(fAccumulatedInterest), "float is not 32 bits");
+	memcpy(&nInterestBits, &fAccumulatedInterest, sizeof(nInterestBits));
+	const std::tuple<uint32_t, int, int> key(nInterestBits, nBlocks, nTermBlocks);
+	std::map<std::tuple<uint32_t, int, int>, std::pair<bool, CInterestFixed> >::iterator it = mapGrowth.find(key);
+	if (it == mapGrowth.end()) {
+		CInterestFixed growth;
+		const bool fGrowth = GetCompoundGrowth(fAccumulatedInterest, nBlocks, nTermBlocks, growth);
+		it = mapGrowth.insert(std::make_pair(key, std::make_pair(fGrowth, growth))).first;
+	}
+	CAmount nInterest;
+	if (it->second.first && ApplyCompoundGrowth(nAccumulatedBalance, nBlocks, it->second.second, nInterest))
+		return nInterest;
+	return GetCompoundInterestDecimal(nAccumulatedBalance, fAccumulatedInterest, nBlocks, nTermBlocks);
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef INTEREST_H
+#define INTEREST_H
+
+#include "amount.h"
+
+#include <map>
+#include <stdint.h>
+#include <tuple>
+
+/** Unsigned binary fixed point number with 160 integer and 160 fraction bits */
+class CInterestFixed
+{
+public:
+	static const int WIDTH = 10;
+	static const int FRACTION_WIDTH = 5;
+	// little endian 32 bit words, the low FRACTION_WIDTH words hold the fraction
+	uint32_t pn[WIDTH];
+
+	CInterestFixed();
+	explicit CInterestFixed(const uint32_t nInteger);
+
+	/** The exact value of d, false if d is negative, not finite or has bits outside of the representable range */
+	bool SetDouble(const double d);
+	/** Divide by n rounding towards zero */
+	void Divide(const uint32_t n);
+	/** Set to a * b rounding towards zero, false if the product does not fit */
+	bool SetProduct(const CInterestFixed& a, const CInterestFixed& b);
+	/** Subtract b, false if b is larger */
+	bool Subtract(const CInterestFixed& b);
+	bool IsZero() const;
+};
+
+/**
+ * Compound interest of an asset allocation since its last claim, the average
+ * balance nAccumulatedBalance / nBlocks grown by the average rate per term
+ * fAccumulatedInterest / nBlocks compounded every block:
+ *
+ *   (1 + rate / nTermBlocks) ^ nBlocks * balance - balance
+ *
+ * rounded towards zero. The growth is computed by exponentiation by squaring in
+ * binary fixed point, its error stays below 2^-60 of a coin unit over the range
+ * of CAmount. Results whose fraction lies within 2^-32 of a whole unit, or that
+ * fall outside of that range, are computed by GetCompoundInterestDecimal so that
+ * both always agree.
+ */
+CAmount GetCompoundInterest(const double nAccumulatedBalance, const float fAccumulatedInterest, const int nBlocks, const int nTermBlocks);
+/** The interest computed with 50 decimal digits, the results consensus was defined by */
+CAmount GetCompoundInterestDecimal(const double nAccumulatedBalance, const float fAccumulatedInterest, const int nBlocks, const int nTermBlocks);
+
+/**
+ * Computes the interest of many allocations at once. The allocations of an
+ * asset usually share their rate and claim period, those share one growth
+ * factor instead of exponentiating per allocation.
+ */
+class CCompoundInterestBatch
+{
+public:
+	CAmount GetCompoundInterest(const double nAccumulatedBalance, const float fAccumulatedInterest, const int nBlocks, const int nTermBlocks);
+
+private:
+	// growth factor by the bits of the accumulated interest, blocks and term, false if it has
+	// to be computed in decimal. Integer keys order every rate, floats would not order NaN
+	std::map<std::tuple<uint32_t, int, int>, std::pair<bool, CInterestFixed> > mapGrowth;
+};
+
+#endif // INTEREST_H
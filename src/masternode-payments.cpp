@@ -202,8 +202,9 @@ std::string GetRequiredPaymentsString(int nBlockHeight)
 void CMasternodePayments::Clear()
 {
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
-    mapMasternodeBlocks.clear();
+    ringMasternodeBlocks.clear();
     mapMasternodePaymentVotes.clear();
+    setRejectedPaymentVotes.clear();
 }
 
 bool CMasternodePayments::UpdateLastVote(const CMasternodePaymentVote& vote)
@@ -325,8 +326,15 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
 
         // Ignore any payments messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) return;
+        // Check the range first, votes are only remembered for heights in the window
+        int nFirstBlock = nCachedBlockHeight - GetStorageLimit();
+        if(vote.nBlockHeight < nFirstBlock || vote.nBlockHeight > nCachedBlockHeight+20) {
+            LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- vote out of range: nFirstBlock=%d, nBlockHeight=%d, nHeight=%d\n", nFirstBlock, vote.nBlockHeight, nCachedBlockHeight);
+            AddRejectedPaymentVote(nHash);
+            return;
+        }
 		{
-			LOCK(cs_mapMasternodePaymentVotes);
+			LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
 
 			auto res = mapMasternodePaymentVotes.emplace(nHash, vote);
 
@@ -337,15 +345,16 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
 				return;
 			}
 
+			if (res.second && !ringMasternodeBlocks.AddVoteHash(vote.nBlockHeight, nHash)) {
+				mapMasternodePaymentVotes.erase(res.first);
+				AddRejectedPaymentVote(nHash);
+				return;
+			}
+
 			// Mark vote as non-verified when it's seen for the first time,
 			// AddOrUpdatePaymentVote() below should take care of it if vote is actually ok
 			res.first->second.MarkAsNotVerified();
 		}
-        int nFirstBlock = nCachedBlockHeight - GetStorageLimit();
-        if(vote.nBlockHeight < nFirstBlock || vote.nBlockHeight > nCachedBlockHeight+20) {
-            LogPrint("mnpayments", "MASTERNODEPAYMENTVOTE -- vote out of range: nFirstBlock=%d, nBlockHeight=%d, nHeight=%d\n", nFirstBlock, vote.nBlockHeight, nCachedBlockHeight);
-            return;
-        }
 
         std::string strError = "";
         if(!vote.IsValid(pfrom, nCachedBlockHeight, strError, connman)) {
@@ -435,13 +444,13 @@ bool CMasternodePaymentVote::Sign()
 
 bool CMasternodePayments::GetBlockPayee(int nBlockHeight, CScript& payeeRet) const
 {
-    auto it = mapMasternodeBlocks.find(nBlockHeight);
-    return it != mapMasternodeBlocks.end() && it->second.GetBestPayee(payeeRet);
+    const CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Find(nBlockHeight);
+    return pblockPayees && pblockPayees->GetBestPayee(payeeRet);
 }
 bool CMasternodePayments::GetBlockPayee(int nBlockHeight, CScript& payeeRet, int &nStartHeightBlock) const
 {
-	auto it = mapMasternodeBlocks.find(nBlockHeight);
-	return it != mapMasternodeBlocks.end() && it->second.GetBestPayee(payeeRet, nStartHeightBlock);
+	const CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Find(nBlockHeight);
+	return pblockPayees && pblockPayees->GetBestPayee(payeeRet, nStartHeightBlock);
 }
 // Is this masternode scheduled to get paid soon?
 // -- Only look ahead up to 8 blocks to allow for propagation of the latest 2 blocks of votes
@@ -476,10 +485,17 @@ bool CMasternodePayments::AddOrUpdatePaymentVote(const CMasternodePaymentVote& v
 
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
 
-    mapMasternodePaymentVotes[nVoteHash] = vote;
+    CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Emplace(vote.nBlockHeight);
+    if (!pblockPayees) return false;
+
+    auto res = mapMasternodePaymentVotes.emplace(nVoteHash, vote);
+    if (res.second) {
+        ringMasternodeBlocks.AddVoteHash(vote.nBlockHeight, nVoteHash);
+    } else {
+        res.first->second = vote;
+    }
 
-    auto it = mapMasternodeBlocks.emplace(vote.nBlockHeight, CMasternodeBlockPayees(vote.nBlockHeight)).first;
-    it->second.AddPayee(vote);
+    pblockPayees->AddPayee(vote);
 
     LogPrint("mnpayments", "CMasternodePayments::AddOrUpdatePaymentVote -- added, hash=%s\n", nVoteHash.ToString());
 
@@ -493,6 +509,20 @@ bool CMasternodePayments::HasVerifiedPaymentVote(const uint256& hashIn) const
     return it != mapMasternodePaymentVotes.end() && it->second.IsVerified();
 }
 
+void CMasternodePayments::AddRejectedPaymentVote(const uint256& hashIn)
+{
+    LOCK(cs_mapMasternodePaymentVotes);
+    if (setRejectedPaymentVotes.size() >= MNPAYMENTS_REJECTED_VOTES_MAX)
+        setRejectedPaymentVotes.clear();
+    setRejectedPaymentVotes.insert(hashIn);
+}
+
+bool CMasternodePayments::HasPaymentVote(const uint256& hashIn) const
+{
+    LOCK(cs_mapMasternodePaymentVotes);
+    return mapMasternodePaymentVotes.count(hashIn) || setRejectedPaymentVotes.count(hashIn);
+}
+
 void CMasternodeBlockPayees::AddPayee(const CMasternodePaymentVote& vote)
 {
     LOCK(cs_vecPayees);
@@ -647,25 +677,137 @@ std::string CMasternodeBlockPayees::GetRequiredPaymentsString() const
     return strRequiredPayments;
 }
 
+CMasternodeBlocksRing::CMasternodeBlocksRing() :
+    vecSlots(MNPAYMENTS_RING_SIZE),
+    nMinHeight(0),
+    nFirstHeight(0),
+    nLastHeight(-1),
+    nSlotsUsed(0),
+    nBlocks(0)
+    {}
+
+void CMasternodeBlocksRing::Resize(size_t nSize)
+{
+    std::vector<CSlot> vecSlotsNew(nSize);
+    for (auto& slot : vecSlots) {
+        if (slot.nBlockHeight < 0) continue;
+        std::swap(vecSlotsNew[slot.nBlockHeight & (nSize - 1)], slot);
+    }
+    vecSlots.swap(vecSlotsNew);
+}
+
+CMasternodeBlocksRing::CSlot* CMasternodeBlocksRing::GetSlot(int nBlockHeight)
+{
+    if (nBlockHeight < nMinHeight) return NULL;
+
+    if (nSlotsUsed == 0) {
+        nFirstHeight = nLastHeight = nBlockHeight;
+    } else {
+        int nFirst = std::min(nFirstHeight, nBlockHeight);
+        int nLast = std::max(nLastHeight, nBlockHeight);
+        size_t nSize = vecSlots.size();
+        // keep the heights in use from wrapping around onto each other
+        while ((int64_t)nLast - nFirst >= (int64_t)nSize) {
+            if (nSize >= (size_t)MNPAYMENTS_RING_SIZE_MAX) {
+                LogPrint("mnpayments", "CMasternodeBlocksRing::GetSlot -- height %d too far from %d-%d\n", nBlockHeight, nFirstHeight, nLastHeight);
+                return NULL;
+            }
+            nSize *= 2;
+        }
+        if (nSize != vecSlots.size()) Resize(nSize);
+        nFirstHeight = nFirst;
+        nLastHeight = nLast;
+    }
+
+    CSlot& slot = At(nBlockHeight);
+    if (slot.nBlockHeight != nBlockHeight) {
+        assert(slot.nBlockHeight < 0);
+        slot.nBlockHeight = nBlockHeight;
+        nSlotsUsed++;
+    }
+    return &slot;
+}
+
+CMasternodeBlockPayees* CMasternodeBlocksRing::Find(int nBlockHeight)
+{
+    if (nSlotsUsed == 0 || nBlockHeight < nFirstHeight || nBlockHeight > nLastHeight) return NULL;
+    CSlot& slot = At(nBlockHeight);
+    return slot.nBlockHeight == nBlockHeight && slot.fPayees ? &slot.payees : NULL;
+}
+
+const CMasternodeBlockPayees* CMasternodeBlocksRing::Find(int nBlockHeight) const
+{
+    if (nSlotsUsed == 0 || nBlockHeight < nFirstHeight || nBlockHeight > nLastHeight) return NULL;
+    const CSlot& slot = At(nBlockHeight);
+    return slot.nBlockHeight == nBlockHeight && slot.fPayees ? &slot.payees : NULL;
+}
+
+CMasternodeBlockPayees* CMasternodeBlocksRing::Emplace(int nBlockHeight)
+{
+    CSlot* pslot = GetSlot(nBlockHeight);
+    if (!pslot) return NULL;
+    if (!pslot->fPayees) {
+        pslot->fPayees = true;
+        pslot->payees = CMasternodeBlockPayees(nBlockHeight);
+        nBlocks++;
+    }
+    return &pslot->payees;
+}
+
+bool CMasternodeBlocksRing::AddVoteHash(int nBlockHeight, const uint256& hash)
+{
+    CSlot* pslot = GetSlot(nBlockHeight);
+    if (!pslot) return false;
+    pslot->vecVoteHashes.push_back(hash);
+    return true;
+}
+
+void CMasternodeBlocksRing::EraseBelow(int nBlockHeight, std::vector<uint256>& vecVoteHashesRet)
+{
+    nMinHeight = std::max(nMinHeight, nBlockHeight);
+    if (nSlotsUsed == 0) return;
+
+    int nEnd = std::min(nBlockHeight, nLastHeight + 1);
+    for (int h = nFirstHeight; h < nEnd; h++) {
+        CSlot& slot = At(h);
+        if (slot.nBlockHeight != h) continue;
+        vecVoteHashesRet.insert(vecVoteHashesRet.end(), slot.vecVoteHashes.begin(), slot.vecVoteHashes.end());
+        if (slot.fPayees) nBlocks--;
+        slot = CSlot();
+        nSlotsUsed--;
+    }
+    nFirstHeight = std::max(nFirstHeight, nBlockHeight);
+}
+
+void CMasternodeBlocksRing::clear()
+{
+    std::vector<CSlot>(MNPAYMENTS_RING_SIZE).swap(vecSlots);
+    nMinHeight = 0;
+    nFirstHeight = 0;
+    nLastHeight = -1;
+    nSlotsUsed = 0;
+    nBlocks = 0;
+}
+
 std::string CMasternodePayments::GetRequiredPaymentsString(int nBlockHeight) const
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    const auto it = mapMasternodeBlocks.find(nBlockHeight);
-    return it == mapMasternodeBlocks.end() ? "Unknown" : it->second.GetRequiredPaymentsString();
+    const CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Find(nBlockHeight);
+    return pblockPayees ? pblockPayees->GetRequiredPaymentsString() : "Unknown";
 }
 
 bool CMasternodePayments::IsTransactionValid(const CTransaction& txNew, int nBlockHeight, const CAmount& fee, CAmount& nTotalRewardWithMasternodes) const
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    const auto it = mapMasternodeBlocks.find(nBlockHeight);
-	if (it == mapMasternodeBlocks.end()) {
+    const CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Find(nBlockHeight);
+	if (!pblockPayees) {
 		nTotalRewardWithMasternodes = txNew.GetValueOut();
 		return true;
 	}
 	else {
-		return it->second.IsTransactionValid(txNew, nBlockHeight, fee, nTotalRewardWithMasternodes);
+		return pblockPayees->IsTransactionValid(txNew, nBlockHeight, fee, nTotalRewardWithMasternodes);
 	}
 }
 
@@ -677,17 +819,14 @@ void CMasternodePayments::CheckAndRemove()
 
     int nLimit = GetStorageLimit();
 
-    std::map<uint256, CMasternodePaymentVote>::iterator it = mapMasternodePaymentVotes.begin();
-    while(it != mapMasternodePaymentVotes.end()) {
-        CMasternodePaymentVote vote = (*it).second;
-
-        if(nCachedBlockHeight - vote.nBlockHeight > nLimit) {
-            LogPrint("mnpayments", "CMasternodePayments::CheckAndRemove -- Removing old Masternode payment: nBlockHeight=%d\n", vote.nBlockHeight);
-            mapMasternodePaymentVotes.erase(it++);
-            mapMasternodeBlocks.erase(vote.nBlockHeight);
-        } else {
-            ++it;
-        }
+    // Only the heights that fell out of the window since the last time are visited
+    std::vector<uint256> vecVoteHashes;
+    ringMasternodeBlocks.EraseBelow(nCachedBlockHeight - nLimit, vecVoteHashes);
+    for (const auto& hash : vecVoteHashes) {
+        mapMasternodePaymentVotes.erase(hash);
+    }
+    if (!vecVoteHashes.empty()) {
+        LogPrint("mnpayments", "CMasternodePayments::CheckAndRemove -- Removed %d old Masternode payment votes below nBlockHeight=%d\n", vecVoteHashes.size(), nCachedBlockHeight - nLimit);
     }
     LogPrintf("CMasternodePayments::CheckAndRemove -- %s\n", ToString());
 }
@@ -835,9 +974,9 @@ void CMasternodePayments::CheckBlockVotes(int nBlockHeight)
         CScript payee;
         bool found = false;
 
-        const auto it = mapMasternodeBlocks.find(nBlockHeight);
-        if (it != mapMasternodeBlocks.end()) {
-            for (const auto& p : it->second.vecPayees) {
+        const CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Find(nBlockHeight);
+        if (pblockPayees) {
+            for (const auto& p : pblockPayees->vecPayees) {
                 for (const auto& voteHash : p.GetVoteHashes()) {
                     const auto itVote = mapMasternodePaymentVotes.find(voteHash);
                     if (itVote == mapMasternodePaymentVotes.end()) {
@@ -944,9 +1083,9 @@ void CMasternodePayments::Sync(CNode* pnode, CConnman& connman) const
     int nInvCount = 0;
 
     for(int h = nCachedBlockHeight; h < nCachedBlockHeight + 20; h++) {
-        const auto it = mapMasternodeBlocks.find(h);
-        if(it != mapMasternodeBlocks.end()) {
-            for (const auto& payee : it->second.vecPayees) {
+        const CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Find(h);
+        if(pblockPayees) {
+            for (const auto& payee : pblockPayees->vecPayees) {
                 std::vector<uint256> vecVoteHashes = payee.GetVoteHashes();
                 for (const auto& hash : vecVoteHashes) {
                     if(!HasVerifiedPaymentVote(hash)) continue;
@@ -976,8 +1115,7 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman& co
     const CBlockIndex *pindex = chainActive.Tip();
 
     while(nCachedBlockHeight - pindex->nHeight < nLimit) {
-        const auto it = mapMasternodeBlocks.find(pindex->nHeight);
-        if(it == mapMasternodeBlocks.end()) {
+        if(!ringMasternodeBlocks.Has(pindex->nHeight)) {
             // We have no idea about this block height, let's ask
             vToFetch.push_back(CInv(MSG_MASTERNODE_PAYMENT_BLOCK, pindex->GetBlockHash()));
             // We should not violate GETDATA rules
@@ -992,11 +1130,12 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman& co
         pindex = pindex->pprev;
     }
 
-    for (auto& mnBlockPayees : mapMasternodeBlocks) {
-        int nBlockHeight = mnBlockPayees.first;
+    for (int nBlockHeight = ringMasternodeBlocks.GetFirstHeight(); nBlockHeight <= ringMasternodeBlocks.GetLastHeight(); nBlockHeight++) {
+        const CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Find(nBlockHeight);
+        if (!pblockPayees) continue;
         int nTotalVotes = 0;
         bool fFound = false;
-        for (const auto& payee : mnBlockPayees.second.vecPayees) {
+        for (const auto& payee : pblockPayees->vecPayees) {
             if(payee.GetVoteCount() >= MNPAYMENTS_SIGNATURES_REQUIRED) {
                 fFound = true;
                 break;
@@ -1012,7 +1151,7 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman& co
         // DEBUG
         DBG (
             // Let's see why this failed
-            for (const auto& payee : mnBlockPayees.second.vecPayees) {
+            for (const auto& payee : pblockPayees->vecPayees) {
                 CTxDestination address1;
                 ExtractDestination(payee.GetPayee(), address1);
                 CBilliecoinAddress address2(address1);
@@ -1046,7 +1185,7 @@ std::string CMasternodePayments::ToString() const
     std::ostringstream info;
 
     info << "Votes: " << (int)mapMasternodePaymentVotes.size() <<
-            ", Blocks: " << (int)mapMasternodeBlocks.size();
+            ", Blocks: " << ringMasternodeBlocks.size();
 
     return info.str();
 }
@@ -11,8 +11,12 @@
 #include "key.h"
 #include "masternode.h"
 #include "net_processing.h"
+#include "txmempool.h"
 #include "utilstrencodings.h"
 
+#include <unordered_map>
+#include <unordered_set>
+
 class CMasternodePayments;
 class CMasternodePaymentVote;
 class CMasternodeBlockPayees;
@@ -20,6 +24,13 @@ class CMasternodeBlockPayees;
 static const int MNPAYMENTS_SIGNATURES_REQUIRED         = 6;
 static const int MNPAYMENTS_SIGNATURES_TOTAL            = 10;
 
+//! initial number of heights the payment blocks ring holds, above the minimum storage limit
+static const int MNPAYMENTS_RING_SIZE                   = 1 << 13;
+//! the ring stops growing at this many heights
+static const int MNPAYMENTS_RING_SIZE_MAX               = 1 << 20;
+//! out-of-range votes remembered so peers cannot resend them, forgotten all at once when full
+static const size_t MNPAYMENTS_REJECTED_VOTES_MAX       = 10000;
+
 //! minimum peer version that can receive and send masternode payment messages,
 //  vote for masternode and be elected as a payment winner
 // V1 - Last protocol version before update
@@ -29,7 +40,7 @@ static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_2 = MIN_PEER_PROTO_VERSION
 
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapMasternodeBlocks;
-extern CCriticalSection cs_mapMasternodePayeeVotes;
+extern CCriticalSection cs_mapMasternodePaymentVotes;
 
 extern CMasternodePayments mnpayments;
 
@@ -167,6 +178,67 @@ public:
     std::string ToString() const;
 };
 
+/**
+ * Payment blocks indexed by height in a window that slides up with the chain
+ *
+ * A height maps onto the slot at its value modulo the size of the ring, so a
+ * lookup is a mask and a compare, and neighbouring heights are next to each
+ * other in memory. The heights in use always span less than the ring, which
+ * doubles when a new height would not fit. Each slot also keeps the hashes of
+ * all votes seen for its height, verified or not, so that evicting a height
+ * hands back its votes without scanning them.
+ */
+class CMasternodeBlocksRing
+{
+private:
+    struct CSlot
+    {
+        // -1 while the slot is unused
+        int nBlockHeight;
+        // set once a vote for the height was accepted into payees
+        bool fPayees;
+        CMasternodeBlockPayees payees;
+        std::vector<uint256> vecVoteHashes;
+
+        CSlot() : nBlockHeight(-1), fPayees(false), payees(), vecVoteHashes() {}
+    };
+
+    std::vector<CSlot> vecSlots;
+    // heights below this one were evicted and are not taken anymore
+    int nMinHeight;
+    // all slots in use are for heights in [nFirstHeight, nLastHeight]
+    int nFirstHeight;
+    int nLastHeight;
+    int nSlotsUsed;
+    int nBlocks;
+
+    CSlot& At(int nBlockHeight) { return vecSlots[nBlockHeight & (vecSlots.size() - 1)]; }
+    const CSlot& At(int nBlockHeight) const { return vecSlots[nBlockHeight & (vecSlots.size() - 1)]; }
+    CSlot* GetSlot(int nBlockHeight);
+    void Resize(size_t nSize);
+
+public:
+    CMasternodeBlocksRing();
+
+    CMasternodeBlockPayees* Find(int nBlockHeight);
+    const CMasternodeBlockPayees* Find(int nBlockHeight) const;
+    bool Has(int nBlockHeight) const { return Find(nBlockHeight) != NULL; }
+
+    /// Payees of a height, added if missing. NULL for heights already evicted.
+    CMasternodeBlockPayees* Emplace(int nBlockHeight);
+    /// Remember a vote for a height, false for heights already evicted
+    bool AddVoteHash(int nBlockHeight, const uint256& hash);
+    /// Evict all heights below nBlockHeight, appending the hashes of their votes
+    void EraseBelow(int nBlockHeight, std::vector<uint256>& vecVoteHashesRet);
+
+    /// Heights to walk to visit every block, Find() tells which ones are known
+    int GetFirstHeight() const { return nSlotsUsed ? nFirstHeight : 0; }
+    int GetLastHeight() const { return nSlotsUsed ? nLastHeight : -1; }
+
+    int size() const { return nBlocks; }
+    void clear();
+};
+
 //
 // Masternode Payments Class
 // Keeps track of who should get paid for which blocks
@@ -184,25 +256,64 @@ private:
     int nCachedBlockHeight;
 
 public:
-    std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotes;
-    std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
+    std::unordered_map<uint256, CMasternodePaymentVote, SaltedTxidHasher> mapMasternodePaymentVotes;
+    CMasternodeBlocksRing ringMasternodeBlocks;
     std::map<COutPoint, int> mapMasternodesLastVote;
     std::map<COutPoint, int> mapMasternodesDidNotVote;
+    // hashes of votes rejected before they got a slot, counted as seen by AlreadyHave
+    std::unordered_set<uint256, SaltedTxidHasher> setRejectedPaymentVotes;
 
     CMasternodePayments() : nStorageCoeff(1.25), nMinBlocksToStore(5000) {}
 
-    ADD_SERIALIZE_METHODS;
+    // Same layout as the std::maps the votes and blocks used to be kept in
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+        WriteCompactSize(s, mapMasternodePaymentVotes.size());
+        for (const auto& pair : mapMasternodePaymentVotes) {
+            s << pair.first << pair.second;
+        }
+        WriteCompactSize(s, ringMasternodeBlocks.size());
+        for (int h = ringMasternodeBlocks.GetFirstHeight(); h <= ringMasternodeBlocks.GetLastHeight(); h++) {
+            const CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Find(h);
+            if (pblockPayees) {
+                s << h << *pblockPayees;
+            }
+        }
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(mapMasternodePaymentVotes);
-        READWRITE(mapMasternodeBlocks);
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+        Clear();
+        uint64_t nVotes = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nVotes; i++) {
+            uint256 hash;
+            CMasternodePaymentVote vote;
+            s >> hash >> vote;
+            if (ringMasternodeBlocks.AddVoteHash(vote.nBlockHeight, hash)) {
+                mapMasternodePaymentVotes.emplace(hash, vote);
+            }
+        }
+        uint64_t nBlocks = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nBlocks; i++) {
+            int nBlockHeight;
+            CMasternodeBlockPayees blockPayees;
+            s >> nBlockHeight >> blockPayees;
+            CMasternodeBlockPayees* pblockPayees = ringMasternodeBlocks.Emplace(nBlockHeight);
+            if (pblockPayees) {
+                *pblockPayees = blockPayees;
+            }
+        }
     }
 
     void Clear();
 
     bool AddOrUpdatePaymentVote(const CMasternodePaymentVote& vote);
     bool HasVerifiedPaymentVote(const uint256& hashIn) const;
+    void AddRejectedPaymentVote(const uint256& hashIn);
+    /** Whether the vote was seen, kept or rejected, so it need not be requested again */
+    bool HasPaymentVote(const uint256& hashIn) const;
     bool ProcessBlock(int nBlockHeight, CConnman& connman);
     void CheckBlockVotes(int nBlockHeight);
 
@@ -223,7 +334,7 @@ public:
     void FillBlockPayee(CMutableTransaction& txNew, int nBlockHeight, CAmount &blockReward, CAmount &fees,  CTxOut& txoutMasternodeRet) const;
     std::string ToString() const;
 
-    int GetBlockCount() const { return mapMasternodeBlocks.size(); }
+    int GetBlockCount() const { return ringMasternodeBlocks.size(); }
     int GetVoteCount() const { return mapMasternodePaymentVotes.size(); }
 
     bool IsEnoughData() const;
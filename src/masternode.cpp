@@ -325,12 +325,17 @@ void CMasternode::UpdateLastPaid(const CBlockIndex *pindex, int nMaxBlocksToScan
     CScript mnpayee = GetScriptForDestination(pubKeyCollateralAddress.GetID());
     // LogPrint("mnpayments", "CMasternode::UpdateLastPaidBlock -- searching for block with payment to %s\n", outpoint.ToStringShort());
 
-    LOCK(cs_mapMasternodeBlocks);
 	CMasternodePayee payee;
 	CAmount nTotal;
     for (int i = 0; BlockReading && BlockReading->nHeight > nBlockLastPaid && i < nMaxBlocksToScanBack; i++) {
-        if(mnpayments.mapMasternodeBlocks.count(BlockReading->nHeight) &&
-            mnpayments.mapMasternodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(mnpayee, 2, payee))
+        bool fHasPayee;
+        {
+            // the ring reallocates and resets its slots as votes come in and blocks get old
+            LOCK(cs_mapMasternodeBlocks);
+            const CMasternodeBlockPayees* pblockPayees = mnpayments.ringMasternodeBlocks.Find(BlockReading->nHeight);
+            fHasPayee = pblockPayees && pblockPayees->HasPayeeWithVotes(mnpayee, 2, payee);
+        }
+        if(fHasPayee)
         {
             CBlock block;
 			if (!ReadBlockFromDisk(block, BlockReading, Params().GetConsensus())) {
@@ -655,7 +660,7 @@ bool CMasternodeBroadcast::CheckSignature(int& nDos) const
     if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
         uint256 hash = GetSignatureHash();
 
-        if (!CHashSigner::VerifyHash(hash, pubKeyCollateralAddress, vchSig, strError)) {
+        if (!CHashSigner::VerifyHash(hash, pubKeyCollateralAddress.GetID(), vchSig, keyRecovered, strError)) {
             LogPrintf("CMasternodeBroadcast::CheckSignature -- Got bad Masternode announce signature, error: %s\n", strError);
             nDos = 100;
             return false;          
@@ -731,7 +736,7 @@ bool CMasternodePing::CheckSignature(const CPubKey& pubKeyMasternode, int &nDos)
     if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
         uint256 hash = GetSignatureHash();
 
-        if (!CHashSigner::VerifyHash(hash, pubKeyMasternode, vchSig, strError)) {
+        if (!CHashSigner::VerifyHash(hash, pubKeyMasternode.GetID(), vchSig, keyRecovered, strError)) {
             LogPrintf("CMasternodePing::CheckSignature -- Got bad Masternode ping signature, masternode=%s, error: %s\n", masternodeOutpoint.ToStringShort(), strError);
             nDos = 33;
             return false;
@@ -7,6 +7,7 @@
 #define MASTERNODE_H
 
 #include "key.h"
+#include "messagesigner.h"
 #include "validation.h"
 #include "spork.h"
 #include "clientversion.h"
@@ -43,6 +44,8 @@ public:
     // MSB is always 0, other 3 bits corresponds to x.x.x version scheme
     uint32_t nSentinelVersion{DEFAULT_SENTINEL_VERSION};
     uint32_t nDaemonVersion{DEFAULT_DAEMON_VERSION};
+    // key of vchSig recovered during list sync for CheckSignature, not serialized
+    CRecoveredHashKey keyRecovered{};
 
     CMasternodePing() = default;
 
@@ -319,6 +322,8 @@ class CMasternodeBroadcast : public CMasternode
 public:
 
     bool fRecovery;
+    // key of vchSig recovered during list sync for CheckSignature, not serialized
+    CRecoveredHashKey keyRecovered;
 
     CMasternodeBroadcast() : CMasternode(), fRecovery(false) {}
     CMasternodeBroadcast(const CMasternode& mn) : CMasternode(mn), fRecovery(false) {}
@@ -6,6 +6,7 @@
 #include "activemasternode.h"
 #include "addrman.h"
 #include "alert.h"
+#include "checkqueue.h"
 #include "clientversion.h"
 #include "init.h"
 #include "governance.h"
@@ -19,6 +20,7 @@
 #include "privatesend-client.h"
 #endif // ENABLE_WALLET
 #include "script/standard.h"
+#include "spork.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "warnings.h"
@@ -26,6 +28,30 @@
 /** Masternode manager */
 CMasternodeMan mnodeman;
 
+int nMasternodeSyncThreads = 0;
+
+static CCheckQueue<CMasternodeSyncCheck> masternodesynccheckqueue(32);
+
+bool CMasternodeSyncCheck::operator()()
+{
+    // bad signatures fail when the message is processed, keep checking the others
+    CHashSigner::RecoverHashKey(hash, *pvchSig, *pkeyRecovered);
+    return true;
+}
+
+void ThreadMasternodeSyncCheck()
+{
+    RenameThread("billiecoin-mnsync");
+    masternodesynccheckqueue.Thread();
+}
+
+void RunMasternodeSyncChecks(std::vector<CMasternodeSyncCheck>& vChecks)
+{
+    CCheckQueueControl<CMasternodeSyncCheck> control(&masternodesynccheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-7";
 const int CMasternodeMan::LAST_PAID_SCAN_BLOCKS = 100;
 
@@ -84,6 +110,7 @@ bool CMasternodeMan::Add(CMasternode &mn)
 
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapMasternodes[mn.outpoint] = mn;
+    InvalidateScoreCache();
     fMasternodesAdded = true;
     return true;
 }
@@ -201,6 +228,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                 // and finally remove it from the list
                 it->second.FlagGovernanceItemsAsDirty();
                 mapMasternodes.erase(it++);
+                InvalidateScoreCache();
                 fMasternodesRemoved = true;
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
@@ -357,6 +385,7 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    InvalidateScoreCache();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
@@ -561,14 +590,17 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
     //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
     //  -- (chance per block * chances before IsScheduled will fire)
+    // All candidates passed the protocol check, so the ranks at blockHash cover them
+    const CScoreCacheEntry* pscores = GetMasternodeScores(blockHash, mnpayments.GetMinMasternodePaymentsProto());
+    if (!pscores) return false;
     int nTenthNetwork = nMnCount/10;
     int nCountTenth = 0;
-    arith_uint256 nHighest = 0;
+    int nBestRank = 0;
     const CMasternode *pBestMasternode = NULL;
     for (const auto& s : vecMasternodeLastPaid) {
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
-        if(nScore > nHighest){
-            nHighest = nScore;
+        auto it = pscores->mapRanks.find(s.second->outpoint);
+        if(it != pscores->mapRanks.end() && (!pBestMasternode || it->second < nBestRank)) {
+            nBestRank = it->second;
             pBestMasternode = s.second;
         }
         nCountTenth++;
@@ -623,27 +655,48 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     return masternode_info_t();
 }
 
-bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeMan::score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol)
+const CMasternodeMan::CScoreCacheEntry* CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, int nMinProtocol)
 {
-    vecMasternodeScoresRet.clear();
-
-    if (!masternodeSync.IsMasternodeListSynced())
-        return false;
-
     AssertLockHeld(cs);
 
-    if (mapMasternodes.empty())
-        return false;
+    for (auto it = listScoreCache.begin(); it != listScoreCache.end(); ++it) {
+        if (it->nBlockHash == nBlockHash && it->nMinProtocol == nMinProtocol) {
+            listScoreCache.splice(listScoreCache.end(), listScoreCache, it);
+            return &listScoreCache.back();
+        }
+    }
+
+    CScoreCacheEntry entry;
+    entry.nBlockHash = nBlockHash;
+    entry.nMinProtocol = nMinProtocol;
 
     // calculate scores
+    entry.vecScores.reserve(mapMasternodes.size());
     for (const auto& mnpair : mapMasternodes) {
         if (mnpair.second.nProtocolVersion >= nMinProtocol) {
-            vecMasternodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
+            entry.vecScores.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
         }
     }
+    if (entry.vecScores.empty())
+        return NULL;
 
-    sort(vecMasternodeScoresRet.rbegin(), vecMasternodeScoresRet.rend(), CompareScoreMN());
-    return !vecMasternodeScoresRet.empty();
+    sort(entry.vecScores.rbegin(), entry.vecScores.rend(), CompareScoreMN());
+    entry.mapRanks.reserve(entry.vecScores.size());
+    int nRank = 0;
+    for (const auto& scorePair : entry.vecScores) {
+        entry.mapRanks.emplace(scorePair.second->outpoint, ++nRank);
+    }
+
+    if (listScoreCache.size() >= MAX_SCORE_CACHE_ENTRIES)
+        listScoreCache.pop_front();
+    listScoreCache.push_back(std::move(entry));
+    return &listScoreCache.back();
+}
+
+void CMasternodeMan::InvalidateScoreCache()
+{
+    AssertLockHeld(cs);
+    listScoreCache.clear();
 }
 
 bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
@@ -660,22 +713,28 @@ bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet,
         return false;
     }
 
+    return GetMasternodeRank(outpoint, nRankRet, nBlockHash, nMinProtocol);
+}
+
+bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, const uint256& nBlockHash, int nMinProtocol)
+{
+    nRankRet = -1;
+
+    if (!masternodeSync.IsMasternodeListSynced())
+        return false;
+
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    const CScoreCacheEntry* pscores = GetMasternodeScores(nBlockHash, nMinProtocol);
+    if (!pscores)
         return false;
 
-    int nRank = 0;
-    for (const auto& scorePair : vecMasternodeScores) {
-        nRank++;
-        if(scorePair.second->outpoint == outpoint) {
-            nRankRet = nRank;
-            return true;
-        }
-    }
+    auto it = pscores->mapRanks.find(outpoint);
+    if (it == pscores->mapRanks.end())
+        return false;
 
-    return false;
+    nRankRet = it->second;
+    return true;
 }
 
 bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight, int nMinProtocol)
@@ -694,12 +753,13 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    const CScoreCacheEntry* pscores = GetMasternodeScores(nBlockHash, nMinProtocol);
+    if (!pscores)
         return false;
 
+    vecMasternodeRanksRet.reserve(pscores->vecScores.size());
     int nRank = 0;
-    for (const auto& scorePair : vecMasternodeScores) {
+    for (const auto& scorePair : pscores->vecScores) {
         nRank++;
         vecMasternodeRanksRet.push_back(std::make_pair(nRank, *scorePair.second));
     }
@@ -805,62 +865,50 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         LogPrint("masternode", "MNANNOUNCE -- Masternode announce, masternode=%s\n", mnb.outpoint.ToStringShort());
 
-        int nDos = 0;
-
-        if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
-            // use announced Masternode as a peer
-            connman.AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2*60*60);
-        } else if(nDos > 0) {
-            Misbehaving(pfrom->GetId(), nDos);
+        if(nMasternodeSyncThreads && !masternodeSync.IsMasternodeListSynced()) {
+            // check the signatures of a whole batch at once while the list syncs
+            LOCK(cs_vecPendingSync);
+            CPendingSyncMessage msg;
+            msg.pfrom = pfrom->AddRef();
+            msg.fPing = false;
+            msg.mnb = mnb;
+            vecPendingSync.push_back(msg);
+            if(vecPendingSync.size() >= MAX_PENDING_SYNC_MESSAGES) {
+                ProcessPendingSyncMessages(connman);
+            }
+            return;
         }
 
-        if(fMasternodesAdded) {
-            NotifyMasternodeUpdates(connman);
-        }
+        // messages that were queued go first
+        ProcessPendingSyncMessages(connman);
+        ProcessBroadcast(pfrom, mnb, connman);
+
     } else if (strCommand == NetMsgType::MNPING) { //Masternode Ping
 
         CMasternodePing mnp;
         vRecv >> mnp;
 
-        uint256 nHash = mnp.GetHash();
-
-        pfrom->setAskFor.erase(nHash);
+        pfrom->setAskFor.erase(mnp.GetHash());
 
         if(!masternodeSync.IsBlockchainSynced()) return;
 
         LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s\n", mnp.masternodeOutpoint.ToStringShort());
 
-        // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
-        LOCK2(cs_main, cs);
-
-        if(mapSeenMasternodePing.count(nHash)) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
-
-        LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.masternodeOutpoint.ToStringShort());
-
-        // see if we have this Masternode
-        CMasternode* pmn = Find(mnp.masternodeOutpoint);
-
-        if(pmn && mnp.fSentinelIsCurrent)
-            UpdateLastSentinelPingTime();
-
-        // too late, new MNANNOUNCE is required
-        if(pmn && pmn->IsNewStartRequired()) return;
-
-        int nDos = 0;
-        if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
-
-        if(nDos > 0) {
-            // if anything significant failed, mark that node
-            Misbehaving(pfrom->GetId(), nDos);
-        } else if(pmn != NULL) {
-            // nothing significant failed, mn is a known one too
+        if(nMasternodeSyncThreads && !masternodeSync.IsMasternodeListSynced()) {
+            LOCK(cs_vecPendingSync);
+            CPendingSyncMessage msg;
+            msg.pfrom = pfrom->AddRef();
+            msg.fPing = true;
+            msg.mnp = mnp;
+            vecPendingSync.push_back(msg);
+            if(vecPendingSync.size() >= MAX_PENDING_SYNC_MESSAGES) {
+                ProcessPendingSyncMessages(connman);
+            }
             return;
         }
 
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.masternodeOutpoint, connman);
+        ProcessPendingSyncMessages(connman);
+        ProcessPing(pfrom, mnp, connman);
 
     } else if (strCommand == NetMsgType::DSEG) { //Get Masternode list or specific entry
         // Ignore such requests until we are fully synced.
@@ -1437,6 +1485,110 @@ std::string CMasternodeMan::ToString() const
     return info.str();
 }
 
+void CMasternodeMan::ProcessBroadcast(CNode* pfrom, const CMasternodeBroadcast& mnb, CConnman& connman)
+{
+    int nDos = 0;
+
+    if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
+        // use announced Masternode as a peer
+        connman.AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2*60*60);
+    } else if(nDos > 0) {
+        Misbehaving(pfrom->GetId(), nDos);
+    }
+
+    if(fMasternodesAdded) {
+        NotifyMasternodeUpdates(connman);
+    }
+}
+
+void CMasternodeMan::ProcessPing(CNode* pfrom, CMasternodePing mnp, CConnman& connman)
+{
+    uint256 nHash = mnp.GetHash();
+
+    // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
+    LOCK2(cs_main, cs);
+
+    if(mapSeenMasternodePing.count(nHash)) return; //seen
+    mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+
+    LogPrint("masternode", "MNPING -- Masternode ping, masternode=%s new\n", mnp.masternodeOutpoint.ToStringShort());
+
+    // see if we have this Masternode
+    CMasternode* pmn = Find(mnp.masternodeOutpoint);
+
+    if(pmn && mnp.fSentinelIsCurrent)
+        UpdateLastSentinelPingTime();
+
+    // too late, new MNANNOUNCE is required
+    if(pmn && pmn->IsNewStartRequired()) return;
+
+    int nDos = 0;
+    if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
+
+    if(nDos > 0) {
+        // if anything significant failed, mark that node
+        Misbehaving(pfrom->GetId(), nDos);
+    } else if(pmn != NULL) {
+        // nothing significant failed, mn is a known one too
+        return;
+    }
+
+    // something significant is broken or mn is unknown,
+    // we might have to ask for a masternode entry once
+    AskForMN(pfrom, mnp.masternodeOutpoint, connman);
+}
+
+void CMasternodeMan::ProcessPendingSyncMessages(CConnman& connman)
+{
+    LOCK(cs_vecPendingSync);
+    if(vecPendingSync.empty()) return;
+
+    int64_t nTimeStart = GetTimeMicros();
+
+    if(sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
+        // recover the keys of all signatures on the worker threads into the messages,
+        // the checks below then only compare them
+        std::vector<CMasternodeSyncCheck> vChecks;
+        vChecks.reserve(vecPendingSync.size() * 2);
+        for (auto& msg : vecPendingSync) {
+            if(msg.fPing) {
+                vChecks.push_back(CMasternodeSyncCheck(msg.mnp.GetSignatureHash(), msg.mnp.vchSig, msg.mnp.keyRecovered));
+            } else {
+                vChecks.push_back(CMasternodeSyncCheck(msg.mnb.GetSignatureHash(), msg.mnb.vchSig, msg.mnb.keyRecovered));
+                if(msg.mnb.lastPing) {
+                    vChecks.push_back(CMasternodeSyncCheck(msg.mnb.lastPing.GetSignatureHash(), msg.mnb.lastPing.vchSig, msg.mnb.lastPing.keyRecovered));
+                }
+            }
+        }
+        RunMasternodeSyncChecks(vChecks);
+    }
+
+    int64_t nTimeChecked = GetTimeMicros();
+
+    for (const auto& msg : vecPendingSync) {
+        if(msg.fPing) {
+            ProcessPing(msg.pfrom, msg.mnp, connman);
+        } else {
+            ProcessBroadcast(msg.pfrom, msg.mnb, connman);
+        }
+        msg.pfrom->Release();
+    }
+
+    LogPrint("masternode", "CMasternodeMan::ProcessPendingSyncMessages -- %u messages, signatures %.2fms, processing %.2fms\n",
+             vecPendingSync.size(), (nTimeChecked - nTimeStart) * 0.001, (GetTimeMicros() - nTimeChecked) * 0.001);
+
+    vecPendingSync.clear();
+}
+
+void CMasternodeMan::ReleasePendingSyncMessages()
+{
+    LOCK(cs_vecPendingSync);
+    for (const auto& msg : vecPendingSync) {
+        msg.pfrom->Release();
+    }
+    vecPendingSync.clear();
+}
+
 bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBroadcast mnb, int& nDos, CConnman& connman)
 {
     // Need to lock cs_main here to ensure consistent locking order because the SimpleCheck call below locks cs_main
@@ -1492,6 +1644,8 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         CMasternode* pmn = Find(mnb.outpoint);
         if(pmn) {
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
+            // the update may change the protocol version the scores are filtered by
+            InvalidateScoreCache();
             if(!mnb.Update(pmn, nDos, connman)) {
                 LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.outpoint.ToStringShort());
                 return false;
@@ -1708,9 +1862,17 @@ void CMasternodeMan::DoMaintenance(CConnman& connman)
 {
     if(fLiteMode) return; // disable all Billiecoin specific functionality
 
-    if(!masternodeSync.IsBlockchainSynced() || ShutdownRequested())
+    if(ShutdownRequested()) {
+        ReleasePendingSyncMessages();
+        return;
+    }
+
+    if(!masternodeSync.IsBlockchainSynced())
         return;
 
+    // don't let the last messages of the list wait for a batch to fill up
+    ProcessPendingSyncMessages(connman);
+
     static unsigned int nTick = 0;
 
     nTick++;
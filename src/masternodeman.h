@@ -12,7 +12,44 @@
 class CMasternodeMan;
 class CConnman;
 
+/** Most threads checking masternode signatures during list sync */
+static const int MAX_MASTERNODE_SYNC_THREADS = 16;
+/** -masternodesyncthreads default (0 = auto) */
+static const int DEFAULT_MASTERNODE_SYNC_THREADS = 0;
+
 extern CMasternodeMan mnodeman;
+extern int nMasternodeSyncThreads;
+
+/**
+ * Recovers the key of one masternode message signature ahead of time into the
+ * message, for the CheckSignature call that checks it when it is processed
+ */
+class CMasternodeSyncCheck
+{
+private:
+    uint256 hash;
+    const std::vector<unsigned char>* pvchSig;
+    CRecoveredHashKey* pkeyRecovered;
+
+public:
+    CMasternodeSyncCheck() : pvchSig(NULL), pkeyRecovered(NULL) {}
+    CMasternodeSyncCheck(const uint256& hashIn, const std::vector<unsigned char>& vchSigIn, CRecoveredHashKey& keyRecoveredIn) :
+        hash(hashIn), pvchSig(&vchSigIn), pkeyRecovered(&keyRecoveredIn) {}
+
+    bool operator()();
+
+    void swap(CMasternodeSyncCheck& check)
+    {
+        std::swap(hash, check.hash);
+        std::swap(pvchSig, check.pvchSig);
+        std::swap(pkeyRecovered, check.pkeyRecovered);
+    }
+};
+
+/** Worker joining the signature checks of masternode messages queued during list sync */
+void ThreadMasternodeSyncCheck();
+/** Run the checks on the ThreadMasternodeSyncCheck workers and the calling thread */
+void RunMasternodeSyncChecks(std::vector<CMasternodeSyncCheck>& vChecks);
 
 class CMasternodeMan
 {
@@ -40,6 +77,20 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    static const size_t MAX_SCORE_CACHE_ENTRIES     = 16;
+
+    static const size_t MAX_PENDING_SYNC_MESSAGES   = 512;
+
+    /// Masternodes sorted by their score at one block hash, highest first
+    struct CScoreCacheEntry
+    {
+        uint256 nBlockHash;
+        int nMinProtocol;
+        score_pair_vec_t vecScores;
+        // rank of each masternode in vecScores, starting at 1
+        std::unordered_map<COutPoint, int, SaltedOutpointHasher> mapRanks;
+    };
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -75,19 +126,43 @@ private:
 
     std::vector<uint256> vecDirtyGovernanceObjectHashes;
 
+    /// Scores at the block hashes asked for recently, most recently used last.
+    /// Holds pointers into mapMasternodes, so it is cleared whenever an entry
+    /// is added or removed or a protocol version changes.
+    std::list<CScoreCacheEntry> listScoreCache;
+
     int64_t nLastSentinelPingTime;
 
+    /// Broadcast or ping received while the list syncs, waiting for its signature check
+    struct CPendingSyncMessage
+    {
+        // referenced until the message is processed
+        CNode* pfrom;
+        bool fPing;
+        CMasternodeBroadcast mnb;
+        CMasternodePing mnp;
+    };
+
+    /// Messages in the order they arrived in, see ProcessPendingSyncMessages
+    std::vector<CPendingSyncMessage> vecPendingSync;
+    CCriticalSection cs_vecPendingSync;
+
     friend class CMasternodeSync;
     /// Find an entry
     CMasternode* Find(const COutPoint& outpoint);
 
-    bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
+    /// Scores at a block hash from the cache, computing them if missing, NULL if no masternode qualifies
+    const CScoreCacheEntry* GetMasternodeScores(const uint256& nBlockHash, int nMinProtocol = 0);
+    void InvalidateScoreCache();
 
     void SyncSingle(CNode* pnode, const COutPoint& outpoint, CConnman& connman);
     void SyncAll(CNode* pnode, CConnman& connman);
 
     void PushDsegInvs(CNode* pnode, const CMasternode& mn);
 
+    void ProcessBroadcast(CNode* pfrom, const CMasternodeBroadcast& mnb, CConnman& connman);
+    void ProcessPing(CNode* pfrom, CMasternodePing mnp, CConnman& connman);
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
@@ -107,6 +182,7 @@ public:
         std::string strVersion;
         if(ser_action.ForRead()) {
             READWRITE(strVersion);
+            InvalidateScoreCache();
         }
         else {
             strVersion = SERIALIZATION_VERSION_STRING; 
@@ -185,6 +261,8 @@ public:
 
     bool GetMasternodeRanks(rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0);
     bool GetMasternodeRank(const COutPoint &outpoint, int& nRankRet, int nBlockHeight = -1, int nMinProtocol = 0);
+    /// Rank at a block hash, fails like the above until the list is synced
+    bool GetMasternodeRank(const COutPoint &outpoint, int& nRankRet, const uint256& nBlockHash, int nMinProtocol = 0);
 
     void ProcessMasternodeConnections(CConnman& connman);
     std::pair<CService, std::set<uint256> > PopScheduledMnbRequestConnection();
@@ -192,6 +270,15 @@ public:
 
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
+    /**
+     * Check the signatures of the broadcasts and pings queued during list sync
+     * on nMasternodeSyncThreads threads, then process the messages one by one
+     * in the order they arrived in.
+     */
+    void ProcessPendingSyncMessages(CConnman& connman);
+    /// Drop the queued messages unprocessed and release their peers, on shutdown
+    void ReleasePendingSyncMessages();
+
     void DoFullVerificationStep(CConnman& connman);
     void CheckSameAddr();
     bool CheckVerifyRequestAddr(const CAddress& addr, CConnman& connman);
@@ -19,6 +19,8 @@
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 
+class uint256;
+
 namespace memusage
 {
 
@@ -36,6 +38,7 @@ static inline size_t DynamicUsage(const int64_t& v) { return 0; }
 static inline size_t DynamicUsage(const uint64_t& v) { return 0; }
 static inline size_t DynamicUsage(const float& v) { return 0; }
 static inline size_t DynamicUsage(const double& v) { return 0; }
+static inline size_t DynamicUsage(const uint256& v) { return 0; }
 template<typename X> static inline size_t DynamicUsage(X * const &v) { return 0; }
 template<typename X> static inline size_t DynamicUsage(const X * const &v) { return 0; }
 
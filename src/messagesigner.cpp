@@ -10,6 +10,26 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 
+static uint256 GetRecoveredKeyHash(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << hash << vchSig;
+    return ss.GetHash();
+}
+
+void CRecoveredHashKey::Set(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyIDIn)
+{
+    nSigHash = GetRecoveredKeyHash(hash, vchSig);
+    keyID = keyIDIn;
+}
+
+bool CRecoveredHashKey::Get(const uint256& hash, const std::vector<unsigned char>& vchSig, CKeyID& keyIDRet) const
+{
+    if(nSigHash.IsNull() || nSigHash != GetRecoveredKeyHash(hash, vchSig)) return false;
+    keyIDRet = keyID;
+    return true;
+}
+
 bool CMessageSigner::GetKeysFromSecret(const std::string& strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     CBilliecoinSecret vchSecret;
@@ -57,18 +77,36 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey& pubkey, const s
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
-    CPubKey pubkeyFromSig;
-    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
-        strErrorRet = "Error recovering public key.";
-        return false;
+    return VerifyHash(hash, keyID, vchSig, CRecoveredHashKey(), strErrorRet);
+}
+
+bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, const CRecoveredHashKey& keyRecovered, std::string& strErrorRet)
+{
+    CKeyID keyIDFromSig;
+    if(!keyRecovered.Get(hash, vchSig, keyIDFromSig)) {
+        CPubKey pubkeyFromSig;
+        if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+            strErrorRet = "Error recovering public key.";
+            return false;
+        }
+        keyIDFromSig = pubkeyFromSig.GetID();
     }
 
-    if(pubkeyFromSig.GetID() != keyID) {
+    if(keyIDFromSig != keyID) {
         strErrorRet = strprintf("Keys don't match: pubkey=%s, pubkeyFromSig=%s, signaturehash=%s, vchSig=%s",
-                    keyID.ToString(), pubkeyFromSig.GetID().ToString(), hash.ToString(),
+                    keyID.ToString(), keyIDFromSig.ToString(), hash.ToString(),
                     EncodeBase64(&vchSig[0], vchSig.size()));
         return false;
     }
 
     return true;
 }
+
+bool CHashSigner::RecoverHashKey(const uint256& hash, const std::vector<unsigned char>& vchSig, CRecoveredHashKey& keyRet)
+{
+    // signatures that do not recover are left for VerifyHash to report
+    CPubKey pubkeyFromSig;
+    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) return false;
+    keyRet.Set(hash, vchSig, pubkeyFromSig.GetID());
+    return true;
+}
@@ -8,6 +8,23 @@
 
 #include "key.h"
 
+/**
+ * Key recovered from a hash signature ahead of its check, see CHashSigner::RecoverHashKey.
+ * Travels with the message the signature belongs to.
+ */
+class CRecoveredHashKey
+{
+private:
+    // hash of the signed hash and the signature the key was recovered from
+    uint256 nSigHash;
+    CKeyID keyID;
+
+public:
+    void Set(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyIDIn);
+    /// Get the key if it was recovered from this hash and signature
+    bool Get(const uint256& hash, const std::vector<unsigned char>& vchSig, CKeyID& keyIDRet) const;
+};
+
 /** Helper class for signing messages and checking their signatures
  */
 class CMessageSigner
@@ -34,6 +51,11 @@ public:
     static bool VerifyHash(const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
     /// Verify the hash signature, returns true if succcessful
     static bool VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
+    /// Verify the hash signature against a key recovered ahead of time, recovers it if keyRecovered is not for this signature
+    static bool VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, const CRecoveredHashKey& keyRecovered, std::string& strErrorRet);
+    /// Recover the key of a hash signature ahead of VerifyHash, which then only has to compare it.
+    /// Safe to call from several threads at once.
+    static bool RecoverHashKey(const uint256& hash, const std::vector<unsigned char>& vchSig, CRecoveredHashKey& keyRet);
 };
 
 #endif
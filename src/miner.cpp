@@ -189,7 +189,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
     pblocktemplate->vTxFees[0] = -nFees;
 
-	if (!OrderBasedOnArrivalTime(nHeight, pblock->vtx))
+	if (!OrderBasedOnArrivalTime(mempool, pblock->vtx))
 	{
 		throw std::runtime_error("OrderBasedOnArrivalTime failed!");
 	}
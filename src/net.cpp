@@ -24,6 +24,7 @@
 #include "scheduler.h"
 #include "ui_interface.h"
 #include "utilstrencodings.h"
+#include "validation.h"
 
 #include "instantx.h"
 #include "masternode-sync.h"
@@ -1229,8 +1230,10 @@ void CConnman::ThreadSocketHandler()
                 //   receiving data.
                 // * Hand off all complete messages to the processor, to be handled without
                 //   blocking here.
+                // * Don't read from a peer whose transactions are still queued for mempool
+                //   validation beyond its share of the validation threadpool.
 
-                bool select_recv = !pnode->fPauseRecv;
+                bool select_recv = !pnode->fPauseRecv && !(threadpool && threadpool->IsPeerPaused(pnode->GetId()));
                 bool select_send;
                 {
                     LOCK(pnode->cs_vSend);
@@ -17,6 +17,8 @@
 #include "consensus/validation.h"
 #include "chainparams.h"
 #include "wallet/coincontrol.h"
+#include "serviceevent.h"
+#include "servicepayload.h"
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/lexical_cast.hpp>
 #include <boost/foreach.hpp>
@@ -182,28 +184,20 @@ void COffer::Serialize(vector<unsigned char> &vchData) {
     dsOffer << *this;
 	vchData = vector<unsigned char>(dsOffer.begin(), dsOffer.end());
 }
-bool COfferDB::CleanupDatabase(int &servicesCleaned)
+bool COfferDB::CleanupDatabase(const vector<unsigned char>& vchAlias, int &servicesCleaned)
 {
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
-	COffer offer;
-	pair<string, vector<unsigned char> > keyTuple;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
-			if (pcursor->GetKey(keyTuple) && keyTuple.first == "offeri") {
-  				if (!GetOffer(keyTuple.second, offer) || chainActive.Tip()->GetMedianTimePast() >= GetOfferExpiration(offer))
-				{
-					servicesCleaned++;
-					EraseOffer(keyTuple.second, true);
-				} 
-				
-            }
-            pcursor->Next();
-        } catch (std::exception &e) {
-            return error("%s() : deserialize error", __PRETTY_FUNCTION__);
-        }
-    }
+	vector<vector<unsigned char> > vchOffers;
+	if (!serviceIndex.GetOwned(vchAlias, vchOffers))
+		return false;
+	COffer txPos;
+	for (const vector<unsigned char>& vchOffer : vchOffers) {
+		if (!GetOffer(vchOffer, txPos) || chainActive.Tip()->GetMedianTimePast() >= GetOfferExpiration(txPos))
+		{
+			servicesCleaned++;
+			if (!EraseOffer(vchOffer, true))
+				return false;
+		}
+	}
 	return true;
 }
 
@@ -328,7 +322,9 @@ bool RevertOffer(const std::vector<unsigned char>& vchOffer, const int op, const
 	return true;
 
 }
-bool CheckOfferInputs(const CTransaction &tx, int op, const vector<vector<unsigned char> > &vvchArgs, const std::vector<unsigned char> &vvchAlias, bool fJustCheck, int nHeight, sorted_vector<std::vector<unsigned char> > &revertedOffers, string &errorMessage, bool bSanityCheck) {
+bool CheckOfferInputs(const CTransaction &tx, const CServicePayload &payload, const std::vector<unsigned char> &vvchAlias, bool fJustCheck, int nHeight, sorted_vector<std::vector<unsigned char> > &revertedOffers, string &errorMessage, bool bSanityCheck) {
+	const int op = payload.nOp;
+	const CServiceArgs &vvchArgs = payload.vvchArgs;
 	if (!pofferdb || !paliasdb)
 		return false;
 	if (tx.IsCoinBase() && !fJustCheck && !bSanityCheck)
@@ -341,17 +337,15 @@ bool CheckOfferInputs(const CTransaction &tx, int op, const vector<vector<unsign
 		LogPrintf("*** OFFER %d %d %s %s %s %d\n", nHeight,
 			chainActive.Tip()->nHeight, tx.GetHash().ToString().c_str(),
 			fJustCheck ? "JUSTCHECK" : "BLOCK", " VVCH SIZE: ", vvchArgs.size());
-	// unserialize msg from txn, check for valid
-	COffer theOffer;
-	vector<unsigned char> vchData;
-	vector<unsigned char> vchHash;
+	// the offer was unserialized from the txn with the payload, check for valid
+	const vector<unsigned char> &vchHash = payload.vchDataHash;
 	CTxDestination payDest, commissionDest, dest, aliasDest;
-	int nDataOut;
-	if(!GetBilliecoinData(tx, vchData, vchHash, nDataOut) || !theOffer.UnserializeFromData(vchData, vchHash))
+	if(!payload.offer)
 	{
 		errorMessage = "BILLIECOIN_OFFER_CONSENSUS_ERROR ERRCODE: 1000 - " + _("Cannot unserialize data inside of this transaction relating to an offer");
 		return true;
 	}
+	COffer theOffer(*payload.offer);
 
 	if(fJustCheck)
 	{
@@ -1158,22 +1152,13 @@ UniValue offerupdate(const JSONRPCRequest& request) {
 }
 
 void COfferDB::WriteOfferIndex(const COffer& offer, const int &op) {
-	if (IsArgSet("-zmqpubofferrecord")) {
-		UniValue oName(UniValue::VOBJ);
-		if (BuildOfferIndexerJson(offer, oName)) {
-			GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "offerrecord");
-		}
-	}
+	if (IsArgSet("-zmqpubofferrecord"))
+		PublishServiceEvent("offerrecord", offer);
 	WriteOfferIndexHistory(offer, op);
 }
 void COfferDB::WriteOfferIndexHistory(const COffer& offer, const int &op) {
-	if (IsArgSet("-zmqpubofferhistory")) {
-		UniValue oName(UniValue::VOBJ);
-		if (BuildOfferIndexerHistoryJson(offer, oName)) {
-			oName.push_back(Pair("op", offerFromOp(op)));
-			GetMainSignals().NotifyBilliecoinUpdate(oName.write().c_str(), "offerhistory");
-		}
-	}
+	if (IsArgSet("-zmqpubofferhistory"))
+		PublishServiceEvent("offerhistory", offer, (unsigned char)op);
 }
 UniValue offerinfo(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
@@ -1268,99 +1253,6 @@ bool BuildOfferJson(const COffer& theOffer, UniValue& oOffer)
 
 	return true;
 }
-bool BuildOfferIndexerJson(const COffer& theOffer, UniValue& oOffer)
-{
-	COffer linkOffer;
-	if (!theOffer.vchLinkOffer.empty())
-	{
-		if (!GetOffer(theOffer.vchLinkOffer, linkOffer))
-			return false;
-	}
-	vector<unsigned char> vchCert;
-	if (!theOffer.vchCert.empty())
-		vchCert = theOffer.vchCert;
-	oOffer.push_back(Pair("_id", stringFromVch(theOffer.vchOffer)));
-	oOffer.push_back(Pair("cert", stringFromVch(vchCert)));
-	oOffer.push_back(Pair("height", (int)theOffer.nHeight));
-	oOffer.push_back(Pair("category", stringFromVch(theOffer.sCategory)));
-	oOffer.push_back(Pair("title", stringFromVch(theOffer.sTitle)));
-	int nQty = theOffer.nQty;
-	string offerTypeStr = "";
-	CAuctionOffer auctionOffer;
-	if (IsOfferTypeInMask(theOffer.offerType, OFFERTYPE_AUCTION))
-		auctionOffer = theOffer.auctionOffer;
-	if (!theOffer.vchLinkOffer.empty()) {
-		oOffer.push_back(Pair("currency", stringFromVch(linkOffer.sCurrencyCode)));
-		oOffer.push_back(Pair("price", linkOffer.GetPrice(theOffer.nCommission)));
-		oOffer.push_back(Pair("paymentoptions", GetPaymentOptionsString(linkOffer.paymentOptions)));
-		oOffer.push_back(Pair("offer_units", linkOffer.fUnits));
-		nQty = linkOffer.nQty;
-		offerTypeStr = GetOfferTypeString(linkOffer.offerType);
-		if (IsOfferTypeInMask(linkOffer.offerType, OFFERTYPE_AUCTION))
-			auctionOffer = linkOffer.auctionOffer;
-	}
-	else
-	{
-		oOffer.push_back(Pair("currency", stringFromVch(theOffer.sCurrencyCode)));
-		oOffer.push_back(Pair("price", theOffer.GetPrice()));
-		oOffer.push_back(Pair("paymentoptions", GetPaymentOptionsString(theOffer.paymentOptions)));
-		oOffer.push_back(Pair("offer_units", theOffer.fUnits));
-		offerTypeStr = GetOfferTypeString(theOffer.offerType);
-	}
-	oOffer.push_back(Pair("quantity", nQty));
-	oOffer.push_back(Pair("private", theOffer.bPrivate));
-	oOffer.push_back(Pair("description", stringFromVch(theOffer.sDescription)));
-	oOffer.push_back(Pair("alias", stringFromVch(theOffer.vchAlias)));
-	oOffer.push_back(Pair("offertype", offerTypeStr));
-	oOffer.push_back(Pair("auction_expires_on", auctionOffer.nExpireTime));
-	oOffer.push_back(Pair("auction_reserve_price", auctionOffer.fReservePrice));
-	return true;
-}
-bool BuildOfferIndexerHistoryJson(const COffer& theOffer, UniValue& oOffer)
-{
-	vector<unsigned char> vchCert;
-	if (!theOffer.vchCert.empty())
-		vchCert = theOffer.vchCert;
-	oOffer.push_back(Pair("_id", theOffer.txHash.GetHex()));
-	oOffer.push_back(Pair("offer", stringFromVch(theOffer.vchOffer)));
-	oOffer.push_back(Pair("cert", stringFromVch(vchCert)));
-	oOffer.push_back(Pair("height", (int)theOffer.nHeight));
-	oOffer.push_back(Pair("category", stringFromVch(theOffer.sCategory)));
-	oOffer.push_back(Pair("title", stringFromVch(theOffer.sTitle)));
-	int nQty = theOffer.nQty;
-	string offerTypeStr = "";
-	CAuctionOffer auctionOffer;
-	if (IsOfferTypeInMask(theOffer.offerType, OFFERTYPE_AUCTION))
-		auctionOffer = theOffer.auctionOffer;
-	if (!theOffer.vchLinkOffer.empty()) {
-		oOffer.push_back(Pair("currency", ""));
-		oOffer.push_back(Pair("price", 0));
-		oOffer.push_back(Pair("commission", theOffer.nCommission));
-		oOffer.push_back(Pair("paymentoptions", ""));
-		nQty = 0;
-		offerTypeStr = "";
-		auctionOffer.SetNull();
-	}
-	else
-	{
-		oOffer.push_back(Pair("currency", stringFromVch(theOffer.sCurrencyCode)));
-		oOffer.push_back(Pair("price", theOffer.GetPrice()));
-		oOffer.push_back(Pair("commission", 0));
-		oOffer.push_back(Pair("paymentoptions", GetPaymentOptionsString(theOffer.paymentOptions)));
-		offerTypeStr = GetOfferTypeString(theOffer.offerType);
-	}
-
-	oOffer.push_back(Pair("quantity", nQty));
-	oOffer.push_back(Pair("private", theOffer.bPrivate));
-	oOffer.push_back(Pair("description", stringFromVch(theOffer.sDescription)));
-	oOffer.push_back(Pair("alias", stringFromVch(theOffer.vchAlias)));
-	oOffer.push_back(Pair("offertype", offerTypeStr));
-	oOffer.push_back(Pair("auction_expires_on", auctionOffer.nExpireTime));
-	oOffer.push_back(Pair("auction_reserve_price", auctionOffer.fReservePrice));
-	oOffer.push_back(Pair("auction_require_witness", auctionOffer.bRequireWitness));
-	oOffer.push_back(Pair("auction_deposit", auctionOffer.fDepositPercentage));
-	return true;
-}
 std::string GetOfferTypeString(const uint32_t &offerType)
 {
 	vector<std::string> types;
@@ -1454,81 +1346,38 @@ float COffer::GetPrice(const int commission) const {
 		price += price*((float)comm / 100.0f);
 	return price;
 }
-bool COfferDB::ScanOffers(const int count, const int from, const UniValue& oOptions, UniValue& oRes) {
-	string strTxid = "";
+CServiceIndexEntry COfferDB::GetIndexEntry(const COffer& offer) {
+	CServiceIndexEntry entry(offer.nHeight, offer.txHash);
+	entry.AddOwner(offer.vchAlias);
+	return entry;
+}
+bool COfferDB::ScanOffers(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor) {
 	vector<unsigned char> vchOffer, vchAlias;
-	int nStartBlock = 0;
 	if (!oOptions.isNull()) {
-		const UniValue &txid = find_value(oOptions, "txid");
-		if (txid.isStr()) {
-			strTxid = txid.get_str();
-		}
 		const UniValue &offerObj = find_value(oOptions, "offer");
-		if (offerObj.isStr())
+		if (offerObj.isStr()) {
 			vchOffer = vchFromValue(offerObj);
+			scan.SetKey(vchOffer);
+		}
 
 		const UniValue &aliasObj = find_value(oOptions, "alias");
-		if (aliasObj.isStr())
+		if (aliasObj.isStr()) {
 			vchAlias = vchFromValue(aliasObj);
-
-		const UniValue &startblock = find_value(oOptions, "startblock");
-		if (startblock.isNum())
-			nStartBlock = startblock.get_int();
-	}
-
-	boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
-	pcursor->SeekToFirst();
-	COffer txPos;
-	pair<string, vector<unsigned char> > key;
-	int index = 0;
-	while (pcursor->Valid()) {
-		boost::this_thread::interruption_point();
-		try {
-			if (pcursor->GetKey(key) && key.first == "offeri") {
-				pcursor->GetValue(txPos);
-				if (nStartBlock > 0 && txPos.nHeight < nStartBlock)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!strTxid.empty() && strTxid != txPos.txHash.GetHex())
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchOffer.empty() && vchOffer != txPos.vchOffer)
-				{
-					pcursor->Next();
-					continue;
-				}
-				if (!vchAlias.empty() && vchAlias != txPos.vchAlias)
-				{
-					pcursor->Next();
-					continue;
-				}
-				UniValue oOffer(UniValue::VOBJ);
-				if (!BuildOfferJson(txPos, oOffer))
-				{
-					pcursor->Next();
-					continue;
-				}
-				index += 1;
-				if (index <= from) {
-					pcursor->Next();
-					continue;
-				}
-				oRes.push_back(oOffer);
-				if (index >= count + from) {
-					break;
-				}
-			}
-			pcursor->Next();
-		}
-		catch (std::exception &e) {
-			return error("%s() : deserialize error", __PRETTY_FUNCTION__);
+			scan.AddOwner(vchAlias);
 		}
 	}
-	return true;
+
+	return serviceIndex.Scan(scan, [&](const COffer& txPos, UniValue& oOffer) {
+		if (scan.nStartBlock > 0 && txPos.nHeight < scan.nStartBlock)
+			return false;
+		if (!scan.txHash.IsNull() && scan.txHash != txPos.txHash)
+			return false;
+		if (!vchOffer.empty() && vchOffer != txPos.vchOffer)
+			return false;
+		if (!vchAlias.empty() && vchAlias != txPos.vchAlias)
+			return false;
+		return BuildOfferJson(txPos, oOffer);
+	}, oRes, strCursor);
 }
 UniValue listoffers(const JSONRPCRequest& request) {
 	const UniValue &params = request.params;
@@ -1543,12 +1392,14 @@ UniValue listoffers(const JSONRPCRequest& request) {
 			"	     \"offer\":guid				(string) Offer GUID to filter.\n"
 			"      \"alias\":alias			(string) Alias name to filter.\n"
 			"      \"startblock\":block	(number) Earliest block to filter from. Block number is the block at which the transaction would have confirmed.\n"
+			"      \"cursor\":cursor		(string) Page through the results: \"\" for the first page, then the cursor returned with the previous page. The result becomes {\"results\":[...],\"cursor\":cursor}, the cursor is empty after the last page.\n"
 			"    }\n"
 			+ HelpExampleCli("listoffers", "0")
 			+ HelpExampleCli("listoffers", "10 10")
 			+ HelpExampleCli("listoffers", "0 0 '{\"offer\":\"32bff1fa844c124\",\"startblock\":0}'")
 			+ HelpExampleCli("listoffers", "0 0 '{\"alias\":\"offer-owner-alias\"}'")
 			+ HelpExampleCli("listoffers", "0 0 '{\"txid\":\"1c7f966dab21119bac53213a2bc7532bff1fa844c124fd750a7d0b1332440bd1\"}'")
+			+ HelpExampleCli("listoffers", "100 0 '{\"cursor\":\"\"}'")
 		);
 	UniValue options;
 	int count = 10;
@@ -1572,8 +1423,10 @@ UniValue listoffers(const JSONRPCRequest& request) {
 		options = params[2];
 	}
 
-	UniValue oRes(UniValue::VARR);
-	if (!pofferdb->ScanOffers(count, from, options, oRes))
+	CServiceScan scan(count, from, options);
+	RPCResultArray oRes = ServiceScanArray(request, scan);
+	std::string strCursor;
+	if (!pofferdb->ScanOffers(scan, options, oRes, strCursor))
 		throw runtime_error("BILLIECOIN_OFFER_RPC_ERROR: ERRCODE: 5538 - " + _("Scan failed"));
-	return oRes;
+	return ServiceScanResult(scan, oRes, strCursor);
 }
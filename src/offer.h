@@ -8,6 +8,7 @@
 #include <math.h>
 #include "rpc/server.h"
 #include "dbwrapper.h"
+#include "serviceindex.h"
 #include "chainparams.h"
 #include "script/script.h"
 #include "serialize.h"
@@ -20,8 +21,9 @@ class CBlockIndex;
 class CBlock;
 class CAliasIndex;
 class COfferLinkWhitelistEntry;
+class CServicePayload;
 
-bool CheckOfferInputs(const CTransaction &tx, int op, const std::vector<std::vector<unsigned char> > &vvchArgs, const std::vector<unsigned char> &vvchAlias, bool fJustCheck, int nHeight, sorted_vector<std::vector<unsigned char> > &revertedOffers, std::string &errorMessage, bool bSanityCheck=false);
+bool CheckOfferInputs(const CTransaction &tx, const CServicePayload &payload, const std::vector<unsigned char> &vvchAlias, bool fJustCheck, int nHeight, sorted_vector<std::vector<unsigned char> > &revertedOffers, std::string &errorMessage, bool bSanityCheck=false);
 
 
 bool DecodeOfferTx(const CTransaction& tx, int& op, std::vector<std::vector<unsigned char> >& vvch);
@@ -202,13 +204,16 @@ public:
 };
 
 class COfferDB : public CDBWrapper {
+private:
+	CServiceIndex<std::vector<unsigned char>, COffer> serviceIndex;
+	static CServiceIndexEntry GetIndexEntry(const COffer& offer);
 public:
-	COfferDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "offers", nCacheSize, fMemory, fWipe) {}
+	COfferDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "offers", nCacheSize, fMemory, fWipe), serviceIndex(*this, "offer", &GetIndexEntry) {}
 
 	bool WriteOffer(const COffer& offer, const int &op, const int64_t& arrivalTime, const bool& fJustCheck, const bool bNotify = true) {
-		bool writeState = false;
-
-		writeState = Write(make_pair(std::string("offeri"), offer.vchOffer), offer);
+		CDBBatch batch(*this);
+		serviceIndex.Write(batch, offer.vchOffer, offer);
+		bool writeState = WriteBatch(batch);
 		if (!fJustCheck)
 			writeState = writeState && Write(make_pair(std::string("offerp"), offer.vchOffer), offer);
 		else if (fJustCheck) {
@@ -225,7 +230,9 @@ public:
 	}
 
 	bool EraseOffer(const std::vector<unsigned char>& vchOffer, bool cleanup = false) {
-		bool eraseState = Erase(make_pair(std::string("offeri"), vchOffer));
+		CDBBatch batch(*this);
+		serviceIndex.Erase(batch, vchOffer);
+		bool eraseState = WriteBatch(batch);
 		if (eraseState) {
 			Erase(make_pair(std::string("offerp"), vchOffer));
 			EraseISArrivalTimes(vchOffer);
@@ -254,15 +261,21 @@ public:
 	bool EraseISArrivalTimes(const std::vector<unsigned char>& vchOffer) {
 		return Erase(make_pair(std::string("offera"), vchOffer));
 	}
-	bool CleanupDatabase(int &servicesCleaned);
+	/** Erase the expired records an alias is indexed as an owner of */
+	bool CleanupDatabase(const std::vector<unsigned char>& vchAlias, int &servicesCleaned);
+	/** Up to nMax aliases after vchAfter that own offers */
+	bool GetOwners(const std::vector<unsigned char>& vchAfter, const size_t nMax, std::vector<std::vector<unsigned char> >& vOwners) const {
+		return serviceIndex.GetOwners(vchAfter, nMax, vOwners);
+	}
 	void WriteOfferIndex(const COffer& offer, const int &op);
 	void WriteOfferIndexHistory(const COffer& offer, const int &op);
-	bool ScanOffers(const int count, const int from, const UniValue& oOptions, UniValue& oRes);
+	bool BuildIndexes() {
+		return serviceIndex.Build();
+	}
+	bool ScanOffers(CServiceScan& scan, const UniValue& oOptions, RPCResultArray& oRes, std::string& strCursor);
 
 };
 bool GetOffer(const std::vector<unsigned char> &vchOffer, COffer& txPos);
 bool BuildOfferJson(const COffer& theOffer, UniValue& oOffer);
-bool BuildOfferIndexerJson(const COffer& theOffer, UniValue& oOffer);
-bool BuildOfferIndexerHistoryJson(const COffer& theOffer, UniValue& oOffer);
 uint64_t GetOfferExpiration(const COffer& offer);
 #endif // OFFER_H
@@ -10,6 +10,91 @@ bool compareRangeReverse(const CRange &i1, const CRange &i2)
 {
 	return (i1.start > i2.start);
 }
+// Ranges with strictly increasing starts have only one sorted order, so sorting
+// them again can be skipped without changing the result.
+static bool isStrictlySorted(const vector<CRange> &arr)
+{
+	for (unsigned int i = 1; i < arr.size(); i++) {
+		if (arr[i].start <= arr[i - 1].start)
+			return false;
+	}
+	return true;
+}
+// Sorted ranges that are well formed and do not overlap. Their ends increase
+// along with their starts, so the last range starting at or before an index is
+// the only one that can hold it.
+static bool isSortedAndDisjoint(const vector<CRange> &arr)
+{
+	for (unsigned int i = 0; i < arr.size(); i++) {
+		if (arr[i].end < arr[i].start)
+			return false;
+		if (i > 0 && arr[i].start <= arr[i - 1].end)
+			return false;
+	}
+	return true;
+}
+// whether child lies inside one of the sorted and disjoint parent ranges
+static bool isRangeContained(const vector<CRange> &parent, const CRange &child)
+{
+	vector<CRange>::const_iterator it = std::upper_bound(parent.begin(), parent.end(), child, compareRange);
+	if (it == parent.begin())
+		return false;
+	--it;
+	return child.start >= it->start && child.end <= it->end;
+}
+
+CRangeSet::CRangeSet(const vector<CRange> &ranges) : nCount(0)
+{
+	Add(ranges);
+}
+bool CRangeSet::Contains(const CRange &range) const
+{
+	return isRangeContained(vRanges, range);
+}
+bool CRangeSet::Contains(const vector<CRange> &ranges) const
+{
+	for (auto& range : ranges) {
+		if (!isRangeContained(vRanges, range))
+			return false;
+	}
+	return true;
+}
+// merge the next range in start order in, by the same rule as mergeRanges
+void CRangeSet::Append(const CRange &range)
+{
+	if (vRanges.empty() || vRanges.back().end + 1 < range.start) {
+		vRanges.push_back(range);
+		nCount += (range.end - range.start) + 1;
+	}
+	else if (vRanges.back().end < range.end) {
+		nCount += range.end - vRanges.back().end;
+		vRanges.back().end = range.end;
+	}
+}
+void CRangeSet::Add(const vector<CRange> &ranges)
+{
+	if (ranges.empty())
+		return;
+	vector<CRange> sortedRanges;
+	const vector<CRange> *pAdd = &ranges;
+	if (!std::is_sorted(ranges.begin(), ranges.end(), compareRange)) {
+		sortedRanges = ranges;
+		std::sort(sortedRanges.begin(), sortedRanges.end(), compareRange);
+		pAdd = &sortedRanges;
+	}
+	vector<CRange> current;
+	current.swap(vRanges);
+	nCount = 0;
+	vRanges.reserve(current.size() + pAdd->size());
+	// both are sorted by start, walk them together
+	vector<CRange>::const_iterator itCurrent = current.begin(), itAdd = pAdd->begin();
+	while (itCurrent != current.end() || itAdd != pAdd->end()) {
+		if (itAdd == pAdd->end() || (itCurrent != current.end() && !compareRange(*itAdd, *itCurrent)))
+			Append(*itCurrent++);
+		else
+			Append(*itAdd++);
+	}
+}
 
 // The main function that takes a set of ranges, merges
 // overlapping ranges and put the result in output
@@ -19,7 +104,8 @@ void mergeRanges(vector<CRange>& arr, vector<CRange>& output)
 		return;
 
 	// sort the ranges in increasing order of start index
-	std::sort(arr.begin(), arr.end(), compareRange);
+	if (!isStrictlySorted(arr))
+		std::sort(arr.begin(), arr.end(), compareRange);
 
 	// push the first range to stack
 	output.push_back(arr[0]);
@@ -56,10 +142,14 @@ void subtractRanges(vector<CRange> &arr, vector<CRange> &deletions, vector<CRang
 		return;
 
 	// sort the ranges in increasing order of start index
-	std::sort(arr.begin(), arr.end(), compareRange);
+	if (!isStrictlySorted(arr))
+		std::sort(arr.begin(), arr.end(), compareRange);
 
 	// sort the deletions in decreasing order of start index
-	std::sort(deletions.begin(), deletions.end(), compareRangeReverse);
+	if (isStrictlySorted(deletions))
+		std::reverse(deletions.begin(), deletions.end());
+	else
+		std::sort(deletions.begin(), deletions.end(), compareRangeReverse);
 	CRange deletion;
 	// Start from the beginning of the main range array from which we'll
 	// delete another array of ranges
@@ -146,6 +236,13 @@ unsigned int validateRangesAndGetCount(const vector<CRange> &arr) {
 bool doesRangeContain(const vector<CRange> &parent, const vector<CRange> &child) {
 	if (parent.empty() || child.empty())
 		return false;
+	if (isSortedAndDisjoint(parent)) {
+		for (auto& childRange : child) {
+			if (!isRangeContained(parent, childRange))
+				return false;
+		}
+		return true;
+	}
 	// we just need to prove that a single child doesn't exist in parent range's to prove this false, otherwise it must be true
 	for (auto& childRange : child) {
 		bool found = false;
@@ -42,6 +42,31 @@ public:
 	void SetNull() { start = 0; end = 0;}
 	bool IsNull() const { return (start == 0 && end == 0); }
 };
+/**
+ * Ranges kept sorted by start, with overlapping and adjacent ranges merged, the
+ * form mergeRanges produces. The number of indexes covered is kept up to date so
+ * it is never recounted, lookups are binary searches and adding sorted ranges is
+ * a single linear pass.
+ */
+class CRangeSet {
+public:
+	CRangeSet() : nCount(0) {}
+	explicit CRangeSet(const std::vector<CRange> &ranges);
+
+	const std::vector<CRange>& GetRanges() const { return vRanges; }
+	unsigned int Count() const { return nCount; }
+	bool IsEmpty() const { return vRanges.empty(); }
+	// whether every index of range lies inside one range of the set
+	bool Contains(const CRange &range) const;
+	bool Contains(const std::vector<CRange> &ranges) const;
+	// same result as mergeRanges of the set and ranges
+	void Add(const std::vector<CRange> &ranges);
+
+private:
+	std::vector<CRange> vRanges;
+	unsigned int nCount;
+	void Append(const CRange &range);
+};
 unsigned int validateRangesAndGetCount(const std::vector<CRange> &arr);
 bool compareRange(const CRange &i1, const CRange &i2);
 void mergeRanges(std::vector<CRange> &arr, std::vector<CRange> &output);
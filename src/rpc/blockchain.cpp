@@ -1507,6 +1507,86 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+static UniValue HistogramToJSON(const CLatencyHistogram& histogram)
+{
+    UniValue ret(UniValue::VOBJ);
+    const uint64_t nCount = histogram.GetCount();
+    ret.push_back(Pair("count", (int64_t)nCount));
+    ret.push_back(Pair("total", histogram.GetTotal()));
+    ret.push_back(Pair("avg", nCount > 0 ? histogram.GetTotal() / (int64_t)nCount : 0));
+    ret.push_back(Pair("p50", histogram.GetPercentile(50)));
+    ret.push_back(Pair("p99", histogram.GetPercentile(99)));
+    ret.push_back(Pair("max", histogram.GetMax()));
+    return ret;
+}
+
+UniValue getthreadpoolinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getthreadpoolinfo ( reset )\n"
+            "\nReturns metrics of the thread pool used for multithreaded mempool validation.\n"
+            "All timings are in microseconds, percentiles are accurate to within 25%.\n"
+            "\nArguments:\n"
+            "1. reset    (boolean, optional, default=false) Clear the timing histograms after reading them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"threads\": n,             (numeric) Number of worker threads\n"
+            "  \"maxqueue\": n,            (numeric) Maximum number of queued tasks\n"
+            "  \"queued\": n,              (numeric) Tasks waiting for a worker\n"
+            "  \"peers\": n,               (numeric) Peers with queued tasks\n"
+            "  \"running\": n,             (numeric) Tasks being run right now\n"
+            "  \"maxrunning\": n,          (numeric) Highest number of tasks run at the same time\n"
+            "  \"failures\": n,            (numeric) Transactions removed from the mempool after failing a check\n"
+            "  \"rejected\": n,            (numeric) Tasks refused because the queue was full\n"
+            "  \"queuewait\": {            (json object) Time between submitting a task and a worker starting it\n"
+            "    \"count\": n,             (numeric) Number of samples\n"
+            "    \"total\": n,             (numeric) Sum of all samples\n"
+            "    \"avg\": n,               (numeric) Average\n"
+            "    \"p50\": n,               (numeric) Median\n"
+            "    \"p99\": n,               (numeric) 99th percentile\n"
+            "    \"max\": n                (numeric) Largest sample\n"
+            "  },\n"
+            "  \"scriptcheck\": {...},     (json object) Time spent verifying one batch of script checks\n"
+            "  \"billiecoincheck\": {...}, (json object) Time spent in CheckBilliecoinInputs\n"
+            "  \"execution\": {...}        (json object) Time spent running a whole task\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getthreadpoolinfo", "")
+            + HelpExampleRpc("getthreadpoolinfo", "")
+        );
+
+    if (threadpool == NULL)
+        throw JSONRPCError(RPC_MISC_ERROR, "Thread pool is not running");
+
+    bool fReset = false;
+    if (request.params.size() > 0)
+        fReset = request.params[0].get_bool();
+
+    CValidationMetrics& metrics = threadpool->GetMetrics();
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("threads", (int64_t)threadpool->GetThreadCount()));
+    ret.push_back(Pair("maxqueue", (int64_t)threadpool->GetMaxDepth()));
+    ret.push_back(Pair("queued", (int64_t)threadpool->GetQueueDepth()));
+    ret.push_back(Pair("peers", (int64_t)threadpool->GetPeerCount()));
+    ret.push_back(Pair("running", metrics.nRunning.load()));
+    ret.push_back(Pair("maxrunning", metrics.nMaxRunning.load()));
+    ret.push_back(Pair("failures", (int64_t)metrics.nFailures.load()));
+    ret.push_back(Pair("rejected", (int64_t)metrics.nRejected.load()));
+    ret.push_back(Pair("queuewait", HistogramToJSON(metrics.queueWait)));
+    ret.push_back(Pair("scriptcheck", HistogramToJSON(metrics.scriptCheck)));
+    ret.push_back(Pair("billiecoincheck", HistogramToJSON(metrics.billiecoinCheck)));
+    ret.push_back(Pair("execution", HistogramToJSON(metrics.execution)));
+    if (fReset) {
+        metrics.queueWait.Reset();
+        metrics.scriptCheck.Reset();
+        metrics.billiecoinCheck.Reset();
+        metrics.execution.Reset();
+        metrics.nMaxRunning = metrics.nRunning.load();
+    }
+    return ret;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1713,6 +1793,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true,  {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
+    { "blockchain",         "getthreadpoolinfo",      &getthreadpoolinfo,      true,  {"reset"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
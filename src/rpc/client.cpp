@@ -131,6 +131,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "pruneblockchain", 0, "height" },
     { "keypoolrefill", 0, "newsize" },
     { "getrawmempool", 0, "verbose" },
+    { "getthreadpoolinfo", 0, "reset" },
     { "estimatefee", 0, "nblocks" },
     { "estimatepriority", 0, "nblocks" },
     { "estimatesmartfee", 0, "nblocks" },
@@ -189,6 +190,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
 	{ "listaliases", 0, "count" },
 	{ "listaliases", 1, "from" },
 	{ "listaliases", 2, "options" },
+	{ "dumpsnapshot", 1, "options" },
 	{ "certtransfer", 3, "accessflags" },
 	{ "listcerts", 0, "count" },
 	{ "listcerts", 1, "from" },
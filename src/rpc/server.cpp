@@ -292,6 +292,8 @@ static const CRPCCommand vRPCCommands[] =
 	{ "wallet", "billiecoindecoderawtransaction",		 &billiecoindecoderawtransaction,	false ,  {}},
 	{ "wallet", "billiecoinlistreceivedbyaddress",		 &billiecoinlistreceivedbyaddress,	false ,  {}},
 	{ "wallet", "prunebilliecoinservices",          &prunebilliecoinservices,          false ,  {}},
+	{ "wallet", "aliascacheinfo",          &aliascacheinfo,          true ,  {}},
+	{ "blockchain", "dumpsnapshot",            &dumpsnapshot,            true ,  {"filename","options"}},
 
 	// use the blockchain as a distributed marketplace
 	{ "wallet", "offernew",             &offernew,             false ,  {}},
@@ -454,6 +456,54 @@ void JSONRPCRequest::parse(const UniValue& valRequest)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array or object");
 }
 
+void RPCResultArray::Start()
+{
+    fStarted = true;
+    if (strKey.empty()) {
+        stream->Write("[");
+        stream->SetClosing("]");
+    } else {
+        stream->Write("{" + UniValue(strKey).write() + ":[");
+        stream->SetClosing("]}");
+    }
+}
+
+void RPCResultArray::push_back(const UniValue& row)
+{
+    if (stream) {
+        if (!fStarted)
+            Start();
+        stream->Write(nSize > 0 ? "," + row.write() : row.write());
+    } else
+        arr.push_back(row);
+    nSize++;
+}
+
+UniValue RPCResultArray::Finish(const UniValue& oMembers)
+{
+    const std::vector<std::string> vKeys = oMembers.isObject() ? oMembers.getKeys() : std::vector<std::string>();
+    if (!stream) {
+        if (strKey.empty())
+            return arr;
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair(strKey, arr));
+        for (unsigned int i = 0; i < vKeys.size(); i++)
+            result.push_back(Pair(vKeys[i], oMembers[vKeys[i]]));
+        return result;
+    }
+    if (!fStarted)
+        Start();
+    std::string strEnd = "]";
+    if (!strKey.empty()) {
+        for (unsigned int i = 0; i < vKeys.size(); i++)
+            strEnd += "," + UniValue(vKeys[i]).write() + ":" + oMembers[vKeys[i]].write();
+        strEnd += "}";
+    }
+    stream->Write(strEnd);
+    stream->SetClosing("");
+    return NullUniValue;
+}
+
 static UniValue JSONRPCExecOne(const UniValue& req)
 {
     UniValue rpc_result(UniValue::VOBJ);
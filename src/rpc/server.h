@@ -42,6 +42,21 @@ struct UniValueType {
     UniValue::VType type;
 };
 
+/**
+ * Takes the JSON text of a result while the RPC produces it, so that a large
+ * result is never held in memory whole. Transports that can send a reply in
+ * parts set it on the request; RPCs write to it through RPCResultArray.
+ */
+class RPCStream
+{
+public:
+    virtual ~RPCStream() {}
+    /** Append to the result, throws once the client is gone */
+    virtual void Write(const std::string& strJSON) = 0;
+    /** The text closing what the result has opened so far, written when the RPC fails half way */
+    virtual void SetClosing(const std::string& strClosing) = 0;
+};
+
 class JSONRPCRequest
 {
 public:
@@ -51,11 +66,42 @@ public:
     bool fHelp;
     std::string URI;
     std::string authUser;
+    // where to stream the result to, if the transport supports it
+    RPCStream* stream;
 
-    JSONRPCRequest() { id = NullUniValue; params = NullUniValue; fHelp = false; }
+    JSONRPCRequest() { id = NullUniValue; params = NullUniValue; fHelp = false; stream = NULL; }
     void parse(const UniValue& valRequest);
 };
 
+/**
+ * The array result of a list RPC, built row by row. Without a stream on the
+ * request the rows are collected and Finish returns them; with one they are
+ * written out as they are pushed and Finish returns null.
+ * When strKey is given the result is an object holding the array under that
+ * key, its other members are passed to Finish.
+ */
+class RPCResultArray
+{
+public:
+    RPCResultArray() : stream(NULL), fStarted(false), nSize(0), arr(UniValue::VARR) {}
+    explicit RPCResultArray(const JSONRPCRequest& request, const std::string& strKeyIn = "") :
+        stream(request.stream), strKey(strKeyIn), fStarted(false), nSize(0), arr(UniValue::VARR) {}
+
+    void push_back(const UniValue& row);
+    size_t size() const { return nSize; }
+    /** The value for the RPC to return */
+    UniValue Finish(const UniValue& oMembers = NullUniValue);
+
+private:
+    RPCStream* stream;
+    std::string strKey;
+    bool fStarted;
+    size_t nSize;
+    UniValue arr;
+
+    void Start();
+};
+
 /** Query whether RPC is running */
 bool IsRPCRunning();
 
@@ -189,6 +235,8 @@ extern UniValue aliasinfo(const JSONRPCRequest& request);
 extern UniValue aliasbalance(const JSONRPCRequest& request);
 extern UniValue aliasbalancemulti(const JSONRPCRequest& request);
 extern UniValue prunebilliecoinservices(const JSONRPCRequest& request);
+extern UniValue aliascacheinfo(const JSONRPCRequest& request);
+extern UniValue dumpsnapshot(const JSONRPCRequest& request);
 extern UniValue aliaspay(const JSONRPCRequest& request);
 extern UniValue aliasaddscript(const JSONRPCRequest& request);
 extern UniValue aliasupdatewhitelist(const JSONRPCRequest& request);
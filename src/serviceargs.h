@@ -0,0 +1,84 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SERVICEARGS_H
+#define SERVICEARGS_H
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * Read only view of one argument pushed by a service script. It does not own
+ * the bytes, whoever handed it out keeps them alive (see CServicePayload).
+ * Converts to a vector where a copy is really needed.
+ */
+class CServiceArg
+{
+private:
+	const unsigned char* pbegin;
+	size_t nSize;
+
+public:
+	CServiceArg() : pbegin(NULL), nSize(0) {}
+	CServiceArg(const unsigned char* pbeginIn, size_t nSizeIn) : pbegin(pbeginIn), nSize(nSizeIn) {}
+	CServiceArg(const std::vector<unsigned char>& vch) : pbegin(vch.data()), nSize(vch.size()) {}
+
+	const unsigned char* begin() const { return pbegin; }
+	const unsigned char* end() const { return pbegin + nSize; }
+	size_t size() const { return nSize; }
+	bool empty() const { return nSize == 0; }
+	unsigned char operator[](size_t pos) const { return pbegin[pos]; }
+
+	std::vector<unsigned char> ToVch() const { return std::vector<unsigned char>(begin(), end()); }
+	operator std::vector<unsigned char>() const { return ToVch(); }
+
+	friend bool operator==(const CServiceArg& a, const CServiceArg& b)
+	{
+		return a.nSize == b.nSize && (a.nSize == 0 || memcmp(a.pbegin, b.pbegin, a.nSize) == 0);
+	}
+	friend bool operator!=(const CServiceArg& a, const CServiceArg& b) { return !(a == b); }
+};
+
+/**
+ * The arguments of a service script as views. Built from a vector of arguments
+ * it views that vector, which has to outlive it, so only pass one as a parameter.
+ */
+class CServiceArgs
+{
+private:
+	std::vector<CServiceArg> vArgs;
+
+public:
+	typedef std::vector<CServiceArg>::const_iterator const_iterator;
+
+	CServiceArgs() {}
+	CServiceArgs(const std::vector<std::vector<unsigned char> >& vvch)
+	{
+		vArgs.reserve(vvch.size());
+		for (const std::vector<unsigned char>& vch : vvch)
+			vArgs.emplace_back(vch);
+	}
+
+	void push_back(const CServiceArg& arg) { vArgs.push_back(arg); }
+	void clear() { vArgs.clear(); }
+	size_t size() const { return vArgs.size(); }
+	bool empty() const { return vArgs.empty(); }
+	const CServiceArg& operator[](size_t pos) const { return vArgs[pos]; }
+	const_iterator begin() const { return vArgs.begin(); }
+	const_iterator end() const { return vArgs.end(); }
+	/** Heap memory of the views, not of the bytes they point to */
+	size_t DynamicMemoryUsage() const { return vArgs.capacity() * sizeof(CServiceArg); }
+
+	std::vector<std::vector<unsigned char> > ToVvch() const
+	{
+		std::vector<std::vector<unsigned char> > vvch;
+		vvch.reserve(vArgs.size());
+		for (const CServiceArg& arg : vArgs)
+			vvch.push_back(arg.ToVch());
+		return vvch;
+	}
+};
+
+#endif // SERVICEARGS_H
@@ -0,0 +1,129 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SERVICECACHE_H
+#define SERVICECACHE_H
+
+#include "memusage.h"
+#include "sync.h"
+
+#include <list>
+#include <map>
+#include <stdint.h>
+
+/**
+ * Least recently used records read from a service database, bounded by the
+ * memory the entries use. The cache only ever holds committed data: the
+ * database drops the entries of the keys it writes, and a reader passes the
+ * generation it took before reading the database so that a record a write
+ * overtook is not inserted.
+ */
+template<typename K, typename V>
+class CServiceCache
+{
+public:
+	typedef size_t (*UsageFunc)(const V&);
+
+	CServiceCache(UsageFunc fnUsageIn, const size_t nMaxUsageIn = 0) :
+		fnUsage(fnUsageIn), nUsage(0), nMaxUsage(nMaxUsageIn), nGeneration(0), nHits(0), nMisses(0) {}
+
+	void SetMaxUsage(const size_t nMaxUsageIn) {
+		LOCK(cs);
+		nMaxUsage = nMaxUsageIn;
+		Trim();
+	}
+	/** Look a record up, counting the hit or miss */
+	bool Get(const K& key, V& value) {
+		LOCK(cs);
+		typename map_t::iterator it = mapItems.find(key);
+		if (it == mapItems.end()) {
+			nMisses++;
+			return false;
+		}
+		nHits++;
+		listItems.splice(listItems.begin(), listItems, it->second);
+		value = it->second->second;
+		return true;
+	}
+	/** The generation to pass to Insert, take it before reading the database */
+	uint64_t GetGeneration() const {
+		LOCK(cs);
+		return nGeneration;
+	}
+	/** Cache a record read from the database, unless the database was written since nGenerationRead */
+	void Insert(const K& key, const V& value, const uint64_t nGenerationRead) {
+		LOCK(cs);
+		if (nGenerationRead != nGeneration || nMaxUsage == 0 || mapItems.count(key))
+			return;
+		listItems.push_front(std::make_pair(key, value));
+		mapItems.insert(std::make_pair(key, listItems.begin()));
+		nUsage += EntryUsage(listItems.front());
+		Trim();
+	}
+	/** Drop the record of a key that was written */
+	void Erase(const K& key) {
+		LOCK(cs);
+		nGeneration++;
+		typename map_t::iterator it = mapItems.find(key);
+		if (it == mapItems.end())
+			return;
+		EraseItem(it);
+	}
+	void Clear() {
+		LOCK(cs);
+		nGeneration++;
+		mapItems.clear();
+		listItems.clear();
+		nUsage = 0;
+	}
+
+	size_t Size() const {
+		LOCK(cs);
+		return mapItems.size();
+	}
+	size_t DynamicMemoryUsage() const {
+		LOCK(cs);
+		return nUsage;
+	}
+	uint64_t Hits() const {
+		LOCK(cs);
+		return nHits;
+	}
+	uint64_t Misses() const {
+		LOCK(cs);
+		return nMisses;
+	}
+
+private:
+	typedef std::list<std::pair<K, V> > list_t;
+	typedef std::map<K, typename list_t::iterator> map_t;
+
+	mutable CCriticalSection cs;
+	// most recently used first
+	list_t listItems;
+	map_t mapItems;
+	const UsageFunc fnUsage;
+	size_t nUsage;
+	size_t nMaxUsage;
+	uint64_t nGeneration;
+	uint64_t nHits;
+	uint64_t nMisses;
+
+	size_t EntryUsage(const std::pair<K, V>& item) const {
+		// the key is held by both the list and the map node
+		return memusage::MallocUsage(2 * sizeof(void*) + sizeof(std::pair<K, V>)) + memusage::MallocUsage(sizeof(memusage::stl_tree_node<typename map_t::value_type>)) +
+			2 * memusage::DynamicUsage(item.first) + fnUsage(item.second);
+	}
+	void EraseItem(typename map_t::iterator it) {
+		nUsage -= EntryUsage(*it->second);
+		listItems.erase(it->second);
+		mapItems.erase(it);
+	}
+	void Trim() {
+		while (nUsage > nMaxUsage && !listItems.empty())
+			EraseItem(mapItems.find(listItems.back().first));
+	}
+};
+
+#endif // SERVICECACHE_H
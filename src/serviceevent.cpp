@@ -0,0 +1,62 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "serviceevent.h"
+
+#include "util.h"
+#include "validationinterface.h"
+
+CServiceEventPublisher serviceEventPublisher;
+
+void CServiceEventPublisher::Enable(const size_t nMaxSizeIn) {
+	boost::unique_lock<boost::mutex> lock(mutex);
+	nMaxSize = nMaxSizeIn;
+	fEnabled = true;
+}
+bool CServiceEventPublisher::Push(const std::string& strTopic, std::vector<unsigned char>& vchPayload) {
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		if (!fEnabled)
+			return false;
+		const uint32_t nSequence = mapSequence[strTopic]++;
+		if (queueEvents.size() >= nMaxSize) {
+			LogPrint("zmq", "%s: queue full, dropped %s event %u\n", __func__, strTopic, nSequence);
+			return false;
+		}
+		queueEvents.push_back(CServiceEvent());
+		CServiceEvent& event = queueEvents.back();
+		event.strTopic = strTopic;
+		event.nSequence = nSequence;
+		event.vchPayload.swap(vchPayload);
+	}
+	cond.notify_one();
+	return true;
+}
+void CServiceEventPublisher::Thread() {
+	try {
+		while (true) {
+			CServiceEvent event;
+			{
+				boost::unique_lock<boost::mutex> lock(mutex);
+				while (queueEvents.empty())
+					cond.wait(lock);
+				std::swap(event, queueEvents.front());
+				queueEvents.pop_front();
+			}
+			GetMainSignals().NotifyBilliecoinUpdate(event);
+		}
+	}
+	catch (const boost::thread_interrupted&) {
+		// nobody publishes what would be queued from now on
+		boost::unique_lock<boost::mutex> lock(mutex);
+		fEnabled = false;
+		queueEvents.clear();
+		throw;
+	}
+}
+
+void ThreadPublishServiceEvents() {
+	RenameThread("billiecoin-svcevents");
+	serviceEventPublisher.Thread();
+}
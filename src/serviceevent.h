@@ -0,0 +1,82 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SERVICEEVENT_H
+#define SERVICEEVENT_H
+
+#include "serialize.h"
+#include "streams.h"
+#include "version.h"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+/** Layout version of the service event payloads, the first byte of every payload */
+static const unsigned char SERVICE_EVENT_VERSION = 1;
+/** Default for -zmqservicequeue, the service events waiting to be published before new ones are dropped */
+static const unsigned int DEFAULT_SERVICE_EVENT_QUEUE_SIZE = 10000;
+
+/** A change of a service record published to indexers */
+struct CServiceEvent
+{
+	std::string strTopic;
+	// counts the events of the topic, an indexer seeing a jump has missed events
+	uint32_t nSequence;
+	// SERVICE_EVENT_VERSION followed by the serialized fields of the topic
+	std::vector<unsigned char> vchPayload;
+};
+
+/**
+ * Hands service events to the validation interface from a thread of its own,
+ * so that connecting a block only pays for serializing the changed records.
+ * When the queue is full new events are dropped; they still take their
+ * sequence number so that subscribers see the gap. Nothing is queued
+ * unless the publisher thread runs.
+ */
+class CServiceEventPublisher
+{
+private:
+	boost::mutex mutex;
+	boost::condition_variable cond;
+	std::deque<CServiceEvent> queueEvents;
+	std::map<std::string, uint32_t> mapSequence;
+	size_t nMaxSize;
+	std::atomic<bool> fEnabled;
+
+public:
+	CServiceEventPublisher() : nMaxSize(DEFAULT_SERVICE_EVENT_QUEUE_SIZE), fEnabled(false) {}
+
+	/** Accept events for the publisher thread about to be started, at most nMaxSizeIn of them waiting */
+	void Enable(const size_t nMaxSizeIn);
+	bool IsEnabled() const { return fEnabled; }
+	/** Queue an event, false if it was dropped */
+	bool Push(const std::string& strTopic, std::vector<unsigned char>& vchPayload);
+	/** Publish queued events until the thread is interrupted */
+	void Thread();
+};
+
+extern CServiceEventPublisher serviceEventPublisher;
+
+/** Publish the fields as an event on strTopic */
+template<typename... Args>
+void PublishServiceEvent(const std::string& strTopic, const Args&... args)
+{
+	if (!serviceEventPublisher.IsEnabled())
+		return;
+	CDataStream ssEvent(SER_NETWORK, PROTOCOL_VERSION);
+	ssEvent << SERVICE_EVENT_VERSION;
+	SerializeMany(ssEvent, args...);
+	std::vector<unsigned char> vchPayload(ssEvent.begin(), ssEvent.end());
+	serviceEventPublisher.Push(strTopic, vchPayload);
+}
+
+void ThreadPublishServiceEvents();
+
+#endif // SERVICEEVENT_H
@@ -0,0 +1,39 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "serviceindex.h"
+
+#include "rpc/server.h"
+#include "utilstrencodings.h"
+
+CServiceScan::CServiceScan(const int nCountIn, const int nFromIn, const UniValue& oOptions) : nCount(nCountIn), nFrom(nFromIn), nStartBlock(0), fCursor(false) {
+	if (oOptions.isNull())
+		return;
+	const UniValue &txid = find_value(oOptions, "txid");
+	if (txid.isStr())
+		txHash = uint256S(txid.get_str());
+	const UniValue &startblock = find_value(oOptions, "startblock");
+	if (startblock.isNum() && startblock.get_int() > 0)
+		nStartBlock = startblock.get_int();
+	const UniValue &cursor = find_value(oOptions, "cursor");
+	if (cursor.isStr()) {
+		fCursor = true;
+		if (!IsHex(cursor.get_str()) && !cursor.get_str().empty())
+			throw std::runtime_error("'cursor' must be the cursor returned by the previous page");
+		const std::vector<unsigned char> vchCursor = ParseHex(cursor.get_str());
+		strCursor.assign(vchCursor.begin(), vchCursor.end());
+	}
+}
+
+RPCResultArray ServiceScanArray(const JSONRPCRequest& request, const CServiceScan& scan) {
+	return RPCResultArray(request, scan.fCursor ? "results" : "");
+}
+
+UniValue ServiceScanResult(const CServiceScan& scan, RPCResultArray& oRes, const std::string& strCursor) {
+	if (!scan.fCursor)
+		return oRes.Finish();
+	UniValue oMembers(UniValue::VOBJ);
+	oMembers.push_back(Pair("cursor", HexStr(strCursor.begin(), strCursor.end())));
+	return oRes.Finish(oMembers);
+}
@@ -0,0 +1,377 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SERVICEINDEX_H
+#define SERVICEINDEX_H
+
+#include "dbwrapper.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <univalue.h>
+
+class JSONRPCRequest;
+class RPCResultArray;
+
+/** Version of the secondary index entries, the indexes are rebuilt from the records when it changes */
+static const int SERVICE_INDEX_VERSION = 2;
+/** Number of records indexed per batch while building the indexes */
+static const int SERVICE_INDEX_BUILD_BATCH = 1000;
+
+/** The values a service record is found by besides its key */
+struct CServiceIndexEntry
+{
+	unsigned int nHeight;
+	uint256 txHash;
+	std::vector<std::vector<unsigned char> > vvchOwners;
+	// time the record expires at, 0 for records that are not indexed by expiry
+	uint64_t nExpireTime;
+
+	CServiceIndexEntry(const unsigned int nHeightIn, const uint256& txHashIn) : nHeight(nHeightIn), txHash(txHashIn), nExpireTime(0) {}
+	void AddOwner(const std::vector<unsigned char>& vchOwner) {
+		if (!vchOwner.empty() && std::find(vvchOwners.begin(), vvchOwners.end(), vchOwner) == vvchOwners.end())
+			vvchOwners.push_back(vchOwner);
+	}
+};
+
+/** Block height serialized big endian so that height index keys sort numerically */
+class CServiceIndexHeight
+{
+public:
+	unsigned int nHeight;
+	explicit CServiceIndexHeight(const unsigned int nHeightIn = 0) : nHeight(nHeightIn) {}
+
+	template<typename Stream>
+	void Serialize(Stream& s) const {
+		ser_writedata32be(s, nHeight);
+	}
+	template<typename Stream>
+	void Unserialize(Stream& s) {
+		nHeight = ser_readdata32be(s);
+	}
+};
+
+/** Expiry time serialized big endian so that expiry index keys sort numerically */
+class CServiceIndexTime
+{
+public:
+	uint64_t nTime;
+	explicit CServiceIndexTime(const uint64_t nTimeIn = 0) : nTime(nTimeIn) {}
+
+	template<typename Stream>
+	void Serialize(Stream& s) const {
+		ser_writedata64be(s, nTime);
+	}
+	template<typename Stream>
+	void Unserialize(Stream& s) {
+		nTime = ser_readdata64be(s);
+	}
+};
+
+/**
+ * What a list RPC asks for. The scan walks the narrowest index covering it, in
+ * this order: a key (or key prefix), a txid, the owners, the start block, and
+ * otherwise every record. The caller still checks the remaining filters.
+ */
+class CServiceScan
+{
+public:
+	int nCount;
+	int nFrom;
+	unsigned int nStartBlock;
+	uint256 txHash;
+	std::vector<std::vector<unsigned char> > vvchOwners;
+	// serialized key, or the serialized leading fields of a key
+	std::string strKey;
+	// serialized index key of the last record returned by the previous page
+	std::string strCursor;
+	bool fCursor;
+
+	/** Read the txid, startblock and cursor options, throws on a malformed cursor */
+	CServiceScan(const int nCountIn, const int nFromIn, const UniValue& oOptions);
+	template<typename K>
+	void SetKey(const K& key) {
+		CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+		ssKey << key;
+		strKey.assign(ssKey.begin(), ssKey.end());
+	}
+	void AddOwner(const std::vector<unsigned char>& vchOwner) {
+		if (!vchOwner.empty())
+			vvchOwners.push_back(vchOwner);
+	}
+};
+
+/** The array a list RPC pushes its records to, streamed when the request allows it */
+RPCResultArray ServiceScanArray(const JSONRPCRequest& request, const CServiceScan& scan);
+/** The result of a list RPC: the records, or with the cursor option an object that also holds the cursor of the next page */
+UniValue ServiceScanResult(const CServiceScan& scan, RPCResultArray& oRes, const std::string& strCursor);
+
+/**
+ * Records of type T stored under (strPrefix + "i", key) together with secondary
+ * indexes on the height ("ih"), txid ("it"), owners ("io") and, for records
+ * that expire, the expiry time ("ix") of each record.
+ * The index entries are keys only, (strPrefix + "ih", (height, key)) and so on,
+ * so that every lookup is a prefix bounded seek. All changes go through Write
+ * and Erase so that the entries of a replaced record are dropped with it.
+ */
+template<typename K, typename T>
+class CServiceIndex
+{
+public:
+	typedef CServiceIndexEntry (*EntryFunc)(const T&);
+
+	CServiceIndex(CDBWrapper& dbIn, const std::string& strPrefix, EntryFunc fnEntryIn) :
+		db(dbIn), strRecords(strPrefix + "i"), strHeights(strPrefix + "ih"), strTxids(strPrefix + "it"), strOwners(strPrefix + "io"), strExpiries(strPrefix + "ix"), fnEntry(fnEntryIn) {}
+
+	bool Read(const K& key, T& record) const {
+		return db.Read(std::make_pair(strRecords, key), record);
+	}
+	/** Queue the record and its index entries, and the removal of the entries of the record it replaces */
+	void Write(CDBBatch& batch, const K& key, const T& record) const {
+		T oldRecord;
+		if (Read(key, oldRecord))
+			EraseEntries(batch, key, fnEntry(oldRecord));
+		batch.Write(std::make_pair(strRecords, key), record);
+		WriteEntries(batch, key, fnEntry(record));
+	}
+	void Erase(CDBBatch& batch, const K& key) const {
+		T oldRecord;
+		if (Read(key, oldRecord))
+			EraseEntries(batch, key, fnEntry(oldRecord));
+		batch.Erase(std::make_pair(strRecords, key));
+	}
+
+	/** Drop an expiry index entry whose record is gone or expires at another time */
+	void EraseExpiry(CDBBatch& batch, const K& key, const uint64_t nExpireTime) const {
+		batch.Erase(std::make_pair(strExpiries, std::make_pair(CServiceIndexTime(nExpireTime), key)));
+	}
+	/** Up to nMax records expiring at or before nTime with their expiry time, the earliest first */
+	bool GetExpired(const uint64_t nTime, const size_t nMax, std::vector<std::pair<uint64_t, K> >& vExpired) const {
+		const std::string strBound = SerializeKey(strExpiries);
+		boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+		for (pcursor->SeekRaw(strBound); pcursor->Valid() && vExpired.size() < nMax; pcursor->Next()) {
+			boost::this_thread::interruption_point();
+			if (pcursor->GetKeyRaw().compare(0, strBound.size(), strBound) != 0)
+				break;
+			std::pair<std::string, std::pair<CServiceIndexTime, K> > key;
+			if (!pcursor->GetKey(key))
+				return error("%s: cannot read %s entry", __func__, strExpiries);
+			if (key.second.first.nTime > nTime)
+				break;
+			vExpired.push_back(std::make_pair(key.second.first.nTime, key.second.second));
+		}
+		return true;
+	}
+	/** The keys of the records an owner is indexed under */
+	bool GetOwned(const std::vector<unsigned char>& vchOwner, std::vector<K>& vKeys) const {
+		const std::string strBound = SerializeKey(std::make_pair(strOwners, vchOwner));
+		boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+		for (pcursor->SeekRaw(strBound); pcursor->Valid(); pcursor->Next()) {
+			boost::this_thread::interruption_point();
+			if (pcursor->GetKeyRaw().compare(0, strBound.size(), strBound) != 0)
+				break;
+			std::pair<std::string, std::pair<std::vector<unsigned char>, K> > key;
+			if (!pcursor->GetKey(key))
+				return error("%s: cannot read %s entry", __func__, strOwners);
+			vKeys.push_back(key.second.second);
+		}
+		return true;
+	}
+
+	/** Up to nMax owners indexed after vchAfter, each once and from the first one when vchAfter is empty */
+	bool GetOwners(const std::vector<unsigned char>& vchAfter, const size_t nMax, std::vector<std::vector<unsigned char> >& vOwners) const {
+		const std::string strBound = SerializeKey(strOwners);
+		boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+		std::vector<unsigned char> vchLast = vchAfter;
+		for (pcursor->SeekRaw(vchAfter.empty() ? strBound : SerializeKey(std::make_pair(strOwners, vchAfter))); pcursor->Valid() && vOwners.size() < nMax; pcursor->Next()) {
+			boost::this_thread::interruption_point();
+			if (pcursor->GetKeyRaw().compare(0, strBound.size(), strBound) != 0)
+				break;
+			std::pair<std::string, std::pair<std::vector<unsigned char>, K> > key;
+			if (!pcursor->GetKey(key))
+				return error("%s: cannot read %s entry", __func__, strOwners);
+			if (key.second.first == vchLast)
+				continue;
+			vchLast = key.second.first;
+			vOwners.push_back(vchLast);
+		}
+		return true;
+	}
+
+	/** Index the records written before the indexes existed */
+	bool Build() const {
+		int nVersion = 0;
+		if (db.Read(strRecords + "version", nVersion) && nVersion == SERVICE_INDEX_VERSION)
+			return true;
+		const std::string strBound = SerializeKey(strRecords);
+		boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+		CDBBatch batch(db);
+		int nIndexed = 0;
+		for (pcursor->SeekRaw(strBound); pcursor->Valid(); pcursor->Next()) {
+			boost::this_thread::interruption_point();
+			const std::string strKey = pcursor->GetKeyRaw();
+			if (strKey.compare(0, strBound.size(), strBound) != 0)
+				break;
+			std::pair<std::string, K> key;
+			T record;
+			if (!pcursor->GetKey(key) || !pcursor->GetValue(record))
+				return error("%s: cannot read %s record", __func__, strRecords);
+			WriteEntries(batch, key.second, fnEntry(record));
+			if (++nIndexed % SERVICE_INDEX_BUILD_BATCH == 0) {
+				if (!db.WriteBatch(batch))
+					return false;
+				batch.Clear();
+			}
+		}
+		batch.Write(strRecords + "version", SERVICE_INDEX_VERSION);
+		if (!db.WriteBatch(batch, true))
+			return false;
+		if (nIndexed > 0)
+			LogPrintf("Indexed %d %s records\n", nIndexed, strRecords);
+		return true;
+	}
+
+	/**
+	 * Page through the records selected by scan. fnBuild returns false for the
+	 * records the remaining filters reject. strCursor is set to the index key of
+	 * the last record returned, or cleared once the scan has run out of records.
+	 * The records go to oRes as they are found, see RPCResultArray.
+	 */
+	template<typename R>
+	bool Scan(const CServiceScan& scan, const std::function<bool(T&, UniValue&)>& fnBuild, R& oRes, std::string& strCursor) {
+		// each range is the prefix its keys share and the key to start at
+		std::vector<std::pair<std::string, std::string> > vRanges;
+		if (!scan.strKey.empty()) {
+			const std::string strBound = SerializeKey(strRecords) + scan.strKey;
+			vRanges.push_back(std::make_pair(strBound, strBound));
+		}
+		else if (!scan.txHash.IsNull()) {
+			const std::string strBound = SerializeKey(std::make_pair(strTxids, scan.txHash));
+			vRanges.push_back(std::make_pair(strBound, strBound));
+		}
+		else if (!scan.vvchOwners.empty()) {
+			for (const std::vector<unsigned char>& vchOwner : scan.vvchOwners) {
+				const std::string strBound = SerializeKey(std::make_pair(strOwners, vchOwner));
+				vRanges.push_back(std::make_pair(strBound, strBound));
+			}
+			std::sort(vRanges.begin(), vRanges.end());
+			vRanges.erase(std::unique(vRanges.begin(), vRanges.end()), vRanges.end());
+		}
+		else if (scan.nStartBlock > 0)
+			vRanges.push_back(std::make_pair(SerializeKey(strHeights), SerializeKey(std::make_pair(strHeights, CServiceIndexHeight(scan.nStartBlock)))));
+		else {
+			const std::string strBound = SerializeKey(strRecords);
+			vRanges.push_back(std::make_pair(strBound, strBound));
+		}
+
+		strCursor.clear();
+		boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+		int64_t nIndex = 0;
+		for (const std::pair<std::string, std::string>& range : vRanges) {
+			const std::string& strBound = range.first;
+			std::string strStart = range.second;
+			if (!scan.strCursor.empty()) {
+				if (scan.strCursor.compare(0, strBound.size(), strBound) == 0)
+					strStart = std::max(strStart, scan.strCursor);
+				// the previous pages got past this range
+				else if (scan.strCursor > strBound)
+					continue;
+			}
+			try {
+				for (pcursor->SeekRaw(strStart); pcursor->Valid(); pcursor->Next()) {
+					boost::this_thread::interruption_point();
+					const std::string strKey = pcursor->GetKeyRaw();
+					if (strKey.compare(0, strBound.size(), strBound) != 0)
+						break;
+					if (strKey == scan.strCursor)
+						continue;
+					T record;
+					if (!ReadRecord(*pcursor, strKey, record))
+						continue;
+					UniValue oRecord(UniValue::VOBJ);
+					if (!fnBuild(record, oRecord))
+						continue;
+					if (++nIndex <= scan.nFrom)
+						continue;
+					oRes.push_back(oRecord);
+					strCursor = strKey;
+					if (nIndex >= (int64_t)scan.nCount + scan.nFrom)
+						return true;
+				}
+			}
+			catch (std::exception &e) {
+				return error("%s() : deserialize error", __PRETTY_FUNCTION__);
+			}
+		}
+		strCursor.clear();
+		return true;
+	}
+
+private:
+	CDBWrapper& db;
+	const std::string strRecords;
+	const std::string strHeights;
+	const std::string strTxids;
+	const std::string strOwners;
+	const std::string strExpiries;
+	const EntryFunc fnEntry;
+
+	template<typename X>
+	static std::string SerializeKey(const X& key) {
+		CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+		ssKey << key;
+		return std::string(ssKey.begin(), ssKey.end());
+	}
+	void WriteEntries(CDBBatch& batch, const K& key, const CServiceIndexEntry& entry) const {
+		const std::string strEmpty;
+		batch.Write(std::make_pair(strHeights, std::make_pair(CServiceIndexHeight(entry.nHeight), key)), strEmpty);
+		batch.Write(std::make_pair(strTxids, std::make_pair(entry.txHash, key)), strEmpty);
+		for (const std::vector<unsigned char>& vchOwner : entry.vvchOwners)
+			batch.Write(std::make_pair(strOwners, std::make_pair(vchOwner, key)), strEmpty);
+		if (entry.nExpireTime > 0)
+			batch.Write(std::make_pair(strExpiries, std::make_pair(CServiceIndexTime(entry.nExpireTime), key)), strEmpty);
+	}
+	void EraseEntries(CDBBatch& batch, const K& key, const CServiceIndexEntry& entry) const {
+		batch.Erase(std::make_pair(strHeights, std::make_pair(CServiceIndexHeight(entry.nHeight), key)));
+		batch.Erase(std::make_pair(strTxids, std::make_pair(entry.txHash, key)));
+		for (const std::vector<unsigned char>& vchOwner : entry.vvchOwners)
+			batch.Erase(std::make_pair(strOwners, std::make_pair(vchOwner, key)));
+		if (entry.nExpireTime > 0)
+			EraseExpiry(batch, key, entry.nExpireTime);
+	}
+	/** The record a record or index key under the cursor refers to, false if the index entry is stale */
+	bool ReadRecord(CDBIterator& cursor, const std::string& strKey, T& record) const {
+		CDataStream ssKey(strKey.data(), strKey.data() + strKey.size(), SER_DISK, CLIENT_VERSION);
+		std::string strName;
+		ssKey >> strName;
+		if (strName == strRecords) {
+			if (!cursor.GetValue(record))
+				throw std::runtime_error("cannot read " + strRecords + " record");
+			return true;
+		}
+		if (strName == strHeights) {
+			CServiceIndexHeight height;
+			ssKey >> height;
+		}
+		else if (strName == strTxids) {
+			uint256 txHash;
+			ssKey >> txHash;
+		}
+		else {
+			std::vector<unsigned char> vchOwner;
+			ssKey >> vchOwner;
+		}
+		K key;
+		ssKey >> key;
+		return Read(key, record);
+	}
+};
+#endif // SERVICEINDEX_H
@@ -0,0 +1,158 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "servicepayload.h"
+
+#include "core_memusage.h"
+#include "memusage.h"
+#include "primitives/transaction.h"
+
+CServicePayloadCache servicePayloadCache;
+
+/**
+ * Decode a service script the way Decode<Service>Script does, with the arguments
+ * as views into script.
+ */
+static bool DecodeServiceScript(const CScript& script, int nService, bool (*fnIsOp)(int), int& op, CServiceArgs& vvch) {
+	CScript::const_iterator pc = script.begin();
+	opcodetype opcode;
+	vvch.clear();
+	if (!script.GetOp(pc, opcode))
+		return false;
+	if (opcode < OP_1 || opcode > OP_16)
+		return false;
+	op = CScript::DecodeOP_N(opcode);
+	if (op != nService)
+		return false;
+	if (!script.GetOp(pc, opcode))
+		return false;
+	if (opcode < OP_1 || opcode > OP_16)
+		return false;
+	op = CScript::DecodeOP_N(opcode);
+	if (!fnIsOp(op))
+		return false;
+	for (;;) {
+		const CScript::const_iterator pcArg = pc;
+		if (!script.GetOp(pc, opcode))
+			return false;
+		if (opcode == OP_DROP || opcode == OP_2DROP)
+			return true;
+		if (!(opcode >= 0 && opcode <= OP_PUSHDATA4))
+			return false;
+		// the pushed bytes follow the opcode and its size field
+		const size_t nHeader = opcode < OP_PUSHDATA1 ? 1 : opcode == OP_PUSHDATA1 ? 2 : opcode == OP_PUSHDATA2 ? 3 : 5;
+		vvch.push_back(CServiceArg(&*pcArg + nHeader, (pc - pcArg) - nHeader));
+	}
+}
+/** Decode the first output of tx that is a script of the service, copying it to script for the views to point into */
+static bool DecodeServiceTx(const CTransaction& tx, int nService, bool (*fnIsOp)(int), int& op, CScript& script, CServiceArgs& vvch) {
+	for (const CTxOut& out : tx.vout) {
+		if (DecodeServiceScript(out.scriptPubKey, nService, fnIsOp, op, vvch)) {
+			script = out.scriptPubKey;
+			return DecodeServiceScript(script, nService, fnIsOp, op, vvch);
+		}
+	}
+	vvch.clear();
+	return false;
+}
+template<typename T>
+static std::shared_ptr<const T> DecodeServiceData(const std::vector<unsigned char>& vchData, const std::vector<unsigned char>& vchHash) {
+	std::shared_ptr<T> object = std::make_shared<T>();
+	if (!object->UnserializeFromData(vchData, vchHash))
+		return NULL;
+	return object;
+}
+CServicePayload::CServicePayload(const CTransaction& tx) : fAliasOutput(false), nAliasOp(0), type(SERVICE_NONE), nOp(0), fOtherServiceOutput(false), nDataOut(-1), fDataValid(false), nUsage(0) {
+	if (tx.nVersion != BILLIECOIN_TX_VERSION)
+		return;
+	for (const CTxOut& out : tx.vout) {
+		int nService;
+		if (FindBilliecoinScriptOp(out.scriptPubKey, nService) && nService != OP_BILLIECOIN_ALIAS)
+			fOtherServiceOutput = true;
+	}
+	fAliasOutput = DecodeServiceTx(tx, OP_BILLIECOIN_ALIAS, IsAliasOp, nAliasOp, scriptAlias, vvchAliasArgs);
+	if (fOtherServiceOutput) {
+		if (DecodeServiceTx(tx, OP_BILLIECOIN_ASSET_ALLOCATION, IsAssetOp, nOp, scriptService, vvchArgs))
+			type = ASSETALLOCATION;
+		else if (DecodeServiceTx(tx, OP_BILLIECOIN_OFFER, IsOfferOp, nOp, scriptService, vvchArgs))
+			type = OFFER;
+		else if (DecodeServiceTx(tx, OP_BILLIECOIN_CERT, IsCertOp, nOp, scriptService, vvchArgs))
+			type = CERT;
+		else if (DecodeServiceTx(tx, OP_BILLIECOIN_ESCROW, IsEscrowOp, nOp, scriptService, vvchArgs))
+			type = ESCROW;
+		else if (DecodeServiceTx(tx, OP_BILLIECOIN_ASSET, IsAssetOp, nOp, scriptService, vvchArgs))
+			type = ASSET;
+	}
+	if (type == SERVICE_NONE)
+		nOp = 0;
+
+	std::vector<unsigned char> vchData;
+	nDataOut = GetBilliecoinDataOutput(tx);
+	if (nDataOut >= 0 && GetBilliecoinData(tx.vout[nDataOut].scriptPubKey, vchData, vchDataHash)) {
+		if (type == ASSETALLOCATION || (type == ASSET && nOp == OP_ASSET_SEND))
+			assetAllocation = DecodeServiceData<CAssetAllocation>(vchData, vchDataHash);
+		else if (type == ASSET)
+			asset = DecodeServiceData<CAsset>(vchData, vchDataHash);
+		else if (type == OFFER)
+			offer = DecodeServiceData<COffer>(vchData, vchDataHash);
+		else if (type == CERT)
+			cert = DecodeServiceData<CCert>(vchData, vchDataHash);
+		else if (type == ESCROW)
+			escrow = DecodeServiceData<CEscrow>(vchData, vchDataHash);
+		fDataValid = assetAllocation || asset || offer || cert || escrow;
+		// data that is not the service's may still be an alias, CheckAliasInputs only reads
+		// it from a transaction without other service outputs
+		if (!fDataValid)
+			alias = DecodeServiceData<CAliasIndex>(vchData, vchDataHash);
+	}
+
+	nUsage = vvchAliasArgs.DynamicMemoryUsage() + vvchArgs.DynamicMemoryUsage() + memusage::DynamicUsage(vchDataHash) +
+		RecursiveDynamicUsage(scriptAlias) + RecursiveDynamicUsage(scriptService) +
+		memusage::DynamicUsage(assetAllocation) + memusage::DynamicUsage(asset) + memusage::DynamicUsage(offer) +
+		memusage::DynamicUsage(cert) + memusage::DynamicUsage(escrow) + memusage::DynamicUsage(alias);
+	if ((fDataValid || alias) && nDataOut >= 0)
+		nUsage += tx.vout[nDataOut].scriptPubKey.size();
+}
+bool CServicePayload::GetParsedType(int& op, char& typeOut) const {
+	if (fDataValid) {
+		op = nOp;
+		// an asset send carries an allocation
+		typeOut = type == ASSET && nOp == OP_ASSET_SEND ? ASSETALLOCATION : type;
+		return true;
+	}
+	if (fAliasOutput && alias) {
+		op = nAliasOp;
+		typeOut = ALIAS;
+		return true;
+	}
+	return false;
+}
+size_t CServicePayloadCache::GetPayloadUsage(const CServicePayloadRef& payload) {
+	return memusage::DynamicUsage(payload) + payload->DynamicMemoryUsage();
+}
+CServicePayloadRef CServicePayloadCache::Get(const CTransaction& tx) {
+	const uint256& txHash = tx.GetHash();
+	CServicePayloadRef payload;
+	if (cache.Get(txHash, payload))
+		return payload;
+	// decode outside the lock, if another thread raced us both results are identical
+	payload = std::make_shared<const CServicePayload>(tx);
+	cache.Insert(txHash, payload, cache.GetGeneration());
+	return payload;
+}
+void CServicePayloadCache::Clear() {
+	cache.Clear();
+}
+size_t CServicePayloadCache::Size() const {
+	return cache.Size();
+}
+size_t CServicePayloadCache::DynamicMemoryUsage() const {
+	return cache.DynamicMemoryUsage();
+}
+CServicePayloadRef GetServicePayload(const CTransaction& tx) {
+	static const CServicePayloadRef emptyPayload = std::make_shared<const CServicePayload>(CTransaction());
+	if (tx.nVersion != BILLIECOIN_TX_VERSION)
+		return emptyPayload;
+	return servicePayloadCache.Get(tx);
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SERVICEPAYLOAD_H
+#define SERVICEPAYLOAD_H
+
+#include "alias.h"
+#include "asset.h"
+#include "assetallocation.h"
+#include "cert.h"
+#include "escrow.h"
+#include "offer.h"
+#include "serviceargs.h"
+#include "servicecache.h"
+#include "uint256.h"
+
+#include <memory>
+#include <vector>
+
+class CTransaction;
+
+/** Default memory in bytes the decoded service payloads kept by servicePayloadCache may use */
+static const size_t DEFAULT_SERVICE_PAYLOAD_CACHE_USAGE = 32 << 20;
+
+/**
+ * The billiecoin service outputs of one transaction, decoded once.
+ *
+ * Holds the result of DecodeAliasTx and of the first of DecodeAssetAllocationTx,
+ * DecodeOfferTx, DecodeCertTx, DecodeEscrowTx and DecodeAssetTx that matches,
+ * tried in the order CheckBilliecoinInputs tries them. The arguments are views
+ * into the payload's own copy of the output script they were pushed by. The data
+ * output is deserialized into the object of the service, or else into an alias.
+ * A payload never changes once built and is shared by the mempool entry, block
+ * validation, block assembly, the wallet and the RPCs through GetServicePayload().
+ */
+class CServicePayload
+{
+public:
+	/** type of a transaction that carries no service output besides an optional alias */
+	static const char SERVICE_NONE = -1;
+
+	bool fAliasOutput;
+	int nAliasOp;
+	CServiceArgs vvchAliasArgs;
+
+	/** one of ASSETALLOCATION, OFFER, CERT, ESCROW, ASSET or SERVICE_NONE */
+	char type;
+	int nOp;
+	CServiceArgs vvchArgs;
+	/** whether an output starts like a service script other than an alias, decoded or not */
+	bool fOtherServiceOutput;
+
+	/** index of the data output, -1 if there is none */
+	int nDataOut;
+	/** hash pushed by the data output */
+	std::vector<unsigned char> vchDataHash;
+	/** whether the data output holds a valid object of type */
+	bool fDataValid;
+
+	/** set when type is ASSETALLOCATION, or ASSET with OP_ASSET_SEND, and the data is valid */
+	std::shared_ptr<const CAssetAllocation> assetAllocation;
+	/** set when type is ASSET, not sending, and the data is valid */
+	std::shared_ptr<const CAsset> asset;
+	/** set when type is OFFER and the data is valid */
+	std::shared_ptr<const COffer> offer;
+	/** set when type is CERT and the data is valid */
+	std::shared_ptr<const CCert> cert;
+	/** set when type is ESCROW and the data is valid */
+	std::shared_ptr<const CEscrow> escrow;
+	/** set when the data is a valid alias and not a valid object of type */
+	std::shared_ptr<const CAliasIndex> alias;
+
+	explicit CServicePayload(const CTransaction& tx);
+	// the argument views point into this object
+	CServicePayload(const CServicePayload&) = delete;
+	CServicePayload& operator=(const CServicePayload&) = delete;
+
+	bool IsService() const { return type != SERVICE_NONE; }
+	bool IsAssetAllocation() const { return type == ASSETALLOCATION; }
+	/** The op and type DecodeAndParseBilliecoinTx reports, false when no service data parses */
+	bool GetParsedType(int& op, char& typeOut) const;
+	/** Heap memory of the payload, a decoded object is taken to use as much as the data output it was read from */
+	size_t DynamicMemoryUsage() const { return nUsage; }
+
+private:
+	CScript scriptAlias;
+	CScript scriptService;
+	size_t nUsage;
+};
+typedef std::shared_ptr<const CServicePayload> CServicePayloadRef;
+
+/** Decoded payloads keyed by txid, the least recently used are dropped once they use more than nMaxUsage bytes */
+class CServicePayloadCache
+{
+private:
+	CServiceCache<uint256, CServicePayloadRef> cache;
+	static size_t GetPayloadUsage(const CServicePayloadRef& payload);
+
+public:
+	explicit CServicePayloadCache(size_t nMaxUsage = DEFAULT_SERVICE_PAYLOAD_CACHE_USAGE) : cache(&GetPayloadUsage, nMaxUsage) {}
+
+	/** The payload of tx, decoding and caching it if it is not cached yet */
+	CServicePayloadRef Get(const CTransaction& tx);
+	void Clear();
+	size_t Size() const;
+	size_t DynamicMemoryUsage() const;
+};
+extern CServicePayloadCache servicePayloadCache;
+
+/**
+ * The decoded service payload of a transaction. Non-billiecoin transactions share
+ * one empty payload and are not cached.
+ */
+CServicePayloadRef GetServicePayload(const CTransaction& tx);
+
+#endif // SERVICEPAYLOAD_H
@@ -0,0 +1,352 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "snapshot.h"
+#include "alias.h"
+#include "base58.h"
+#include "chain.h"
+#include "fs.h"
+#include "init.h"
+#include "rpc/server.h"
+#include "streams.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "util.h"
+#include "utilmoneystr.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+/**
+ * Binary snapshot files hold, in the disk serialization of the node:
+ *  - the magic "BSNP" and SNAPSHOT_VERSION (4 bytes)
+ *  - the hash (32 bytes) and height (4 bytes) of the block scanned
+ *  - the number of rows (CompactSize)
+ *  - per row the address type (1 byte, 1 for a key and 2 for a script hash),
+ *    the address hash (20 bytes), the current alias name (CompactSize length
+ *    and name, empty if none) and the amount in satoshis (8 bytes)
+ * The alias database keeps no history, so the alias of a row is the one the
+ * address belongs to when the file is written, not at the block scanned.
+ */
+static const unsigned char SNAPSHOT_MAGIC[4] = {'B', 'S', 'N', 'P'};
+
+struct CSnapshotScan::CPart
+{
+	std::unique_ptr<CCoinsViewCursor> pcursor;
+	// first bytes of the txids walked by this part, the end excluded
+	int nBegin;
+	int nEnd;
+	// first byte of the txid being read, for reporting progress
+	std::atomic<int> nPosition;
+	std::atomic<bool> fDone;
+	bool fFailed;
+	uint64_t nOutputs;
+	uint64_t nSkipped;
+	std::map<CTxDestination, CAmount> mapBalances;
+
+	CPart(const int nBeginIn, const int nEndIn) : nBegin(nBeginIn), nEnd(nEndIn), nPosition(nBeginIn), fDone(false), fFailed(false), nOutputs(0), nSkipped(0) {}
+};
+
+CSnapshotScan::CSnapshotScan(const CCoinsViewDB& view, const int nThreads)
+{
+	const int nParts = std::max(1, std::min(nThreads, MAX_SNAPSHOT_THREADS));
+	for (int i = 0; i < nParts; i++) {
+		std::unique_ptr<CPart> part(new CPart(256 * i / nParts, 256 * (i + 1) / nParts));
+		uint256 hashStart;
+		*hashStart.begin() = part->nBegin;
+		part->pcursor.reset(view.Cursor(hashStart));
+		vParts.push_back(std::move(part));
+	}
+	hashBlock = vParts[0]->pcursor->GetBestBlock();
+}
+
+CSnapshotScan::~CSnapshotScan()
+{
+}
+
+void CSnapshotScan::ScanPart(CPart& part)
+{
+	RenameThread("billiecoin-snapshot");
+	try {
+		CCoinsViewCursor& cursor = *part.pcursor;
+		for (; cursor.Valid(); cursor.Next()) {
+			boost::this_thread::interruption_point();
+			COutPoint key;
+			Coin coin;
+			if (!cursor.GetKey(key) || !cursor.GetValue(coin)) {
+				LogPrintf("%s: unable to read coin\n", __func__);
+				part.fFailed = true;
+				break;
+			}
+			const int nPosition = *key.hash.begin();
+			if (nPosition >= part.nEnd)
+				break;
+			part.nPosition = nPosition;
+
+			// service outputs pay to the address behind their prefix
+			CScript scriptPubKey;
+			if (!RemoveBilliecoinScript(coin.out.scriptPubKey, scriptPubKey))
+				scriptPubKey = coin.out.scriptPubKey;
+			CTxDestination dest;
+			if (coin.out.nValue <= 0 || !ExtractDestination(scriptPubKey, dest)) {
+				part.nSkipped++;
+				continue;
+			}
+			part.mapBalances[dest] += coin.out.nValue;
+			part.nOutputs++;
+		}
+	}
+	catch (const boost::thread_interrupted&) {
+		part.fFailed = true;
+	}
+	catch (const std::exception& e) {
+		LogPrintf("%s: %s\n", __func__, e.what());
+		part.fFailed = true;
+	}
+	part.fDone = true;
+}
+
+int CSnapshotScan::GetProgress() const
+{
+	double dProgress = 0;
+	for (const auto& part : vParts) {
+		if (part->fDone)
+			dProgress += 1;
+		else
+			dProgress += (double)(part->nPosition - part->nBegin) / (part->nEnd - part->nBegin);
+	}
+	return (int)(dProgress * 100 / vParts.size());
+}
+
+bool CSnapshotScan::Run(CSnapshotBalances& balances)
+{
+	const std::string strProgress = _("Creating snapshot...");
+	uiInterface.ShowProgress(strProgress, 0);
+	boost::thread_group threads;
+	for (auto& part : vParts)
+		threads.create_thread(boost::bind(&CSnapshotScan::ScanPart, boost::ref(*part)));
+
+	int64_t nLastLog = GetTimeMillis();
+	while (!std::all_of(vParts.begin(), vParts.end(), [](const std::unique_ptr<CPart>& part) { return part->fDone.load(); })) {
+		MilliSleep(100);
+		if (ShutdownRequested())
+			threads.interrupt_all();
+		const int nProgress = GetProgress();
+		uiInterface.ShowProgress(strProgress, std::max(1, std::min(99, nProgress)));
+		if (GetTimeMillis() - nLastLog >= 10000) {
+			LogPrintf("Snapshot of block %s: %d%% scanned\n", hashBlock.GetHex(), nProgress);
+			nLastLog = GetTimeMillis();
+		}
+	}
+	threads.join_all();
+	uiInterface.ShowProgress(strProgress, 100);
+
+	balances.hashBlock = hashBlock;
+	balances.nOutputs = 0;
+	balances.nSkipped = 0;
+	balances.mapBalances.clear();
+	bool fFailed = false;
+	for (auto& part : vParts) {
+		fFailed |= part->fFailed;
+		balances.nOutputs += part->nOutputs;
+		balances.nSkipped += part->nSkipped;
+		// the parts hold disjoint outputs but an address may appear in several
+		if (balances.mapBalances.size() < part->mapBalances.size())
+			balances.mapBalances.swap(part->mapBalances);
+		for (const auto& balance : part->mapBalances)
+			balances.mapBalances[balance.first] += balance.second;
+		part->mapBalances.clear();
+	}
+	return !fFailed;
+}
+
+/**
+ * The alias an address belongs to now, read from the live alias database, if it
+ * had not expired by nMedianTime. Changes after the snapshot block show through.
+ */
+static std::string GetCurrentAlias(const std::string& strAddress, const int64_t nMedianTime)
+{
+	std::vector<unsigned char> vchAddress, vchAlias;
+	CAliasIndex alias;
+	if (!paliasdb || !DecodeBase58(strAddress, vchAddress))
+		return "";
+	if (!paliasdb->ReadAddress(vchAddress, vchAlias) || !paliasdb->ReadAlias(vchAlias, alias))
+		return "";
+	if (alias.nExpireTime <= (uint64_t)nMedianTime)
+		return "";
+	return stringFromVch(vchAlias);
+}
+
+bool WriteSnapshot(const boost::filesystem::path& path, const CSnapshotBalances& balances, const CSnapshotOptions& options, uint64_t& nRows, CAmount& nTotal, std::string& strError)
+{
+	struct CSnapshotRow
+	{
+		CBilliecoinAddress address;
+		std::string strCurrentAlias;
+		CAmount nAmount;
+	};
+	std::vector<CSnapshotRow> vRows;
+	nRows = 0;
+	nTotal = 0;
+	for (const auto& balance : balances.mapBalances) {
+		if (balance.second < options.nMinAmount)
+			continue;
+		const CBilliecoinAddress address(balance.first);
+		const std::string strAddress = address.ToString();
+		if (options.setExclude.count(strAddress))
+			continue;
+		const std::string strCurrentAlias = GetCurrentAlias(strAddress, balances.nMedianTime);
+		if (!strCurrentAlias.empty() && options.setExclude.count(strCurrentAlias))
+			continue;
+		vRows.push_back(CSnapshotRow{address, strCurrentAlias, balance.second});
+	}
+
+	// write next to the destination and move over it once complete
+	const boost::filesystem::path pathTmp = path.string() + ".new";
+	CAutoFile fileout(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+	if (fileout.IsNull()) {
+		strError = strprintf("Cannot open %s for writing", pathTmp.string());
+		return false;
+	}
+	try {
+		if (options.fBinary) {
+			fileout.write((const char*)SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+			fileout << SNAPSHOT_VERSION << balances.hashBlock << balances.nHeight;
+			WriteCompactSize(fileout, vRows.size());
+			for (const auto& row : vRows) {
+				uint160 hashBytes;
+				int type = 0;
+				if (!row.address.GetIndexKey(hashBytes, type)) {
+					strError = strprintf("Cannot serialize address %s", row.address.ToString());
+					return false;
+				}
+				fileout << (unsigned char)type << hashBytes << vchFromString(row.strCurrentAlias) << row.nAmount;
+				nTotal += row.nAmount;
+			}
+		}
+		else {
+			std::string strHeader = strprintf("# Snapshot of block %s at height %d\n", balances.hashBlock.GetHex(), balances.nHeight);
+			strHeader += "# address,current_alias,amount\n";
+			fileout.write(strHeader.data(), strHeader.size());
+			for (const auto& row : vRows) {
+				const std::string strLine = strprintf("%s,%s,%s\n", row.address.ToString(), row.strCurrentAlias, FormatMoney(row.nAmount));
+				fileout.write(strLine.data(), strLine.size());
+				nTotal += row.nAmount;
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		strError = strprintf("Cannot write %s: %s", pathTmp.string(), e.what());
+		return false;
+	}
+	FileCommit(fileout.Get());
+	fileout.fclose();
+	if (!RenameOver(pathTmp, path)) {
+		strError = strprintf("Cannot rename %s to %s", pathTmp.string(), path.string());
+		return false;
+	}
+	nRows = vRows.size();
+	return true;
+}
+
+UniValue dumpsnapshot(const JSONRPCRequest& request)
+{
+	const UniValue &params = request.params;
+	if (request.fHelp || params.size() < 1 || params.size() > 2)
+		throw std::runtime_error(
+			"dumpsnapshot \"filename\" ( {\"min_amount\":n,\"exclude\":[...],\"format\":\"csv|binary\",\"threads\":n} )\n"
+			"\nWrites the balance of every address holding unspent outputs at the current tip to a file, with the alias of the address.\n"
+			"Service outputs count towards the address they pay to. Aliases expired by the median time past of the tip are left out.\n"
+			"The current_alias column is live data: it is the alias the address belongs to when the file is written, blocks connected\n"
+			"during the scan can change it.\n"
+			"The unspent outputs are scanned by several threads without holding up block processing.\n"
+			"\nArguments:\n"
+			"1. \"filename\"          (string, required) The file to write, overwritten if it exists\n"
+			"2. options             (object, optional)\n"
+			"    {\n"
+			"      \"min_amount\": n,    (numeric, optional, default=0) Leave out addresses holding less than this\n"
+			"      \"exclude\": [...],   (array, optional) Addresses and alias names to leave out\n"
+			"      \"format\": \"csv\",    (string, optional, default=csv) csv for lines of address,current_alias,amount or binary\n"
+			"      \"threads\": n        (numeric, optional, default=cores) Threads scanning the unspent outputs, up to " + std::to_string(MAX_SNAPSHOT_THREADS) + "\n"
+			"    }\n"
+			"\nResult:\n"
+			"{\n"
+			"  \"filename\": \"xxx\",    (string) The file written\n"
+			"  \"height\": n,           (numeric) The height of the block scanned\n"
+			"  \"bestblock\": \"hash\",  (string) The hash of the block scanned\n"
+			"  \"outputs\": n,          (numeric) Unspent outputs paying to an address\n"
+			"  \"skipped\": n,          (numeric) Unspent outputs paying to no address\n"
+			"  \"addresses\": n,        (numeric) Addresses written\n"
+			"  \"total_amount\": x.xxx  (numeric) Sum of the amounts written\n"
+			"}\n"
+			"\nExamples:\n"
+			+ HelpExampleCli("dumpsnapshot", "\"/tmp/snapshot.csv\"")
+			+ HelpExampleCli("dumpsnapshot", "\"/tmp/snapshot.bin\" '{\"min_amount\":1,\"format\":\"binary\"}'")
+			+ HelpExampleRpc("dumpsnapshot", "\"/tmp/snapshot.csv\", {\"exclude\":[\"burn\"]}")
+		);
+	const boost::filesystem::path path(params[0].get_str());
+	CSnapshotOptions options;
+	int nThreads = GetNumCores();
+	if (params.size() > 1) {
+		const UniValue& opts = params[1].get_obj();
+		RPCTypeCheckObj(opts,
+			{
+				{ "min_amount", UniValueType() },
+				{ "exclude", UniValueType(UniValue::VARR) },
+				{ "format", UniValueType(UniValue::VSTR) },
+				{ "threads", UniValueType(UniValue::VNUM) },
+			}, true, true);
+		if (opts.exists("min_amount"))
+			options.nMinAmount = AmountFromValue(opts["min_amount"]);
+		if (opts.exists("exclude")) {
+			const UniValue& exclude = opts["exclude"].get_array();
+			for (unsigned int i = 0; i < exclude.size(); i++)
+				options.setExclude.insert(exclude[i].get_str());
+		}
+		if (opts.exists("format")) {
+			const std::string& strFormat = opts["format"].get_str();
+			if (strFormat != "csv" && strFormat != "binary")
+				throw JSONRPCError(RPC_INVALID_PARAMETER, "format must be csv or binary");
+			options.fBinary = strFormat == "binary";
+		}
+		if (opts.exists("threads")) {
+			nThreads = opts["threads"].get_int();
+			if (nThreads < 1 || nThreads > MAX_SNAPSHOT_THREADS)
+				throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("threads must be between 1 and %d", MAX_SNAPSHOT_THREADS));
+		}
+	}
+
+	// open the cursors on the flushed tip, then scan without cs_main
+	std::unique_ptr<CSnapshotScan> scan;
+	CSnapshotBalances balances;
+	{
+		LOCK(cs_main);
+		FlushStateToDisk();
+		scan.reset(new CSnapshotScan(*pcoinsdbview, nThreads));
+		balances.nHeight = chainActive.Height();
+		balances.nMedianTime = chainActive.Tip()->GetMedianTimePast();
+	}
+	if (!scan->Run(balances))
+		throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to scan the unspent outputs");
+
+	uint64_t nRows = 0;
+	CAmount nTotal = 0;
+	std::string strError;
+	if (!WriteSnapshot(path, balances, options, nRows, nTotal, strError))
+		throw JSONRPCError(RPC_INTERNAL_ERROR, strError);
+
+	UniValue res(UniValue::VOBJ);
+	res.push_back(Pair("filename", path.string()));
+	res.push_back(Pair("height", balances.nHeight));
+	res.push_back(Pair("bestblock", balances.hashBlock.GetHex()));
+	res.push_back(Pair("outputs", balances.nOutputs));
+	res.push_back(Pair("skipped", balances.nSkipped));
+	res.push_back(Pair("addresses", nRows));
+	res.push_back(Pair("total_amount", ValueFromAmount(nTotal)));
+	return res;
+}
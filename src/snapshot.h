@@ -0,0 +1,89 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "amount.h"
+#include "script/standard.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+class CCoinsViewCursor;
+class CCoinsViewDB;
+
+/** Most threads a snapshot scan splits the unspent outputs between */
+static const int MAX_SNAPSHOT_THREADS = 64;
+/** Layout version of binary snapshot files, written after the "BSNP" magic */
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+/** The balances of the addresses holding unspent outputs at one block */
+struct CSnapshotBalances
+{
+	uint256 hashBlock;
+	int nHeight;
+	// median time past of the block, current aliases that had expired by then are left out
+	int64_t nMedianTime;
+	uint64_t nOutputs;
+	// outputs that pay to no address
+	uint64_t nSkipped;
+	std::map<CTxDestination, CAmount> mapBalances;
+
+	CSnapshotBalances() : nHeight(0), nMedianTime(0), nOutputs(0), nSkipped(0) {}
+};
+
+/**
+ * Sums up the unspent outputs of the coin database by the address they pay
+ * to, alias and other service outputs by the address behind their script.
+ * The txid space is split between threads walking cursors of their own.
+ * The cursors are all opened by the constructor, each reads the database as
+ * it was then, so the caller only needs to keep the database from changing
+ * while constructing and can let go of cs_main for the scan itself.
+ */
+class CSnapshotScan
+{
+public:
+	CSnapshotScan(const CCoinsViewDB& view, const int nThreads);
+	~CSnapshotScan();
+
+	/** Scan with one thread per cursor, reporting progress until done */
+	bool Run(CSnapshotBalances& balances);
+
+private:
+	struct CPart;
+	uint256 hashBlock;
+	std::vector<std::unique_ptr<CPart> > vParts;
+
+	static void ScanPart(CPart& part);
+	int GetProgress() const;
+};
+
+/** Which rows a snapshot file holds and how */
+struct CSnapshotOptions
+{
+	CAmount nMinAmount;
+	// addresses and alias names whose rows are left out
+	std::set<std::string> setExclude;
+	bool fBinary;
+
+	CSnapshotOptions() : nMinAmount(0), fBinary(false) {}
+};
+
+/**
+ * Write the balances with the current alias of each address to path, as CSV
+ * lines of address,current_alias,amount or in the binary layout documented in
+ * snapshot.cpp. Aliases are read from the live alias database, not as of the
+ * block the balances were scanned at.
+ */
+bool WriteSnapshot(const boost::filesystem::path& path, const CSnapshotBalances& balances, const CSnapshotOptions& options, uint64_t& nRows, CAmount& nTotal, std::string& strError);
+
+#endif // SNAPSHOT_H
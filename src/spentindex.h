@@ -236,6 +236,56 @@ struct CAddressUnspentValue {
     }
 };
 
+// BILLIECOIN
+// the unspent alias outputs of an alias, by the address they pay to
+struct CAliasUnspentKey {
+    std::vector<unsigned char> vchAlias;
+    std::vector<unsigned char> vchGUID;
+    unsigned int type;
+    uint160 hashBytes;
+    uint256 txhash;
+    unsigned int index;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(vchAlias);
+        READWRITE(vchGUID);
+        READWRITE(type);
+        READWRITE(hashBytes);
+        READWRITE(txhash);
+        READWRITE(index);
+    }
+
+    CAliasUnspentKey(const std::vector<unsigned char> &alias, const std::vector<unsigned char> &guid, unsigned int addressType, uint160 addressHash, uint256 txid, unsigned int indexValue) {
+        vchAlias = alias;
+        vchGUID = guid;
+        type = addressType;
+        hashBytes = addressHash;
+        txhash = txid;
+        index = indexValue;
+    }
+
+    CAliasUnspentKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        vchAlias.clear();
+        vchGUID.clear();
+        type = 0;
+        hashBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+    }
+
+    // whether both keys belong to the same alias and address
+    bool IsSameOwner(const CAliasUnspentKey &other) const {
+        return vchAlias == other.vchAlias && vchGUID == other.vchGUID && type == other.type && hashBytes == other.hashBytes;
+    }
+};
+
 struct CAddressIndexKey {
     unsigned int type;
     uint160 hashBytes;
@@ -0,0 +1,126 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "alias.h"
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "key.h"
+#include "script/standard.h"
+#include "spentindex.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "validation.h"
+
+#include "test/test_billiecoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(aliasunspentindex_tests, TestChain100Setup)
+
+static std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > ReadAliasUnspent(const CAliasUnspentKey& owner)
+{
+    std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    BOOST_CHECK(pblocktree->ReadAliasUnspentIndex(owner, unspentOutputs));
+    return unspentOutputs;
+}
+
+static void SignInput(CMutableTransaction& tx, const CScript& scriptPrev, const CKey& key, bool fPushPubKey)
+{
+    std::vector<unsigned char> vchSig;
+    const uint256 hash = SignatureHash(scriptPrev, tx, 0, SIGHASH_ALL);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig = CScript() << vchSig;
+    if (fPushPubKey)
+        tx.vin[0].scriptSig << ToByteVector(key.GetPubKey());
+}
+
+static void DisconnectTip()
+{
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    BOOST_CHECK(state.IsValid());
+    mempool.clear();
+}
+
+BOOST_AUTO_TEST_CASE(aliasunspentindex_connect_disconnect)
+{
+    const bool fAddressIndexOld = fAddressIndex;
+    fAddressIndex = true;
+
+    CScript scriptCoinbase = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CKey aliasKey;
+    aliasKey.MakeNewKey(true);
+    const std::vector<unsigned char> vchAlias = vchFromString("jagunspent");
+    const std::vector<unsigned char> vchGUID = vchFromString("guid");
+    CScript scriptAlias;
+    scriptAlias << CScript::EncodeOP_N(OP_BILLIECOIN_ALIAS) << CScript::EncodeOP_N(OP_ALIAS_UPDATE) << vchAlias << vchGUID << vchFromString("hash") << OP_2DROP << OP_2DROP << OP_DROP;
+    scriptAlias += GetScriptForDestination(aliasKey.GetPubKey().GetID());
+    const CAliasUnspentKey owner(vchAlias, vchGUID, 1, aliasKey.GetPubKey().GetID(), uint256(), 0);
+
+    // an alias output and a plain output paying to the same key
+    CMutableTransaction txAlias;
+    txAlias.nVersion = 1;
+    txAlias.vin.resize(1);
+    txAlias.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    txAlias.vout.resize(2);
+    txAlias.vout[0].nValue = 11 * CENT;
+    txAlias.vout[0].scriptPubKey = scriptAlias;
+    txAlias.vout[1].nValue = 11 * CENT;
+    txAlias.vout[1].scriptPubKey = GetScriptForDestination(aliasKey.GetPubKey().GetID());
+    SignInput(txAlias, scriptCoinbase, coinbaseKey, false);
+
+    BOOST_CHECK(ReadAliasUnspent(owner).empty());
+    CBlock block = CreateAndProcessBlock(std::vector<CMutableTransaction>(1, txAlias), scriptCoinbase);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    const int nAliasHeight = chainActive.Height();
+
+    // connecting adds the alias output only
+    std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > unspentOutputs = ReadAliasUnspent(owner);
+    BOOST_CHECK_EQUAL(unspentOutputs.size(), 1U);
+    if (!unspentOutputs.empty()) {
+        BOOST_CHECK(unspentOutputs[0].first.txhash == txAlias.GetHash());
+        BOOST_CHECK_EQUAL(unspentOutputs[0].first.index, 0U);
+        BOOST_CHECK_EQUAL(unspentOutputs[0].second.finneas, 11 * CENT);
+        BOOST_CHECK(unspentOutputs[0].second.script == scriptAlias);
+        BOOST_CHECK_EQUAL(unspentOutputs[0].second.blockHeight, nAliasHeight);
+    }
+
+    // spending the alias output removes it
+    CMutableTransaction txSpend;
+    txSpend.nVersion = 1;
+    txSpend.vin.resize(1);
+    txSpend.vin[0].prevout = COutPoint(txAlias.GetHash(), 0);
+    txSpend.vout.resize(1);
+    txSpend.vout[0].nValue = 10 * CENT;
+    txSpend.vout[0].scriptPubKey = scriptCoinbase;
+    SignInput(txSpend, scriptAlias, aliasKey, true);
+    block = CreateAndProcessBlock(std::vector<CMutableTransaction>(1, txSpend), scriptCoinbase);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    BOOST_CHECK(ReadAliasUnspent(owner).empty());
+
+    // disconnecting the spend brings the output back as it was
+    DisconnectTip();
+    BOOST_CHECK_EQUAL(chainActive.Height(), nAliasHeight);
+    unspentOutputs = ReadAliasUnspent(owner);
+    BOOST_CHECK_EQUAL(unspentOutputs.size(), 1U);
+    if (!unspentOutputs.empty()) {
+        BOOST_CHECK(unspentOutputs[0].first.txhash == txAlias.GetHash());
+        BOOST_CHECK_EQUAL(unspentOutputs[0].second.finneas, 11 * CENT);
+        BOOST_CHECK(unspentOutputs[0].second.script == scriptAlias);
+        BOOST_CHECK_EQUAL(unspentOutputs[0].second.blockHeight, nAliasHeight);
+    }
+
+    // disconnecting the block that created it removes it
+    DisconnectTip();
+    BOOST_CHECK_EQUAL(chainActive.Height(), nAliasHeight - 1);
+    BOOST_CHECK(ReadAliasUnspent(owner).empty());
+
+    fAddressIndex = fAddressIndexOld;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
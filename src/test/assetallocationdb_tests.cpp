@@ -0,0 +1,209 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "assetallocation.h"
+
+#include "alias.h"
+#include "test/test_billiecoin.h"
+
+#include <map>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(assetallocationdb_tests, TestingSetup)
+
+// an entry the way BuildAssetAllocationIndexerJson wrote it
+static UniValue LegacyIndexEntry(const uint256& txid, const std::string& strAsset, const std::string& strSender, const std::string& strReceiver, int nHeight, const std::string& strBalance, const std::string& strAmount)
+{
+    UniValue oEntry(UniValue::VOBJ);
+    oEntry.push_back(Pair("_id", strAsset + "-" + strSender));
+    oEntry.push_back(Pair("txid", txid.GetHex()));
+    oEntry.push_back(Pair("time", (int64_t)1500000000 + nHeight));
+    oEntry.push_back(Pair("asset", strAsset));
+    oEntry.push_back(Pair("symbol", "SYM"));
+    oEntry.push_back(Pair("interest_rate", 0.05f));
+    oEntry.push_back(Pair("height", nHeight));
+    oEntry.push_back(Pair("sender", strSender));
+    oEntry.push_back(Pair("sender_balance", UniValue(UniValue::VSTR, strBalance)));
+    oEntry.push_back(Pair("receiver", strReceiver));
+    oEntry.push_back(Pair("receiver_balance", UniValue(UniValue::VSTR, strBalance)));
+    oEntry.push_back(Pair("memo", "memo"));
+    oEntry.push_back(Pair("confirmed", true));
+    oEntry.push_back(Pair("category", "send"));
+    oEntry.push_back(Pair("amount", UniValue(UniValue::VSTR, strAmount)));
+    return oEntry;
+}
+
+static std::vector<std::string> ScanTxids(CAssetAllocationTransactionsDB& db, int count, int from, const UniValue& oOptions)
+{
+    RPCResultArray oRes;
+    BOOST_CHECK(db.ScanAssetAllocationIndex(count, from, oOptions, oRes));
+    const UniValue res = oRes.Finish();
+    std::vector<std::string> vTxids;
+    for (size_t i = 0; i < res.size(); i++)
+        vTxids.push_back(find_value(res[i], "txid").get_str());
+    return vTxids;
+}
+
+BOOST_AUTO_TEST_CASE(assetallocationdb_index_upgrade)
+{
+    CAssetAllocationTransactionsDB db(1 << 20, true, false);
+    const uint256 txid1 = uint256S("01"), txid2 = uint256S("02"), txid3 = uint256S("03");
+    const UniValue oEntry1 = LegacyIndexEntry(txid1, "asset1", "alias1", "alias2", 10, "100.00000000", "-1.25000000");
+    const UniValue oEntry2 = LegacyIndexEntry(txid2, "asset2", "alias2", "alias1", 20, "2.50000000", "0.00000001");
+    // an asset that is no longer known is read with the decimals it was written with
+    const UniValue oEntry3 = LegacyIndexEntry(txid3, "asset1", "alias1", "alias3", 30, "3.5", "7.0");
+
+    // the whole-map blob and a json entry under its own key
+    std::map<int, std::map<std::string, std::string> > mapIndex;
+    mapIndex[10][txid1.GetHex() + "-asset1-alias1-alias2"] = oEntry1.write();
+    mapIndex[20][txid2.GetHex() + "-asset2-alias2-alias1"] = oEntry2.write();
+    mapIndex[20]["not json"] = "{";
+    BOOST_CHECK(db.Write(std::string("assetallocationtxi"), mapIndex));
+    const CAssetAllocationIndexKey key3(30, txid3, "asset1", "alias1", "alias3");
+    BOOST_CHECK(db.Write(std::make_pair(std::string("assetallocationtxe"), key3), oEntry3.write()));
+    BOOST_CHECK(db.Write(std::make_pair(std::string("assetallocationtxa"), std::make_pair(key3.strAsset, key3)), std::string()));
+
+    BOOST_CHECK(db.UpgradeAssetAllocationIndex());
+    BOOST_CHECK(!db.Exists(std::string("assetallocationtxi")));
+    BOOST_CHECK(!db.Exists(std::make_pair(std::string("assetallocationtxe"), key3)));
+
+    // typed entries give back the json they were upgraded from, newest first
+    RPCResultArray oRes;
+    BOOST_CHECK(db.ScanAssetAllocationIndex(10, 0, NullUniValue, oRes));
+    const UniValue res = oRes.Finish();
+    BOOST_CHECK_EQUAL(res.size(), 3U);
+    BOOST_CHECK_EQUAL(res[0].write(), oEntry3.write());
+    BOOST_CHECK_EQUAL(res[1].write(), oEntry2.write());
+    BOOST_CHECK_EQUAL(res[2].write(), oEntry1.write());
+
+    CAssetAllocationIndexEntry entry;
+    BOOST_CHECK(db.ReadAssetAllocationIndexEntry(CAssetAllocationIndexKey(10, txid1, "asset1", "alias1", "alias2"), entry));
+    BOOST_CHECK_EQUAL(entry.nAmount, -125000000);
+    BOOST_CHECK_EQUAL(entry.nSenderBalance, 10000000000);
+    BOOST_CHECK_EQUAL(entry.nHeight, 10U);
+    BOOST_CHECK(entry.vchAliasOrAddress == vchFromString("alias1"));
+
+    // nothing is left to upgrade
+    BOOST_CHECK(db.UpgradeAssetAllocationIndex());
+    BOOST_CHECK_EQUAL(ScanTxids(db, 10, 0, NullUniValue).size(), 3U);
+}
+
+BOOST_AUTO_TEST_CASE(assetallocationdb_index_filters)
+{
+    CAssetAllocationTransactionsDB db(1 << 20, true, false);
+    std::vector<uint256> vTxids;
+    for (int i = 0; i < 6; i++) {
+        const uint256 txid = uint256S(strprintf("%02x", i + 1));
+        vTxids.push_back(txid);
+        CAssetAllocationIndexEntry entry;
+        entry.vchAliasOrAddress = vchFromString(i % 2 ? "alias1" : "alias2");
+        entry.nHeight = 10 * (i + 1);
+        entry.nAmount = i + 1;
+        const CAssetAllocationIndexKey key(10 * (i + 1), txid, i < 4 ? "asset1" : "asset2", i % 2 ? "alias1" : "alias2", i % 3 ? "alias3" : "alias4");
+        BOOST_CHECK(db.WriteAssetAllocationIndexEntry(key, entry));
+    }
+
+    std::vector<std::string> vResult = ScanTxids(db, 10, 0, NullUniValue);
+    BOOST_CHECK_EQUAL(vResult.size(), 6U);
+    BOOST_CHECK_EQUAL(vResult.front(), vTxids[5].GetHex());
+    BOOST_CHECK_EQUAL(vResult.back(), vTxids[0].GetHex());
+
+    UniValue oOptions(UniValue::VOBJ);
+    oOptions.push_back(Pair("asset", "asset2"));
+    vResult = ScanTxids(db, 10, 0, oOptions);
+    BOOST_CHECK_EQUAL(vResult.size(), 2U);
+    BOOST_CHECK_EQUAL(vResult[0], vTxids[5].GetHex());
+    BOOST_CHECK_EQUAL(vResult[1], vTxids[4].GetHex());
+
+    oOptions = UniValue(UniValue::VOBJ);
+    oOptions.push_back(Pair("txid", vTxids[2].GetHex()));
+    vResult = ScanTxids(db, 10, 0, oOptions);
+    BOOST_CHECK_EQUAL(vResult.size(), 1U);
+    BOOST_CHECK_EQUAL(vResult[0], vTxids[2].GetHex());
+
+    UniValue oSender(UniValue::VOBJ);
+    oSender.push_back(Pair("sender_alias", "alias1"));
+    UniValue senders(UniValue::VARR);
+    senders.push_back(oSender);
+    UniValue oReceiver(UniValue::VOBJ);
+    oReceiver.push_back(Pair("receiver_address", "alias4"));
+    UniValue receivers(UniValue::VARR);
+    receivers.push_back(oReceiver);
+    oOptions = UniValue(UniValue::VOBJ);
+    oOptions.push_back(Pair("senders", senders));
+    vResult = ScanTxids(db, 10, 0, oOptions);
+    BOOST_CHECK_EQUAL(vResult.size(), 3U);
+    oOptions.push_back(Pair("receivers", receivers));
+    vResult = ScanTxids(db, 10, 0, oOptions);
+    BOOST_CHECK_EQUAL(vResult.size(), 1U);
+    BOOST_CHECK_EQUAL(vResult[0], vTxids[3].GetHex());
+
+    // entries below the start block end the scan
+    oOptions = UniValue(UniValue::VOBJ);
+    oOptions.push_back(Pair("startblock", 30));
+    vResult = ScanTxids(db, 10, 0, oOptions);
+    BOOST_CHECK_EQUAL(vResult.size(), 4U);
+    BOOST_CHECK_EQUAL(vResult.back(), vTxids[2].GetHex());
+
+    // paging skips the first from matches
+    vResult = ScanTxids(db, 2, 3, NullUniValue);
+    BOOST_CHECK_EQUAL(vResult.size(), 2U);
+    BOOST_CHECK_EQUAL(vResult[0], vTxids[2].GetHex());
+    BOOST_CHECK_EQUAL(vResult[1], vTxids[1].GetHex());
+}
+
+BOOST_AUTO_TEST_CASE(assetallocationdb_arrival_times_upgrade)
+{
+    CAssetAllocationDB db(1 << 20, true, false);
+    const CAssetAllocationTuple tuple1(vchFromString("asset1"), vchFromString("alias1"));
+    const CAssetAllocationTuple tuple2(vchFromString("asset1"), vchFromString("alias2"));
+    const uint256 txid1 = uint256S("01"), txid2 = uint256S("02"), txid3 = uint256S("03"), txid4 = uint256S("04");
+
+    // a txid already in the log keeps its first arrival time
+    BOOST_CHECK(db.WriteISArrivalTime(tuple1, txid1, 5000));
+
+    // the whole-map blobs older versions wrote per allocation
+    ArrivalTimesMap mapArrivalTimes1;
+    mapArrivalTimes1[txid1] = 3000;
+    mapArrivalTimes1[txid2] = 1000;
+    mapArrivalTimes1[txid3] = 2000;
+    ArrivalTimesMap mapArrivalTimes2;
+    mapArrivalTimes2[txid4] = 500;
+    BOOST_CHECK(db.Write(std::make_pair(std::string("assetallocationa"), tuple1), mapArrivalTimes1));
+    BOOST_CHECK(db.Write(std::make_pair(std::string("assetallocationa"), tuple2), mapArrivalTimes2));
+
+    BOOST_CHECK(db.UpgradeArrivalTimes());
+    BOOST_CHECK(!db.Exists(std::make_pair(std::string("assetallocationa"), tuple1)));
+    BOOST_CHECK(!db.Exists(std::make_pair(std::string("assetallocationa"), tuple2)));
+
+    // the log of each allocation is in arrival order
+    ArrivalTimesList arrivalTimes;
+    BOOST_CHECK(db.ReadISArrivalTimes(tuple1, arrivalTimes));
+    BOOST_CHECK_EQUAL(arrivalTimes.size(), 3U);
+    if (arrivalTimes.size() == 3) {
+        BOOST_CHECK(arrivalTimes[0] == std::make_pair(txid2, (int64_t)1000));
+        BOOST_CHECK(arrivalTimes[1] == std::make_pair(txid3, (int64_t)2000));
+        BOOST_CHECK(arrivalTimes[2] == std::make_pair(txid1, (int64_t)5000));
+    }
+    BOOST_CHECK(db.ReadISArrivalTimes(tuple2, arrivalTimes));
+    BOOST_CHECK_EQUAL(arrivalTimes.size(), 1U);
+    BOOST_CHECK(arrivalTimes.front() == std::make_pair(txid4, (int64_t)500));
+
+    // and every txid points back at its time
+    int64_t nArrivalTime = 0;
+    BOOST_CHECK(db.ReadISArrivalTime(tuple1, txid3, nArrivalTime));
+    BOOST_CHECK_EQUAL(nArrivalTime, 2000);
+    BOOST_CHECK(db.ReadISArrivalTime(tuple1, txid1, nArrivalTime));
+    BOOST_CHECK_EQUAL(nArrivalTime, 5000);
+    BOOST_CHECK(!db.ReadISArrivalTime(tuple2, txid1, nArrivalTime));
+
+    // nothing is left to upgrade
+    BOOST_CHECK(db.UpgradeArrivalTimes());
+    BOOST_CHECK(db.ReadISArrivalTimes(tuple1, arrivalTimes));
+    BOOST_CHECK_EQUAL(arrivalTimes.size(), 3U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -274,4 +274,150 @@ BOOST_AUTO_TEST_CASE(generate_asset_allocation_send_address)
 	BOOST_CHECK_EQUAL(find_value(r.get_obj(), "status").get_int(), ZDAG_NOT_FOUND);
 
 }
+static void WaitForMempoolTx(const string& node, const string& txid)
+{
+	UniValue r;
+	for (int i = 0; i < 100; i++) {
+		BOOST_CHECK_NO_THROW(r = CallRPC(node, "getrawmempool"));
+		for (unsigned int j = 0; j < r.size(); j++) {
+			if (r[j].get_str() == txid)
+				return;
+		}
+		MilliSleep(100);
+	}
+	BOOST_ERROR("transaction " + txid + " did not reach the mempool of " + node);
+}
+// node2 checks every sender status it serves against a replay of the DB and the mempool, and aborts on a mismatch
+static void CheckSenderStatuses(const string& guid, const string& sender, const vector<string>& vTxids)
+{
+	UniValue r;
+	for (auto& txid : vTxids)
+		BOOST_CHECK_NO_THROW(r = CallRPC("node2", "assetallocationsenderstatus " + guid + " " + sender + " " + txid));
+	BOOST_CHECK_NO_THROW(r = CallRPC("node2", "assetallocationsenderstatus " + guid + " " + sender + " ''"));
+}
+BOOST_AUTO_TEST_CASE(generate_asset_allocation_send_ledger)
+{
+	UniValue r;
+	printf("Running generate_asset_allocation_send_ledger...\n");
+	StopNode("node2");
+	StartNode("node2", true, "-checkzdagledger");
+	GenerateBlocks(5);
+	AliasNew("node1", "jagallocledger1", "data");
+	AliasNew("node1", "jagallocledger2", "data");
+	string guid = AssetNew("node1", "ledger", "jagallocledger1", "data", "8", "false", "10", "-1");
+	AssetSend("node1", guid, "\"[{\\\"ownerto\\\":\\\"jagallocledger1\\\",\\\"amount\\\":5}]\"", "memo");
+	vector<string> vTxids;
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+
+	// pending sends added to the mempool
+	vTxids.push_back(AssetAllocationTransfer(true, "node1", guid, "jagallocledger1", "\"[{\\\"ownerto\\\":\\\"jagallocledger2\\\",\\\"amount\\\":1}]\"", "memo"));
+	WaitForMempoolTx("node2", vTxids.back());
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+	MilliSleep(1000);
+	vTxids.push_back(AssetAllocationTransfer(true, "node1", guid, "jagallocledger1", "\"[{\\\"ownerto\\\":\\\"jagallocledger2\\\",\\\"amount\\\":2}]\"", "memo"));
+	WaitForMempoolTx("node2", vTxids.back());
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+	MilliSleep(1500);
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+
+	// a send of another sender of the asset leaves the ledger of the first one as it is
+	vector<string> vTxidsOther;
+	CheckSenderStatuses(guid, "jagallocledger2", vTxidsOther);
+	vTxidsOther.push_back(AssetAllocationTransfer(true, "node1", guid, "jagallocledger2", "\"[{\\\"ownerto\\\":\\\"jagallocledger1\\\",\\\"amount\\\":0.25}]\"", "memo"));
+	WaitForMempoolTx("node2", vTxidsOther.back());
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+	CheckSenderStatuses(guid, "jagallocledger2", vTxidsOther);
+
+	// confirmed
+	GenerateBlocks(1);
+	BOOST_CHECK_NO_THROW(r = CallRPC("node1", "getinfo"));
+	const int nHeight = find_value(r.get_obj(), "blocks").get_int();
+	for (int i = 0; i < 100; i++) {
+		BOOST_CHECK_NO_THROW(r = CallRPC("node2", "getinfo"));
+		if (find_value(r.get_obj(), "blocks").get_int() >= nHeight)
+			break;
+		MilliSleep(100);
+	}
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+	vTxids.push_back(AssetAllocationTransfer(true, "node1", guid, "jagallocledger1", "\"[{\\\"ownerto\\\":\\\"jagallocledger2\\\",\\\"amount\\\":0.5}]\"", "memo"));
+	WaitForMempoolTx("node2", vTxids.back());
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+
+	// the block is disconnected on node2 and its sends go back to the mempool, then it is connected again
+	BOOST_CHECK_NO_THROW(r = CallRPC("node2", "getblockchaininfo"));
+	const string strBlockHash = find_value(r.get_obj(), "bestblockhash").get_str();
+	BOOST_CHECK_NO_THROW(CallRPC("node2", "invalidateblock " + strBlockHash, true, false));
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+	CheckSenderStatuses(guid, "jagallocledger2", vTxidsOther);
+	BOOST_CHECK_NO_THROW(CallRPC("node2", "reconsiderblock " + strBlockHash, true, false));
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+	CheckSenderStatuses(guid, "jagallocledger2", vTxidsOther);
+	MilliSleep(1500);
+	CheckSenderStatuses(guid, "jagallocledger1", vTxids);
+
+	StopNode("node2");
+	StartNode("node2");
+}
+BOOST_AUTO_TEST_CASE(generate_asset_allocation_send_parallel)
+{
+	UniValue r;
+	printf("Running generate_asset_allocation_send_parallel...\n");
+	// node2 connects the independent sends of a block concurrently, node3 connects them one by one
+	StopNode("node2");
+	StartNode("node2", true, "-par=4");
+	StopNode("node3");
+	StartNode("node3", true, "-par=1");
+	GenerateBlocks(5);
+	AliasNew("node1", "jagallocparallel1", "data");
+	AliasNew("node1", "jagallocparallel2", "data");
+	AliasNew("node1", "jagallocparallelrecv", "data");
+	string guid1 = AssetNew("node1", "par1", "jagallocparallel1", "data", "8", "false", "10", "-1");
+	string guid2 = AssetNew("node1", "par2", "jagallocparallel2", "data", "8", "false", "10", "-1");
+	AssetSend("node1", guid1, "\"[{\\\"ownerto\\\":\\\"jagallocparallel1\\\",\\\"amount\\\":5}]\"", "memo");
+	AssetSend("node1", guid2, "\"[{\\\"ownerto\\\":\\\"jagallocparallel2\\\",\\\"amount\\\":5}]\"", "memo");
+
+	// sends of two assets from two senders end up in two partitions of the same block, two of them from one sender
+	AssetAllocationTransfer(true, "node1", guid1, "jagallocparallel1", "\"[{\\\"ownerto\\\":\\\"jagallocparallelrecv\\\",\\\"amount\\\":1}]\"", "memo");
+	AssetAllocationTransfer(true, "node1", guid2, "jagallocparallel2", "\"[{\\\"ownerto\\\":\\\"jagallocparallelrecv\\\",\\\"amount\\\":2}]\"", "memo");
+	MilliSleep(1000);
+	AssetAllocationTransfer(true, "node1", guid1, "jagallocparallel1", "\"[{\\\"ownerto\\\":\\\"jagallocparallelrecv\\\",\\\"amount\\\":3}]\"", "memo");
+	GenerateBlocks(1);
+	BOOST_CHECK_NO_THROW(r = CallRPC("node1", "getinfo"));
+	const int nHeight = find_value(r.get_obj(), "blocks").get_int();
+	for (int i = 0; i < 100; i++) {
+		BOOST_CHECK_NO_THROW(r = CallRPC("node3", "getinfo"));
+		if (find_value(r.get_obj(), "blocks").get_int() >= nHeight)
+			break;
+		MilliSleep(100);
+	}
+
+	// both nodes end up with the same allocations and conflicts
+	const vector<pair<string, string> > vAllocations = {
+		make_pair(guid1, string("jagallocparallel1")),
+		make_pair(guid1, string("jagallocparallelrecv")),
+		make_pair(guid2, string("jagallocparallel2")),
+		make_pair(guid2, string("jagallocparallelrecv")),
+	};
+	UniValue r3;
+	for (auto& allocation : vAllocations) {
+		BOOST_CHECK_NO_THROW(r = CallRPC("node2", "assetallocationinfo " + allocation.first + " " + allocation.second + " false"));
+		BOOST_CHECK_NO_THROW(r3 = CallRPC("node3", "assetallocationinfo " + allocation.first + " " + allocation.second + " false"));
+		BOOST_CHECK_EQUAL(find_value(r.get_obj(), "balance").write(), find_value(r3.get_obj(), "balance").write());
+		BOOST_CHECK_EQUAL(find_value(r.get_obj(), "txid").get_str(), find_value(r3.get_obj(), "txid").get_str());
+		BOOST_CHECK_NO_THROW(r = CallRPC("node2", "assetallocationsenderstatus " + allocation.first + " " + allocation.second + " ''"));
+		BOOST_CHECK_NO_THROW(r3 = CallRPC("node3", "assetallocationsenderstatus " + allocation.first + " " + allocation.second + " ''"));
+		BOOST_CHECK_EQUAL(find_value(r.get_obj(), "status").get_int(), find_value(r3.get_obj(), "status").get_int());
+	}
+	BOOST_CHECK_NO_THROW(r = CallRPC("node2", "assetallocationinfo " + guid1 + " jagallocparallelrecv false"));
+	UniValue balance = find_value(r.get_obj(), "balance");
+	BOOST_CHECK_EQUAL(AssetAmountFromValue(balance, 8, false), 4 * COIN);
+	BOOST_CHECK_NO_THROW(r = CallRPC("node2", "assetallocationinfo " + guid2 + " jagallocparallelrecv false"));
+	balance = find_value(r.get_obj(), "balance");
+	BOOST_CHECK_EQUAL(AssetAmountFromValue(balance, 8, false), 2 * COIN);
+
+	StopNode("node2");
+	StartNode("node2");
+	StopNode("node3");
+	StartNode("node3");
+}
 BOOST_AUTO_TEST_SUITE_END ()
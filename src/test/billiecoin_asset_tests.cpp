@@ -15,7 +15,10 @@
 #include <boost/lexical_cast.hpp>
 #include <iterator>
 #include <chrono>
+#include <limits>
 #include "ranges.h"
+#include "interest.h"
+#include "test/test_random.h"
 using namespace boost::chrono;
 using namespace std;
 BOOST_GLOBAL_FIXTURE( BilliecoinTestingSetup );
@@ -36,6 +39,133 @@ void addToRangeVector (vector<CRange> &vecRange, int range_start, int range_end)
 	vecRange.push_back(range);
 }
 
+// The range functions as they were before CRangeSet, the randomized test checks
+// the current ones against them
+static bool oldCompareRangeReverse(const CRange &i1, const CRange &i2)
+{
+	return (i1.start > i2.start);
+}
+static void oldMergeRanges(vector<CRange>& arr, vector<CRange>& output)
+{
+	if (arr.empty())
+		return;
+	std::sort(arr.begin(), arr.end(), compareRange);
+	output.push_back(arr[0]);
+	CRange top;
+	for (unsigned int i = 1; i < arr.size(); i++)
+	{
+		top = output.back();
+		if (top.end + 1 < arr[i].start)
+			output.push_back(arr[i]);
+		else if (top.end < arr[i].end)
+		{
+			top.end = arr[i].end;
+			output.pop_back();
+			output.push_back(top);
+		}
+	}
+}
+static void oldSubtractRanges(vector<CRange> &arr, vector<CRange> &deletions, vector<CRange> &output)
+{
+	if (arr.empty() || deletions.empty())
+		return;
+	std::sort(arr.begin(), arr.end(), compareRange);
+	std::sort(deletions.begin(), deletions.end(), oldCompareRangeReverse);
+	CRange deletion;
+	for (unsigned int i = 0; i < arr.size(); i++)
+	{
+		deletion = deletions.back();
+		while (arr[i].start > deletion.end && deletions.size() > 1) {
+			deletions.pop_back();
+			deletion = deletions.back();
+		}
+		if (arr[i].end < deletion.start || arr[i].start > deletion.end) {
+			output.push_back(arr[i]);
+			continue;
+		}
+		if (arr[i].start >= deletion.start && arr[i].end <= deletion.end) {
+			continue;
+		}
+		if (arr[i].start < deletion.start && arr[i].end <= deletion.end) {
+			arr[i].end = deletion.start - 1;
+			output.push_back(arr[i]);
+			continue;
+		}
+		if (arr[i].end > deletion.end && arr[i].start >= deletion.start) {
+			arr[i].start = deletion.end + 1;
+			i--;
+			if (deletions.size() > 1) {
+				deletions.pop_back();
+			}
+			continue;
+		}
+		if (arr[i].start < deletion.start && arr[i].end > deletion.end) {
+			CRange r(arr[i].start, deletion.start - 1);
+			arr[i].start = deletion.end + 1;
+			output.push_back(r);
+			i--;
+			if (deletions.size() > 1) {
+				deletions.pop_back();
+			}
+			continue;
+		}
+	}
+}
+static bool oldDoesRangeContain(const vector<CRange> &parent, const vector<CRange> &child) {
+	if (parent.empty() || child.empty())
+		return false;
+	for (auto& childRange : child) {
+		bool found = false;
+		for (auto& parentRange : parent) {
+			if (childRange.start >= parentRange.start && childRange.end <= parentRange.end) {
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+	return true;
+}
+static bool isWellFormed(const vector<CRange> &vecRange)
+{
+	for (auto& range : vecRange) {
+		if (range.end < range.start)
+			return false;
+	}
+	return true;
+}
+// ranges of every shape the fast paths tell apart: sorted and disjoint, sorted
+// by start but overlapping, unsorted, with repeated starts and the odd ill formed one
+static vector<CRange> randomRanges()
+{
+	vector<CRange> vecRange;
+	const int nShape = insecure_rand() % 4;
+	const int nRanges = insecure_rand() % 24;
+	unsigned int nStart = insecure_rand() % 8;
+	for (int i = 0; i < nRanges; i++) {
+		if (nShape == 0) {
+			// sorted and disjoint, like a sender allocation
+			const unsigned int nEnd = nStart + insecure_rand() % 6;
+			addToRangeVector(vecRange, nStart, nEnd);
+			nStart = nEnd + 1 + insecure_rand() % 4;
+		} else if (nShape == 1) {
+			// starts increasing, ranges overlapping
+			addToRangeVector(vecRange, nStart, nStart + insecure_rand() % 12);
+			nStart += 1 + insecure_rand() % 4;
+		} else {
+			const unsigned int s = insecure_rand() % 160;
+			if (nShape == 3 && insecure_rand() % 20 == 0)
+				addToRangeVector(vecRange, s + 1 + insecure_rand() % 4, s);
+			else
+				addToRangeVector(vecRange, s, s + insecure_rand() % 10);
+		}
+	}
+	if (nShape == 2 && !vecRange.empty() && insecure_rand() % 2)
+		vecRange.push_back(vecRange[insecure_rand() % vecRange.size()]);
+	return vecRange;
+}
+
 BOOST_FIXTURE_TEST_SUITE (billiecoin_asset_tests, BasicBilliecoinTestingSetup)
 
 BOOST_AUTO_TEST_CASE(generate_range_merge)
@@ -90,6 +220,37 @@ BOOST_AUTO_TEST_CASE(generate_range_contain)
 	BOOST_CHECK(!DoesRangeContain("{0,8}", "{0,1} {2,4} {6,9}"));
 	BOOST_CHECK(!DoesRangeContain("{0,8}", "{0,9} {2,4} {6,8}"));
 }
+BOOST_AUTO_TEST_CASE(generate_range_set)
+{
+	printf("Running generate_range_set...\n");
+	vector<CRange> vecRange1_i, vecRange2_i, vecRange_o, vecRange_expected;
+	// unsorted and overlapping input is merged like mergeRanges does
+	addToRangeVector(vecRange1_i, 6, 8);
+	addToRangeVector(vecRange1_i, 0);
+	addToRangeVector(vecRange1_i, 2, 3);
+	addToRangeVector(vecRange1_i, 7, 10);
+	CRangeSet rangeSet(vecRange1_i);
+	mergeRanges(vecRange1_i, vecRange_o);
+	BOOST_CHECK(rangeSet.GetRanges() == vecRange_o);
+	BOOST_CHECK_EQUAL(rangeSet.Count(), validateRangesAndGetCount(vecRange_o));
+
+	// adjacent ranges are joined and the count follows
+	addToRangeVector(vecRange2_i, 1);
+	addToRangeVector(vecRange2_i, 4, 5);
+	addToRangeVector(vecRange2_i, 12);
+	rangeSet.Add(vecRange2_i);
+	addToRangeVector(vecRange_expected, 0, 10);
+	addToRangeVector(vecRange_expected, 12);
+	BOOST_CHECK(rangeSet.GetRanges() == vecRange_expected);
+	BOOST_CHECK_EQUAL(rangeSet.Count(), 12U);
+
+	BOOST_CHECK(rangeSet.Contains(CRange(0, 10)));
+	BOOST_CHECK(rangeSet.Contains(CRange(12, 12)));
+	BOOST_CHECK(rangeSet.Contains(vecRange2_i));
+	BOOST_CHECK(!rangeSet.Contains(CRange(11, 11)));
+	BOOST_CHECK(!rangeSet.Contains(CRange(10, 12)));
+	BOOST_CHECK(!rangeSet.Contains(CRange(13, 13)));
+}
 BOOST_AUTO_TEST_CASE(generate_range_complex)
 {
 	/* Test 1:  Generate two large input, 1 all even number 1 all odd and merge them */
@@ -279,6 +440,89 @@ BOOST_AUTO_TEST_CASE(generate_range_stress_subtract2)
 	printf("CheckRangeSubtract Completed %ldms\n", ms2-ms1);
 }
 
+BOOST_AUTO_TEST_CASE(generate_range_randomized)
+{
+	printf("Running generate_range_randomized...\n");
+	// results and side effects on the arguments have to match the functions CRangeSet replaced
+	seed_insecure_rand(true);
+	for (int i = 0; i < 20000; i++) {
+		const vector<CRange> vecRange1 = randomRanges(), vecRange2 = randomRanges();
+
+		vector<CRange> vecMerge = vecRange1, vecMergeOld = vecRange1, vecMerge_o, vecMergeOld_o;
+		mergeRanges(vecMerge, vecMerge_o);
+		oldMergeRanges(vecMergeOld, vecMergeOld_o);
+		BOOST_CHECK(vecMerge_o == vecMergeOld_o);
+		BOOST_CHECK(vecMerge == vecMergeOld);
+
+		vector<CRange> vecArr = vecRange1, vecArrOld = vecRange1, vecDel = vecRange2, vecDelOld = vecRange2, vecSub_o, vecSubOld_o;
+		subtractRanges(vecArr, vecDel, vecSub_o);
+		oldSubtractRanges(vecArrOld, vecDelOld, vecSubOld_o);
+		BOOST_CHECK(vecSub_o == vecSubOld_o);
+		BOOST_CHECK(vecArr == vecArrOld);
+		BOOST_CHECK(vecDel == vecDelOld);
+
+		BOOST_CHECK_EQUAL(doesRangeContain(vecRange1, vecRange2), oldDoesRangeContain(vecRange1, vecRange2));
+		BOOST_CHECK_EQUAL(doesRangeContain(vecMergeOld_o, vecRange2), oldDoesRangeContain(vecMergeOld_o, vecRange2));
+		BOOST_CHECK_EQUAL(doesRangeContain(vecMergeOld_o, vecSubOld_o), oldDoesRangeContain(vecMergeOld_o, vecSubOld_o));
+
+		// a set built from both holds what merging both gives, ill formed ranges merge
+		// differently depending on their order so they are left out
+		if (!isWellFormed(vecRange1) || !isWellFormed(vecRange2))
+			continue;
+		vector<CRange> vecBoth = vecRange1, vecBoth_o;
+		vecBoth.insert(vecBoth.end(), vecRange2.begin(), vecRange2.end());
+		oldMergeRanges(vecBoth, vecBoth_o);
+		CRangeSet rangeSet(vecRange1);
+		rangeSet.Add(vecRange2);
+		BOOST_CHECK(rangeSet.GetRanges() == vecBoth_o);
+		BOOST_CHECK_EQUAL(rangeSet.Count(), validateRangesAndGetCount(vecBoth_o));
+		if (!vecRange2.empty())
+			BOOST_CHECK_EQUAL(rangeSet.Contains(vecRange2), oldDoesRangeContain(vecBoth_o, vecRange2));
+		vector<CRange> vecRange2Merge = vecRange2, vecRange2_o;
+		oldMergeRanges(vecRange2Merge, vecRange2_o);
+		if (!vecRange1.empty())
+			BOOST_CHECK_EQUAL(CRangeSet(vecRange2).Contains(vecRange1), oldDoesRangeContain(vecRange2_o, vecRange1));
+	}
+}
+BOOST_AUTO_TEST_CASE(generate_interest_fixed_point)
+{
+	printf("Running generate_interest_fixed_point...\n");
+	// the fixed point interest has to round exactly like the decimal computation it replaces
+	seed_insecure_rand(true);
+	CCompoundInterestBatch batch;
+	for (int i = 0; i < 20000; i++) {
+		const int nTermBlocks = (insecure_rand() % 2) ? ONE_YEAR_IN_BLOCKS : ONE_HOUR_IN_BLOCKS;
+		const int nBlocks = 1 + insecure_rand() % (nTermBlocks == ONE_HOUR_IN_BLOCKS ? 50 * ONE_HOUR_IN_BLOCKS : 2 * ONE_YEAR_IN_BLOCKS);
+		const float fInterestRate = (insecure_rand() % 1000001) / 1000000.0f;
+		// the balance changes a few times within the claim period
+		double nAccumulatedBalance = 0;
+		float fAccumulatedInterest = 0;
+		for (int nBlocksLeft = nBlocks; nBlocksLeft > 0; ) {
+			const int nPeriod = 1 + insecure_rand() % nBlocksLeft;
+			const CAmount nBalance = ((CAmount)insecure_rand() << (insecure_rand() % 31)) + insecure_rand();
+			nAccumulatedBalance += ((double)nBalance)*nPeriod;
+			fAccumulatedInterest += fInterestRate*nPeriod;
+			nBlocksLeft -= nPeriod;
+		}
+		const CAmount nExpected = GetCompoundInterestDecimal(nAccumulatedBalance, fAccumulatedInterest, nBlocks, nTermBlocks);
+		BOOST_CHECK_EQUAL(GetCompoundInterest(nAccumulatedBalance, fAccumulatedInterest, nBlocks, nTermBlocks), nExpected);
+		BOOST_CHECK_EQUAL(batch.GetCompoundInterest(nAccumulatedBalance, fAccumulatedInterest, nBlocks, nTermBlocks), nExpected);
+	}
+	// results on a whole unit, no interest, and interest beyond the range of CAmount
+	BOOST_CHECK_EQUAL(GetCompoundInterest(3000, 180, 3, ONE_HOUR_IN_BLOCKS), GetCompoundInterestDecimal(3000, 180, 3, ONE_HOUR_IN_BLOCKS));
+	BOOST_CHECK_EQUAL(GetCompoundInterest(5000*60, 0.05f*60, 60, ONE_HOUR_IN_BLOCKS), 256);
+	BOOST_CHECK_EQUAL(GetCompoundInterest(5000*60, 0, 60, ONE_HOUR_IN_BLOCKS), 0);
+	BOOST_CHECK_EQUAL(GetCompoundInterest(0, 0.05f*60, 60, ONE_HOUR_IN_BLOCKS), 0);
+	BOOST_CHECK_EQUAL(GetCompoundInterest(1e18*3000, 3000, 3000, ONE_HOUR_IN_BLOCKS), GetCompoundInterestDecimal(1e18*3000, 3000, 3000, ONE_HOUR_IN_BLOCKS));
+	BOOST_CHECK_EQUAL(GetCompoundInterest(1e18*3000, 3000, 3000, ONE_HOUR_IN_BLOCKS), INT64_MAX);
+	// rates that are not finite are left out of the cache, the rates around them still share it
+	CCompoundInterestBatch batchNotFinite;
+	const float rates[] = {0.05f*60, std::numeric_limits<float>::quiet_NaN(), 0.1f*60, std::numeric_limits<float>::infinity(), 0.05f*60, -std::numeric_limits<float>::quiet_NaN(), 0.1f*60};
+	for (const float fRate : rates)
+		BOOST_CHECK_EQUAL(batchNotFinite.GetCompoundInterest(5000*60, fRate, 60, ONE_HOUR_IN_BLOCKS), GetCompoundInterestDecimal(5000*60, fRate, 60, ONE_HOUR_IN_BLOCKS));
+	BOOST_CHECK_EQUAL(batchNotFinite.GetCompoundInterest(5000*60, 0.05f*60, 60, ONE_HOUR_IN_BLOCKS), 256);
+}
+
 BOOST_AUTO_TEST_CASE(generate_big_assetdata)
 {
 	ECC_Start();
@@ -6,6 +6,7 @@
 #include "util.h"
 #include "utiltime.h"
 #include "validation.h"
+#include "validationexecutor.h"
 
 #include "test/test_billiecoin.h"
 #include "checkqueue.h"
@@ -142,6 +143,7 @@ typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
+typedef CCheckQueue<CBatchedCheck<FailingCheck> > Batched_Queue;
 
 
 /** This test case checks that the CCheckQueue works properly
@@ -439,4 +441,151 @@ BOOST_AUTO_TEST_CASE(test_CheckQueueControl_Locks)
         tg.join_all();
     }
 }
+/** Test that a batch holding checks of many transactions reports each result
+ * to its own transaction, and that a failing one does not fail the others.
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueueBatcher_FanOut)
+{
+    auto queue = std::unique_ptr<Batched_Queue>(new Batched_Queue {QUEUE_BATCH_SIZE});
+    boost::thread_group tg;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+       tg.create_thread([&]{queue->Thread();});
+    }
+    CCheckQueueBatcher<FailingCheck> batcher(queue.get(), 50);
+
+    const size_t nTxs = 1000;
+    std::vector<int> vResults(nTxs, -1);
+    size_t nFlushed = 0;
+    for (size_t i = 0; i < nTxs; i++)
+        batcher.Expect();
+    for (size_t i = 0; i < nTxs; i++) {
+        // up to three inputs per transaction, every seventh one has a bad last input
+        std::vector<FailingCheck> vChecks;
+        const size_t nInputs = i % 4;
+        for (size_t k = 0; k < nInputs; k++)
+            vChecks.emplace_back(i % 7 == 0 && k == nInputs - 1);
+        if (batcher.Add(vChecks, [&vResults, i](bool fOk) { vResults[i] = fOk; }))
+            nFlushed += batcher.Flush();
+    }
+    // the last transaction flushed the partial batch
+    BOOST_CHECK_EQUAL(batcher.GetPending(), 0U);
+
+    size_t nExpectedChecks = 0;
+    for (size_t i = 0; i < nTxs; i++) {
+        nExpectedChecks += i % 4;
+        const bool fExpectFail = i % 7 == 0 && i % 4 > 0;
+        BOOST_CHECK_EQUAL(vResults[i], fExpectFail ? 0 : 1);
+    }
+    BOOST_CHECK_EQUAL(nFlushed, nExpectedChecks);
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+/** Test that a partial batch is flushed by the last transaction announced to the
+ * batcher even when other work is queued behind it, and that withdrawing an
+ * announcement hands the flush back to the caller.
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueueBatcher_PartialBatch)
+{
+    CCheckQueueBatcher<FailingCheck> batcher(nullptr, 50);
+    std::atomic<int> nDone(0);
+    auto batchingTask = [&batcher, &nDone] {
+        std::vector<FailingCheck> vChecks(1, FailingCheck(false));
+        if (batcher.Add(vChecks, [&nDone](bool fOk) { if (fOk) nDone++; }))
+            batcher.Flush();
+    };
+
+    // hold the single worker until a batching task and one that does not batch are both queued
+    CValidationExecutor executor(1, 16);
+    std::mutex mutexGate;
+    std::condition_variable condGate;
+    bool fOpen = false;
+    BOOST_CHECK(executor.TrySubmit(0, [&] {
+        std::unique_lock<std::mutex> lock(mutexGate);
+        condGate.wait(lock, [&] { return fOpen; });
+    }));
+    batcher.Expect();
+    BOOST_CHECK(executor.TrySubmit(1, batchingTask));
+    BOOST_CHECK(executor.TrySubmit(1, [] {}));
+    {
+        std::unique_lock<std::mutex> lock(mutexGate);
+        fOpen = true;
+    }
+    condGate.notify_all();
+    while (executor.GetQueueDepth() > 0)
+        MilliSleep(1);
+    executor.Stop();
+    BOOST_CHECK_EQUAL(nDone, 1);
+    BOOST_CHECK_EQUAL(batcher.GetPending(), 0U);
+
+    // a task announced but never run leaves the flush to whoever withdraws it
+    batcher.Expect();
+    batcher.Expect();
+    std::vector<FailingCheck> vChecks(1, FailingCheck(false));
+    BOOST_CHECK(!batcher.Add(vChecks, [&nDone](bool fOk) { if (fOk) nDone++; }));
+    BOOST_CHECK_EQUAL(batcher.GetPending(), 1U);
+    BOOST_CHECK(batcher.Cancel());
+    BOOST_CHECK_EQUAL(batcher.Flush(), 1U);
+    BOOST_CHECK_EQUAL(nDone, 2);
+    BOOST_CHECK(!batcher.Cancel());
+}
+
+/** Test that stopping the executor in the middle of a batch flushes the checks
+ * already added, instead of leaving them waiting for a task that never runs.
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueueBatcher_StopMidBatch)
+{
+    CCheckQueueBatcher<FailingCheck> batcher(nullptr, 50);
+    std::atomic<int> nDone(0);
+    std::atomic<int> nDropped(0);
+    auto batchingTask = [&batcher, &nDone] {
+        std::vector<FailingCheck> vChecks(2, FailingCheck(false));
+        if (batcher.Add(vChecks, [&nDone](bool fOk) { if (fOk) nDone++; }))
+            batcher.Flush();
+    };
+    auto droppedTask = [&batcher, &nDropped] {
+        nDropped++;
+        batcher.Drop();
+    };
+
+    // the first batching task runs, then the gate holds the single worker with two more queued
+    CValidationExecutor executor(1, 16);
+    std::mutex mutexGate;
+    std::condition_variable condGate;
+    bool fStarted = false;
+    bool fOpen = false;
+    for (int i = 0; i < 3; i++)
+        batcher.Expect();
+    BOOST_CHECK(executor.TrySubmit(1, batchingTask, droppedTask));
+    BOOST_CHECK(executor.TrySubmit(1, [&] {
+        std::unique_lock<std::mutex> lock(mutexGate);
+        fStarted = true;
+        condGate.notify_all();
+        condGate.wait(lock, [&] { return fOpen; });
+    }));
+    BOOST_CHECK(executor.TrySubmit(1, batchingTask, droppedTask));
+    BOOST_CHECK(executor.TrySubmit(1, batchingTask, droppedTask));
+    {
+        std::unique_lock<std::mutex> lock(mutexGate);
+        condGate.wait(lock, [&] { return fStarted; });
+    }
+    // the partial batch waits for the two queued tasks
+    BOOST_CHECK_EQUAL(batcher.GetPending(), 2U);
+    BOOST_CHECK_EQUAL(nDone, 0);
+
+    std::thread stopper([&executor] { executor.Stop(); });
+    while (executor.GetQueueDepth() > 0)
+        MilliSleep(1);
+    {
+        std::unique_lock<std::mutex> lock(mutexGate);
+        fOpen = true;
+    }
+    condGate.notify_all();
+    stopper.join();
+    BOOST_CHECK_EQUAL(nDropped, 2);
+    BOOST_CHECK_EQUAL(nDone, 1);
+    BOOST_CHECK_EQUAL(batcher.GetPending(), 0U);
+    BOOST_CHECK(!batcher.Cancel());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
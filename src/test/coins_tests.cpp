@@ -5,6 +5,8 @@
 
 #include "coins.h"
 #include "script/standard.h"
+#include "snapshot.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "undo.h"
 #include "utilstrencodings.h"
@@ -857,4 +859,37 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+
+BOOST_AUTO_TEST_CASE(snapshot_scan_threads)
+{
+    // Spread outputs of a few addresses over the whole txid space.
+    CCoinsViewDB db(1 << 20, true);
+    CCoinsViewCache cache(&db);
+    std::vector<CKeyID> keys;
+    for (int i = 0; i < 10; i++)
+        keys.push_back(CKeyID(uint160(std::vector<unsigned char>(20, i + 1))));
+    std::map<CTxDestination, CAmount> mapExpected;
+    for (int i = 0; i < 2000; i++) {
+        const CKeyID& key = keys[insecure_rand() % keys.size()];
+        const CAmount nValue = 1 + insecure_rand() % 1000;
+        cache.AddCoin(COutPoint(GetRandHash(), 0), Coin(CTxOut(nValue, GetScriptForDestination(key)), 1, false), false);
+        mapExpected[key] += nValue;
+    }
+    // Outputs paying to no address are counted apart.
+    cache.AddCoin(COutPoint(GetRandHash(), 0), Coin(CTxOut(1, CScript() << OP_RETURN), 1, false), false);
+    const uint256 hashBlock = GetRandHash();
+    cache.SetBestBlock(hashBlock);
+    BOOST_CHECK(cache.Flush());
+
+    for (int nThreads : {1, 3, 16}) {
+        CSnapshotBalances balances;
+        CSnapshotScan scan(db, nThreads);
+        BOOST_CHECK(scan.Run(balances));
+        BOOST_CHECK(balances.hashBlock == hashBlock);
+        BOOST_CHECK_EQUAL(balances.nOutputs, 2000U);
+        BOOST_CHECK_EQUAL(balances.nSkipped, 1U);
+        BOOST_CHECK(balances.mapBalances == mapExpected);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
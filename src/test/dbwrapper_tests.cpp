@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "dbwrapper.h"
+#include "serviceindex.h"
+#include "servicecache.h"
 #include "uint256.h"
 #include "random.h"
 #include "test/test_billiecoin.h"
@@ -123,6 +125,366 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_staged_writes)
+{
+    // Perform tests both obfuscated and non-obfuscated.
+    for (int i = 0; i < 2; i++) {
+        bool obfuscate = (bool)i;
+        boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        char key = 'i';
+        uint256 in = GetRandHash();
+        char key2 = 'j';
+        uint256 in2 = GetRandHash();
+        char key3 = 'k';
+        uint256 in3 = GetRandHash();
+        uint256 res;
+        BOOST_CHECK(dbw.Write(key, in));
+
+        CDBStagedWrites staged;
+        {
+            CDBStagingScope scope(staged);
+            BOOST_CHECK(CDBStagedWrites::GetActive() == &staged);
+            staged.SetTag(1);
+            BOOST_CHECK(dbw.Erase(key));
+            BOOST_CHECK(dbw.Write(key2, in2));
+            staged.SetTag(2);
+            CDBBatch batch(dbw);
+            batch.Write(key3, in3);
+            BOOST_CHECK(dbw.WriteBatch(batch));
+
+            // the staging thread sees its own changes
+            BOOST_CHECK(!dbw.Exists(key));
+            BOOST_CHECK(dbw.Read(key2, res));
+            BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+            BOOST_CHECK(dbw.Read(key3, res));
+            BOOST_CHECK_EQUAL(res.ToString(), in3.ToString());
+        }
+        BOOST_CHECK(CDBStagedWrites::GetActive() == NULL);
+        BOOST_CHECK_EQUAL(staged.Size(), 3U);
+
+        // nothing reached the database yet
+        BOOST_CHECK(dbw.Read(key, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+        BOOST_CHECK(!dbw.Exists(key2));
+
+        // only the changes tagged below 2 are written
+        BOOST_CHECK(staged.Commit(2));
+        BOOST_CHECK_EQUAL(staged.Size(), 0U);
+        BOOST_CHECK(!dbw.Exists(key));
+        BOOST_CHECK(dbw.Read(key2, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+        BOOST_CHECK(!dbw.Exists(key3));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_staged_writes_nested)
+{
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+    char key = 'i';
+    uint256 in = GetRandHash();
+    uint256 res;
+
+    CDBStagedWrites outer;
+    {
+        CDBStagingScope scope(outer);
+        CDBStagedWrites inner;
+        {
+            CDBStagingScope innerScope(inner);
+            BOOST_CHECK(dbw.Write(key, in));
+        }
+        BOOST_CHECK(CDBStagedWrites::GetActive() == &outer);
+        BOOST_CHECK(!dbw.Exists(key));
+        // committing inside the outer scope moves the change there
+        BOOST_CHECK(inner.Commit(INT_MAX));
+        BOOST_CHECK(dbw.Read(key, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    }
+    BOOST_CHECK(!dbw.Exists(key));
+    BOOST_CHECK(outer.Commit(INT_MAX));
+    BOOST_CHECK(dbw.Read(key, res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_staged_writes_deferred)
+{
+    std::vector<int> vRun;
+    // without staged writes the work runs right away
+    CDBStagedWrites::Defer([&vRun] { vRun.push_back(0); });
+    BOOST_CHECK_EQUAL(vRun.size(), 1U);
+
+    CDBStagedWrites outer;
+    {
+        CDBStagingScope scope(outer);
+        CDBStagedWrites inner;
+        {
+            CDBStagingScope innerScope(inner);
+            inner.SetTag(1);
+            CDBStagedWrites::Defer([&vRun] { vRun.push_back(1); });
+            inner.SetTag(2);
+            CDBStagedWrites::Defer([&vRun] { vRun.push_back(2); });
+        }
+        // work of the changes that are not committed is dropped, the rest moves to the outer scope
+        BOOST_CHECK(inner.Commit(2));
+        CDBStagedWrites::Defer([&vRun] { vRun.push_back(3); });
+        BOOST_CHECK_EQUAL(vRun.size(), 1U);
+    }
+    BOOST_CHECK(outer.Commit(INT_MAX));
+    const std::vector<int> vExpected = {0, 1, 3};
+    BOOST_CHECK(vRun == vExpected);
+    // and runs once only
+    BOOST_CHECK(outer.Commit(INT_MAX));
+    BOOST_CHECK(vRun == vExpected);
+}
+
+struct CTestServiceRecord {
+    unsigned int nHeight;
+    uint256 txHash;
+    std::vector<unsigned char> vchOwner;
+    uint64_t nExpireTime;
+
+    CTestServiceRecord() : nHeight(0), nExpireTime(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nHeight);
+        READWRITE(txHash);
+        READWRITE(vchOwner);
+        READWRITE(nExpireTime);
+    }
+};
+
+static CServiceIndexEntry GetTestServiceIndexEntry(const CTestServiceRecord& record)
+{
+    CServiceIndexEntry entry(record.nHeight, record.txHash);
+    entry.AddOwner(record.vchOwner);
+    entry.nExpireTime = record.nExpireTime;
+    return entry;
+}
+
+static std::vector<unsigned char> Vch(const std::string& str)
+{
+    return std::vector<unsigned char>(str.begin(), str.end());
+}
+
+// Scan one page and return the keys of the records found, by their owner
+static std::string ScanTestServiceIndex(CServiceIndex<std::vector<unsigned char>, CTestServiceRecord>& index, const std::string& strOptions, int nCount, std::string& strCursor)
+{
+    UniValue oOptions;
+    BOOST_CHECK(oOptions.read(strOptions));
+    CServiceScan scan(nCount, 0, oOptions);
+    const UniValue &owner = find_value(oOptions, "owner");
+    if (owner.isStr())
+        scan.AddOwner(Vch(owner.get_str()));
+    UniValue oRes(UniValue::VARR);
+    BOOST_CHECK(index.Scan(scan, [](CTestServiceRecord& record, UniValue& oRecord) {
+        oRecord.push_back(Pair("height", (int)record.nHeight));
+        return true;
+    }, oRes, strCursor));
+    std::string strHeights;
+    for (unsigned int i = 0; i < oRes.size(); i++)
+        strHeights += strprintf("%d ", find_value(oRes[i], "height").get_int());
+    return strHeights;
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_service_index)
+{
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+    CServiceIndex<std::vector<unsigned char>, CTestServiceRecord> index(dbw, "test", &GetTestServiceIndexEntry);
+    const char* guids[] = {"a", "b", "c", "d"};
+    const unsigned int heights[] = {5, 3, 7, 4};
+    const char* owners[] = {"x", "y", "x", "y"};
+    CTestServiceRecord records[4];
+    for (int i = 0; i < 4; i++) {
+        records[i].nHeight = heights[i];
+        records[i].txHash = GetRandHash();
+        records[i].vchOwner = Vch(owners[i]);
+        // the first record is written without its index entries, Build adds them
+        CDBBatch batch(dbw);
+        if (i == 0)
+            batch.Write(std::make_pair(std::string("testi"), Vch(guids[i])), records[i]);
+        else
+            index.Write(batch, Vch(guids[i]), records[i]);
+        BOOST_CHECK(dbw.WriteBatch(batch));
+    }
+    BOOST_CHECK(index.Build());
+
+    std::string strCursor;
+    // records are in key order, the cursor picks up where the previous page stopped
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"cursor\":\"\"}", 3, strCursor), "5 3 7 ");
+    BOOST_CHECK(!strCursor.empty());
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"cursor\":\"" + HexStr(strCursor.begin(), strCursor.end()) + "\"}", 3, strCursor), "4 ");
+    BOOST_CHECK(strCursor.empty());
+    // heights are in numeric order
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"startblock\":4}", 10, strCursor), "4 5 7 ");
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"owner\":\"x\"}", 10, strCursor), "5 7 ");
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"txid\":\"" + records[2].txHash.GetHex() + "\"}", 10, strCursor), "7 ");
+
+    // replacing a record drops its old index entries
+    records[0].nHeight = 9;
+    records[0].txHash = GetRandHash();
+    records[0].vchOwner = Vch("y");
+    CDBBatch batch(dbw);
+    index.Write(batch, Vch("a"), records[0]);
+    index.Erase(batch, Vch("b"));
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"owner\":\"x\"}", 10, strCursor), "7 ");
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"owner\":\"y\"}", 10, strCursor), "9 4 ");
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"startblock\":1}", 1, strCursor), "4 ");
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{\"startblock\":1,\"cursor\":\"" + HexStr(strCursor.begin(), strCursor.end()) + "\"}", 10, strCursor), "7 9 ");
+    BOOST_CHECK_EQUAL(ScanTestServiceIndex(index, "{}", 10, strCursor), "9 7 4 ");
+}
+
+// the keys of the records expiring at or before nTime, joined in expiry order
+static std::string GetTestServiceExpired(CServiceIndex<std::vector<unsigned char>, CTestServiceRecord>& index, uint64_t nTime, size_t nMax)
+{
+    std::vector<std::pair<uint64_t, std::vector<unsigned char> > > vExpired;
+    BOOST_CHECK(index.GetExpired(nTime, nMax, vExpired));
+    std::string strKeys;
+    for (unsigned int i = 0; i < vExpired.size(); i++)
+        strKeys += strprintf("%s:%d ", std::string(vExpired[i].second.begin(), vExpired[i].second.end()), vExpired[i].first);
+    return strKeys;
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_service_index_expiry)
+{
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+    CServiceIndex<std::vector<unsigned char>, CTestServiceRecord> index(dbw, "test", &GetTestServiceIndexEntry);
+    const char* guids[] = {"a", "b", "c", "d"};
+    // the expiries sort numerically across byte boundaries, records without one are not indexed
+    const uint64_t expiries[] = {300, 0, 256, 1};
+    const char* owners[] = {"x", "y", "x", "y"};
+    CTestServiceRecord records[4];
+    CDBBatch batch(dbw);
+    for (int i = 0; i < 4; i++) {
+        records[i].nHeight = i;
+        records[i].vchOwner = Vch(owners[i]);
+        records[i].nExpireTime = expiries[i];
+        index.Write(batch, Vch(guids[i]), records[i]);
+    }
+    BOOST_CHECK(dbw.WriteBatch(batch));
+
+    BOOST_CHECK_EQUAL(GetTestServiceExpired(index, 0, 10), "");
+    BOOST_CHECK_EQUAL(GetTestServiceExpired(index, 299, 10), "d:1 c:256 ");
+    BOOST_CHECK_EQUAL(GetTestServiceExpired(index, 1000, 2), "d:1 c:256 ");
+    BOOST_CHECK_EQUAL(GetTestServiceExpired(index, 1000, 10), "d:1 c:256 a:300 ");
+
+    std::vector<std::vector<unsigned char> > vKeys;
+    BOOST_CHECK(index.GetOwned(Vch("x"), vKeys));
+    BOOST_CHECK(vKeys.size() == 2 && vKeys[0] == Vch("a") && vKeys[1] == Vch("c"));
+
+    // the owners are walked each once, in batches continuing after the last one
+    std::vector<std::vector<unsigned char> > vOwners;
+    BOOST_CHECK(index.GetOwners(std::vector<unsigned char>(), 10, vOwners));
+    BOOST_CHECK(vOwners.size() == 2 && vOwners[0] == Vch("x") && vOwners[1] == Vch("y"));
+    vOwners.clear();
+    BOOST_CHECK(index.GetOwners(std::vector<unsigned char>(), 1, vOwners));
+    BOOST_CHECK(vOwners.size() == 1 && vOwners[0] == Vch("x"));
+    vOwners.clear();
+    BOOST_CHECK(index.GetOwners(Vch("x"), 1, vOwners));
+    BOOST_CHECK(vOwners.size() == 1 && vOwners[0] == Vch("y"));
+    vOwners.clear();
+    BOOST_CHECK(index.GetOwners(Vch("y"), 1, vOwners));
+    BOOST_CHECK(vOwners.empty());
+
+    // renewing a record moves its entry, erasing one drops it
+    batch.Clear();
+    records[3].nExpireTime = 500;
+    index.Write(batch, Vch("d"), records[3]);
+    index.Erase(batch, Vch("c"));
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    BOOST_CHECK_EQUAL(GetTestServiceExpired(index, 1000, 10), "a:300 d:500 ");
+
+    // stale entries can be dropped by themselves
+    batch.Clear();
+    index.EraseExpiry(batch, Vch("a"), 300);
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    BOOST_CHECK_EQUAL(GetTestServiceExpired(index, 1000, 10), "d:500 ");
+    vKeys.clear();
+    BOOST_CHECK(index.GetOwned(Vch("x"), vKeys));
+    BOOST_CHECK(vKeys.size() == 1 && vKeys[0] == Vch("a"));
+}
+
+// a database caching its reads the way the alias database does
+class CTestCachedDB : public CDBWrapper
+{
+public:
+    CServiceCache<std::vector<unsigned char>, uint256> cache;
+
+    CTestCachedDB(const boost::filesystem::path& ph) : CDBWrapper(ph, (1 << 20), true, false), cache(&GetUsage, (1 << 20)) {}
+    static size_t GetUsage(const uint256& value) { return 0; }
+
+    bool ReadCached(const std::vector<unsigned char>& key, uint256& value) {
+        if (IsStaged(key))
+            return Read(key, value);
+        if (cache.Get(key, value))
+            return true;
+        const uint64_t nGeneration = cache.GetGeneration();
+        if (!Read(key, value))
+            return false;
+        cache.Insert(key, value, nGeneration);
+        return true;
+    }
+
+protected:
+    void BatchWritten(const leveldb::WriteBatch& batch) override {
+        cache.Erase(Vch("a"));
+    }
+};
+
+BOOST_AUTO_TEST_CASE(dbwrapper_service_cache)
+{
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CTestCachedDB dbw(ph);
+    const uint256 in = GetRandHash();
+    const uint256 in2 = GetRandHash();
+    uint256 res;
+
+    BOOST_CHECK(dbw.Write(Vch("a"), in));
+    BOOST_CHECK(dbw.ReadCached(Vch("a"), res) && res == in);
+    BOOST_CHECK(dbw.ReadCached(Vch("a"), res) && res == in);
+    BOOST_CHECK_EQUAL(dbw.cache.Hits(), 1U);
+    BOOST_CHECK_EQUAL(dbw.cache.Misses(), 1U);
+
+    // writes drop the cached record
+    BOOST_CHECK(dbw.Write(Vch("a"), in2));
+    BOOST_CHECK_EQUAL(dbw.cache.Size(), 0U);
+    BOOST_CHECK(dbw.ReadCached(Vch("a"), res) && res == in2);
+
+    // staged changes are seen by the staging thread only and bypass the cache
+    CDBStagedWrites staged;
+    {
+        CDBStagingScope scope(staged);
+        BOOST_CHECK(dbw.Write(Vch("a"), in));
+        BOOST_CHECK(dbw.ReadCached(Vch("a"), res) && res == in);
+    }
+    BOOST_CHECK(dbw.ReadCached(Vch("a"), res) && res == in2);
+    const uint64_t nGeneration = dbw.cache.GetGeneration();
+    BOOST_CHECK(staged.Commit(1));
+    BOOST_CHECK(dbw.ReadCached(Vch("a"), res) && res == in);
+
+    // a record read before a write is not cached after it
+    dbw.cache.Insert(Vch("b"), in, nGeneration);
+    BOOST_CHECK(!dbw.cache.Get(Vch("b"), res));
+    dbw.cache.Clear();
+
+    // the least recently used records are evicted first
+    for (unsigned char c = 0; c < 10; c++)
+        dbw.cache.Insert(std::vector<unsigned char>(1, c), in, dbw.cache.GetGeneration());
+    BOOST_CHECK(dbw.cache.Get(std::vector<unsigned char>(1, 0), res));
+    dbw.cache.SetMaxUsage(dbw.cache.DynamicMemoryUsage() / 2);
+    BOOST_CHECK_EQUAL(dbw.cache.Size(), 5U);
+    BOOST_CHECK(dbw.cache.Get(std::vector<unsigned char>(1, 0), res));
+    BOOST_CHECK(!dbw.cache.Get(std::vector<unsigned char>(1, 1), res));
+    BOOST_CHECK(dbw.cache.Get(std::vector<unsigned char>(1, 9), res));
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
@@ -0,0 +1,137 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat-database.h"
+
+#include "test/test_billiecoin.h"
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(flatdb_tests, TestingSetup)
+
+// the interface CFlatDB expects of the caches it stores
+class CFlatDBTestObject
+{
+public:
+    std::vector<int> vValues;
+    // serializing throws, as a cache in a bad state would
+    bool fFailWrite;
+    int nCheckAndRemove;
+
+    CFlatDBTestObject() : fFailWrite(false), nCheckAndRemove(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        if (!ser_action.ForRead() && fFailWrite)
+            throw std::ios_base::failure("test object fails to serialize");
+        READWRITE(vValues);
+    }
+
+    void CheckAndRemove() { nCheckAndRemove++; }
+    void Clear() { vValues.clear(); }
+    std::string ToString() const { return strprintf("Values: %d", vValues.size()); }
+};
+
+static CFlatDBTestObject TestObject(int nValues, int nFirst)
+{
+    CFlatDBTestObject obj;
+    for (int i = 0; i < nValues; i++)
+        obj.vValues.push_back(nFirst + i);
+    return obj;
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_dump_load)
+{
+    CFlatDB<CFlatDBTestObject> flatdb("flatdbtest.dat", "magicFlatDBTest");
+    CFlatDBTestObject objSaved = TestObject(1000, 7);
+    BOOST_CHECK(flatdb.Dump(objSaved));
+    // the temporary file was renamed over the destination
+    BOOST_CHECK(boost::filesystem::exists(GetDataDir() / "flatdbtest.dat"));
+    BOOST_CHECK(!boost::filesystem::exists(GetDataDir() / "flatdbtest.dat.new"));
+
+    CFlatDBTestObject objLoaded;
+    BOOST_CHECK(flatdb.Load(objLoaded));
+    BOOST_CHECK(objLoaded.vValues == objSaved.vValues);
+    BOOST_CHECK_EQUAL(objLoaded.nCheckAndRemove, 1);
+
+    // a later dump replaces the file, loading without the cleanup leaves it to the caller
+    CFlatDBTestObject objUpdated = TestObject(10, 100);
+    BOOST_CHECK(flatdb.Dump(objUpdated));
+    CFlatDBTestObject objReloaded;
+    BOOST_CHECK(flatdb.Load(objReloaded, false));
+    BOOST_CHECK(objReloaded.vValues == objUpdated.vValues);
+    BOOST_CHECK_EQUAL(objReloaded.nCheckAndRemove, 0);
+
+    // a missing file is not an error, it is written on the next dump
+    CFlatDB<CFlatDBTestObject> flatdbMissing("flatdbmissing.dat", "magicFlatDBTest");
+    CFlatDBTestObject objEmpty;
+    BOOST_CHECK(flatdbMissing.Load(objEmpty));
+    BOOST_CHECK(objEmpty.vValues.empty());
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_failed_dump_keeps_file)
+{
+    CFlatDB<CFlatDBTestObject> flatdb("flatdbkeep.dat", "magicFlatDBTest");
+    CFlatDBTestObject objSaved = TestObject(100, 1);
+    BOOST_CHECK(flatdb.Dump(objSaved));
+
+    // serializing fails before anything is written
+    CFlatDBTestObject objFailing = TestObject(5, 50);
+    objFailing.fFailWrite = true;
+    BOOST_CHECK(!flatdb.Dump(objFailing));
+    BOOST_CHECK(!boost::filesystem::exists(GetDataDir() / "flatdbkeep.dat.new"));
+    CFlatDBTestObject objLoaded;
+    BOOST_CHECK(flatdb.Load(objLoaded));
+    BOOST_CHECK(objLoaded.vValues == objSaved.vValues);
+
+    // the temporary file cannot be created
+    boost::filesystem::create_directory(GetDataDir() / "flatdbkeep.dat.new");
+    CFlatDBTestObject objBlocked = TestObject(5, 60);
+    BOOST_CHECK(!flatdb.Dump(objBlocked));
+    boost::filesystem::remove(GetDataDir() / "flatdbkeep.dat.new");
+    objLoaded.Clear();
+    BOOST_CHECK(flatdb.Load(objLoaded));
+    BOOST_CHECK(objLoaded.vValues == objSaved.vValues);
+
+    // a file of another kind is not overwritten
+    CFlatDB<CFlatDBTestObject> flatdbOther("flatdbkeep.dat", "magicOtherCache");
+    BOOST_CHECK(!flatdbOther.Dump(objBlocked));
+    objLoaded.Clear();
+    BOOST_CHECK(flatdb.Load(objLoaded));
+    BOOST_CHECK(objLoaded.vValues == objSaved.vValues);
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_parallel_load)
+{
+    // two caches read side by side and cleaned up once both are in, as at startup
+    CFlatDB<CFlatDBTestObject> flatdb1("flatdbparallel1.dat", "magicFlatDBTest1");
+    CFlatDB<CFlatDBTestObject> flatdb2("flatdbparallel2.dat", "magicFlatDBTest2");
+    CFlatDBTestObject objSaved1 = TestObject(20000, 0);
+    CFlatDBTestObject objSaved2 = TestObject(30000, 5);
+    BOOST_CHECK(flatdb1.Dump(objSaved1));
+    BOOST_CHECK(flatdb2.Dump(objSaved2));
+
+    CFlatDBTestObject objLoaded1, objLoaded2;
+    bool fLoaded2 = false;
+    boost::thread thread([&flatdb2, &objLoaded2, &fLoaded2] {
+        fLoaded2 = flatdb2.Load(objLoaded2, false);
+    });
+    const bool fLoaded1 = flatdb1.Load(objLoaded1, false);
+    thread.join();
+    BOOST_CHECK(fLoaded1);
+    BOOST_CHECK(fLoaded2);
+    BOOST_CHECK(objLoaded1.vValues == objSaved1.vValues);
+    BOOST_CHECK(objLoaded2.vValues == objSaved2.vValues);
+    BOOST_CHECK_EQUAL(objLoaded1.nCheckAndRemove, 0);
+    BOOST_CHECK_EQUAL(objLoaded2.nCheckAndRemove, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance.h"
+
+#include "base58.h"
+#include "governance-object.h"
+#include "governance-vote.h"
+#include "governance-votedb.h"
+#include "key.h"
+#include "masternodeman.h"
+#include "script/interpreter.h"
+#include "script/standard.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+
+#include "test/test_billiecoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <univalue.h>
+
+BOOST_FIXTURE_TEST_SUITE(governance_tests, TestChain100Setup)
+
+static CGovernanceVote SignedVote(const COutPoint& outpoint, const CKey& keyMasternode, const uint256& nParentHash, vote_outcome_enum_t eVoteOutcome)
+{
+    CGovernanceVote vote(outpoint, nParentHash, VOTE_SIGNAL_FUNDING, eVoteOutcome);
+    BOOST_CHECK(vote.Sign(keyMasternode, keyMasternode.GetPubKey()));
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(governance_orphan_votes)
+{
+    CGovernanceVoteDB* pvotedbOld = pgovernancevotedb;
+    pgovernancevotedb = new CGovernanceVoteDB(1 << 20, true);
+
+    CKey keyYes, keyNo;
+    keyYes.MakeNewKey(true);
+    keyNo.MakeNewKey(true);
+    const COutPoint outpointYes(GetRandHash(), 0);
+    const COutPoint outpointNo(GetRandHash(), 0);
+    CMasternode mnYes(CService(), outpointYes, keyYes.GetPubKey(), keyYes.GetPubKey(), PROTOCOL_VERSION);
+    CMasternode mnNo(CService(), outpointNo, keyNo.GetPubKey(), keyNo.GetPubKey(), PROTOCOL_VERSION);
+    BOOST_CHECK(mnodeman.Add(mnYes));
+    BOOST_CHECK(mnodeman.Add(mnNo));
+
+    const int64_t nNow = GetTime();
+    UniValue objProposal(UniValue::VOBJ);
+    objProposal.push_back(Pair("type", 1));
+    objProposal.push_back(Pair("name", "orphan-votes"));
+    objProposal.push_back(Pair("start_epoch", nNow));
+    objProposal.push_back(Pair("end_epoch", nNow + 30 * 24 * 60 * 60));
+    objProposal.push_back(Pair("payment_address", CBilliecoinAddress(coinbaseKey.GetPubKey().GetID()).ToString()));
+    objProposal.push_back(Pair("payment_amount", 10));
+    objProposal.push_back(Pair("url", "http://billiecoin.org/orphan-votes"));
+    const std::string strDataHex = HexStr(objProposal.write());
+    // the collateral is not part of the object hash
+    const uint256 nHash = CGovernanceObject(uint256(), 1, nNow, uint256(), strDataHex).GetHash();
+
+    // burn the collateral for the object and give it its confirmations
+    CScript scriptCoinbase = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction txCollateral;
+    txCollateral.nVersion = 1;
+    txCollateral.vin.resize(1);
+    txCollateral.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    txCollateral.vout.resize(2);
+    txCollateral.vout[0].nValue = GOVERNANCE_PROPOSAL_FEE_TX;
+    txCollateral.vout[0].scriptPubKey = CScript() << OP_RETURN << ToByteVector(nHash);
+    txCollateral.vout[1].nValue = coinbaseTxns[0].vout[0].nValue - GOVERNANCE_PROPOSAL_FEE_TX - CENT;
+    txCollateral.vout[1].scriptPubKey = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(coinbaseKey.Sign(SignatureHash(scriptCoinbase, txCollateral, 0, SIGHASH_ALL), vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    txCollateral.vin[0].scriptSig = CScript() << vchSig;
+    CreateAndProcessBlock(std::vector<CMutableTransaction>(1, txCollateral), scriptCoinbase);
+    for (int i = 1; i < GOVERNANCE_FEE_CONFIRMATIONS; i++)
+        CreateAndProcessBlock(std::vector<CMutableTransaction>(), scriptCoinbase);
+
+    // the votes arrive ahead of their object and are kept as orphans
+    CGovernanceVote voteYes = SignedVote(outpointYes, keyYes, nHash, VOTE_OUTCOME_YES);
+    CGovernanceVote voteNo = SignedVote(outpointNo, keyNo, nHash, VOTE_OUTCOME_NO);
+    CGovernanceException exception;
+    BOOST_CHECK(!governance.ProcessVoteAndRelay(voteYes, exception, *connman));
+    BOOST_CHECK(!governance.ProcessVoteAndRelay(voteNo, exception, *connman));
+    BOOST_CHECK(governance.FindGovernanceObject(nHash) == NULL);
+
+    CGovernanceObject govobj(uint256(), 1, nNow, txCollateral.GetHash(), strDataHex);
+    BOOST_CHECK(govobj.GetHash() == nHash);
+    governance.AddGovernanceObject(govobj, *connman);
+
+    // the object kept by the manager, not the one handed in, holds the votes
+    CGovernanceObject* pGovobj = governance.FindGovernanceObject(nHash);
+    BOOST_CHECK(pGovobj != NULL);
+    if (pGovobj) {
+        BOOST_CHECK_EQUAL(pGovobj->GetVoteFile().GetVoteCount(), 2);
+        BOOST_CHECK(pGovobj->GetVoteFile().HasVote(voteYes.GetHash()));
+        BOOST_CHECK(pGovobj->GetVoteFile().HasVote(voteNo.GetHash()));
+        BOOST_CHECK_EQUAL(pGovobj->GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+        BOOST_CHECK_EQUAL(pGovobj->GetNoCount(VOTE_SIGNAL_FUNDING), 1);
+        BOOST_CHECK_EQUAL(pGovobj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING), 0);
+    }
+
+    // a vote sent again is known to the stored object
+    BOOST_CHECK(!governance.ProcessVoteAndRelay(voteYes, exception, *connman));
+    if (pGovobj)
+        BOOST_CHECK_EQUAL(pGovobj->GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+
+    governance.Clear();
+    mnodeman.Clear();
+    delete pgovernancevotedb;
+    pgovernancevotedb = pvotedbOld;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
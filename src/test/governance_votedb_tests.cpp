@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "governance-votedb.h"
+
+#include "governance-object.h"
+#include "test/test_billiecoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votedb_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(governance_votedb_file)
+{
+    CGovernanceVoteDB* pvotedbOld = pgovernancevotedb;
+    pgovernancevotedb = new CGovernanceVoteDB(1 << 20, true);
+
+    const uint256 nParentHash = GetRandHash();
+    const uint256 nOtherParentHash = GetRandHash();
+    const COutPoint outpoint1(GetRandHash(), 0);
+    const COutPoint outpoint2(GetRandHash(), 1);
+
+    CGovernanceObjectVoteFile fileVotes(nParentHash);
+    std::vector<uint256> vecHashes;
+    for (int i = 0; i < 10; i++) {
+        CGovernanceVote vote(i % 2 ? outpoint1 : outpoint2, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+        vote.SetTime(1000 + i);
+        fileVotes.AddVote(vote);
+        // adding a known vote again is a no-op
+        fileVotes.AddVote(vote);
+        vecHashes.push_back(vote.GetHash());
+    }
+    // votes of another object are kept apart
+    CGovernanceObjectVoteFile fileOther(nOtherParentHash);
+    CGovernanceVote voteOther(outpoint1, nOtherParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO);
+    fileOther.AddVote(voteOther);
+    // a file only takes votes for its own object
+    fileVotes.AddVote(voteOther);
+    CGovernanceObjectVoteFile fileUnset;
+    fileUnset.AddVote(voteOther);
+    BOOST_CHECK_EQUAL(fileUnset.GetVoteCount(), 0);
+
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 10);
+    BOOST_CHECK_EQUAL(fileVotes.GetVotes().size(), 10U);
+    BOOST_CHECK(fileVotes.HasVote(vecHashes[3]));
+    BOOST_CHECK(!fileVotes.HasVote(voteOther.GetHash()));
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(fileVotes.SerializeVoteToStream(vecHashes[3], ss));
+    CGovernanceVote voteRead;
+    ss >> voteRead;
+    BOOST_CHECK(voteRead.GetHash() == vecHashes[3]);
+
+    // the file itself only refers to the votes on disk
+    CDataStream ssFile(SER_DISK, CLIENT_VERSION);
+    ssFile << fileVotes;
+    CGovernanceObjectVoteFile fileLoaded;
+    ssFile >> fileLoaded;
+    BOOST_CHECK_EQUAL(fileLoaded.GetVoteCount(), 10);
+    BOOST_CHECK(fileLoaded.HasVote(vecHashes[0]));
+
+    int nRead = 0;
+    fileLoaded.ForEachVote([&nRead](const CGovernanceVote& vote) { return ++nRead < 4; });
+    BOOST_CHECK_EQUAL(nRead, 4);
+
+    fileLoaded.RemoveVotesFromMasternode(outpoint1);
+    BOOST_CHECK_EQUAL(fileLoaded.GetVoteCount(), 5);
+    BOOST_CHECK(!fileLoaded.HasVote(vecHashes[1]));
+    BOOST_CHECK(fileLoaded.HasVote(vecHashes[0]));
+    for (const auto& vote : fileLoaded.GetVotes())
+        BOOST_CHECK(vote.GetMasternodeOutpoint() == outpoint2);
+
+    // votes for objects no longer known go, the others stay
+    std::set<uint256> setParentHashes;
+    setParentHashes.insert(nParentHash);
+    BOOST_CHECK_EQUAL(pgovernancevotedb->EraseOtherVotes(setParentHashes), 1);
+    BOOST_CHECK(!fileOther.HasVote(voteOther.GetHash()));
+    BOOST_CHECK_EQUAL(fileLoaded.GetVotes().size(), 5U);
+
+    fileLoaded.RemoveAllVotes();
+    BOOST_CHECK_EQUAL(fileLoaded.GetVoteCount(), 0);
+    BOOST_CHECK(!fileLoaded.HasVote(vecHashes[0]));
+
+    delete pgovernancevotedb;
+    pgovernancevotedb = pvotedbOld;
+}
+
+BOOST_AUTO_TEST_CASE(governance_votedb_reload)
+{
+    CGovernanceVoteDB* pvotedbOld = pgovernancevotedb;
+    pgovernancevotedb = new CGovernanceVoteDB(1 << 20, true);
+
+    CGovernanceObject govobj(uint256(), 1, 1500000000, GetRandHash(), "7b7d");
+    const uint256 nHash = govobj.GetHash();
+    BOOST_CHECK(govobj.GetVoteFile().GetParentHash() == nHash);
+
+    // the hash changes with the masternode, so does the file
+    govobj.SetMasternodeOutpoint(COutPoint(GetRandHash(), 0));
+    const uint256 nParentHash = govobj.GetHash();
+    BOOST_CHECK(nParentHash != nHash);
+    BOOST_CHECK(govobj.GetVoteFile().GetParentHash() == nParentHash);
+
+    // the stored count says no votes while three are on disk
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << govobj;
+    std::vector<uint256> vecHashes;
+    for (int i = 0; i < 3; i++) {
+        CGovernanceVote vote(COutPoint(GetRandHash(), i), nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+        BOOST_CHECK(pgovernancevotedb->WriteVote(vote));
+        vecHashes.push_back(vote.GetHash());
+    }
+
+    CGovernanceObject govobjLoaded;
+    ss >> govobjLoaded;
+    const CGovernanceObjectVoteFile& fileVotes = govobjLoaded.GetVoteFile();
+    BOOST_CHECK(fileVotes.GetParentHash() == nParentHash);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 3);
+    for (const auto& nVoteHash : vecHashes)
+        BOOST_CHECK(fileVotes.HasVote(nVoteHash));
+    int nRead = 0;
+    fileVotes.ForEachVote([&nRead, &nParentHash](const CGovernanceVote& vote) {
+        BOOST_CHECK(vote.GetParentHash() == nParentHash);
+        return ++nRead > 0;
+    });
+    BOOST_CHECK_EQUAL(nRead, 3);
+
+    // a vote erased behind the file's back is counted out on the next load
+    BOOST_CHECK(pgovernancevotedb->EraseVotes(nParentHash, std::vector<uint256>(1, vecHashes[0])));
+    CDataStream ssLoaded(SER_DISK, CLIENT_VERSION);
+    ssLoaded << govobjLoaded;
+    CGovernanceObject govobjReloaded;
+    ssLoaded >> govobjReloaded;
+    BOOST_CHECK_EQUAL(govobjReloaded.GetVoteFile().GetVoteCount(), 2);
+    BOOST_CHECK(!govobjReloaded.GetVoteFile().HasVote(vecHashes[0]));
+    BOOST_CHECK_EQUAL(govobjReloaded.GetVoteFile().GetVotes().size(), 2U);
+
+    // objects read from the network have no votes but are keyed the same way
+    CDataStream ssNet(SER_NETWORK, PROTOCOL_VERSION);
+    ssNet << govobj;
+    CGovernanceObject govobjNet;
+    ssNet >> govobjNet;
+    BOOST_CHECK(govobjNet.GetVoteFile().GetParentHash() == nParentHash);
+    BOOST_CHECK(govobjNet.GetVoteFile().HasVote(vecHashes[1]));
+
+    delete pgovernancevotedb;
+    pgovernancevotedb = pvotedbOld;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,185 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "graph.h"
+
+#include "test/test_billiecoin.h"
+#include "test/test_random.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/hawick_circuits.hpp>
+#include <boost/graph/topological_sort.hpp>
+#include <boost/next_prior.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(graph_tests, BasicTestingSetup)
+
+typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS> BoostGraph;
+
+// the visitor the block graph code used with hawick_circuits, collects the vertex closing each circuit
+struct CycleVisitor
+{
+    std::set<int>& cleared;
+    CycleVisitor(std::set<int>& clearedIn) : cleared(clearedIn) {}
+    template <typename Path, typename Graph>
+    void cycle(const Path& p, Graph& g)
+    {
+        if (p.empty())
+            return;
+        cleared.insert(*boost::prior(p.end()));
+    }
+};
+
+// Conflicted transactions and transaction order of the boost::adjacency_list code the
+// block graph replaced: hawick_circuits, clear_out_edges of the senders that close a
+// circuit and topological_sort
+static bool BoostOrder(int nVertices, const std::vector<std::pair<int, int> >& vEdges, std::map<int, std::vector<int> > mapTxIndex,
+    std::vector<int>& vConflicted, std::vector<int>& vOrdered)
+{
+    BoostGraph graph;
+    for (int i = 0; i < nVertices; i++)
+        boost::add_vertex(graph);
+    for (const auto& edge : vEdges)
+        boost::add_edge(edge.first, edge.second, graph);
+
+    std::set<int> cleared;
+    CycleVisitor visitor(cleared);
+    boost::hawick_circuits(graph, visitor);
+    for (int nVertex : cleared) {
+        auto it = mapTxIndex.find(nVertex);
+        if (it == mapTxIndex.end())
+            continue;
+        boost::clear_out_edges(nVertex, graph);
+        vConflicted.insert(vConflicted.end(), it->second.begin(), it->second.end());
+        mapTxIndex.erase(it);
+    }
+    std::sort(vConflicted.begin(), vConflicted.end());
+
+    std::vector<int> vSorted;
+    try {
+        boost::topological_sort(graph, std::back_inserter(vSorted));
+    } catch (const boost::not_a_dag&) {
+        return false;
+    }
+    std::reverse(vSorted.begin(), vSorted.end());
+    for (int nVertex : vSorted) {
+        auto it = mapTxIndex.find(nVertex);
+        if (it != mapTxIndex.end())
+            vOrdered.insert(vOrdered.end(), it->second.begin(), it->second.end());
+    }
+    return true;
+}
+
+static void CheckMatchesBoost(int nVertices, const std::vector<std::pair<int, int> >& vEdges, const std::map<int, std::vector<int> >& mapTxIndex)
+{
+    std::vector<int> vConflictedBoost, vOrderedBoost;
+    const bool fSortedBoost = BoostOrder(nVertices, vEdges, mapTxIndex, vConflictedBoost, vOrderedBoost);
+
+    CServiceTxGraph graph;
+    for (int i = 0; i < nVertices; i++)
+        graph.AddVertex();
+    for (const auto& edge : vEdges)
+        graph.AddEdge(edge.first, edge.second);
+    for (const auto& senderTxs : mapTxIndex) {
+        for (int nTxIndex : senderTxs.second)
+            graph.AddSenderTx(senderTxs.first, nTxIndex);
+    }
+    std::vector<int> vConflicted, vOrder, vOrdered;
+    graph.RemoveCycles(vConflicted);
+    const bool fSorted = graph.TopologicalSort(vOrder);
+    for (int nVertex : vOrder) {
+        const std::vector<int>& vTxs = graph.GetSenderTxs(nVertex);
+        vOrdered.insert(vOrdered.end(), vTxs.begin(), vTxs.end());
+    }
+
+    BOOST_CHECK(vConflicted == vConflictedBoost);
+    BOOST_CHECK_EQUAL(fSorted, fSortedBoost);
+    BOOST_CHECK(vOrdered == vOrderedBoost);
+}
+
+BOOST_AUTO_TEST_CASE(graph_matches_boost)
+{
+    // a cycle with a duplicate edge, closed by the sender of the last edge
+    CheckMatchesBoost(3, {{0, 1}, {0, 1}, {1, 2}, {2, 0}}, {{0, {1}}, {1, {2}}, {2, {3}}});
+    // a self loop next to a path
+    CheckMatchesBoost(3, {{1, 1}, {0, 1}, {1, 2}}, {{0, {1}}, {1, {2, 4}}});
+    // no cycle, duplicate and transitive edges keep their insertion order
+    CheckMatchesBoost(4, {{0, 2}, {0, 1}, {0, 2}, {1, 2}, {3, 0}}, {{0, {1}}, {1, {2}}, {3, {3, 5}}});
+    // two cycles through vertex 0, and a receiver that never sends
+    CheckMatchesBoost(5, {{0, 1}, {1, 0}, {0, 2}, {2, 3}, {3, 0}, {3, 4}}, {{0, {1}}, {1, {2}}, {2, {3}}, {3, {4}}});
+    // a vertex closing a cycle that sends nothing keeps its edges
+    CheckMatchesBoost(2, {{0, 1}, {1, 0}}, {{0, {1}}});
+
+    // random multigraphs with self loops, parallel edges and back edges
+    seed_insecure_rand(true);
+    for (int i = 0; i < 2000; i++) {
+        const int nVertices = 1 + insecure_rand() % 30;
+        const int nEdges = insecure_rand() % (nVertices * 3 / 2 + 1);
+        std::vector<std::pair<int, int> > vEdges;
+        std::map<int, std::vector<int> > mapTxIndex;
+        int nTxIndex = 1;
+        for (int e = 0; e < nEdges; e++) {
+            const int nFrom = insecure_rand() % nVertices;
+            int nTo = insecure_rand() % nVertices;
+            if (insecure_rand() % 4 == 0)
+                nTo = nFrom > 0 ? insecure_rand() % nFrom : nFrom;
+            vEdges.push_back(std::make_pair(nFrom, nTo));
+            if (!mapTxIndex.count(nFrom) || insecure_rand() % 3 == 0)
+                mapTxIndex[nFrom].push_back(nTxIndex++);
+        }
+        for (int v = 0; v < nVertices; v++) {
+            if (insecure_rand() % 3 == 0 && !mapTxIndex.count(v))
+                mapTxIndex[v].push_back(nTxIndex++);
+        }
+        CheckMatchesBoost(nVertices, vEdges, mapTxIndex);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(graph_partition_by_keys)
+{
+    std::vector<std::vector<int> > vGroups;
+    PartitionByKeys(std::vector<std::vector<std::string> >(), vGroups);
+    BOOST_CHECK(vGroups.empty());
+
+    // 0 and 2 share a key, 4 joins them through 3 which also shares a key with 2,
+    // 1 and 5 share nothing with anybody, 6 has no keys at all
+    const std::vector<std::vector<std::string> > vTxKeys = {
+        {"asset-a", "alias-x"},
+        {"asset-b", "alias-y"},
+        {"asset-c", "alias-x"},
+        {"asset-c", "alias-z"},
+        {"asset-d", "alias-z"},
+        {"asset-e"},
+        {},
+    };
+    PartitionByKeys(vTxKeys, vGroups);
+    const std::vector<std::vector<int> > vExpected = {{0, 2, 3, 4}, {1}, {5}, {6}};
+    BOOST_CHECK(vGroups == vExpected);
+
+    // a key shared by the last transaction merges groups that started out apart, the
+    // merged group keeps the block order and its place by its first transaction
+    const std::vector<std::vector<std::string> > vTxKeysMerged = {
+        {"asset-a"},
+        {"asset-b"},
+        {"asset-c"},
+        {"asset-c", "asset-a"},
+        {"asset-b", "asset-a"},
+    };
+    PartitionByKeys(vTxKeysMerged, vGroups);
+    const std::vector<std::vector<int> > vExpectedMerged = {{0, 1, 2, 3, 4}};
+    BOOST_CHECK(vGroups == vExpectedMerged);
+
+    // no transaction appears twice and every one is covered
+    const std::vector<std::vector<std::string> > vTxKeysSame = {{"k"}, {"k", "k"}, {"j"}, {"k"}};
+    PartitionByKeys(vTxKeysSame, vGroups);
+    const std::vector<std::vector<int> > vExpectedSame = {{0, 1, 3}, {2}};
+    BOOST_CHECK(vGroups == vExpectedSame);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,103 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternodeman.h"
+#include "masternode-sync.h"
+
+#include "test/test_billiecoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, TestingSetup)
+
+static CMasternode MakeMasternode(int nProtocolVersion)
+{
+    CMasternode mn;
+    mn.outpoint = COutPoint(GetRandHash(), 0);
+    mn.nCollateralMinConfBlockHash = GetRandHash();
+    mn.nProtocolVersion = nProtocolVersion;
+    return mn;
+}
+
+// ranks from a list that never ranked anything before
+static void CheckRanks(CMasternodeMan& man, const std::vector<CMasternode>& vecMasternodes, const std::vector<uint256>& vecBlockHashes)
+{
+    CMasternodeMan manFresh;
+    for (auto mn : vecMasternodes)
+        manFresh.Add(mn);
+
+    for (const auto& hash : vecBlockHashes) {
+        for (const auto& mn : vecMasternodes) {
+            int nRank, nRankFresh;
+            bool fRank = man.GetMasternodeRank(mn.outpoint, nRank, hash, PROTOCOL_VERSION);
+            bool fRankFresh = manFresh.GetMasternodeRank(mn.outpoint, nRankFresh, hash, PROTOCOL_VERSION);
+            BOOST_CHECK_EQUAL(fRank, fRankFresh);
+            BOOST_CHECK_EQUAL(nRank, nRankFresh);
+        }
+    }
+}
+
+// replace the list the way reading mncache.dat does
+static void ReadList(CMasternodeMan& man, const std::vector<CMasternode>& vecMasternodes)
+{
+    CMasternodeMan manWritten;
+    for (auto mn : vecMasternodes)
+        manWritten.Add(mn);
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << manWritten;
+    ss >> man;
+}
+
+BOOST_AUTO_TEST_CASE(masternodeman_rank_cache)
+{
+    CMasternodeMan man;
+    std::vector<CMasternode> vecMasternodes;
+    std::vector<uint256> vecBlockHashes;
+    for (int i = 0; i < 3; i++)
+        vecBlockHashes.push_back(GetRandHash());
+
+    // nothing is ranked before the list is synced
+    CMasternode mn = MakeMasternode(PROTOCOL_VERSION);
+    vecMasternodes.push_back(mn);
+    BOOST_CHECK(man.Add(mn));
+    int nRank;
+    BOOST_CHECK(!man.GetMasternodeRank(mn.outpoint, nRank, vecBlockHashes[0]));
+    BOOST_CHECK_EQUAL(nRank, -1);
+
+    masternodeSync.Reset();
+    while (!masternodeSync.IsMasternodeListSynced())
+        masternodeSync.SwitchToNextAsset(*connman);
+
+    for (int i = 0; i < 20; i++) {
+        mn = MakeMasternode(PROTOCOL_VERSION);
+        vecMasternodes.push_back(mn);
+        BOOST_CHECK(man.Add(mn));
+    }
+    CheckRanks(man, vecMasternodes, vecBlockHashes);
+
+    // added after the ranks were cached
+    mn = MakeMasternode(PROTOCOL_VERSION);
+    vecMasternodes.push_back(mn);
+    BOOST_CHECK(man.Add(mn));
+    CheckRanks(man, vecMasternodes, vecBlockHashes);
+
+    // removed after the ranks were cached
+    vecMasternodes.erase(vecMasternodes.begin() + 5);
+    ReadList(man, vecMasternodes);
+    BOOST_CHECK_EQUAL(man.size(), (int)vecMasternodes.size());
+    CheckRanks(man, vecMasternodes, vecBlockHashes);
+
+    // a protocol version update drops one below the minimum, the next one brings it back
+    vecMasternodes[3].nProtocolVersion = PROTOCOL_VERSION - 1;
+    ReadList(man, vecMasternodes);
+    BOOST_CHECK(!man.GetMasternodeRank(vecMasternodes[3].outpoint, nRank, vecBlockHashes[0], PROTOCOL_VERSION));
+    CheckRanks(man, vecMasternodes, vecBlockHashes);
+    vecMasternodes[3].nProtocolVersion = PROTOCOL_VERSION;
+    ReadList(man, vecMasternodes);
+    CheckRanks(man, vecMasternodes, vecBlockHashes);
+
+    masternodeSync.Reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
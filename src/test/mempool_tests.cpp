@@ -3,8 +3,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "alias.h"
+#include "consensus/validation.h"
+#include "graph.h"
+#include "script/interpreter.h"
 #include "txmempool.h"
 #include "util.h"
+#include "utiltime.h"
+#include "validation.h"
 
 #include "test/test_billiecoin.h"
 
@@ -587,4 +593,101 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
 	SetMockTime(0);
 }
 
+BOOST_FIXTURE_TEST_CASE(MempoolArrivalTimeTest, TestChain100Setup)
+{
+	// Accepted transactions are stamped with the clock in milliseconds, replayed ones keep the time they are given
+	CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+	std::vector<CMutableTransaction> spends(2);
+	for (int i = 0; i < 2; i++)
+	{
+		spends[i].nVersion = 1;
+		spends[i].vin.resize(1);
+		spends[i].vin[0].prevout.hash = coinbaseTxns[i].GetHash();
+		spends[i].vin[0].prevout.n = 0;
+		spends[i].vout.resize(1);
+		spends[i].vout[0].nValue = 11*CENT;
+		spends[i].vout[0].scriptPubKey = scriptPubKey;
+
+		std::vector<unsigned char> vchSig;
+		uint256 hash = SignatureHash(scriptPubKey, spends[i], 0, SIGHASH_ALL);
+		BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+		vchSig.push_back((unsigned char)SIGHASH_ALL);
+		spends[i].vin[0].scriptSig << vchSig;
+	}
+
+	LOCK(cs_main);
+	CValidationState state;
+	const int64_t nBefore = GetTimeMillis();
+	BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(spends[0]), false, NULL));
+	const int64_t nAfter = GetTimeMillis();
+	// a time between two prior second stamps of the clock
+	const int64_t nReplayed = 1500000000;
+	BOOST_CHECK(AcceptToMemoryPoolWithTime(mempool, state, MakeTransactionRef(spends[1]), false, NULL, nReplayed, nReplayed * 1000 + 999));
+
+	LOCK(mempool.cs);
+	CTxMemPool::txiter it = mempool.mapTx.find(spends[0].GetHash());
+	BOOST_CHECK(it != mempool.mapTx.end());
+	if (it != mempool.mapTx.end()) {
+		BOOST_CHECK(it->GetArrivalTime() >= nBefore && it->GetArrivalTime() <= nAfter);
+	}
+	it = mempool.mapTx.find(spends[1].GetHash());
+	BOOST_CHECK(it != mempool.mapTx.end());
+	if (it != mempool.mapTx.end()) {
+		BOOST_CHECK_EQUAL(it->GetTime(), nReplayed);
+		BOOST_CHECK_EQUAL(it->GetArrivalTime(), nReplayed * 1000 + 999);
+	}
+	mempool.clear();
+}
+
+BOOST_AUTO_TEST_CASE(MempoolArrivalOrderTest)
+{
+	// Service transactions go last in the order of their arrival in milliseconds, even within one second
+	CTxMemPool pool(CFeeRate(0));
+	TestMemPoolEntryHelper entry;
+	std::vector<CTransactionRef> vtx;
+	for (int i = 0; i < 5; i++)
+	{
+		CMutableTransaction tx;
+		tx.vin.resize(1);
+		tx.vin[0].scriptSig = CScript() << i;
+		tx.vout.resize(1);
+		tx.vout[0].nValue = 10 * COIN;
+		if (i == 0) {
+			tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+		}
+		else {
+			tx.nVersion = BILLIECOIN_TX_VERSION;
+			tx.vout[0].scriptPubKey = CScript() << CScript::EncodeOP_N(OP_BILLIECOIN_CERT) << CScript::EncodeOP_N(OP_CERT_UPDATE) << vchFromString("cert") << OP_2DROP << OP_DROP << OP_11 << OP_EQUAL;
+		}
+		vtx.push_back(MakeTransactionRef(tx));
+	}
+	// the same second for all of them, the last one is not in the pool
+	const int64_t arrivalTimes[] = {5000, 5002, 5000, 5001};
+	for (int i = 0; i < 4; i++)
+	{
+		LockPoints lp;
+		pool.addUnchecked(vtx[i]->GetHash(), CTxMemPoolEntry(vtx[i], entry.nFee, 5, entry.dPriority, entry.nHeight,
+			vtx[i]->GetValueOut(), entry.spendsCoinbase, entry.sigOpCount, lp, arrivalTimes[i]));
+	}
+
+	std::vector<CTransactionRef> blockVtx;
+	blockVtx.push_back(vtx[4]);
+	blockVtx.push_back(vtx[1]);
+	blockVtx.push_back(vtx[2]);
+	blockVtx.push_back(vtx[0]);
+	blockVtx.push_back(vtx[3]);
+	{
+		LOCK(pool.cs);
+		BOOST_CHECK(OrderBasedOnArrivalTime(pool, blockVtx));
+	}
+	BOOST_CHECK_EQUAL(blockVtx.size(), 5U);
+	if (blockVtx.size() == 5) {
+		BOOST_CHECK(blockVtx[0] == vtx[0]);
+		BOOST_CHECK(blockVtx[1] == vtx[2]);
+		BOOST_CHECK(blockVtx[2] == vtx[3]);
+		BOOST_CHECK(blockVtx[3] == vtx[1]);
+		BOOST_CHECK(blockVtx[4] == vtx[4]);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
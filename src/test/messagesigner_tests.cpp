@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "messagesigner.h"
+
+#include "random.h"
+#include "test/test_billiecoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(messagesigner_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messagesigner_recovered_hash_key)
+{
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    const uint256 hash = GetRandHash();
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(CHashSigner::SignHash(hash, key, vchSig));
+    std::string strError;
+
+    // a recovered good signature verifies, as often as it is checked
+    CRecoveredHashKey keyRecovered;
+    BOOST_CHECK(CHashSigner::RecoverHashKey(hash, vchSig, keyRecovered));
+    CKeyID keyID;
+    BOOST_CHECK(keyRecovered.Get(hash, vchSig, keyID));
+    BOOST_CHECK(keyID == key.GetPubKey().GetID());
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key.GetPubKey().GetID(), vchSig, keyRecovered, strError));
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key.GetPubKey().GetID(), vchSig, keyRecovered, strError));
+
+    // and still fails against another key
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, keyOther.GetPubKey().GetID(), vchSig, keyRecovered, strError));
+    BOOST_CHECK(strError.find("Keys don't match") == 0);
+
+    // a key recovered for another hash or signature is not used, the signature is recovered again
+    const uint256 hashOther = GetRandHash();
+    std::vector<unsigned char> vchSigOther;
+    BOOST_CHECK(CHashSigner::SignHash(hashOther, keyOther, vchSigOther));
+    BOOST_CHECK(!keyRecovered.Get(hashOther, vchSigOther, keyID));
+    BOOST_CHECK(!keyRecovered.Get(hashOther, vchSig, keyID));
+    BOOST_CHECK(CHashSigner::VerifyHash(hashOther, keyOther.GetPubKey().GetID(), vchSigOther, keyRecovered, strError));
+    BOOST_CHECK(!CHashSigner::VerifyHash(hashOther, key.GetPubKey().GetID(), vchSigOther, keyRecovered, strError));
+
+    // nothing recovered, nothing to get
+    BOOST_CHECK(!CRecoveredHashKey().Get(hash, vchSig, keyID));
+
+    // a signature that recovers no key is left for VerifyHash to report
+    std::vector<unsigned char> vchSigBad(vchSig.size(), 0);
+    CRecoveredHashKey keyBad;
+    BOOST_CHECK(!CHashSigner::RecoverHashKey(hash, vchSigBad, keyBad));
+    BOOST_CHECK(!keyBad.Get(hash, vchSigBad, keyID));
+    strError.clear();
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, key.GetPubKey().GetID(), vchSigBad, keyBad, strError));
+    BOOST_CHECK_EQUAL(strError, "Error recovering public key.");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
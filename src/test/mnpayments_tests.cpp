@@ -0,0 +1,140 @@
+// Copyright (c) 2017-2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-payments.h"
+
+#include "test/test_billiecoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(mnpayments_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(mnpayments_blocks_ring)
+{
+    CMasternodeBlocksRing ring;
+    BOOST_CHECK_EQUAL(ring.size(), 0);
+    BOOST_CHECK(ring.GetFirstHeight() > ring.GetLastHeight());
+    BOOST_CHECK(!ring.Find(100));
+
+    // heights only seen in votes are no blocks yet
+    const uint256 hash1 = GetRandHash();
+    const uint256 hash2 = GetRandHash();
+    BOOST_CHECK(ring.AddVoteHash(100, hash1));
+    BOOST_CHECK(!ring.Has(100));
+    BOOST_CHECK_EQUAL(ring.size(), 0);
+
+    CMasternodeBlockPayees* pblockPayees = ring.Emplace(100);
+    BOOST_CHECK(pblockPayees);
+    BOOST_CHECK_EQUAL(pblockPayees->nBlockHeight, 100);
+    BOOST_CHECK_EQUAL(ring.Emplace(100), pblockPayees);
+    BOOST_CHECK(ring.AddVoteHash(101, hash2));
+    BOOST_CHECK(ring.Emplace(101));
+    BOOST_CHECK_EQUAL(ring.size(), 2);
+    BOOST_CHECK(!ring.Has(100 + MNPAYMENTS_RING_SIZE));
+
+    // heights further apart than the ring is long make it grow
+    const int nFar = 100 + 3 * MNPAYMENTS_RING_SIZE;
+    BOOST_CHECK(ring.Emplace(nFar));
+    BOOST_CHECK(ring.Has(100));
+    BOOST_CHECK(ring.Has(101));
+    BOOST_CHECK(ring.Has(nFar));
+    BOOST_CHECK_EQUAL(ring.GetFirstHeight(), 100);
+    BOOST_CHECK_EQUAL(ring.GetLastHeight(), nFar);
+    // but not past the maximum
+    BOOST_CHECK(!ring.Emplace(100 + MNPAYMENTS_RING_SIZE_MAX));
+
+    // evicting hands back the votes of the heights evicted
+    std::vector<uint256> vecVoteHashes;
+    ring.EraseBelow(101, vecVoteHashes);
+    BOOST_CHECK_EQUAL(vecVoteHashes.size(), 1U);
+    BOOST_CHECK(vecVoteHashes[0] == hash1);
+    BOOST_CHECK(!ring.Has(100));
+    BOOST_CHECK(ring.Has(101));
+    BOOST_CHECK_EQUAL(ring.size(), 2);
+    // and evicted heights are not taken again
+    BOOST_CHECK(!ring.Emplace(100));
+    BOOST_CHECK(!ring.AddVoteHash(100, hash1));
+
+    vecVoteHashes.clear();
+    ring.EraseBelow(nFar + 1, vecVoteHashes);
+    BOOST_CHECK_EQUAL(vecVoteHashes.size(), 1U);
+    BOOST_CHECK_EQUAL(ring.size(), 0);
+    BOOST_CHECK(!ring.Has(nFar));
+
+    ring.clear();
+    BOOST_CHECK(ring.Emplace(100));
+}
+
+BOOST_AUTO_TEST_CASE(mnpayments_serialize)
+{
+    CMasternodePayments payments;
+    for (int h = 1000; h < 1010; h++) {
+        CMasternodePaymentVote vote(COutPoint(GetRandHash(), 0), h, CScript() << OP_TRUE, h - 100);
+        const uint256 nHash = vote.GetHash();
+        payments.mapMasternodePaymentVotes.emplace(nHash, vote);
+        BOOST_CHECK(payments.ringMasternodeBlocks.AddVoteHash(h, nHash));
+        if (h % 2) {
+            payments.ringMasternodeBlocks.Emplace(h)->AddPayee(vote);
+        }
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << payments;
+
+    // the layout is that of the std::maps the votes and blocks were kept in before
+    std::map<uint256, CMasternodePaymentVote> mapVotes;
+    std::map<int, CMasternodeBlockPayees> mapBlocks;
+    CDataStream ssMaps(ss);
+    ssMaps >> mapVotes >> mapBlocks;
+    BOOST_CHECK_EQUAL(mapVotes.size(), 10U);
+    BOOST_CHECK_EQUAL(mapBlocks.size(), 5U);
+    BOOST_CHECK(ssMaps.empty());
+
+    CMasternodePayments paymentsRead;
+    ss >> paymentsRead;
+    BOOST_CHECK_EQUAL(paymentsRead.GetVoteCount(), 10);
+    BOOST_CHECK_EQUAL(paymentsRead.GetBlockCount(), 5);
+    CScript payee;
+    BOOST_CHECK(paymentsRead.GetBlockPayee(1001, payee));
+    BOOST_CHECK(payee == CScript() << OP_TRUE);
+    BOOST_CHECK(!paymentsRead.GetBlockPayee(1002, payee));
+
+    // evicting a height drops its votes too
+    std::vector<uint256> vecVoteHashes;
+    paymentsRead.ringMasternodeBlocks.EraseBelow(1005, vecVoteHashes);
+    BOOST_CHECK_EQUAL(vecVoteHashes.size(), 5U);
+    BOOST_CHECK_EQUAL(paymentsRead.GetBlockCount(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(mnpayments_rejected_votes)
+{
+    CMasternodePayments payments;
+    CMasternodePaymentVote vote(COutPoint(GetRandHash(), 0), 1000, CScript() << OP_TRUE, 900);
+    const uint256 nHashKept = vote.GetHash();
+    payments.mapMasternodePaymentVotes.emplace(nHashKept, vote);
+    const uint256 nHashRejected = GetRandHash();
+    BOOST_CHECK(payments.HasPaymentVote(nHashKept));
+    BOOST_CHECK(!payments.HasPaymentVote(nHashRejected));
+
+    // a rejected vote counts as seen without being kept
+    payments.AddRejectedPaymentVote(nHashRejected);
+    BOOST_CHECK(payments.HasPaymentVote(nHashRejected));
+    BOOST_CHECK(!payments.HasVerifiedPaymentVote(nHashRejected));
+    BOOST_CHECK_EQUAL(payments.GetVoteCount(), 1);
+
+    // the set is bounded, it starts over once full
+    for (size_t i = 1; i < MNPAYMENTS_REJECTED_VOTES_MAX; i++)
+        payments.AddRejectedPaymentVote(GetRandHash());
+    BOOST_CHECK_EQUAL(payments.setRejectedPaymentVotes.size(), MNPAYMENTS_REJECTED_VOTES_MAX);
+    BOOST_CHECK(payments.HasPaymentVote(nHashRejected));
+    payments.AddRejectedPaymentVote(GetRandHash());
+    BOOST_CHECK_EQUAL(payments.setRejectedPaymentVotes.size(), 1U);
+    BOOST_CHECK(!payments.HasPaymentVote(nHashRejected));
+
+    payments.Clear();
+    BOOST_CHECK(payments.setRejectedPaymentVotes.empty());
+    BOOST_CHECK(!payments.HasPaymentVote(nHashKept));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
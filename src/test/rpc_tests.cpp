@@ -356,4 +356,48 @@ BOOST_AUTO_TEST_CASE(rpc_sentinel_ping)
     BOOST_CHECK_THROW(CallRPC("sentinelping 2"), std::bad_cast);
 }
 
+// collects what an RPC streams
+class CTestRPCStream : public RPCStream
+{
+public:
+    std::string strJSON;
+    std::string strClosing;
+
+    void Write(const std::string& str) override { strJSON += str; }
+    void SetClosing(const std::string& str) override { strClosing = str; }
+};
+
+// the rows of a result array pushed without and with a stream
+static void CheckResultArray(const std::string& strKey, const UniValue& oMembers)
+{
+    UniValue row(UniValue::VOBJ);
+    row.push_back(Pair("name", "a\"b"));
+    JSONRPCRequest request;
+    for (int nRows = 0; nRows < 3; nRows++) {
+        RPCResultArray collected(request, strKey);
+        CTestRPCStream stream;
+        request.stream = &stream;
+        RPCResultArray streamed(request, strKey);
+        request.stream = NULL;
+        for (int i = 0; i < nRows; i++) {
+            collected.push_back(row);
+            streamed.push_back(row);
+            BOOST_CHECK(!stream.strClosing.empty());
+        }
+        BOOST_CHECK_EQUAL(streamed.size(), (size_t)nRows);
+        const UniValue result = collected.Finish(oMembers);
+        BOOST_CHECK(streamed.Finish(oMembers).isNull());
+        BOOST_CHECK_EQUAL(stream.strJSON, result.write());
+        BOOST_CHECK(stream.strClosing.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rpc_result_array)
+{
+    CheckResultArray("", NullUniValue);
+    UniValue oMembers(UniValue::VOBJ);
+    oMembers.push_back(Pair("cursor", "00ff"));
+    CheckResultArray("results", oMembers);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
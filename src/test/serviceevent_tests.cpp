@@ -0,0 +1,129 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "serviceevent.h"
+
+#include "validationinterface.h"
+
+#include "test/test_billiecoin.h"
+
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(serviceevent_tests, BasicTestingSetup)
+
+// collects what the publisher thread hands to the validation interface
+class CServiceEventRecorder : public CValidationInterface
+{
+public:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::vector<CServiceEvent> vEvents;
+
+    void NotifyBilliecoinUpdate(const CServiceEvent &event) override
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            vEvents.push_back(event);
+        }
+        cond.notify_all();
+    }
+
+    bool WaitFor(const size_t nEvents)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        const boost::system_time timeout = boost::get_system_time() + boost::posix_time::seconds(10);
+        while (vEvents.size() < nEvents) {
+            if (!cond.timed_wait(lock, timeout))
+                return vEvents.size() >= nEvents;
+        }
+        return true;
+    }
+};
+
+static std::vector<unsigned char> Payload(unsigned char ch)
+{
+    return std::vector<unsigned char>(3, ch);
+}
+
+static bool Push(CServiceEventPublisher& publisher, const std::string& strTopic, unsigned char ch)
+{
+    std::vector<unsigned char> vchPayload = Payload(ch);
+    return publisher.Push(strTopic, vchPayload);
+}
+
+BOOST_AUTO_TEST_CASE(serviceevent_publisher_queue)
+{
+    CServiceEventPublisher publisher;
+    // nothing is queued before the thread is about to run
+    BOOST_CHECK(!publisher.IsEnabled());
+    BOOST_CHECK(!Push(publisher, "aliasrecord", 0));
+
+    publisher.Enable(3);
+    BOOST_CHECK(publisher.IsEnabled());
+    BOOST_CHECK(Push(publisher, "aliasrecord", 1));
+    BOOST_CHECK(Push(publisher, "certrecord", 2));
+    BOOST_CHECK(Push(publisher, "aliasrecord", 3));
+    // the queue is full, dropped events still take their sequence number
+    BOOST_CHECK(!Push(publisher, "aliasrecord", 4));
+    BOOST_CHECK(!Push(publisher, "certrecord", 5));
+
+    CServiceEventRecorder recorder;
+    RegisterValidationInterface(&recorder);
+    boost::thread thread(boost::bind(&CServiceEventPublisher::Thread, &publisher));
+    BOOST_CHECK(recorder.WaitFor(3));
+    // room again once the thread took the queued events
+    BOOST_CHECK(Push(publisher, "aliasrecord", 6));
+    BOOST_CHECK(recorder.WaitFor(4));
+    thread.interrupt();
+    thread.join();
+    UnregisterValidationInterface(&recorder);
+
+    // queued in order, the sequence of each topic jumps over what was dropped
+    BOOST_CHECK_EQUAL(recorder.vEvents.size(), 4U);
+    const char* topics[] = {"aliasrecord", "certrecord", "aliasrecord", "aliasrecord"};
+    const uint32_t sequences[] = {0, 0, 1, 3};
+    const unsigned char payloads[] = {1, 2, 3, 6};
+    for (size_t i = 0; i < recorder.vEvents.size() && i < 4; i++) {
+        BOOST_CHECK_EQUAL(recorder.vEvents[i].strTopic, topics[i]);
+        BOOST_CHECK_EQUAL(recorder.vEvents[i].nSequence, sequences[i]);
+        BOOST_CHECK(recorder.vEvents[i].vchPayload == Payload(payloads[i]));
+    }
+
+    // nothing is queued once the thread was interrupted
+    BOOST_CHECK(!publisher.IsEnabled());
+    BOOST_CHECK(!Push(publisher, "aliasrecord", 7));
+}
+
+BOOST_AUTO_TEST_CASE(serviceevent_payload_layout)
+{
+    // the topic helpers publish nothing unless the publisher was enabled
+    PublishServiceEvent("aliashistory", std::string("name"), (unsigned char)1);
+    serviceEventPublisher.Enable(DEFAULT_SERVICE_EVENT_QUEUE_SIZE);
+    PublishServiceEvent("aliashistory", std::string("name"), (unsigned char)2);
+
+    CServiceEventRecorder recorder;
+    RegisterValidationInterface(&recorder);
+    boost::thread thread(boost::bind(&CServiceEventPublisher::Thread, &serviceEventPublisher));
+    BOOST_CHECK(recorder.WaitFor(1));
+    thread.interrupt();
+    thread.join();
+    UnregisterValidationInterface(&recorder);
+
+    // the layout version, then the fields in their network serialization
+    CDataStream ssExpected(SER_NETWORK, PROTOCOL_VERSION);
+    ssExpected << SERVICE_EVENT_VERSION << std::string("name") << (unsigned char)2;
+    BOOST_CHECK_EQUAL(recorder.vEvents.size(), 1U);
+    if (!recorder.vEvents.empty()) {
+        BOOST_CHECK_EQUAL(recorder.vEvents[0].strTopic, "aliashistory");
+        BOOST_CHECK_EQUAL(recorder.vEvents[0].nSequence, 0U);
+        BOOST_CHECK(recorder.vEvents[0].vchPayload == std::vector<unsigned char>(ssExpected.begin(), ssExpected.end()));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,243 @@
+// Copyright (c) 2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "servicepayload.h"
+
+#include "hash.h"
+#include "primitives/transaction.h"
+#include "script/script.h"
+
+#include "test/test_billiecoin.h"
+#include "test/test_random.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(servicepayload_tests, BasicTestingSetup)
+
+static std::vector<unsigned char> RandomBytes(size_t nSize)
+{
+    std::vector<unsigned char> vch(nSize);
+    for (unsigned char& ch : vch)
+        ch = insecure_rand() & 0xff;
+    return vch;
+}
+
+// sizes around the push opcode boundaries, direct, OP_PUSHDATA1 and OP_PUSHDATA2
+static size_t RandomArgSize()
+{
+    static const size_t sizes[] = {0, 1, 2, 20, 32, 75, 76, 100, 255, 256, 300, 600};
+    return sizes[insecure_rand() % (sizeof(sizes) / sizeof(sizes[0]))];
+}
+
+static std::vector<std::vector<unsigned char> > RandomArgs()
+{
+    std::vector<std::vector<unsigned char> > vvch(insecure_rand() % 6);
+    for (std::vector<unsigned char>& vch : vvch)
+        vch = RandomBytes(RandomArgSize());
+    return vvch;
+}
+
+static CScript ServiceScript(int nService, int nOp, const std::vector<std::vector<unsigned char> >& vvch)
+{
+    CScript script;
+    script << CScript::EncodeOP_N(nService) << CScript::EncodeOP_N(nOp);
+    for (const std::vector<unsigned char>& vch : vvch)
+        script << vch;
+    script << OP_2DROP << OP_DROP;
+    script << OP_DUP << OP_HASH160 << RandomBytes(20) << OP_EQUALVERIFY << OP_CHECKSIG;
+    return script;
+}
+
+static CScript DataScript(const std::vector<unsigned char>& vchData)
+{
+    const uint256 hash = Hash(vchData.begin(), vchData.end());
+    return CScript() << OP_RETURN << vchData << vchFromString(hash.GetHex());
+}
+
+template<typename T>
+static std::vector<unsigned char> ObjectData(T object)
+{
+    std::vector<unsigned char> vchData;
+    object.Serialize(vchData);
+    return vchData;
+}
+
+static std::vector<unsigned char> RandomObjectData(int nType)
+{
+    const std::vector<unsigned char> vchName = RandomBytes(1 + insecure_rand() % 16);
+    switch (nType) {
+    case 0: { CAliasIndex alias; alias.vchAlias = vchName; return ObjectData(alias); }
+    case 1: { COffer offer; offer.vchOffer = vchName; return ObjectData(offer); }
+    case 2: { CCert cert; cert.vchCert = vchName; return ObjectData(cert); }
+    case 3: { CEscrow escrow; escrow.vchEscrow = vchName; return ObjectData(escrow); }
+    case 4: { CAsset asset; asset.vchAsset = vchName; return ObjectData(asset); }
+    default: { CAssetAllocation allocation; allocation.vchAsset = vchName; allocation.vchAliasOrAddress = RandomBytes(8); return ObjectData(allocation); }
+    }
+}
+
+template<typename T>
+static void CheckObject(const std::shared_ptr<const T>& object, bool fExpected, const CTransaction& tx)
+{
+    BOOST_CHECK_EQUAL((bool)object, fExpected);
+    if (!object || !fExpected)
+        return;
+    T objectOld(tx);
+    BOOST_CHECK(ObjectData(*object) == ObjectData(objectOld));
+}
+
+static bool DecodeServiceTxOld(const CTransaction& tx, char& type, int& op, std::vector<std::vector<unsigned char> >& vvch)
+{
+    // the order CheckBilliecoinInputs tries the services in
+    if (DecodeAssetAllocationTx(tx, op, vvch))
+        type = ASSETALLOCATION;
+    else if (DecodeOfferTx(tx, op, vvch))
+        type = OFFER;
+    else if (DecodeCertTx(tx, op, vvch))
+        type = CERT;
+    else if (DecodeEscrowTx(tx, op, vvch))
+        type = ESCROW;
+    else if (DecodeAssetTx(tx, op, vvch))
+        type = ASSET;
+    else
+        return false;
+    return true;
+}
+
+// compare a payload with what the per service decoders read from the same transaction
+static void CheckPayload(const CTransaction& tx, bool fCheckParsedType)
+{
+    const CServicePayload payload(tx);
+
+    int op = 0;
+    std::vector<std::vector<unsigned char> > vvch;
+    const bool fAlias = DecodeAliasTx(tx, op, vvch);
+    BOOST_CHECK_EQUAL(payload.fAliasOutput, fAlias);
+    if (fAlias) {
+        BOOST_CHECK_EQUAL(payload.nAliasOp, op);
+        BOOST_CHECK(payload.vvchAliasArgs.ToVvch() == vvch);
+    }
+
+    char type = CServicePayload::SERVICE_NONE;
+    op = 0;
+    const bool fService = DecodeServiceTxOld(tx, type, op, vvch);
+    BOOST_CHECK_EQUAL(payload.IsService(), fService);
+    BOOST_CHECK_EQUAL(payload.type, type);
+    if (fService) {
+        BOOST_CHECK_EQUAL(payload.nOp, op);
+        BOOST_CHECK(payload.vvchArgs.ToVvch() == vvch);
+    }
+
+    std::vector<unsigned char> vchData, vchHash;
+    int nOut;
+    const bool fData = GetBilliecoinData(tx, vchData, vchHash, nOut);
+    BOOST_CHECK_EQUAL(payload.nDataOut, GetBilliecoinDataOutput(tx));
+    if (fData)
+        BOOST_CHECK(payload.vchDataHash == vchHash);
+
+    const bool fSend = type == ASSETALLOCATION || (type == ASSET && op == OP_ASSET_SEND);
+    CheckObject(payload.assetAllocation, fSend && CAssetAllocation().UnserializeFromTx(tx), tx);
+    CheckObject(payload.asset, type == ASSET && !fSend && CAsset().UnserializeFromTx(tx), tx);
+    CheckObject(payload.offer, type == OFFER && COffer().UnserializeFromTx(tx), tx);
+    CheckObject(payload.cert, type == CERT && CCert().UnserializeFromTx(tx), tx);
+    CheckObject(payload.escrow, type == ESCROW && CEscrow().UnserializeFromTx(tx), tx);
+    CheckObject(payload.alias, !payload.fDataValid && CAliasIndex().UnserializeFromTx(tx), tx);
+
+    if (!fCheckParsedType)
+        return;
+    int opParsed = 0, opParsedOld = 0;
+    char typeParsed = 0, typeParsedOld = 0;
+    const bool fParsedOld = DecodeAndParseBilliecoinTx(tx, opParsedOld, vvch, typeParsedOld);
+    BOOST_CHECK_EQUAL(payload.GetParsedType(opParsed, typeParsed), fParsedOld);
+    if (fParsedOld) {
+        BOOST_CHECK_EQUAL(opParsed, opParsedOld);
+        BOOST_CHECK_EQUAL(typeParsed, typeParsedOld);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(servicepayload_push_sizes)
+{
+    // one argument per push opcode, including one only OP_PUSHDATA4 can push
+    std::vector<std::vector<unsigned char> > vvchArgs;
+    vvchArgs.push_back(std::vector<unsigned char>());
+    vvchArgs.push_back(RandomBytes(75));
+    vvchArgs.push_back(RandomBytes(76));
+    vvchArgs.push_back(RandomBytes(256));
+    vvchArgs.push_back(RandomBytes(0x10000));
+    std::vector<std::vector<unsigned char> > vvchAliasArgs;
+    vvchAliasArgs.push_back(RandomBytes(8));
+    vvchAliasArgs.push_back(RandomBytes(300));
+
+    CMutableTransaction mtx;
+    mtx.nVersion = BILLIECOIN_TX_VERSION;
+    mtx.vout.resize(3);
+    mtx.vout[0].scriptPubKey = ServiceScript(OP_BILLIECOIN_ALIAS, OP_ALIAS_UPDATE, vvchAliasArgs);
+    mtx.vout[1].scriptPubKey = ServiceScript(OP_BILLIECOIN_CERT, OP_CERT_TRANSFER, vvchArgs);
+    mtx.vout[2].scriptPubKey = DataScript(RandomObjectData(2));
+    CheckPayload(mtx, true);
+
+    // the arguments are views into the payload, they outlive the transaction
+    std::shared_ptr<CServicePayload> payload;
+    {
+        const CTransaction tx(mtx);
+        payload = std::make_shared<CServicePayload>(tx);
+    }
+    mtx = CMutableTransaction();
+    BOOST_CHECK_EQUAL(payload->type, CERT);
+    BOOST_CHECK_EQUAL(payload->nOp, OP_CERT_TRANSFER);
+    BOOST_CHECK(payload->vvchArgs.ToVvch() == vvchArgs);
+    BOOST_CHECK(payload->vvchAliasArgs.ToVvch() == vvchAliasArgs);
+    BOOST_CHECK(payload->vvchArgs[3] == CServiceArg(vvchArgs[3]));
+    BOOST_CHECK(payload->vvchArgs[3] != CServiceArg(vvchArgs[2]));
+    BOOST_CHECK(payload->cert && payload->fDataValid);
+    BOOST_CHECK(!payload->alias);
+}
+
+BOOST_AUTO_TEST_CASE(servicepayload_not_billiecoin)
+{
+    CMutableTransaction mtx;
+    mtx.vout.resize(2);
+    mtx.vout[0].scriptPubKey = ServiceScript(OP_BILLIECOIN_ALIAS, OP_ALIAS_UPDATE, RandomArgs());
+    mtx.vout[1].scriptPubKey = DataScript(RandomObjectData(0));
+    const CTransaction tx(mtx);
+    const CServicePayloadRef payload = GetServicePayload(tx);
+    BOOST_CHECK(!payload->fAliasOutput && !payload->IsService() && payload->nDataOut == -1 && !payload->alias);
+    BOOST_CHECK(payload == GetServicePayload(CTransaction()));
+}
+
+BOOST_AUTO_TEST_CASE(servicepayload_randomized)
+{
+    static const int services[] = {OP_BILLIECOIN_ALIAS, OP_BILLIECOIN_CERT, OP_BILLIECOIN_ESCROW, OP_BILLIECOIN_OFFER, OP_BILLIECOIN_ASSET, OP_BILLIECOIN_ASSET_ALLOCATION};
+    for (int i = 0; i < 2000; i++) {
+        CMutableTransaction mtx;
+        mtx.nVersion = BILLIECOIN_TX_VERSION;
+        if (insecure_rand() % 4 == 0)
+            mtx.vout.push_back(CTxOut(1, CScript() << OP_DUP << OP_HASH160 << RandomBytes(20) << OP_EQUALVERIFY << OP_CHECKSIG));
+        if (insecure_rand() % 2)
+            mtx.vout.push_back(CTxOut(1, ServiceScript(OP_BILLIECOIN_ALIAS, 1 + insecure_rand() % 3, RandomArgs())));
+        // ops up to 10 so some are not ops of the service
+        const int nServiceOutputs = insecure_rand() % 3;
+        int nService = 0, nOp = 0;
+        for (int n = 0; n < nServiceOutputs; n++) {
+            nService = services[1 + insecure_rand() % 5];
+            nOp = 1 + insecure_rand() % 10;
+            mtx.vout.push_back(CTxOut(1, ServiceScript(nService, nOp, RandomArgs())));
+        }
+        const int nData = insecure_rand() % 8;
+        if (nData < 6)
+            mtx.vout.push_back(CTxOut(0, DataScript(RandomObjectData(nData))));
+        else if (nData == 6)
+            mtx.vout.push_back(CTxOut(0, DataScript(RandomBytes(RandomArgSize()))));
+        if (insecure_rand() % 2 && !mtx.vout.empty())
+            std::swap(mtx.vout[0], mtx.vout[insecure_rand() % mtx.vout.size()]);
+        // DecodeAndParseBilliecoinTx tries certificates first and reads asset data as either an
+        // asset or an allocation whatever the op, the payload follows the op, so only compare
+        // the parsed type of transactions with one service output whose data fits its op
+        const bool fAssetMix = nService == OP_BILLIECOIN_ASSET && (nOp == OP_ASSET_SEND ? nData == 4 : nData == 5);
+        CheckPayload(mtx, nServiceOutputs < 2 && !fAssetMix);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -149,7 +149,7 @@ CTxMemPoolEntry TestMemPoolEntryHelper::FromTx(const CMutableTransaction &tx, CT
 
 CTxMemPoolEntry TestMemPoolEntryHelper::FromTx(const CTransaction &txn, CTxMemPool *pool) {
     return CTxMemPoolEntry(MakeTransactionRef(txn), nFee, nTime, dPriority, nHeight,
-                           txn.GetValueOut(), spendsCoinbase, sigOpCount, lp);
+                           txn.GetValueOut(), spendsCoinbase, sigOpCount, lp, nTime * 1000);
 }
 
 void Shutdown(void* parg)
@@ -0,0 +1,169 @@
+// Copyright (c) 2017-2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "validationexecutor.h"
+#include "utiltime.h"
+#include "test/test_billiecoin.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+// holds the single worker of an executor until released
+class Gate
+{
+public:
+    Gate() : fStarted(false), fOpen(false) {}
+    void Block()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        fStarted = true;
+        cond.notify_all();
+        cond.wait(lock, [this] { return fOpen; });
+    }
+    void WaitStarted()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return fStarted; });
+    }
+    void Open()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        fOpen = true;
+        cond.notify_all();
+    }
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool fStarted;
+    bool fOpen;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(validationexecutor_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(validationexecutor_round_robin)
+{
+    CValidationExecutor executor(1, 100);
+    Gate gate;
+    BOOST_CHECK(executor.TrySubmit(0, [&gate] { gate.Block(); }));
+    gate.WaitStarted();
+
+    std::mutex mutexOrder;
+    std::vector<NodeId> vOrder;
+    for (int i = 0; i < 3; i++) {
+        BOOST_CHECK(executor.TrySubmit(1, [&] { std::lock_guard<std::mutex> lock(mutexOrder); vOrder.push_back(1); }));
+    }
+    for (int i = 0; i < 3; i++) {
+        BOOST_CHECK(executor.TrySubmit(2, [&] { std::lock_guard<std::mutex> lock(mutexOrder); vOrder.push_back(2); }));
+    }
+    BOOST_CHECK_EQUAL(executor.GetQueueDepth(), 6);
+    BOOST_CHECK_EQUAL(executor.GetPeerCount(), 2);
+    gate.Open();
+    while (executor.GetQueueDepth() > 0)
+        MilliSleep(1);
+    executor.Stop();
+
+    // the flooding peer does not get to run all its work before the other one
+    const std::vector<NodeId> vExpected = {1, 2, 1, 2, 1, 2};
+    BOOST_CHECK(vOrder == vExpected);
+}
+
+BOOST_AUTO_TEST_CASE(validationexecutor_backpressure)
+{
+    CValidationExecutor executor(1, 4);
+    Gate gate;
+    BOOST_CHECK(executor.TrySubmit(0, [&gate] { gate.Block(); }));
+    gate.WaitStarted();
+
+    BOOST_CHECK(executor.TrySubmit(1, [] {}));
+    BOOST_CHECK(executor.TrySubmit(1, [] {}));
+    BOOST_CHECK(executor.TrySubmit(2, [] {}));
+    // two peers share a depth of 4, the first one is at its share
+    BOOST_CHECK(executor.IsPeerPaused(1));
+    BOOST_CHECK(!executor.IsPeerPaused(2));
+
+    BOOST_CHECK(executor.TrySubmit(2, [] {}));
+    BOOST_CHECK(executor.IsPeerPaused(2));
+    // a full queue pauses everybody and rejects once the deadline passes
+    BOOST_CHECK(executor.IsPeerPaused(3));
+    BOOST_CHECK(!executor.TrySubmit(3, [] {}));
+    BOOST_CHECK(!executor.Submit(3, [] {}, 20));
+
+    gate.Open();
+    BOOST_CHECK(executor.Submit(3, [] {}, 5000));
+    executor.Stop();
+    BOOST_CHECK(!executor.TrySubmit(3, [] {}));
+}
+
+BOOST_AUTO_TEST_CASE(validationexecutor_stop_drops)
+{
+    CValidationExecutor executor(1, 16);
+    Gate gate;
+    BOOST_CHECK(executor.TrySubmit(0, [&gate] { gate.Block(); }, [] { BOOST_ERROR("a started task must not be dropped"); }));
+    gate.WaitStarted();
+
+    std::atomic<int> nRun(0);
+    std::atomic<int> nDropped(0);
+    for (int i = 0; i < 5; i++)
+        BOOST_CHECK(executor.TrySubmit(i % 2, [&nRun] { nRun++; }, [&nDropped] { nDropped++; }));
+    // a task without a drop handler is dropped silently
+    BOOST_CHECK(executor.TrySubmit(1, [&nRun] { nRun++; }));
+
+    std::thread stopper([&executor] { executor.Stop(); });
+    // Stop() waits for the running task, queued ones never start
+    while (executor.GetQueueDepth() > 0)
+        MilliSleep(1);
+    gate.Open();
+    stopper.join();
+    BOOST_CHECK_EQUAL(nRun, 0);
+    BOOST_CHECK_EQUAL(nDropped, 5);
+    // a refused submit does not call its drop handler, the caller handles it
+    BOOST_CHECK(!executor.TrySubmit(2, [&nRun] { nRun++; }, [&nDropped] { nDropped++; }));
+    BOOST_CHECK_EQUAL(nDropped, 5);
+}
+
+BOOST_AUTO_TEST_CASE(validationexecutor_histogram)
+{
+    CLatencyHistogram histogram;
+    BOOST_CHECK_EQUAL(histogram.GetPercentile(50), 0);
+    for (int64_t i = 1; i <= 1000; i++)
+        histogram.Record(i * 10);
+    BOOST_CHECK_EQUAL(histogram.GetCount(), 1000U);
+    BOOST_CHECK_EQUAL(histogram.GetTotal(), 5005000);
+    BOOST_CHECK_EQUAL(histogram.GetMax(), 10000);
+    // percentiles are bucket upper bounds, never below the real value and at most 25% above it
+    const int64_t p50 = histogram.GetPercentile(50);
+    BOOST_CHECK(p50 >= 5000 && p50 <= 6250);
+    const int64_t p99 = histogram.GetPercentile(99);
+    BOOST_CHECK(p99 >= 9900 && p99 <= 10000);
+    BOOST_CHECK_EQUAL(histogram.GetPercentile(100), 10000);
+
+    histogram.Record(3);
+    histogram.Reset();
+    BOOST_CHECK_EQUAL(histogram.GetCount(), 0U);
+    BOOST_CHECK_EQUAL(histogram.GetMax(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(validationexecutor_metrics)
+{
+    CValidationExecutor executor(2, 16);
+    for (int i = 0; i < 10; i++)
+        BOOST_CHECK(executor.Submit(i % 3, [] { MilliSleep(1); }));
+    while (executor.GetMetrics().execution.GetCount() < 10)
+        MilliSleep(1);
+    executor.Stop();
+    CValidationMetrics& metrics = executor.GetMetrics();
+    BOOST_CHECK_EQUAL(metrics.queueWait.GetCount(), 10U);
+    BOOST_CHECK(metrics.execution.GetPercentile(50) >= 1000);
+    BOOST_CHECK(metrics.nMaxRunning >= 1 && metrics.nMaxRunning <= 2);
+    BOOST_CHECK_EQUAL(metrics.nRunning, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,7 @@
 #include "uint256.h"
 #include "ui_interface.h"
 #include "init.h"
+#include "alias.h"
 
 #include <stdint.h>
 
@@ -25,6 +26,7 @@ static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_ALIASUNSPENTINDEX = 'n';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -129,12 +131,18 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 }
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
+{
+    return Cursor(uint256());
+}
+
+CCoinsViewCursor *CCoinsViewDB::Cursor(const uint256 &hashStart) const
 {
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper*>(&db)->NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
-    i->pcursor->Seek(DB_COIN);
+    const COutPoint start(hashStart, 0);
+    i->pcursor->Seek(CoinEntry(&start));
     // Cache key of first record
     if (i->pcursor->Valid()) {
         CoinEntry entry(&i->keyTmp.second);
@@ -259,6 +267,75 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::UpdateAliasUnspentIndex(const std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue > >&vect) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(std::make_pair(DB_ALIASUNSPENTINDEX, it->first));
+        } else {
+            batch.Write(std::make_pair(DB_ALIASUNSPENTINDEX, it->first), it->second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAliasUnspentIndex(const CAliasUnspentKey &owner,
+                                         std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    // the outputs of an owner start at the key with a null txid and index
+    pcursor->Seek(std::make_pair(DB_ALIASUNSPENTINDEX, CAliasUnspentKey(owner.vchAlias, owner.vchGUID, owner.type, owner.hashBytes, uint256(), 0)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAliasUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ALIASUNSPENTINDEX && key.second.IsSameOwner(owner)) {
+            CAddressUnspentValue nValue;
+            if (pcursor->GetValue(nValue)) {
+                unspentOutputs.push_back(std::make_pair(key.second, nValue));
+                pcursor->Next();
+            } else {
+                return error("failed to get alias unspent value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::BuildAliasUnspentIndex() {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > aliasUnspentIndex;
+    int nIndexed = 0;
+
+    // the alias outputs are a subset of the address unspent index
+    pcursor->Seek(DB_ADDRESSUNSPENTINDEX);
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX)
+            break;
+        CAddressUnspentValue nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address unspent value");
+        CAliasUnspentKey aliasKey;
+        if (GetAliasUnspentKey(nValue.script, key.second.txhash, key.second.index, aliasKey)) {
+            aliasUnspentIndex.push_back(std::make_pair(aliasKey, nValue));
+            nIndexed++;
+        }
+        pcursor->Next();
+    }
+
+    if (!UpdateAliasUnspentIndex(aliasUnspentIndex))
+        return false;
+    LogPrintf("%s: indexed %d unspent alias outputs\n", __func__, nIndexed);
+    return WriteFlag("aliasunspentindex", true);
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
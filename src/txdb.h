@@ -81,6 +81,8 @@ public:
     uint256 GetBestBlock() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
+    //! Cursor starting at the first output of the first txid not below hashStart
+    CCoinsViewCursor *Cursor(const uint256 &hashStart) const;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
@@ -130,6 +132,11 @@ public:
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool UpdateAliasUnspentIndex(const std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue > >&vect);
+    bool ReadAliasUnspentIndex(const CAliasUnspentKey &owner,
+                               std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > &vect);
+    /** Fill the alias unspent index from the address unspent index of a database that predates it */
+    bool BuildAliasUnspentIndex();
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type,
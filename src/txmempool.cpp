@@ -14,6 +14,7 @@
 #include "policy/policy.h"
 #include "policy/fees.h"
 #include "random.h"
+#include "servicepayload.h"
 #include "streams.h"
 #include "timedata.h"
 #include "util.h"
@@ -25,8 +26,8 @@ extern bool RemoveBilliecoinScript(const CScript& scriptPubKeyIn, CScript& scrip
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, double _entryPriority, unsigned int _entryHeight,
                                  CAmount _inChainInputValue,
-                                 bool _spendsCoinbase, unsigned int _sigOps, LockPoints lp):
-    tx(_tx), nFee(_nFee), nTime(_nTime), entryPriority(_entryPriority), entryHeight(_entryHeight),
+                                 bool _spendsCoinbase, unsigned int _sigOps, LockPoints lp, int64_t _nArrivalTime):
+    tx(_tx), nFee(_nFee), nTime(_nTime), nArrivalTime(_nArrivalTime), entryPriority(_entryPriority), entryHeight(_entryHeight),
     inChainInputValue(_inChainInputValue),
     spendsCoinbase(_spendsCoinbase), sigOpCount(_sigOps), lockPoints(lp)
 {
@@ -53,6 +54,15 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
     *this = other;
 }
 
+void CTxMemPoolEntry::SetServicePayload(const std::shared_ptr<const CServicePayload>& payload)
+{
+    if (servicePayload)
+        nUsageSize -= memusage::DynamicUsage(servicePayload) + servicePayload->DynamicMemoryUsage();
+    servicePayload = payload;
+    if (servicePayload)
+        nUsageSize += memusage::DynamicUsage(servicePayload) + servicePayload->DynamicMemoryUsage();
+}
+
 double
 CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
 {
@@ -65,6 +65,7 @@ struct LockPoints
 };
 
 class CTxMemPool;
+class CServicePayload;
 
 /** \class CTxMemPoolEntry
  *
@@ -92,6 +93,8 @@ private:
     size_t nModSize;           //!< ... and modified size for priority
     size_t nUsageSize;         //!< ... and total memory usage
     int64_t nTime;             //!< Local time when entering the mempool
+    int64_t nArrivalTime;      //!< Local time in milliseconds when first seen, orders service transactions in block templates
+    std::shared_ptr<const CServicePayload> servicePayload; //!< Decoded billiecoin service outputs, NULL for other transactions
     double entryPriority;      //!< Priority when entering the mempool
     unsigned int entryHeight;  //!< Chain height when entering the mempool
     CAmount inChainInputValue; //!< Sum of all txin values that are already in blockchain
@@ -119,7 +122,7 @@ public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, double _entryPriority, unsigned int _entryHeight,
                     CAmount _inChainInputValue, bool spendsCoinbase,
-                    unsigned int nSigOps, LockPoints lp);
+                    unsigned int nSigOps, LockPoints lp, int64_t _nArrivalTime);
 
     CTxMemPoolEntry(const CTxMemPoolEntry& other);
 
@@ -133,6 +136,10 @@ public:
     const CAmount& GetFee() const { return nFee; }
     size_t GetTxSize() const { return nTxSize; }
     int64_t GetTime() const { return nTime; }
+    int64_t GetArrivalTime() const { return nArrivalTime; }
+    const std::shared_ptr<const CServicePayload>& GetServicePayload() const { return servicePayload; }
+    /** Attach the decoded service outputs, their memory counts towards the entry's usage */
+    void SetServicePayload(const std::shared_ptr<const CServicePayload>& payload);
     unsigned int GetHeight() const { return entryHeight; }
     unsigned int GetSigOpCount() const { return sigOpCount; }
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
@@ -62,10 +62,9 @@
 #include "assetallocation.h"
 #include "escrow.h"
 #include "graph.h"
+#include "servicepayload.h"
 #include "base58.h"
 #include "rpc/server.h"
-#include "thread_pool/thread_pool.hpp"
-#include <future>
 #include <functional>
 #include "cuckoocache.h"
 #if defined(NDEBUG)
@@ -87,8 +86,7 @@ int nScriptCheckThreads = 0;
 // BILLIECOIN
 int64_t nLastMultithreadMempoolFailure = 0;
 bool fLoaded = false;
-bool fLogThreadpool = false;
-tp::ThreadPool *threadpool = NULL;
+CValidationExecutor *threadpool = NULL;
 std::atomic_bool fImporting(false);
 bool fReindex = false;
 bool fTxIndex = true;
@@ -593,6 +591,184 @@ void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age) {
         pcoinsTip->Uncache(removed);
 }
 // BILLIECOIN
+/** A unit of work on the service check queue */
+class CServiceCheck
+{
+private:
+	std::function<void()> func;
+
+public:
+	CServiceCheck() {}
+	explicit CServiceCheck(const std::function<void()>& funcIn) : func(funcIn) {}
+	// failures are reported through the work itself so one failure does not skip the other partitions
+	bool operator()() { func(); return true; }
+	void swap(CServiceCheck& check) { func.swap(check.func); }
+};
+static CCheckQueue<CServiceCheck> servicecheckqueue(1);
+
+/** Coins view shared by the partitions of a block, base lookups fill the shared cache and are serialized */
+class CCoinsViewLocked : public CCoinsViewBacked
+{
+private:
+	mutable CCriticalSection cs;
+
+public:
+	CCoinsViewLocked(CCoinsView *viewIn) : CCoinsViewBacked(viewIn) {}
+	bool GetCoin(const COutPoint &outpoint, Coin &coin) const override { LOCK(cs); return base->GetCoin(outpoint, coin); }
+	bool HaveCoin(const COutPoint &outpoint) const override { LOCK(cs); return base->HaveCoin(outpoint); }
+	uint256 GetBestBlock() const override { LOCK(cs); return base->GetBestBlock(); }
+};
+
+/**
+ * Connect the asset allocation sends at the front of a sorted block concurrently.
+ *
+ * A send reads and writes its sender alias and the allocations of its asset only,
+ * so the sends are split into partitions sharing neither (see PartitionByKeys). The
+ * alias checks of the sends read the chain and write nothing for a send, they run here
+ * first in block order. The allocation checks of the partitions then run on the service
+ * check threads, each in block order with its own coins cache and with its DB writes staged.
+ * The staged writes are committed in block order, into the block's staged writes, up to
+ * and including the first send that failed, which leaves the DBs as connecting the sends
+ * one by one would. Notifications, index and wallet work and the conflict list are only
+ * touched for the committed sends, on this thread (see CDBStagedWrites::Defer). Returns the
+ * index of the first transaction left to connect and sets fFailed if a send failed, in
+ * which case nothing after it may be connected.
+ */
+static unsigned int ConnectAssetAllocationsParallel(const std::vector<CTransactionRef>& vtx, const CCoinsViewCache &inputs, int nHeight, sorted_vector<CAssetAllocationTuple> &revertedAssetAllocations, bool& fFailed)
+{
+	struct CAllocationSend {
+		int nIndex;
+		CServicePayloadRef payload;
+		bool fAliasInput;
+		int nAliasOp;
+		// holds the alias arguments found in the inputs, moving the send keeps the bytes in place
+		std::vector<std::vector<unsigned char> > vvchAliasInput;
+		CServiceArgs vvchAliasArgs;
+	};
+	struct CPartition {
+		std::vector<int> vSends;
+		CDBStagedWrites staged;
+		sorted_vector<CAssetAllocationTuple> revertedAssetAllocations;
+		int nFailedIndex;
+		std::exception_ptr error;
+	};
+	fFailed = false;
+	std::vector<CAllocationSend> vSends;
+	std::vector<std::vector<std::string> > vSendKeys;
+	unsigned int nEnd = 0;
+	for (; nEnd < vtx.size(); nEnd++) {
+		const CTransaction &tx = *vtx[nEnd];
+		if (tx.nVersion != BILLIECOIN_TX_VERSION)
+			continue;
+		CAllocationSend send;
+		send.payload = GetServicePayload(tx);
+		if (!send.payload->IsAssetAllocation() || !send.payload->assetAllocation)
+			break;
+		send.nIndex = nEnd;
+		send.fAliasInput = true;
+		send.nAliasOp = send.payload->nAliasOp;
+		if (send.payload->fAliasOutput)
+			send.vvchAliasArgs = send.payload->vvchAliasArgs;
+		else {
+			send.fAliasInput = FindAliasInTx(inputs, tx, send.vvchAliasInput);
+			send.vvchAliasArgs = CServiceArgs(send.vvchAliasInput);
+			send.nAliasOp = OP_ALIAS_UPDATE;
+		}
+		std::vector<std::string> vKeys;
+		vKeys.push_back("asset-" + stringFromVch(send.payload->assetAllocation->vchAsset));
+		if (send.fAliasInput && !send.vvchAliasArgs.empty())
+			vKeys.push_back("alias-" + stringFromVch(send.vvchAliasArgs[0].ToVch()));
+		vSends.push_back(std::move(send));
+		vSendKeys.push_back(std::move(vKeys));
+	}
+	std::vector<std::vector<int> > vGroups;
+	PartitionByKeys(vSendKeys, vGroups);
+	if (vGroups.size() < 2)
+		return 0;
+
+	// the alias of a send is only read, the sends carry no alias data to write. A send whose
+	// alias check fails is the last one connected, as in the sequential loop
+	int nFailedIndex = INT_MAX;
+	for (const CAllocationSend &send : vSends) {
+		if (!send.fAliasInput)
+			continue;
+		std::string errorMessage;
+		const bool good = CheckAliasInputs(inputs, *vtx[send.nIndex], *send.payload, send.nAliasOp, send.vvchAliasArgs, false, nHeight, errorMessage);
+		if (fDebug && !errorMessage.empty())
+			LogPrintf("%s\n", errorMessage.c_str());
+		if (!good) {
+			nFailedIndex = send.nIndex;
+			break;
+		}
+	}
+
+	std::vector<CPartition> vPartitions(vGroups.size());
+	CCoinsViewLocked viewShared(const_cast<CCoinsViewCache*>(&inputs));
+	std::vector<CServiceCheck> vChecks;
+	for (unsigned int p = 0; p < vGroups.size(); p++) {
+		CPartition &partition = vPartitions[p];
+		partition.vSends.swap(vGroups[p]);
+		partition.nFailedIndex = INT_MAX;
+		vChecks.emplace_back([&vtx, &vSends, &viewShared, &partition, nHeight, nFailedIndex]() {
+			const std::vector<unsigned char> emptyVch;
+			CCoinsViewCache view(&viewShared);
+			CDBStagingScope scope(partition.staged);
+			for (const int n : partition.vSends) {
+				const CAllocationSend &send = vSends[n];
+				if (send.nIndex >= nFailedIndex)
+					return;
+				const CTransaction &tx = *vtx[send.nIndex];
+				partition.staged.SetTag(send.nIndex);
+				try {
+					std::string errorMessage;
+					const bool good = CheckAssetAllocationInputs(tx, view, *send.payload, send.fAliasInput ? send.vvchAliasArgs[0].ToVch() : emptyVch, false, nHeight, partition.revertedAssetAllocations, errorMessage);
+					if (fDebug && !errorMessage.empty())
+						LogPrintf("%s\n", errorMessage.c_str());
+					if (!good) {
+						partition.nFailedIndex = send.nIndex;
+						return;
+					}
+				} catch (...) {
+					partition.nFailedIndex = send.nIndex;
+					partition.error = std::current_exception();
+					return;
+				}
+			}
+		});
+	}
+	CCheckQueueControl<CServiceCheck> control(&servicecheckqueue);
+	control.Add(vChecks);
+	control.Wait();
+
+	std::exception_ptr error;
+	for (auto &partition : vPartitions) {
+		if (partition.nFailedIndex < nFailedIndex) {
+			nFailedIndex = partition.nFailedIndex;
+			error = partition.error;
+		}
+	}
+	// a send that threw leaves the DBs untouched and the error to the caller
+	if (error)
+		std::rethrow_exception(error);
+	for (auto &partition : vPartitions) {
+		if (!partition.staged.Commit(nFailedIndex == INT_MAX ? INT_MAX : nFailedIndex + 1))
+			throw std::runtime_error("ConnectAssetAllocationsParallel: failed to commit billiecoin databases");
+		for (auto &tuple : partition.revertedAssetAllocations)
+			revertedAssetAllocations.insert(tuple);
+	}
+	// the sender ledger may have cached balances read while the writes were staged
+	for (auto &send : vSends) {
+		const CAssetAllocation &allocation = *send.payload->assetAllocation;
+		const std::vector<unsigned char> vchSender = send.fAliasInput && !send.vvchAliasArgs.empty() ? send.vvchAliasArgs[0].ToVch() : allocation.vchAliasOrAddress;
+		assetAllocationSenderLedger.Invalidate(CAssetAllocationTuple(allocation.vchAsset, vchSender));
+		for (auto &amountTuple : allocation.listSendingAllocationAmounts)
+			assetAllocationSenderLedger.Invalidate(CAssetAllocationTuple(allocation.vchAsset, amountTuple.first));
+		for (auto &inputTuple : allocation.listSendingAllocationInputs)
+			assetAllocationSenderLedger.Invalidate(CAssetAllocationTuple(allocation.vchAsset, inputTuple.first));
+	}
+	fFailed = nFailedIndex != INT_MAX;
+	return nEnd;
+}
 bool CheckBilliecoinInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache &inputs, bool fJustCheck, int nHeight, const CBlock& block, bool bSanity)
 {
 	// Ensure that we don't fail on verifydb which loads recent UTXO and will fail if the input is already spent, 
@@ -603,7 +779,6 @@ bool CheckBilliecoinInputs(const CTransaction& tx, CValidationState& state, cons
 	std::string statusRpc = "";
 	if (fJustCheck && (IsInitialBlockDownload() || RPCIsInWarmup(&statusRpc)))
 		return true;
-	std::vector<std::vector<unsigned char> > vvchArgs;
 	std::vector<std::vector<unsigned char> > vvchAliasArgs;
 	sorted_vector<CAssetAllocationTuple> revertedAssetAllocations;
 	sorted_vector<std::vector<unsigned char> > revertedOffers;
@@ -615,55 +790,60 @@ bool CheckBilliecoinInputs(const CTransaction& tx, CValidationState& state, cons
 	bool good = true;
 	const std::vector<unsigned char> &emptyVch = vchFromString("");
 	if (block.vtx.empty() && tx.nVersion == BILLIECOIN_TX_VERSION) {
+		// decoded once, shared with the mempool entry and block validation
+		const CServicePayloadRef payload = GetServicePayload(tx);
+		CServiceArgs vvchAlias = payload->vvchAliasArgs;
 		bool foundAliasInput = true;
-		if (!DecodeAliasTx(tx, op, vvchAliasArgs))
+		op = payload->nAliasOp;
+		if (!payload->fAliasOutput)
 		{
 			if (!FindAliasInTx(inputs, tx, vvchAliasArgs)) {
 				// must be address backed asset or asset allocation (try validate as such)
 				foundAliasInput = false;
 			}
+			vvchAlias = CServiceArgs(vvchAliasArgs);
 			// it is assumed if no alias output is found, then it is for another service so this would be an alias update
 			op = OP_ALIAS_UPDATE;
 
 		}
 		errorMessage.clear();
 		if (foundAliasInput)
-			good = CheckAliasInputs(inputs, tx, op, vvchAliasArgs, fJustCheck, nHeight, errorMessage, bSanity);
+			good = CheckAliasInputs(inputs, tx, *payload, op, vvchAlias, fJustCheck, nHeight, errorMessage, bSanity);
 		if (!errorMessage.empty())
 			return state.DoS(100, false, REJECT_INVALID, errorMessage);
 
 		if (good)
 		{
-			if (DecodeAssetAllocationTx(tx, op, vvchArgs))
+			if (payload->type == ASSETALLOCATION)
 			{
 				errorMessage.clear();
-				good = CheckAssetAllocationInputs(tx, inputs, op, vvchArgs, foundAliasInput ? vvchAliasArgs[0] : emptyVch, fJustCheck, nHeight, revertedAssetAllocations, errorMessage, bSanity);
+				good = CheckAssetAllocationInputs(tx, inputs, *payload, foundAliasInput ? vvchAlias[0].ToVch() : emptyVch, fJustCheck, nHeight, revertedAssetAllocations, errorMessage, bSanity);
 			}
-			else if (DecodeOfferTx(tx, op, vvchArgs))
+			else if (payload->type == OFFER)
 			{
 				if (!foundAliasInput)
 					return state.DoS(100, false, REJECT_INVALID, "no-alias-input-found-mempool");
 				errorMessage.clear();
-				good = CheckOfferInputs(tx, op, vvchArgs, vvchAliasArgs[0], fJustCheck, nHeight, revertedOffers, errorMessage, bSanity);
+				good = CheckOfferInputs(tx, *payload, vvchAlias[0], fJustCheck, nHeight, revertedOffers, errorMessage, bSanity);
 			}
-			else if (DecodeCertTx(tx, op, vvchArgs))
+			else if (payload->type == CERT)
 			{
 				if (!foundAliasInput)
 					return state.DoS(100, false, REJECT_INVALID, "no-alias-input-found-mempool");
 				errorMessage.clear();
-				good = CheckCertInputs(tx, op, vvchArgs, vvchAliasArgs[0], fJustCheck, nHeight, revertedCerts, errorMessage, bSanity);
+				good = CheckCertInputs(tx, *payload, vvchAlias[0], fJustCheck, nHeight, revertedCerts, errorMessage, bSanity);
 			}
-			else if (DecodeEscrowTx(tx, op, vvchArgs))
+			else if (payload->type == ESCROW)
 			{
 				if (!foundAliasInput)
 					return state.DoS(100, false, REJECT_INVALID, "no-alias-input-found-mempool");
 				errorMessage.clear();
-				good = CheckEscrowInputs(tx, op, vvchArgs, vvchAliasArgs, fJustCheck, nHeight, errorMessage, bSanity);
+				good = CheckEscrowInputs(tx, *payload, vvchAlias, fJustCheck, nHeight, errorMessage, bSanity);
 			}
-			else if (DecodeAssetTx(tx, op, vvchArgs))
+			else if (payload->type == ASSET)
 			{
 				errorMessage.clear();
-				good = CheckAssetInputs(tx, inputs, op, vvchArgs, foundAliasInput ? vvchAliasArgs[0] : emptyVch, fJustCheck, nHeight, revertedAssetAllocations, errorMessage, bSanity);
+				good = CheckAssetInputs(tx, inputs, *payload, foundAliasInput ? vvchAlias[0].ToVch() : emptyVch, fJustCheck, nHeight, revertedAssetAllocations, errorMessage, bSanity);
 			}
 		}
 		else
@@ -676,14 +856,12 @@ bool CheckBilliecoinInputs(const CTransaction& tx, CValidationState& state, cons
 	else if (!block.vtx.empty()) {
 		CBlock sortedBlock;
 		sortedBlock.vtx = block.vtx;
-		Graph graph;
-		std::vector<vertex_descriptor> vertices;
-		IndexMap mapTxIndex;
-		if (CreateGraphFromVTX(nHeight, sortedBlock.vtx, graph, vertices, mapTxIndex)) {
+		CServiceTxGraph graph;
+		if (CreateGraphFromVTX(nHeight, sortedBlock.vtx, graph)) {
 			std::vector<int> conflictedIndexes;
-			GraphRemoveCycles(sortedBlock.vtx, conflictedIndexes, graph, vertices, mapTxIndex);
+			GraphRemoveCycles(sortedBlock.vtx, conflictedIndexes, graph);
 			if (!sortedBlock.vtx.empty()) {
-				if (!DAGTopologicalSort(sortedBlock.vtx, conflictedIndexes, graph, mapTxIndex)) {
+				if (!DAGTopologicalSort(sortedBlock.vtx, conflictedIndexes, graph)) {
 					if (fDebug)
 						LogPrintf("CheckBilliecoinInputs: Toposort failed");
 					return true;
@@ -693,78 +871,104 @@ bool CheckBilliecoinInputs(const CTransaction& tx, CValidationState& state, cons
 		if (fJustCheck)
 			return true;
 
-		for (unsigned int i = 0; i < sortedBlock.vtx.size(); i++)
+		// every service DB change of the block is staged and written in one batch per DB once the block is done
+		CDBStagedWrites blockWrites;
+		bool fFailed = false;
+		bool fStopped = false;
 		{
-			const CTransaction &tx = *sortedBlock.vtx[i];
-			if (tx.nVersion == BILLIECOIN_TX_VERSION)
+			CDBStagingScope scope(blockWrites);
+			// allocation sends are sorted to the front, independent ones are connected concurrently. This
+			// has to come first as the partitions do not see what is staged in blockWrites
+			unsigned int nFirst = 0;
+			if (nScriptCheckThreads > 1)
+				nFirst = ConnectAssetAllocationsParallel(sortedBlock.vtx, inputs, nHeight, revertedAssetAllocations, fFailed);
+			for (unsigned int i = nFirst; i < sortedBlock.vtx.size() && !fFailed; i++)
 			{
-				bool foundAliasInput = true;
-				good = true;
-				if (!DecodeAliasTx(tx, op, vvchAliasArgs))
+				const CTransaction &tx = *sortedBlock.vtx[i];
+				if (tx.nVersion == BILLIECOIN_TX_VERSION)
 				{
-					if (!FindAliasInTx(inputs, tx, vvchAliasArgs)) {
-						foundAliasInput = false;
+					const CServicePayloadRef payload = GetServicePayload(tx);
+					CServiceArgs vvchAlias = payload->vvchAliasArgs;
+					bool foundAliasInput = true;
+					good = true;
+					op = payload->nAliasOp;
+					if (!payload->fAliasOutput)
+					{
+						if (!FindAliasInTx(inputs, tx, vvchAliasArgs)) {
+							foundAliasInput = false;
+						}
+						vvchAlias = CServiceArgs(vvchAliasArgs);
+						// it is assumed if no alias output is found, then it is for another service so this would be an alias update
+						op = OP_ALIAS_UPDATE;
 					}
-					// it is assumed if no alias output is found, then it is for another service so this would be an alias update
-					op = OP_ALIAS_UPDATE;
-				}
-				errorMessage.clear();
-				if(foundAliasInput)
-					good = CheckAliasInputs(inputs, tx, op, vvchAliasArgs, fJustCheck, nHeight, errorMessage);
-				if (fDebug && !errorMessage.empty())
-					LogPrintf("%s\n", errorMessage.c_str());
+					errorMessage.clear();
+					if(foundAliasInput)
+						good = CheckAliasInputs(inputs, tx, *payload, op, vvchAlias, fJustCheck, nHeight, errorMessage);
+					if (fDebug && !errorMessage.empty())
+						LogPrintf("%s\n", errorMessage.c_str());
 
-				if (good)
-				{
-					if (DecodeAssetAllocationTx(tx, op, vvchArgs))
+					if (good)
 					{
-						errorMessage.clear();
-						good = CheckAssetAllocationInputs(tx, inputs, op, vvchArgs, foundAliasInput ? vvchAliasArgs[0] : emptyVch, fJustCheck, nHeight, revertedAssetAllocations, errorMessage);
-						if (fDebug && !errorMessage.empty())
-							LogPrintf("%s\n", errorMessage.c_str());
+						if (payload->type == ASSETALLOCATION)
+						{
+							errorMessage.clear();
+							good = CheckAssetAllocationInputs(tx, inputs, *payload, foundAliasInput ? vvchAlias[0].ToVch() : emptyVch, fJustCheck, nHeight, revertedAssetAllocations, errorMessage);
+							if (fDebug && !errorMessage.empty())
+								LogPrintf("%s\n", errorMessage.c_str());
 
+						}
+						else if (payload->type == OFFER)
+						{
+							if (!foundAliasInput) {
+								fStopped = true;
+								break;
+							}
+							errorMessage.clear();
+							good = CheckOfferInputs(tx, *payload, vvchAlias[0], fJustCheck, nHeight, revertedOffers, errorMessage);
+							if (fDebug && !errorMessage.empty())
+								LogPrintf("%s\n", errorMessage.c_str());
+						}
+						else if (payload->type == CERT)
+						{
+							if (!foundAliasInput) {
+								fStopped = true;
+								break;
+							}
+							errorMessage.clear();
+							good = CheckCertInputs(tx, *payload, vvchAlias[0], fJustCheck, nHeight, revertedCerts, errorMessage);
+							if (fDebug && !errorMessage.empty())
+								LogPrintf("%s\n", errorMessage.c_str());
+						}
+						else if (payload->type == ESCROW)
+						{
+							if (!foundAliasInput) {
+								fStopped = true;
+								break;
+							}
+							errorMessage.clear();
+							good = CheckEscrowInputs(tx, *payload, vvchAlias, fJustCheck, nHeight, errorMessage);
+							if (fDebug && !errorMessage.empty())
+								LogPrintf("%s\n", errorMessage.c_str());
+						}
+						else if (payload->type == ASSET)
+						{
+							errorMessage.clear();
+							good = CheckAssetInputs(tx, inputs, *payload, foundAliasInput ? vvchAlias[0].ToVch() : emptyVch, fJustCheck, nHeight, revertedAssetAllocations, errorMessage);
+							if (fDebug && !errorMessage.empty())
+								LogPrintf("%s\n", errorMessage.c_str());
+						}
 					}
-					else if (DecodeOfferTx(tx, op, vvchArgs))
-					{
-						if (!foundAliasInput)
-							return true;
-						errorMessage.clear();
-						good = CheckOfferInputs(tx, op, vvchArgs, vvchAliasArgs[0], fJustCheck, nHeight, revertedOffers, errorMessage);
-						if (fDebug && !errorMessage.empty())
-							LogPrintf("%s\n", errorMessage.c_str());
-					}
-					else if (DecodeCertTx(tx, op, vvchArgs))
-					{
-						if (!foundAliasInput)
-							return true;
-						errorMessage.clear();
-						good = CheckCertInputs(tx, op, vvchArgs, vvchAliasArgs[0], fJustCheck, nHeight, revertedCerts, errorMessage);
-						if (fDebug && !errorMessage.empty())
-							LogPrintf("%s\n", errorMessage.c_str());
-					}
-					else if (DecodeEscrowTx(tx, op, vvchArgs))
-					{
-						if (!foundAliasInput)
-							return true;
-						errorMessage.clear();
-						good = CheckEscrowInputs(tx, op, vvchArgs, vvchAliasArgs, fJustCheck, nHeight, errorMessage);
-						if (fDebug && !errorMessage.empty())
-							LogPrintf("%s\n", errorMessage.c_str());
-					}
-					else if (DecodeAssetTx(tx, op, vvchArgs))
+					if (!good)
 					{
-						errorMessage.clear();
-						good = CheckAssetInputs(tx, inputs, op, vvchArgs, foundAliasInput ? vvchAliasArgs[0] : emptyVch, fJustCheck, nHeight, revertedAssetAllocations, errorMessage);
-						if (fDebug && !errorMessage.empty())
-							LogPrintf("%s\n", errorMessage.c_str());
+						break;
 					}
 				}
-				if (!good)
-				{
-					break;
-				}
 			}
 		}
+		if (!blockWrites.Commit(INT_MAX))
+			return state.DoS(0, false, REJECT_INVALID, "Failed to write billiecoin databases");
+		if (fStopped)
+			return true;
 		nFlushIndexBlocks++;
 		if ((nFlushIndexBlocks % 200) == 0 && !FlushBilliecoinDBs())
 			return state.DoS(0, false, REJECT_INVALID, "Failed to flush billiecoin databases");
@@ -792,13 +996,16 @@ static bool IsCurrentForFeeEstimation()
     return true;
 }
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+// script checks of multithreaded mempool validation, batched across transactions
+static CCheckQueue<CBatchedCheck<CScriptCheck> > mempoolcheckqueue(128);
+static CCheckQueueBatcher<CScriptCheck> mempoolcheckbatcher(&mempoolcheckqueue, MEMPOOL_SCRIPTCHECK_BATCH_SIZE);
 static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
 
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx, bool fLimitFree,
-                              bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
+                              bool* pfMissingInputs, int64_t nAcceptTime, int64_t nArrivalTime, std::list<CTransactionRef>* plTxnReplaced,
                               bool fOverrideMempoolLimit, const CAmount& nAbsurdFee,
-                              std::vector<COutPoint>& coins_to_uncache, bool fDryRun, bool bMultiThreaded)
+                              std::vector<COutPoint>& coins_to_uncache, bool fDryRun, bool bMultiThreaded, NodeId nodeid)
 {
     const CTransaction& tx = *ptx;
     const uint256 hash = tx.GetHash();
@@ -999,7 +1206,9 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 	
 
 		CTxMemPoolEntry entry(ptx, nFees, nAcceptTime, dPriority, chainActive.Height(),
-			inChainInputValue, fSpendsCoinbase, nSigOps, lp);
+			inChainInputValue, fSpendsCoinbase, nSigOps, lp, nArrivalTime);
+		if (tx.nVersion == BILLIECOIN_TX_VERSION)
+			entry.SetServicePayload(GetServicePayload(tx));
 		unsigned int nSize = entry.GetTxSize();
 
 		// Check that the transaction doesn't have an excessive number of
@@ -1268,151 +1477,97 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 		}
 		if (bMultiThreaded && threadpool != NULL)
 		{
-			// track worker thread metrics
-			static int totalWorkerCount = 0;
-			static int totalExecutionCount = 0;
-
-			static int totalCheckCount = 0;
-			static int totalCheckMicros = 0;
-
-			static int totalBilliecoinCheckCount = 0;
-			static int totalBilliecoinCheckMicros = 0;
-
-			static int concurrentExecutionCount = 0;
-			static int maxConcurrentExecutionCount = 0;
-
-			static int64_t totalExecutionMicros = 0;
-			static int64_t minExecutionMicros = 1000000000;
-			static int64_t maxExecutionMicros = 0;
-
-			// define a task for the worker to process
-			std::packaged_task<void()> task([&pool, ptx, hash, coins_to_uncache, hashCacheEntry, vChecks]() {
-				// metrics
-				int64_t time;
-				if (fLogThreadpool) {
-					time = GetTimeMicros();
-					concurrentExecutionCount += 1;
-				}
-				int thisCheckCount = 0;
-				int thisBilliecoinCheckCount = 0;
-				int thisCheckMicros = 0;
-				int thisBilliecoinCheckMicros = 0;
-				
-
+			// undo the optimistic mempool add when a deferred check fails or will never run
+			auto removeUnverified = [&pool, ptx, hash, coins_to_uncache](const char* strCheck) {
+				LOCK2(cs_main, mempool.cs);
+				LogPrint("mempool", "%s: %s\n", strCheck, hash.ToString());
+				BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
+					pcoinsTip->Uncache(hashTx);
+				pool.removeRecursive(*ptx, MemPoolRemovalReason::UNKNOWN);
+				pool.ClearPrioritisation(hash);
+				// After we've (potentially) uncached entries, ensure our coins cache is still within its size limits	
+				CValidationState stateDummy;
+				FlushStateToDisk(stateDummy, FLUSH_STATE_PERIODIC);
+			};
+			auto removeFailed = [removeUnverified](const char* strCheck) {
+				nLastMultithreadMempoolFailure = GetTime();
+				threadpool->GetMetrics().nFailures++;
+				removeUnverified(strCheck);
+			};
+			// a task dropped on shutdown leaves the transaction unverified, it must not stay in the mempool
+			CValidationExecutor::Task billiecoinDropped([removeUnverified]() {
+				removeUnverified("CheckBilliecoinInputs dropped");
+			});
+			// runs once the script checks of this transaction passed
+			CValidationExecutor::Task billiecoinTask([ptx, hashCacheEntry, removeFailed]() {
 				CValidationState validationState;
 				CCoinsViewCache coinsViewCache(pcoinsTip);
-				const CTransaction& txIn = *ptx;
-				bool isCheckPassing = true;  // optimistic in case vChecks is empty
-				for (auto &check : vChecks)
-				{
-					if (fLogThreadpool) 
-						thisCheckCount += 1;
-					isCheckPassing = check();
-					if (!isCheckPassing)
-					{
-						nLastMultithreadMempoolFailure = GetTime();
-						LOCK2(cs_main, mempool.cs);
-						LogPrint("mempool", "%s: %s\n", "CheckInputs Error", hash.ToString());
-						BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
-							pcoinsTip->Uncache(hashTx);
-						pool.removeRecursive(txIn, MemPoolRemovalReason::UNKNOWN);
-						pool.ClearPrioritisation(hash);
-						// After we've (potentially) uncached entries, ensure our coins cache is still within its size limits	
-						CValidationState stateDummy;
-						FlushStateToDisk(stateDummy, FLUSH_STATE_PERIODIC);
-						break;
-					}
-				}
-				if (fLogThreadpool) {
-					// how long did we run check()'s
-					thisCheckMicros = GetTimeMicros() - time;
-				}
-
-				if (isCheckPassing)
-				{
-					int64_t billiecoinCheckTime;
-					if (fLogThreadpool) {
-						billiecoinCheckTime = GetTimeMicros();
-						thisBilliecoinCheckCount += 1;
-					}
-					if (!CheckBilliecoinInputs(txIn, validationState, coinsViewCache, true, chainActive.Height(), CBlock()))
-					{
-						nLastMultithreadMempoolFailure = GetTime();
-						LOCK2(cs_main, mempool.cs);
-						LogPrint("mempool", "%s: %s\n", "CheckBilliecoinInputs Error", hash.ToString());
-						BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
-							pcoinsTip->Uncache(hashTx);
-						pool.removeRecursive(txIn, MemPoolRemovalReason::UNKNOWN);
-						pool.ClearPrioritisation(hash);
-						// After we've (potentially) uncached entries, ensure our coins cache is still within its size limits	
-						CValidationState stateDummy;
-						FlushStateToDisk(stateDummy, FLUSH_STATE_PERIODIC);
-					}
-					scriptExecutionCache.insert(hashCacheEntry);
-					if (fLogThreadpool) {
-						// how long did we run CheckBilliecoinInputs()'s
-						thisBilliecoinCheckMicros = GetTimeMicros() - billiecoinCheckTime;
+				const int64_t nBilliecoinCheckStart = GetTimeMicros();
+				if (!CheckBilliecoinInputs(*ptx, validationState, coinsViewCache, true, chainActive.Height(), CBlock()))
+					removeFailed("CheckBilliecoinInputs Error");
+				scriptExecutionCache.insert(hashCacheEntry);
+				threadpool->GetMetrics().billiecoinCheck.Record(GetTimeMicros() - nBilliecoinCheckStart);
+			});
+			// define a task for the worker to process, timings end up in the executor metrics (see getthreadpoolinfo)
+			// the script checks are not run here but handed to a batcher that verifies the checks of many
+			// transactions together on the mempool check queue and calls back per transaction. The
+			// script execution cache was already consulted by CheckInputs and signatures go through the
+			// signature cache as usual.
+			CValidationExecutor::Task task([nodeid, vChecks, billiecoinTask, billiecoinDropped, removeFailed]() mutable {
+				CValidationMetrics& metrics = threadpool->GetMetrics();
+				bool fFlush = mempoolcheckbatcher.Add(vChecks, [nodeid, billiecoinTask, billiecoinDropped, removeFailed](bool fOk) {
+					if (!fOk)
+						removeFailed("CheckInputs Error");
+					// hand CheckBilliecoinInputs back to the pool so it does not run serialized on the flushing thread
+					else if (!threadpool->TrySubmit(nodeid, billiecoinTask, billiecoinDropped)) {
+						try {
+							billiecoinTask();
+						} catch (const std::exception& e) {
+							PrintExceptionContinue(&e, "AcceptToMemoryPoolWorker()");
+						} catch (...) {
+							PrintExceptionContinue(NULL, "AcceptToMemoryPoolWorker()");
+						}
 					}
+				});
+				// flush when the batch is full or when no other batching task is left to flush it, other
+				// work queued behind us (like the CheckBilliecoinInputs tasks above) never flushes
+				if (fFlush) {
+					const int64_t nCheckStart = GetTimeMicros();
+					if (mempoolcheckbatcher.Flush() > 0)
+						metrics.scriptCheck.Record(GetTimeMicros() - nCheckStart);
 				}
-				if (fLogThreadpool) {
-					// metrics
-					const int64_t &thisExecutionMicros = GetTimeMicros() - time;
-					if (thisExecutionMicros < minExecutionMicros) {
-						minExecutionMicros = thisExecutionMicros;
-					}
-					if (thisExecutionMicros > maxExecutionMicros) {
-						maxExecutionMicros = thisExecutionMicros;
-					}
-					if (concurrentExecutionCount > maxConcurrentExecutionCount) {
-						maxConcurrentExecutionCount = concurrentExecutionCount;
-					}
-					totalCheckCount += thisCheckCount;
-					totalCheckMicros += thisCheckMicros;
-					totalBilliecoinCheckCount += thisBilliecoinCheckCount;
-					totalBilliecoinCheckMicros += thisBilliecoinCheckMicros;
-
-					totalExecutionMicros += thisExecutionMicros;
-
+			});
 
-					// indicate that this thread is done
-					concurrentExecutionCount -= 1;
-				}
+			CValidationExecutor::Task dropped([removeUnverified]() {
+				// the task never added its checks, flush the partial batch of those that did
+				mempoolcheckbatcher.Drop();
+				removeUnverified("CheckInputs dropped");
 			});
-			if(fLogThreadpool)
-				totalExecutionCount ++;
-			// every 100th transaction or when not in unit test mode
-			if (fLogThreadpool && totalCheckCount > 0 && totalBilliecoinCheckCount > 0 && totalExecutionCount > 0 && (!fUnitTest || (fUnitTest && totalExecutionCount % 100 == 0))) {
-				int avgCheckMicros = totalCheckMicros / totalCheckCount;
-				int avgBilliecoinCheckMicros = totalBilliecoinCheckMicros / totalBilliecoinCheckCount;
-				int avgExecutionMicros = totalExecutionMicros / totalExecutionCount;
-				const std::string &messageCounts = "THREADPOOL::%s:Signature check executions - concurrent: %d, max concurrent: %d, total calls: %d\n";
-				const std::string &messageInternals = "THREADPOOL::%s:Signature check internals - check(%d): total %lld, avg %lld microseconds, billiecoin(%d): total %lld, avg %lld microseconds\n";
-				const std::string &messageMicros = "THREADPOOL::%s:Signature check timing - avg: %lld, min: %lld, max: %lld, total: %lld microseconds\n";
-				LogPrint("threadpool", messageCounts, hash.ToString(), concurrentExecutionCount, maxConcurrentExecutionCount, totalExecutionCount);
-				LogPrint("threadpool", messageInternals, hash.ToString(), totalCheckCount, totalCheckMicros, avgCheckMicros, totalBilliecoinCheckCount, totalBilliecoinCheckMicros, avgBilliecoinCheckMicros);
-				LogPrint("threadpool", messageMicros, hash.ToString(), avgExecutionMicros, minExecutionMicros, maxExecutionMicros, totalExecutionMicros);
-			}
 
-			// retry if the threadpool queue is full and return error if we can't post
-			bool isThreadPosted = false;
-			for (int numTries = 1; numTries <= 50; numTries++)
+			// queue the task on behalf of the sending peer, the net layer stops reading from peers that are over
+			// their share (see CValidationExecutor::IsPeerPaused). We hold cs_main so never wait for queue space,
+			// when the queue is full the transaction is verified right here instead.
+			mempoolcheckbatcher.Expect();
+			if (!threadpool->TrySubmit(nodeid, task, dropped))
 			{
-				// send task to threadpool pointer from init.cpp
-				isThreadPosted = threadpool->tryPost(task);
-				if (isThreadPosted)
-				{
-					totalWorkerCount += 1;
-					if(!fUnitTest)
-						LogPrint("threadpool", "THREADPOOL::%s:Signature check task #%d added in %d tries\n", hash.ToString(), totalWorkerCount, numTries);
-					break;
+				// a task that already ran may have left its checks for us to flush
+				mempoolcheckbatcher.Drop();
+				LogPrint("threadpool", "THREADPOOL::%s: queue is full, verifying in the calling thread\n", hash.ToString());
+				CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+				control.Add(vChecks);
+				if (!control.Wait()) {
+					removeFailed("CheckInputs Error");
+					return state.DoS(0, false, REJECT_INVALID, "mandatory-script-verify-flag-failed");
 				}
-				LogPrintf("THREADPOOL::AcceptToMemoryPoolWorker: thread pool queue is full\n");
-				MilliSleep(10);
-			}
-			if (!isThreadPosted)
-			{
-				return state.DoS(0, false, REJECT_INVALID, "threadpool-full", false, "AcceptToMemoryPoolWorker: thread pool queue is full");
+				CCoinsViewCache coinsViewCache(pcoinsTip);
+				if (!CheckBilliecoinInputs(tx, state, coinsViewCache, true, chainActive.Height(), CBlock())) {
+					removeFailed("CheckBilliecoinInputs Error");
+					return false;
+				}
+				scriptExecutionCache.insert(hashCacheEntry);
 			}
+			if(!fUnitTest)
+				LogPrint("threadpool", "THREADPOOL::%s:Signature check task added for peer=%d, queue depth %u\n", hash.ToString(), nodeid, threadpool->GetQueueDepth());
 		}
 	}
 
@@ -1422,8 +1577,8 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 }
 
 bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool fLimitFree,
-                        bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
-                        bool fOverrideMempoolLimit, const CAmount nAbsurdFee, bool fDryRun, bool bMultiThreaded)
+                        bool* pfMissingInputs, int64_t nAcceptTime, int64_t nArrivalTime, std::list<CTransactionRef>* plTxnReplaced,
+                        bool fOverrideMempoolLimit, const CAmount nAbsurdFee, bool fDryRun, bool bMultiThreaded, NodeId nodeid)
 {
 	// BILLIECOIN if its been less 60 seconds since the last MT mempool verification failure then fallback to single threaded
 	if (GetTime() - nLastMultithreadMempoolFailure < 60) {
@@ -1431,7 +1586,7 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
 		bMultiThreaded = false;
 	}
     std::vector<COutPoint> coins_to_uncache;
-    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, plTxnReplaced, fOverrideMempoolLimit, nAbsurdFee, coins_to_uncache, fDryRun, bMultiThreaded);
+    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, nArrivalTime, plTxnReplaced, fOverrideMempoolLimit, nAbsurdFee, coins_to_uncache, fDryRun, bMultiThreaded, nodeid);
     if (!res || fDryRun) {
         if(!res) LogPrint("mempool", "%s: %s %s (%s)\n", __func__, tx->GetHash().ToString(), state.GetRejectReason(), state.GetDebugMessage());
         BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
@@ -1445,9 +1600,9 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
 
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool fLimitFree,
                         bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced,
-                        bool fOverrideMempoolLimit, const CAmount nAbsurdFee, bool fDryRun, bool bMultiThreaded)
+                        bool fOverrideMempoolLimit, const CAmount nAbsurdFee, bool fDryRun, bool bMultiThreaded, NodeId nodeid)
 {
-    return AcceptToMemoryPoolWithTime(pool, state, tx, fLimitFree, pfMissingInputs, GetTime(), plTxnReplaced, fOverrideMempoolLimit, nAbsurdFee, fDryRun, bMultiThreaded);
+    return AcceptToMemoryPoolWithTime(pool, state, tx, fLimitFree, pfMissingInputs, GetTime(), GetTimeMillis(), plTxnReplaced, fOverrideMempoolLimit, nAbsurdFee, fDryRun, bMultiThreaded, nodeid);
 }
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes)
 {
@@ -2183,6 +2338,7 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > aliasUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     // undo transactions in reverse order
@@ -2196,6 +2352,11 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
             for (unsigned int k = tx.vout.size(); k-- > 0;) {
                 const CTxOut &out = tx.vout[k];
 
+                // BILLIECOIN undo unspent alias index
+                CAliasUnspentKey aliasKey;
+                if (GetAliasUnspentKey(out.scriptPubKey, hash, k, aliasKey))
+                    aliasUnspentIndex.push_back(std::make_pair(aliasKey, CAddressUnspentValue()));
+
                 if (out.scriptPubKey.IsPayToScriptHash()) {
 					// BILLIECOIN
 					CScript scriptOut;
@@ -2284,6 +2445,11 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                 if (fAddressIndex) {
                     const Coin &coin = view.AccessCoin(tx.vin[j].prevout);
                     const CTxOut &prevout = coin.out;
+
+                    // BILLIECOIN restore unspent alias index
+                    CAliasUnspentKey aliasKey;
+                    if (GetAliasUnspentKey(prevout.scriptPubKey, input.prevout.hash, input.prevout.n, aliasKey))
+                        aliasUnspentIndex.push_back(std::make_pair(aliasKey, CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
                     if (prevout.scriptPubKey.IsPayToScriptHash()) {
 						// BILLIECOIN
 						CScript scriptOut;
@@ -2351,6 +2517,10 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
             AbortNode(state, "Failed to write address unspent index");
             return DISCONNECT_FAILED;
         }
+        if (!pblocktree->UpdateAliasUnspentIndex(aliasUnspentIndex)) {
+            AbortNode(state, "Failed to write alias unspent index");
+            return DISCONNECT_FAILED;
+        }
     }
 
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
@@ -2387,6 +2557,16 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+void ThreadMempoolScriptCheck() {
+    RenameThread("billiecoin-mpscriptch");
+    mempoolcheckqueue.Thread();
+}
+
+void ThreadServiceCheck() {
+    RenameThread("billiecoin-svccheck");
+    servicecheckqueue.Thread();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2540,6 +2720,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CAliasUnspentKey, CAddressUnspentValue> > aliasUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     bool fDIP0001Active_context = pindex->nHeight >= Params().GetConsensus().DIP0001Height;
@@ -2633,6 +2814,11 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                         // and to find the amount and address from an input
                         spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
                     }
+
+                    // BILLIECOIN remove alias output from unspent alias index
+                    CAliasUnspentKey aliasKey;
+                    if (fAddressIndex && GetAliasUnspentKey(prevout.scriptPubKey, input.prevout.hash, input.prevout.n, aliasKey))
+                        aliasUnspentIndex.push_back(std::make_pair(aliasKey, CAddressUnspentValue()));
                 }
 
             }
@@ -2660,6 +2846,11 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             for (unsigned int k = 0; k < tx.vout.size(); k++) {
                 const CTxOut &out = tx.vout[k];
 
+                // BILLIECOIN record unspent alias output
+                CAliasUnspentKey aliasKey;
+                if (GetAliasUnspentKey(out.scriptPubKey, txhash, k, aliasKey))
+                    aliasUnspentIndex.push_back(std::make_pair(aliasKey, CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
+
                 if (out.scriptPubKey.IsPayToScriptHash()) {
 					// BILLIECOIN
 					CScript scriptOut;
@@ -2792,6 +2983,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             return AbortNode(state, "Failed to write address unspent index");
         }
+
+        if (!pblocktree->UpdateAliasUnspentIndex(aliasUnspentIndex)) {
+            return AbortNode(state, "Failed to write alias unspent index");
+        }
     }
 
     if (fSpentIndex)
@@ -4432,6 +4627,12 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Index the alias outputs of an address index that predates the alias unspent index
+    bool fAliasUnspentIndex = false;
+    pblocktree->ReadFlag("aliasunspentindex", fAliasUnspentIndex);
+    if (fAddressIndex && !fAliasUnspentIndex && !pblocktree->BuildAliasUnspentIndex())
+        return error("%s: failed to build alias unspent index", __func__);
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
@@ -4628,6 +4829,7 @@ bool InitBlockIndex(const CChainParams& chainparams)
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("aliasunspentindex", fAddressIndex);
 
     // Use the provided setting for -timestampindex in the new database
     fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
@@ -5023,7 +5225,7 @@ bool LoadMempool(void)
             CValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(mempool, state, tx, true, NULL, nTime);
+                AcceptToMemoryPoolWithTime(mempool, state, tx, true, NULL, nTime, nTime * 1000);
                 if (state.IsValid()) {
                     ++count;
                 } else {
@@ -21,7 +21,7 @@
 #include "versionbits.h"
 #include "spentindex.h"
 
-#include "thread_pool/thread_pool.hpp"
+#include "validationexecutor.h"
 
 #include <algorithm>
 #include <exception>
@@ -87,6 +87,8 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Number of script checks collected from multithreaded mempool validation before they are verified together */
+static const unsigned int MEMPOOL_SCRIPTCHECK_BATCH_SIZE = 256;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -170,7 +172,6 @@ extern std::atomic_bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
-extern bool fLogThreadpool;
 extern bool fAddressIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
@@ -277,6 +278,10 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the script checking thread for batched mempool checks */
+void ThreadMempoolScriptCheck();
+/** Run an instance of the thread connecting independent service transactions of a block */
+void ThreadServiceCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -338,11 +343,11 @@ typedef int64_t NodeId;
  * plTxnReplaced will be appended to with all transactions replaced from mempool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool fLimitFree,
 	bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced = NULL, bool fOverrideMempoolLimit = false,
-	const CAmount nAbsurdFee = 0, bool fDryRun = false, bool bMultiThreaded = false);
-/** (try to) add transaction to memory pool with a specified acceptance time **/
+	const CAmount nAbsurdFee = 0, bool fDryRun = false, bool bMultiThreaded = false, NodeId nodeid = THREADPOOL_LOCAL_NODE);
+/** (try to) add transaction to memory pool with a specified acceptance time, and arrival time in milliseconds **/
 bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool fLimitFree,
-                        bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced = NULL,
-                        bool fOverrideMempoolLimit=false, const CAmount nAbsurdFee=0, bool fDryRun=false, bool bMultiThreaded = false);
+                        bool* pfMissingInputs, int64_t nAcceptTime, int64_t nArrivalTime, std::list<CTransactionRef>* plTxnReplaced = NULL,
+                        bool fOverrideMempoolLimit=false, const CAmount nAbsurdFee=0, bool fDryRun=false, bool bMultiThreaded = false, NodeId nodeid = THREADPOOL_LOCAL_NODE);
 // BILLIECOIN
 inline CBlockIndex* LookupBlockIndex(const uint256& hash)
 {
@@ -553,7 +558,8 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
-extern tp::ThreadPool* threadpool;
+/** Executor for the deferred signature and service checks of multithreaded mempool acceptance */
+extern CValidationExecutor* threadpool;
 extern std::vector<std::pair<uint256, int64_t> > vecTPSTestReceivedTimesMempool;
 extern int64_t nTPSTestingStartTime;
 /**
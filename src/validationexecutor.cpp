@@ -0,0 +1,213 @@
+// Copyright (c) 2017-2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "validationexecutor.h"
+
+#include "util.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <chrono>
+
+int CLatencyHistogram::BucketIndex(int64_t nMicros)
+{
+    if (nMicros < 16)
+        return nMicros < 0 ? 0 : (int)nMicros;
+    int nBit = 63;
+    while (!((uint64_t)nMicros >> nBit))
+        nBit--;
+    return 16 + (nBit - 4) * 4 + (int)(((uint64_t)nMicros >> (nBit - 2)) & 3);
+}
+
+int64_t CLatencyHistogram::BucketUpperBound(int nIndex)
+{
+    if (nIndex < 16)
+        return nIndex;
+    const int nBit = (nIndex - 16) / 4 + 4;
+    const int64_t nSub = (nIndex - 16) % 4;
+    return (int64_t)((((uint64_t)(4 + nSub + 1)) << (nBit - 2)) - 1);
+}
+
+void CLatencyHistogram::Record(int64_t nMicros)
+{
+    if (nMicros < 0)
+        nMicros = 0;
+    vBuckets[BucketIndex(nMicros)].fetch_add(1, std::memory_order_relaxed);
+    nCount.fetch_add(1, std::memory_order_relaxed);
+    nTotal.fetch_add(nMicros, std::memory_order_relaxed);
+    int64_t nPrevMax = nMax.load(std::memory_order_relaxed);
+    while (nMicros > nPrevMax && !nMax.compare_exchange_weak(nPrevMax, nMicros, std::memory_order_relaxed)) {}
+}
+
+void CLatencyHistogram::Reset()
+{
+    for (auto& bucket : vBuckets)
+        bucket.store(0, std::memory_order_relaxed);
+    nCount.store(0, std::memory_order_relaxed);
+    nTotal.store(0, std::memory_order_relaxed);
+    nMax.store(0, std::memory_order_relaxed);
+}
+
+int64_t CLatencyHistogram::GetPercentile(double dPercentile) const
+{
+    // buckets are read one by one while writers keep going, so sum them here rather than trusting nCount
+    uint64_t vSnapshot[BUCKETS];
+    uint64_t nSnapshotCount = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        vSnapshot[i] = vBuckets[i].load(std::memory_order_relaxed);
+        nSnapshotCount += vSnapshot[i];
+    }
+    if (nSnapshotCount == 0)
+        return 0;
+    const uint64_t nRank = std::max<uint64_t>(1, (uint64_t)(dPercentile / 100.0 * nSnapshotCount + 0.5));
+    uint64_t nSeen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        nSeen += vSnapshot[i];
+        if (nSeen >= nRank)
+            return std::min(BucketUpperBound(i), GetMax());
+    }
+    return GetMax();
+}
+
+CValidationExecutor::CValidationExecutor(int nThreads, int nMaxDepthIn) : nQueued(0), fStop(false)
+{
+    if (nThreads <= 0)
+        nThreads = std::max<int>(1, (int)std::thread::hardware_concurrency() - 1);
+    nMaxDepth = std::max<int>(1, nMaxDepthIn);
+    vThreads.reserve(nThreads);
+    for (int i = 0; i < nThreads; i++)
+        vThreads.emplace_back(&CValidationExecutor::ThreadWorker, this);
+}
+
+CValidationExecutor::~CValidationExecutor()
+{
+    Stop();
+}
+
+void CValidationExecutor::Stop()
+{
+    std::vector<Task> vDropped;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (fStop && vThreads.empty())
+            return;
+        fStop = true;
+        for (auto& entry : mapQueues) {
+            for (QueuedTask& queued : entry.second) {
+                if (queued.dropped)
+                    vDropped.push_back(std::move(queued.dropped));
+            }
+        }
+        mapQueues.clear();
+        queueRoundRobin.clear();
+        nQueued = 0;
+    }
+    condWork.notify_all();
+    condSpace.notify_all();
+    for (auto& thread : vThreads)
+        thread.join();
+    vThreads.clear();
+    // run the handlers once no worker is left, they may submit again and see the executor stopped
+    for (Task& dropped : vDropped) {
+        try {
+            dropped();
+        } catch (const std::exception& e) {
+            PrintExceptionContinue(&e, "CValidationExecutor::Stop()");
+        } catch (...) {
+            PrintExceptionContinue(NULL, "CValidationExecutor::Stop()");
+        }
+    }
+}
+
+bool CValidationExecutor::Submit(NodeId nodeid, const Task& task, int64_t nTimeoutMillis, const Task& dropped)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (nQueued >= nMaxDepth) {
+        if (nTimeoutMillis <= 0) {
+            metrics.nRejected++;
+            return false;
+        }
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(nTimeoutMillis);
+        if (!condSpace.wait_until(lock, deadline, [this] { return fStop || nQueued < nMaxDepth; })) {
+            metrics.nRejected++;
+            return false;
+        }
+    }
+    if (fStop)
+        return false;
+    std::deque<QueuedTask>& queue = mapQueues[nodeid];
+    if (queue.empty())
+        queueRoundRobin.push_back(nodeid);
+    queue.push_back(QueuedTask{task, dropped, GetTimeMicros()});
+    nQueued++;
+    lock.unlock();
+    condWork.notify_one();
+    return true;
+}
+
+size_t CValidationExecutor::PeerShare() const
+{
+    return std::max<size_t>(1, nMaxDepth / std::max<size_t>(1, mapQueues.size()));
+}
+
+bool CValidationExecutor::IsPeerPaused(NodeId nodeid) const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (nQueued >= nMaxDepth)
+        return true;
+    auto it = mapQueues.find(nodeid);
+    return it != mapQueues.end() && it->second.size() >= PeerShare();
+}
+
+size_t CValidationExecutor::GetQueueDepth() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return nQueued;
+}
+
+size_t CValidationExecutor::GetPeerCount() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return mapQueues.size();
+}
+
+void CValidationExecutor::ThreadWorker()
+{
+    RenameThread("billiecoin-txvalidation");
+    while (true) {
+        QueuedTask queued;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condWork.wait(lock, [this] { return fStop || nQueued > 0; });
+            if (fStop)
+                return;
+            // serve the peer at the front and move it to the back if it still has work
+            const NodeId nodeid = queueRoundRobin.front();
+            queueRoundRobin.pop_front();
+            auto it = mapQueues.find(nodeid);
+            queued = std::move(it->second.front());
+            it->second.pop_front();
+            if (it->second.empty())
+                mapQueues.erase(it);
+            else
+                queueRoundRobin.push_back(nodeid);
+            nQueued--;
+        }
+        condSpace.notify_one();
+        const int64_t nStart = GetTimeMicros();
+        metrics.queueWait.Record(nStart - queued.nQueuedMicros);
+        const int nRunning = ++metrics.nRunning;
+        int nPrevMax = metrics.nMaxRunning.load();
+        while (nRunning > nPrevMax && !metrics.nMaxRunning.compare_exchange_weak(nPrevMax, nRunning)) {}
+        try {
+            queued.task();
+        } catch (const std::exception& e) {
+            PrintExceptionContinue(&e, "CValidationExecutor::ThreadWorker()");
+        } catch (...) {
+            PrintExceptionContinue(NULL, "CValidationExecutor::ThreadWorker()");
+        }
+        metrics.nRunning--;
+        metrics.execution.Record(GetTimeMicros() - nStart);
+    }
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2017-2020 The Billiecoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BILLIECOIN_VALIDATIONEXECUTOR_H
+#define BILLIECOIN_VALIDATIONEXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+typedef int64_t NodeId;
+
+/** Default for -threadpoolsize, 0 means one worker per core less one */
+static const int DEFAULT_THREADPOOL_SIZE = 0;
+/** Default for -threadpoolqueue, maximum number of queued validation tasks */
+static const int DEFAULT_THREADPOOL_QUEUE = 1024;
+/** How long a submitter waits for queue space before giving up, in milliseconds */
+static const int64_t THREADPOOL_SUBMIT_TIMEOUT = 500;
+/** Node id used for work that does not come from a peer (RPC, tests) */
+static const NodeId THREADPOOL_LOCAL_NODE = -1;
+
+/**
+ * Lock-free latency histogram in microseconds.
+ *
+ * Values below 16 get a bucket each, larger values are bucketed by their highest
+ * set bit with four sub-buckets per power of two, so percentiles are reported with
+ * at most 25% error. Record() may be called from any thread.
+ */
+class CLatencyHistogram
+{
+public:
+    static const int BUCKETS = 256;
+
+    CLatencyHistogram() { Reset(); }
+
+    void Record(int64_t nMicros);
+    void Reset();
+
+    uint64_t GetCount() const { return nCount.load(std::memory_order_relaxed); }
+    int64_t GetTotal() const { return nTotal.load(std::memory_order_relaxed); }
+    int64_t GetMax() const { return nMax.load(std::memory_order_relaxed); }
+    /** Upper bound of the bucket holding the given percentile (0-100), 0 when empty */
+    int64_t GetPercentile(double dPercentile) const;
+
+private:
+    static int BucketIndex(int64_t nMicros);
+    static int64_t BucketUpperBound(int nIndex);
+
+    std::atomic<uint64_t> vBuckets[BUCKETS];
+    std::atomic<uint64_t> nCount;
+    std::atomic<int64_t> nTotal;
+    std::atomic<int64_t> nMax;
+};
+
+/** Timings and counters of the multithreaded mempool path, see getthreadpoolinfo */
+struct CValidationMetrics
+{
+    /** Time a task sat in the queue before a worker picked it up */
+    CLatencyHistogram queueWait;
+    /** Time spent verifying one batch of CScriptChecks, see CCheckQueueBatcher */
+    CLatencyHistogram scriptCheck;
+    /** Time spent in CheckBilliecoinInputs */
+    CLatencyHistogram billiecoinCheck;
+    /** Time spent running the whole task */
+    CLatencyHistogram execution;
+    std::atomic<int> nRunning;
+    std::atomic<int> nMaxRunning;
+    std::atomic<uint64_t> nFailures;
+    std::atomic<uint64_t> nRejected;
+
+    CValidationMetrics() : nRunning(0), nMaxRunning(0), nFailures(0), nRejected(0) {}
+};
+
+/**
+ * Bounded executor for deferred mempool validation work.
+ *
+ * Tasks are queued per submitting peer and workers take them round robin across
+ * peers, so one peer flooding transactions cannot starve the others. Submitting to
+ * a full queue blocks until space frees up or the deadline passes, callers holding
+ * cs_main must use TrySubmit() instead. A peer whose queue holds more than its
+ * share is reported through IsPeerPaused() so the net layer can stop reading from
+ * its socket until the workers catch up. Tasks still queued when the executor
+ * stops do not run, their drop handler is called instead.
+ */
+class CValidationExecutor
+{
+public:
+    typedef std::function<void()> Task;
+
+    CValidationExecutor(int nThreads, int nMaxDepth);
+    ~CValidationExecutor();
+
+    /**
+     * Queue a task on behalf of a peer, waiting up to nTimeoutMillis for space. Returns false if it could not
+     * be queued. If the executor stops before the task ran, dropped is called from Stop() instead.
+     */
+    bool Submit(NodeId nodeid, const Task& task, int64_t nTimeoutMillis = THREADPOOL_SUBMIT_TIMEOUT, const Task& dropped = Task());
+    /** Queue a task only if there is space right now */
+    bool TrySubmit(NodeId nodeid, const Task& task, const Task& dropped = Task()) { return Submit(nodeid, task, 0, dropped); }
+    /** Whether the net layer should hold off reading from this peer */
+    bool IsPeerPaused(NodeId nodeid) const;
+    /** Stop the workers, queued tasks that have not started are dropped and their drop handlers run */
+    void Stop();
+
+    size_t GetThreadCount() const { return vThreads.size(); }
+    size_t GetMaxDepth() const { return nMaxDepth; }
+    size_t GetQueueDepth() const;
+    size_t GetPeerCount() const;
+    CValidationMetrics& GetMetrics() { return metrics; }
+
+private:
+    struct QueuedTask
+    {
+        Task task;
+        Task dropped;
+        int64_t nQueuedMicros;
+    };
+
+    void ThreadWorker();
+    size_t PeerShare() const;
+
+    mutable std::mutex mutex;
+    std::condition_variable condWork;
+    std::condition_variable condSpace;
+    std::map<NodeId, std::deque<QueuedTask> > mapQueues;
+    // peers with queued work in the order they will be served
+    std::deque<NodeId> queueRoundRobin;
+    size_t nQueued;
+    size_t nMaxDepth;
+    bool fStop;
+    std::vector<std::thread> vThreads;
+    CValidationMetrics metrics;
+};
+
+#endif // BILLIECOIN_VALIDATIONEXECUTOR_H
@@ -16,6 +16,7 @@ class CBlockIndex;
 struct CBlockLocator;
 class CConnman;
 class CReserveScript;
+struct CServiceEvent;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
@@ -37,7 +38,7 @@ protected:
     virtual void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) {}
     virtual void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock) {}
     virtual void NotifyTransactionLock(const CTransaction &tx) {}
-	virtual void NotifyBilliecoinUpdate(const char *value, const char *topic) {}
+	virtual void NotifyBilliecoinUpdate(const CServiceEvent &event) {}
     virtual void SetBestChain(const CBlockLocator &locator) {}
     virtual bool UpdatedTransaction(const uint256 &hash) { return false;}
     virtual void Inventory(const uint256 &hash) {}
@@ -71,7 +72,7 @@ struct CMainSignals {
     /** Notifies listeners of an updated transaction lock without new data. */
     boost::signals2::signal<void (const CTransaction &)> NotifyTransactionLock;
 	/** Notifies listeners of an updated billiecoin payload with a topic. */
-	boost::signals2::signal<void(const char *value, const char *topic)> NotifyBilliecoinUpdate;
+	boost::signals2::signal<void(const CServiceEvent &event)> NotifyBilliecoinUpdate;
     /** Notifies listeners of an updated transaction without new data (for now: a coinbase potentially becoming visible). */
     boost::signals2::signal<bool (const uint256 &)> UpdatedTransaction;
     /** Notifies listeners of a new active block chain. */
@@ -36,11 +36,11 @@ using namespace std;
 #include "escrow.h"
 #include "assetallocation.h"
 #include "asset.h"
+#include "servicepayload.h"
 #include "coincontrol.h"
 extern bool GetAddressFromAlias(const std::string& strAlias, std::string& strAddress, std::vector<unsigned char> &vchPubKey);
 extern std::string stringFromVch(const std::vector<unsigned char> &vch);
 extern bool IsBilliecoinScript(const CScript& scriptPubKey, int &op, vector<vector<unsigned char> > &vvchArgs);
-extern string GetBilliecoinTransactionDescription(const CTransaction& tx, const int op, string& responseEnglish, const char &type, string& responseGUID);
 int64_t nWalletUnlockTime;
 static CCriticalSection cs_nWalletUnlockTime;
 
@@ -1433,7 +1433,6 @@ void ListTransactions(const CWalletTx& wtx, const std::string& strAccount, int n
     bool involvesWatchonly = wtx.IsFromMe(ISMINE_WATCH_ONLY);
 	// BILLIECOIN
 	map<uint256, bool> mapSysTx = map<uint256, bool>();
-	vector<vector<unsigned char> > vvchArgs;
 	int op;
 	string strResponse = "";
 	char type;
@@ -1459,7 +1458,8 @@ void ListTransactions(const CWalletTx& wtx, const std::string& strAccount, int n
             entry.push_back(Pair("abandoned", wtx.isAbandoned()));
 			// BILLIECOIN
 			const CTransaction& tx = *wtx.tx;
-			if (tx.nVersion == BILLIECOIN_TX_VERSION && DecodeAndParseBilliecoinTx(tx, op, vvchArgs, type))
+			const CServicePayloadRef payload = tx.nVersion == BILLIECOIN_TX_VERSION ? GetServicePayload(tx) : CServicePayloadRef();
+			if (payload && payload->GetParsedType(op, type))
 			{
 				int aliasOp;
 				vector<vector<unsigned char> > aliasVvch;
@@ -1470,7 +1470,7 @@ void ListTransactions(const CWalletTx& wtx, const std::string& strAccount, int n
 				mapSysTx[tx.GetHash()] = true;
 				string strResponseEnglish = "";
 				string strResponseGUID = "";
-				strResponse = GetBilliecoinTransactionDescription(tx, op, strResponseEnglish, type, strResponseGUID);
+				strResponse = GetBilliecoinTransactionDescription(*payload, op, strResponseEnglish, type, strResponseGUID);
 				
 				if (op == OP_ASSET_ALLOCATION_SEND || op == OP_ASSET_SEND) {
 					for (auto& vin : tx.vin) {
@@ -1480,8 +1480,8 @@ void ListTransactions(const CWalletTx& wtx, const std::string& strAccount, int n
 						}
 					}
 
-					CAssetAllocation assetallocation(tx);
-					if (!assetallocation.IsNull()) {
+					if (payload->assetAllocation) {
+						const CAssetAllocation &assetallocation = *payload->assetAllocation;
                         const string& aliasOrAddress = stringFromVch(assetallocation.vchAliasOrAddress);
                         CCoinsViewCache inputs(pcoinsTip);
                         if(!aliasVvch.empty())
@@ -1566,7 +1566,8 @@ void ListTransactions(const CWalletTx& wtx, const std::string& strAccount, int n
                     WalletTxToJSON(wtx, entry);
 				// BILLIECOIN
 				const CTransaction& tx = *wtx.tx;
-				if (tx.nVersion == BILLIECOIN_TX_VERSION && DecodeAndParseBilliecoinTx(tx, op, vvchArgs, type))
+				const CServicePayloadRef payload = tx.nVersion == BILLIECOIN_TX_VERSION ? GetServicePayload(tx) : CServicePayloadRef();
+				if (payload && payload->GetParsedType(op, type))
 				{
 					int aliasOp;
 					vector<vector<unsigned char> > aliasVvch;
@@ -1577,7 +1578,7 @@ void ListTransactions(const CWalletTx& wtx, const std::string& strAccount, int n
 					mapSysTx[tx.GetHash()] = true;
 					string strResponseEnglish = "";
 					string strResponseGUID = "";
-					strResponse = GetBilliecoinTransactionDescription(tx, op, strResponseEnglish, type, strResponseGUID);
+					strResponse = GetBilliecoinTransactionDescription(*payload, op, strResponseEnglish, type, strResponseGUID);
 					entry.push_back(Pair("systx", strResponse));
 					entry.push_back(Pair("systype", strResponseEnglish));
 					entry.push_back(Pair("sysguid", strResponseGUID));
@@ -1589,8 +1590,8 @@ void ListTransactions(const CWalletTx& wtx, const std::string& strAccount, int n
 							}
 						}
 
-						CAssetAllocation assetallocation(tx);
-						if (!assetallocation.IsNull()) {
+						if (payload->assetAllocation) {
+							const CAssetAllocation &assetallocation = *payload->assetAllocation;
                             CCoinsViewCache inputs(pcoinsTip);
                             const string& aliasOrAddress = stringFromVch(assetallocation.vchAliasOrAddress);
                             if(!aliasVvch.empty())
@@ -25,7 +25,7 @@ bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transacti
 {
     return true;
 }
-bool CZMQAbstractNotifier::NotifyBilliecoinUpdate(const char *, const char *)
+bool CZMQAbstractNotifier::NotifyBilliecoinUpdate(const CServiceEvent &/*event*/)
 {
 	return true;
 }
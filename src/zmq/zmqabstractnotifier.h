@@ -9,6 +9,7 @@
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
+struct CServiceEvent;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
@@ -35,7 +36,7 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
-	virtual bool NotifyBilliecoinUpdate(const char *, const char *);
+	virtual bool NotifyBilliecoinUpdate(const CServiceEvent &event);
 
 protected:
     void *psocket;
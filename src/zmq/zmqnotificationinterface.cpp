@@ -9,6 +9,7 @@
 #include "validation.h"
 #include "streams.h"
 #include "util.h"
+#include "serviceevent.h"
 
 void zmqError(const char *str)
 {
@@ -125,6 +126,7 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
+    LOCK(cs);
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -144,6 +146,8 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, co
     if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
         return;
 
+    LOCK(cs);
+
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
@@ -161,6 +165,7 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, co
 
 void CZMQNotificationInterface::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
 {
+    LOCK(cs);
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
@@ -178,6 +183,7 @@ void CZMQNotificationInterface::SyncTransaction(const CTransaction& tx, const CB
 
 void CZMQNotificationInterface::NotifyTransactionLock(const CTransaction &tx)
 {
+    LOCK(cs);
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
@@ -192,21 +198,20 @@ void CZMQNotificationInterface::NotifyTransactionLock(const CTransaction &tx)
         }
     }
 }
-void CZMQNotificationInterface::NotifyBilliecoinUpdate(const char *value, const char *topic)
+void CZMQNotificationInterface::NotifyBilliecoinUpdate(const CServiceEvent &event)
 {
-
+	LOCK(cs);
 	for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); )
 	{
 		CZMQAbstractNotifier *notifier = *i;
-		std::string strTopic(topic);
 
 		// look for topic in notifier list, if finds it, sends an update
-		if (notifier->GetType() != "pub" + strTopic) {
+		if (notifier->GetType() != "pub" + event.strTopic) {
 			i++;
 			continue;
 		}
 
-		if (notifier->NotifyBilliecoinUpdate(value, topic))
+		if (notifier->NotifyBilliecoinUpdate(event))
 		{
 			i++;
 		}
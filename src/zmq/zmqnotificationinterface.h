@@ -5,6 +5,7 @@
 #ifndef BILLIECOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BILLIECOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include "sync.h"
 #include "validationinterface.h"
 #include <string>
 #include <map>
@@ -27,12 +28,14 @@ protected:
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
     void NotifyTransactionLock(const CTransaction &tx) override;
-	void NotifyBilliecoinUpdate(const char *value, const char *topic) override;
+	void NotifyBilliecoinUpdate(const CServiceEvent &event) override;
 
 private:
     CZMQNotificationInterface();
 
     void *pcontext;
+    //! guards notifiers, service events are published from their own thread
+    CCriticalSection cs;
     std::list<CZMQAbstractNotifier*> notifiers;
 };
 
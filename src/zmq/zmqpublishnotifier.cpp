@@ -3,12 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "serviceevent.h"
 #include "streams.h"
 #include "zmqpublishnotifier.h"
 #include "validation.h"
 #include "util.h"
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
+static CCriticalSection cs_send;
 
 static const char *MSG_HASHBLOCK  = "hashblock";
 static const char *MSG_HASHTX     = "hashtx";
@@ -126,15 +128,22 @@ void CZMQAbstractPublishNotifier::Shutdown()
     psocket = 0;
 }
 
-bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size, uint32_t nSequenceIn)
 {
     assert(psocket);
 
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
+    WriteLE32(&msgseq[0], nSequenceIn);
+    /* notifiers of the same address share a socket, service events are sent from their own thread */
+    LOCK(cs_send);
     int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
-    if (rc == -1)
+    return rc != -1;
+}
+
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
+{
+    if (!SendMessage(command, data, size, nSequence))
         return false;
 
     /* increment memory only sequence number after sending */
@@ -211,8 +220,8 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     ss << transaction;
     return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
-bool CZMQPublishRawBilliecoinNotifier::NotifyBilliecoinUpdate(const char * value, const char * topic)
+bool CZMQPublishRawBilliecoinNotifier::NotifyBilliecoinUpdate(const CServiceEvent &event)
 {
-	LogPrint("zmq", "zmq: Publish raw billiecoin payload for topic %s: %s\n", topic, value);
-	return SendMessage(topic, value, strlen(value));
+	LogPrint("zmq", "zmq: Publish raw billiecoin payload for topic %s: %u\n", event.strTopic, event.nSequence);
+	return SendMessage(event.strTopic.c_str(), event.vchPayload.data(), event.vchPayload.size(), event.nSequence);
 }
@@ -14,6 +14,10 @@ class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 private:
     uint32_t nSequence; //!< upcounting per message sequence number
 
+protected:
+    //! send the message with the given sequence number
+    bool SendMessage(const char *command, const void* data, size_t size, uint32_t nSequenceIn);
+
 public:
 
     /* send zmq multipart message
@@ -66,6 +70,6 @@ public:
 class CZMQPublishRawBilliecoinNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-	bool NotifyBilliecoinUpdate(const char *value, const char *topic) override;
+	bool NotifyBilliecoinUpdate(const CServiceEvent &event) override;
 };
 #endif // BILLIECOIN_ZMQ_ZMQPUBLISHNOTIFIER_H